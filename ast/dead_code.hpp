@@ -0,0 +1,471 @@
+#pragma once
+#include <cstring>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/* Dead code elimination over the generated code, before it is written out.
+ * The code generators emit one C statement per line (a few span several lines: array initialisers, switch
+ * tables and the two line if/goto), so each function is split into instructions and the pass repeats,
+ * until nothing changes:
+ *  - instructions after return, goto, throw, break or continue are unreachable up to the next label
+ *  - a goto to the label straight after it is dropped
+ *  - labels that no goto names are dropped
+ *  - registers that are never read are dropped when the expression that defines them has no side effects, and
+ *    otherwise the definition is kept as an expression statement, so the C compiler has no unused locals to report
+ * Braces that open and close C scopes are kept so the output stays balanced.
+ */
+class DeadCodeElimination {
+private:
+	// the lowering of generators reads generated code with the same helpers
+	friend class ResumableFunction;
+
+	enum InstructionKind {
+		instructionOther,
+		instructionTerminator,
+		instructionLabel,
+		instructionScopeOpen,
+		instructionScopeClose,
+		instructionComment
+	};
+
+	struct Instruction {
+		vector<string> lines;
+		InstructionKind kind;
+		string name;      // label name, or the register a definition writes
+		string text;      // all lines joined, for searching
+		bool removed;
+	};
+
+	size_t unreachableRemoved;
+	size_t registersRemoved;
+	size_t labelsRemoved;
+	size_t jumpsRemoved;
+
+	static string trim(const string& line) {
+		size_t begin = line.find_first_not_of(" \t");
+		if (begin == string::npos) {
+			return "";
+		}
+		return line.substr(begin, line.find_last_not_of(" \t") + 1 - begin);
+	}
+
+	static bool startsWith(const string& text, const char* prefix) {
+		return text.compare(0, strlen(prefix), prefix) == 0;
+	}
+
+	static bool isIdentifierChar(char c) {
+		return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+	}
+
+	/* Open minus close braces on a line, outside string and character literals */
+	static int braceBalance(const string& line) {
+		int balance = 0;
+		char quote = 0;
+		for (size_t i = 0; i < line.size(); i++) {
+			char c = line[i];
+			if (quote != 0) {
+				if (c == '\\') {
+					i++;
+				} else if (c == quote) {
+					quote = 0;
+				}
+			} else if (c == '"' || c == '\'') {
+				quote = c;
+			} else if (c == '/' && i + 1 < line.size() && line[i + 1] == '/') {
+				break;
+			} else if (c == '{') {
+				balance++;
+			} else if (c == '}') {
+				balance--;
+			}
+		}
+		return balance;
+	}
+
+	/* The register a line such as "ESValue* r4 = ..." or "int r5_elements[] = {" defines, or "" */
+	static string definedRegister(const string& statement) {
+		const char* types[] = {"ESValue* ", "bool ", "int ", "double ", "unsigned char ", NULL};
+		for (int i = 0; types[i] != NULL; i++) {
+			if (startsWith(statement, types[i])) {
+				size_t begin = strlen(types[i]);
+				size_t end = begin;
+				while (end < statement.size() && isIdentifierChar(statement[end])) {
+					end++;
+				}
+				string name = statement.substr(begin, end - begin);
+				size_t assignment = statement.find('=', end);
+				if (name.size() > 1 && name[0] == 'r' && assignment != string::npos
+						&& statement.find_first_not_of(" []", end) == assignment) {
+					return name;
+				}
+			}
+		}
+		return "";
+	}
+
+	/* Every register token (r12, r12_elements, ...) in text, with how often it appears */
+	static void countRegisters(const string& text, map<string, int>& counts) {
+		char quote = 0;
+		for (size_t i = 0; i < text.size(); i++) {
+			char c = text[i];
+			if (quote != 0) {
+				if (c == '\\') {
+					i++;
+				} else if (c == quote) {
+					quote = 0;
+				}
+				continue;
+			}
+			if (c == '"' || c == '\'') {
+				quote = c;
+			} else if (c == 'r' && (i == 0 || !isIdentifierChar(text[i - 1])) && i + 1 < text.size()
+					&& text[i + 1] >= '0' && text[i + 1] <= '9') {
+				size_t end = i + 1;
+				while (end < text.size() && isIdentifierChar(text[end])) {
+					end++;
+				}
+				counts[text.substr(i, end - i)]++;
+				i = end - 1;
+			}
+		}
+	}
+
+	/* The function, constructor or method a call at the "(" at position open refers to, as written */
+	static string callee(const string& text, size_t open) {
+		size_t end = open;
+		while (end > 0 && text[end - 1] == ' ') {
+			end--;
+		}
+		size_t begin = end;
+		if (begin > 0 && text[begin - 1] == '>') {
+			int depth = 0;
+			while (begin > 0) {
+				begin--;
+				if (text[begin] == '>') {
+					depth++;
+				} else if (text[begin] == '<' && --depth == 0) {
+					break;
+				}
+			}
+		}
+		while (begin > 0 && (isIdentifierChar(text[begin - 1]) || text[begin - 1] == ':')) {
+			begin--;
+		}
+		string name = text.substr(begin, end - begin);
+		if (begin >= 4 && text.compare(begin - 4, 4, "new ") == 0) {
+			return "new " + name;
+		}
+		if (begin >= 1 && text[begin - 1] == '.') {
+			return "." + name;
+		}
+		return name;
+	}
+
+	/* Whether evaluating the initialiser of a definition can be skipped: it only allocates values, loads
+	 * variables or does arithmetic on operands the compiler knew were Numbers or Strings
+	 */
+	static bool isPure(const string& text) {
+		static const char* pureCallees[] = {
+			"", "new Number", "new String", "new Reference", "new Boolean", "new Undefined", "new Null", "new NaN",
+			"new ESArray", "Core::getValue", "TypeOps::toBoolean", ".getValue", NULL
+		};
+		static const char* arithmetic[] = {
+			"Core::plus<", "Core::subtract<", "Core::multiply<", "Core::divide<", "Core::modulo<", NULL
+		};
+		size_t initialiser = text.find('=');
+		char quote = 0;
+		for (size_t i = initialiser + 1; i < text.size(); i++) {
+			char c = text[i];
+			if (quote != 0) {
+				if (c == '\\') {
+					i++;
+				} else if (c == quote) {
+					quote = 0;
+				}
+				continue;
+			}
+			if (c == '"' || c == '\'') {
+				quote = c;
+				continue;
+			}
+			if (c != '(') {
+				continue;
+			}
+			string name = callee(text, i);
+			bool pure = false;
+			for (int k = 0; pureCallees[k] != NULL && !pure; k++) {
+				pure = name == pureCallees[k];
+			}
+			for (int k = 0; arithmetic[k] != NULL && !pure; k++) {
+				pure = startsWith(name, arithmetic[k]) && name.find("AnyTag") == string::npos;
+			}
+			if (!pure) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	static vector<Instruction> split(const vector<string>& lines, size_t begin, size_t end) {
+		vector<Instruction> instructions;
+		for (size_t i = begin; i < end; i++) {
+			Instruction instruction;
+			instruction.removed = false;
+			instruction.lines.push_back(lines[i]);
+			string statement = trim(lines[i]);
+
+			if (statement == "{") {
+				instruction.kind = instructionScopeOpen;
+			} else if (statement == "}") {
+				instruction.kind = instructionScopeClose;
+			} else if (statement.empty() || startsWith(statement, "//")) {
+				instruction.kind = instructionComment;
+			} else if (!lines[i].empty() && lines[i][0] != '\t' && lines[i][0] != ' '
+					&& statement[statement.size() - 1] == ':') {
+				instruction.kind = instructionLabel;
+				instruction.name = statement.substr(0, statement.size() - 1);
+			} else {
+				int balance = braceBalance(lines[i]);
+				bool openIf = startsWith(statement, "if") && statement[statement.size() - 1] == ')';
+				while ((balance > 0 || openIf) && i + 1 < end) {
+					i++;
+					instruction.lines.push_back(lines[i]);
+					balance += braceBalance(lines[i]);
+					openIf = false;
+				}
+				bool terminator = startsWith(statement, "return") || startsWith(statement, "goto ")
+					|| startsWith(statement, "throw") || statement == "break;" || statement == "continue;";
+				instruction.kind = terminator ? instructionTerminator : instructionOther;
+				instruction.name = definedRegister(statement);
+			}
+			for (size_t k = 0; k < instruction.lines.size(); k++) {
+				instruction.text += instruction.lines[k];
+				instruction.text += '\n';
+			}
+			instructions.push_back(instruction);
+		}
+		return instructions;
+	}
+
+	static bool isCode(const Instruction& instruction) {
+		return instruction.kind != instructionScopeOpen && instruction.kind != instructionScopeClose;
+	}
+
+	static string jumpTarget(const Instruction& instruction) {
+		string statement = trim(instruction.lines[0]);
+		if (!startsWith(statement, "goto ")) {
+			return "";
+		}
+		return statement.substr(5, statement.size() - 6);
+	}
+
+	bool removeUnreachable(vector<Instruction>& instructions) {
+		bool changed = false;
+		bool reachable = true;
+		for (size_t i = 0; i < instructions.size(); i++) {
+			Instruction& instruction = instructions[i];
+			if (instruction.removed) {
+				continue;
+			}
+			if (instruction.kind == instructionLabel) {
+				reachable = true;
+			} else if (!reachable && isCode(instruction)) {
+				instruction.removed = true;
+				unreachableRemoved++;
+				changed = true;
+			} else if (instruction.kind == instructionTerminator) {
+				reachable = false;
+			}
+		}
+		return changed;
+	}
+
+	bool removeJumpsToNext(vector<Instruction>& instructions) {
+		bool changed = false;
+		for (size_t i = 0; i < instructions.size(); i++) {
+			string target = instructions[i].removed ? "" : jumpTarget(instructions[i]);
+			if (target.empty()) {
+				continue;
+			}
+			size_t next = i + 1;
+			while (next < instructions.size() && (instructions[next].removed || !isCode(instructions[next]))) {
+				next++;
+			}
+			if (next < instructions.size() && instructions[next].kind == instructionLabel
+					&& instructions[next].name == target) {
+				instructions[i].removed = true;
+				jumpsRemoved++;
+				changed = true;
+			}
+		}
+		return changed;
+	}
+
+	bool removeDeadLabels(vector<Instruction>& instructions) {
+		set<string> targets;
+		for (size_t i = 0; i < instructions.size(); i++) {
+			if (instructions[i].removed) {
+				continue;
+			}
+			const string& text = instructions[i].text;
+			for (size_t at = text.find("goto "); at != string::npos; at = text.find("goto ", at + 5)) {
+				size_t end = at + 5;
+				while (end < text.size() && isIdentifierChar(text[end])) {
+					end++;
+				}
+				targets.insert(text.substr(at + 5, end - at - 5));
+			}
+		}
+		bool changed = false;
+		for (size_t i = 0; i < instructions.size(); i++) {
+			if (!instructions[i].removed && instructions[i].kind == instructionLabel
+					&& targets.count(instructions[i].name) == 0) {
+				instructions[i].removed = true;
+				labelsRemoved++;
+				changed = true;
+			}
+		}
+		return changed;
+	}
+
+	bool removeUnusedRegisters(vector<Instruction>& instructions) {
+		map<string, int> counts;
+		for (size_t i = 0; i < instructions.size(); i++) {
+			if (!instructions[i].removed) {
+				countRegisters(instructions[i].text, counts);
+			}
+		}
+		bool changed = false;
+		for (size_t i = 0; i < instructions.size(); i++) {
+			Instruction& instruction = instructions[i];
+			// the definition itself is the only appearance of the register
+			if (instruction.removed || instruction.name.empty() || counts[instruction.name] != 1) {
+				continue;
+			}
+			if (isPure(instruction.text)) {
+				instruction.removed = true;
+				registersRemoved++;
+				changed = true;
+			} else if (instruction.lines.size() == 1) {
+				string& line = instruction.lines[0];
+				size_t name = line.find(" " + instruction.name) + 1 + instruction.name.size();
+				if (line[name] == '[') {
+					continue;
+				}
+				line = line.substr(0, line.find_first_not_of(" \t")) + trim(line.substr(line.find('=', name) + 1));
+				instruction.text = line + '\n';
+				instruction.name.clear();
+				registersRemoved++;
+			}
+		}
+		return changed;
+	}
+
+	/* A scope brace pair with nothing left between them */
+	static void removeEmptyScopes(vector<Instruction>& instructions) {
+		vector<size_t> open;
+		for (size_t i = 0; i < instructions.size(); i++) {
+			if (instructions[i].removed) {
+				continue;
+			}
+			if (instructions[i].kind == instructionScopeOpen) {
+				open.push_back(i);
+			} else if (instructions[i].kind == instructionScopeClose && !open.empty()) {
+				size_t first = open.back();
+				open.pop_back();
+				bool empty = true;
+				for (size_t k = first + 1; k < i && empty; k++) {
+					empty = instructions[k].removed;
+				}
+				if (empty) {
+					instructions[first].removed = true;
+					instructions[i].removed = true;
+				}
+			}
+		}
+	}
+
+	void optimiseFunction(const vector<string>& lines, size_t begin, size_t end, vector<string>& output) {
+		vector<Instruction> instructions = split(lines, begin, end);
+		bool changed = true;
+		while (changed) {
+			changed = removeUnreachable(instructions);
+			changed = removeJumpsToNext(instructions) || changed;
+			changed = removeDeadLabels(instructions) || changed;
+			changed = removeUnusedRegisters(instructions) || changed;
+		}
+		removeEmptyScopes(instructions);
+		for (size_t i = 0; i < instructions.size(); i++) {
+			if (!instructions[i].removed) {
+				output.insert(output.end(), instructions[i].lines.begin(), instructions[i].lines.end());
+			}
+		}
+	}
+
+public:
+	DeadCodeElimination() {
+		unreachableRemoved = 0;
+		registersRemoved = 0;
+		labelsRemoved = 0;
+		jumpsRemoved = 0;
+	}
+
+	/* Optimises the body of every function in lines, anything outside a function is copied as it is.
+	 * A function starts with a line in column 0 that ends in "{" and ends at a line that is just "}". The frames
+	 * of generators are structs, which end at a line that is just "};" and are copied as they are.
+	 */
+	vector<string> run(const vector<string>& lines) {
+		vector<string> output;
+		size_t i = 0;
+		while (i < lines.size()) {
+			const string& line = lines[i];
+			output.push_back(line);
+			i++;
+			if (startsWith(line, "struct ")) {
+				while (i < lines.size() && output.back() != "};") {
+					output.push_back(lines[i]);
+					i++;
+				}
+				continue;
+			}
+			if (line.empty() || line[0] == '\t' || line[0] == ' ' || line[line.size() - 1] != '{') {
+				continue;
+			}
+			size_t end = i;
+			while (end < lines.size() && lines[end] != "}") {
+				end++;
+			}
+			optimiseFunction(lines, i, end, output);
+			i = end;
+		}
+		return output;
+	}
+
+	size_t getUnreachableRemoved() {
+		return unreachableRemoved;
+	}
+
+	size_t getRegistersRemoved() {
+		return registersRemoved;
+	}
+
+	size_t getLabelsRemoved() {
+		return labelsRemoved;
+	}
+
+	size_t getJumpsRemoved() {
+		return jumpsRemoved;
+	}
+
+	static size_t size(const vector<string>& lines) {
+		size_t bytes = 0;
+		for (size_t i = 0; i < lines.size(); i++) {
+			bytes += lines[i].size() + 1;
+		}
+		return bytes;
+	}
+};
@@ -13,6 +13,7 @@
 
 
 #include "../type/type.hpp"
+#include "../runtime/class.hpp"
 
 using namespace std;
 
@@ -25,10 +26,71 @@ inline unsigned int getNewRegister() {
 	return global_var++;
 }
 
+// number of array literal elements emitted per line of generated code
+static const size_t ARRAY_ELEMENTS_PER_LINE = 8;
+
+/* What the compiler can prove about the value of an expression before it runs */
+enum StaticType {
+	staticUnknown,
+	staticNumber,
+	staticString
+};
+
 class Expression:public Node{
 public:
 	virtual unsigned int genCode() = 0;
 	virtual unsigned int genStoreCode()=0;
+
+	virtual StaticType getStaticType() {
+		return staticUnknown;
+	}
+
+	/* Emits Core::<operation> of two registers. When the type of either operand is known the call goes to the
+	 * template specialised on NumberTag or StringTag, which is resolved by the C++ compiler and leaves only the
+	 * arithmetic to run.
+	 */
+	void arithmeticEmit(unsigned int registerNumber, const char* operation, StaticType lhsType,
+			unsigned int lhsRegister, StaticType rhsType, unsigned int rhsRegister) {
+		if (lhsType == staticUnknown && rhsType == staticUnknown) {
+			emit("\tESValue* r%d = Core::%s(r%d, r%d);", registerNumber, operation, lhsRegister, rhsRegister);
+		} else {
+			emit("\tESValue* r%d = Core::%s<%s, %s>(r%d, r%d);", registerNumber, operation, typeTag(lhsType),
+				typeTag(rhsType), lhsRegister, rhsRegister);
+		}
+	}
+
+	static const char* typeTag(StaticType type) {
+		switch (type) {
+			case staticNumber:
+				return "NumberTag";
+			case staticString:
+				return "StringTag";
+			default:
+				return "AnyTag";
+		}
+	}
+
+	/* Core operation of a compound assignment operator, NULL for plain = */
+	static const char* compoundOperation(char operand) {
+		switch (operand) {
+			case '+': return ADDITION;
+			case '-': return SUBTRACTION;
+			case '*': return MULTIPLICATION;
+			case '/': return DIVISION;
+			case '%': return MODULUS;
+		}
+		return NULL;
+	}
+
+	/* Emits the expression as a branch condition into a C bool register.
+	 * Expressions that already produce a plain bool (comparisons) override this to skip ToBoolean.
+	 */
+	virtual unsigned int genConditionCode() {
+		unsigned int valueRegister = genStoreCode();
+		unsigned int registerNumber = getNewRegister();
+		emit("\tbool r%d = TypeOps::toBoolean(Core::getValue(r%d)).getValue();", registerNumber, valueRegister);
+		return registerNumber;
+	}
 };
 
 class DecimalIntegerLiteralExpression:public Expression{
@@ -52,6 +114,10 @@ public:
         return getNewRegister();
     }
 
+	StaticType getStaticType() {
+		return staticNumber;
+	}
+
 	unsigned int genStoreCode() {
 		unsigned int registerNumber = getNewRegister();
 		emit("\tESValue* r%d = new Number(%d);", registerNumber, this->getValue());
@@ -73,16 +139,20 @@ public:
     }
 
     void dump(int indent){
-        label(indent, "IntegerLiteralExpression: %d\n", value);
+        label(indent, "DecimalLiteralExpression: %g\n", value);
     }
 
     unsigned int genCode() {
         return getNewRegister();
     }
 
+	StaticType getStaticType() {
+		return staticNumber;
+	}
+
 	unsigned int genStoreCode() {
 		unsigned int registerNumber = getNewRegister();
-		emit("\tESValue* r%d = new Reference(env, \"%d\");", registerNumber, this->getValue());
+		emit("\tESValue* r%d = new Number(%s);", registerNumber, numberLiteral(this->getValue()).c_str());
 		return registerNumber;
 	};
 };
@@ -115,6 +185,34 @@ public:
 
 	unsigned int genStoreCode() 	{
 		unsigned int registerNumber = getNewRegister();
+		std::string environment;
+		LexicalScope::LexicalBinding* binding = resolveLexical(name, &environment);
+		if (binding != NULL && binding->captured) {
+			// like a C local, a binding initialised before the function reading it was created needs no check
+			std::string value = environment + "->getBinding(" + std::to_string(binding->registerNumber) + ")";
+			if (binding->initialized) {
+				lexicalStatistics.checksRemoved++;
+				emit("\tESValue* r%d = %s;", registerNumber, value.c_str());
+			} else {
+				lexicalStatistics.checksEmitted++;
+				emit("\tESValue* r%d = Core::initializedBinding(%s);", registerNumber, value.c_str());
+			}
+			return registerNumber;
+		}
+		if (binding != NULL) {
+			if (binding->initialized) {
+				lexicalStatistics.checksRemoved++;
+				emit("\tESValue* r%d = r%d;", registerNumber, binding->registerNumber);
+			} else {
+				lexicalStatistics.checksEmitted++;
+				emit("\tESValue* r%d = Core::initializedBinding(r%d);", registerNumber, binding->registerNumber);
+			}
+			return registerNumber;
+		}
+		if (localBindings.count(name) > 0) {
+			emit("\tESValue* r%d = local_%s;", registerNumber, name.c_str());
+			return registerNumber;
+		}
 		emit("\tESValue* r%d = new Reference(new String(\"%s\"));", registerNumber, this->getReferencedName().c_str());
 		return registerNumber;
 	}
@@ -150,14 +248,235 @@ public:
         return getNewRegister();
     }
 
+	StaticType getStaticType() {
+		return staticString;
+	}
+
+	unsigned int genStoreCode() {
+		// the lexer keeps the quotes, a single quoted literal is re-quoted for C and the double quotes in it escaped
+		std::string literal = this->getValue();
+		if (literal[0] == '\'') {
+			std::string body = literal.substr(1, literal.size() - 2);
+			literal = "\"";
+			for (size_t i = 0; i < body.size(); i++) {
+				if (body[i] == '\\' && i + 1 < body.size()) {
+					literal += body.substr(i++, 2);
+				} else if (body[i] == '"') {
+					literal += "\\\"";
+				} else {
+					literal += body[i];
+				}
+			}
+			literal += "\"";
+		}
+		unsigned int registerNumber = getNewRegister();
+		emit("\tESValue* r%d = new String(%s);", registerNumber, literal.c_str());
+		return registerNumber;
+	}
+};
+
+
+
+/* 12.2.2 The this Keyword
+ * In the constructor and the methods of a class this is the C parameter self, see ClassDeclaration. Everywhere else
+ * it is undefined, as it is in strict code called without a receiver; that includes the arrow functions and the
+ * functions nested in a method, which are compiled apart from it and do not see self.
+ */
+class ThisExpression : public Expression {
+public:
+	void dump(int indent) {
+		label(indent, "ThisExpression\n");
+	}
+
+	unsigned int genCode() {
+		return getNewRegister();
+	}
+
+	unsigned int genStoreCode() {
+		unsigned int registerNumber = getNewRegister();
+		if (currentClass.name.empty()) {
+			emit("\tESValue* r%d = new Undefined();", registerNumber);
+		} else {
+			emit("\tESValue* r%d = self;", registerNumber);
+		}
+		return registerNumber;
+	}
+};
+
+/* 12.3.2 Property Accessors: MemberExpression [ Expression ]
+ * Loads and stores go through Core::getElement/setElement, which are native loads and stores for typed arrays
+ */
+class ElementAccessExpression : public Expression {
+protected:
+	Expression* object;
+	Expression* key;
+
+public:
+	ElementAccessExpression(Expression* object, Expression* key) {
+		this->object = object;
+		this->key = key;
+	}
+
+	void dump(int indent) {
+		label(indent, "ElementAccessExpression\n");
+		object->dump(indent + 1, "object");
+		key->dump(indent + 1, "key");
+	}
+
+	unsigned int genCode() {
+		return getNewRegister();
+	}
+
+	unsigned int genStoreCode() {
+		unsigned int objectRegister = object->genStoreCode();
+		unsigned int keyRegister = key->genStoreCode();
+		unsigned int registerNumber = getNewRegister();
+		emit("\tESValue* r%d = Core::getElement(r%d, r%d);", registerNumber, objectRegister, keyRegister);
+		return registerNumber;
+	}
+
+	/* Called by AssignmentExpression when this is the assignment target, operand is 0 for plain = */
+	virtual unsigned int genAssignCode(Expression* rhs, char operand) {
+		unsigned int objectRegister = object->genStoreCode();
+		unsigned int keyRegister = key->genStoreCode();
+		unsigned int valueRegister = rhs->genStoreCode();
+
+		const char* operation = compoundOperation(operand);
+		if (operation != NULL) {
+			unsigned int currentRegister = getNewRegister();
+			emit("\tESValue* r%d = Core::getElement(r%d, r%d);", currentRegister, objectRegister, keyRegister);
+			unsigned int resultRegister = getNewRegister();
+			arithmeticEmit(resultRegister, operation, staticUnknown, currentRegister, rhs->getStaticType(),
+				valueRegister);
+			valueRegister = resultRegister;
+		}
+
+		unsigned int registerNumber = getNewRegister();
+		emit("\tESValue* r%d = Core::setElement(r%d, r%d, Core::getValue(r%d));", registerNumber, objectRegister, keyRegister, valueRegister);
+		return registerNumber;
+	}
+};
+
+/* 12.3.2 Property Accessors: MemberExpression . IdentifierName
+ * The same as MemberExpression [ "IdentifierName" ], except that this.name in a class is a slot of the instance
+ * when name is one of its fields. The constructor makes each name it assigns a field, up to
+ * ClassInstance::MAX_FIELDS, unless a method has that name: it stays in the property map, where it shadows the
+ * method as it would on an ordinary object.
+ */
+class PropertyAccessExpression : public ElementAccessExpression {
+private:
+	std::string name;
+
+	/* The slot this.name loads and stores, or -1 */
+	int fieldSlot(bool assigned) {
+		if (currentClass.name.empty() || dynamic_cast<ThisExpression*>(object) == NULL) {
+			return -1;
+		}
+		int index = fieldIndex(name);
+		if (index < 0 && assigned && currentClass.inConstructor && currentClass.methods.count(name) == 0
+				&& currentClass.fields.size() < ClassInstance::MAX_FIELDS) {
+			currentClass.fields.push_back(name);
+			index = (int)currentClass.fields.size() - 1;
+		}
+		return index;
+	}
+
+public:
+	PropertyAccessExpression(Expression* object, std::string name)
+		: ElementAccessExpression(object, new StringLiteralExpression(strdup(("\"" + name + "\"").c_str()))) {
+		this->name = name;
+	}
+
+	std::string getName() {
+		return name;
+	}
+
+	Expression* getObject() {
+		return object;
+	}
+
+	void dump(int indent) {
+		label(indent, "PropertyAccessExpression: %s\n", name.c_str());
+		object->dump(indent + 1, "object");
+	}
+
 	unsigned int genStoreCode() {
+		int index = fieldSlot(false);
+		if (index < 0) {
+			return ElementAccessExpression::genStoreCode();
+		}
+		unsigned int registerNumber = getNewRegister();
+		emit("\tESValue* r%d = self->getField(%d, \"%s\");", registerNumber, index, name.c_str());
+		return registerNumber;
+	}
+
+	unsigned int genAssignCode(Expression* rhs, char operand) {
+		int index = fieldSlot(true);
+		if (index < 0) {
+			return ElementAccessExpression::genAssignCode(rhs, operand);
+		}
+		unsigned int valueRegister = rhs->genStoreCode();
+
+		const char* operation = compoundOperation(operand);
+		if (operation != NULL) {
+			unsigned int currentRegister = getNewRegister();
+			emit("\tESValue* r%d = self->getField(%d, \"%s\");", currentRegister, index, name.c_str());
+			unsigned int resultRegister = getNewRegister();
+			arithmeticEmit(resultRegister, operation, staticUnknown, currentRegister, rhs->getStaticType(),
+				valueRegister);
+			valueRegister = resultRegister;
+		}
+
 		unsigned int registerNumber = getNewRegister();
-		emit("\tESValue* r%d = new Reference(env, \"%s\");", registerNumber, this->getValue().c_str());
+		emit("\tESValue* r%d = self->setField(%d, Core::getValue(r%d));", registerNumber, index, valueRegister);
 		return registerNumber;
 	}
 };
 
+/* 12.3.3 The new Operator: new MemberExpression Arguments */
+class NewExpression : public Expression {
+private:
+	Expression* constructor;
+	vector<Expression*>* arguments;
+
+public:
+	NewExpression(Expression* constructor, vector<Expression*>* arguments) {
+		this->constructor = constructor;
+		this->arguments = arguments;
+	}
+
+	void dump(int indent) {
+		label(indent++, "NewExpression\n");
+		constructor->dump(indent);
+		label(indent, "Arguments\n");
+		for (vector<Expression*>::iterator iter = arguments->begin(); iter != arguments->end(); ++iter) {
+			(*iter)->dump(indent + 1);
+		}
+	}
+
+	unsigned int genCode() {
+		return getNewRegister();
+	}
+
+	unsigned int genStoreCode() {
+		unsigned int constructorRegister = constructor->genStoreCode();
+		std::string argumentRegisters;
+		char argumentRegister[16];
+		for (vector<Expression*>::iterator iter = arguments->begin(); iter != arguments->end(); ++iter) {
+			snprintf(argumentRegister, sizeof(argumentRegister), "r%d, ", (*iter)->genStoreCode());
+			argumentRegisters += argumentRegister;
+		}
 
+		unsigned int registerNumber = getNewRegister();
+		if (arguments->empty()) {
+			emit("\tESValue* r%d = Core::construct(r%d, NULL, 0);", registerNumber, constructorRegister);
+		} else {
+			emit("\tESValue* r%d_arguments[] = {%s};", registerNumber, argumentRegisters.c_str());
+			emit("\tESValue* r%d = Core::construct(r%d, r%d_arguments, %d);", registerNumber, constructorRegister, registerNumber, (int)arguments->size());
+		}
+		return registerNumber;
+	}
+};
 
 class AssignmentExpression:public Expression {
 private:
@@ -174,6 +493,7 @@ public:
     AssignmentExpression(Expression *lhs, Expression *rhs) {
         this->lhs = lhs;
         this->rhs = rhs;
+        this->operand = 0;
     };
 
     AssignmentExpression() {};
@@ -182,6 +502,18 @@ public:
         this->lhs = expression;
     }
 
+	Expression* getLhs() {
+		return lhs;
+	}
+
+	Expression* getRhs() {
+		return rhs;
+	}
+
+	char getOperand() {
+		return operand;
+	}
+
     void dump(int indent) {
 				if (operand > 0){
 					label(indent, "%c AssignmentExpression\n", operand);
@@ -195,39 +527,96 @@ public:
         }
     }
 
+	/* 12.14.5 Destructuring Assignment, for an array literal on the left, see BindingPatternExpression */
+	static bool isAssignmentPattern(Expression* lhs);
+	unsigned int genDestructuringCode(bool valueUsed);
+
+	/* 8.1.1.1.5 SetMutableBinding of a let or const that is a C local, see LexicalScope */
+	unsigned int genLexicalAssignCode(LexicalScope::LexicalBinding* binding, const std::string& environment) {
+		const char* operation = compoundOperation(operand);
+		// a compound assignment reads the binding first, which checks it
+		unsigned int lhsRegisterNumber = operation != NULL ? lhs->genStoreCode() : 0;
+		unsigned int rhsRegisterNumber = rhs->genStoreCode();
+		if (operation != NULL) {
+			unsigned int registerNumber = getNewRegister();
+			arithmeticEmit(registerNumber, operation, staticUnknown, lhsRegisterNumber, rhs->getStaticType(),
+				rhsRegisterNumber);
+			rhsRegisterNumber = registerNumber;
+		}
+
+		std::string value = "r" + std::to_string(binding->registerNumber);
+		if (binding->captured) {
+			value = environment + "->getBinding(" + std::to_string(binding->registerNumber) + ")";
+		}
+		if (binding->constant) {
+			emit("\tCore::assignConstant(%s);", value.c_str());
+			return rhsRegisterNumber;
+		}
+		if (operation == NULL && binding->initialized) {
+			lexicalStatistics.checksRemoved++;
+		} else if (operation == NULL) {
+			lexicalStatistics.checksEmitted++;
+			emit("\tCore::initializedBinding(%s);", value.c_str());
+		}
+		unsigned int registerNumber = getNewRegister();
+		if (binding->captured) {
+			emit("\tESValue* r%d = %s->setBinding(%d, Core::getValue(r%d));", registerNumber, environment.c_str(),
+				binding->registerNumber, rhsRegisterNumber);
+			return registerNumber;
+		}
+		emit("\tr%d = Core::getValue(r%d);", binding->registerNumber, rhsRegisterNumber);
+		emit("\tESValue* r%d = r%d;", registerNumber, binding->registerNumber);
+		return registerNumber;
+	}
+
+	/* The assignment as an expression statement, whose value is not used */
+	unsigned int genDiscardedCode() {
+		if (operand == 0 && isAssignmentPattern(lhs)) {
+			return genDestructuringCode(false);
+		}
+		return genStoreCode();
+	}
+
     unsigned int genStoreCode() 	{
 
+    if (operand == 0 && isAssignmentPattern(lhs)) {
+        return genDestructuringCode(true);
+    }
+
+    IdentifierExpression* name = dynamic_cast<IdentifierExpression*>(lhs);
+    std::string environment;
+    LexicalScope::LexicalBinding* binding = name != NULL ? resolveLexical(name->getReferencedName(), &environment)
+        : NULL;
+    if (binding != NULL) {
+        return genLexicalAssignCode(binding, environment);
+    }
+
+    ElementAccessExpression* element = dynamic_cast<ElementAccessExpression*>(lhs);
+    if (element != NULL) {
+        return element->genAssignCode(rhs, operand);
+    }
+
     unsigned int lhsRegisterNumber = lhs->genStoreCode();
 		unsigned int rhsRegisterNumber = rhs->genStoreCode();
 		unsigned int registerNumber = getNewRegister();
 
-		if (operand == '+') {
-			unsigned int newRegisterNumber = getNewRegister();
-			emit("\tESValue* r%d = Core::plus(r%d, r%d);", registerNumber, lhsRegisterNumber, rhsRegisterNumber);
-			rhsRegisterNumber = registerNumber;
-			registerNumber = newRegisterNumber;
-		} else if (operand == '-') {
-			unsigned int newRegisterNumber = getNewRegister();
-			emit("\tESValue* r%d = Core::subtract(r%d, r%d);", registerNumber, lhsRegisterNumber, rhsRegisterNumber);
-			rhsRegisterNumber = registerNumber;
-			registerNumber = newRegisterNumber;
-		} else if (operand == '*') {
-			unsigned int newRegisterNumber = getNewRegister();
-			emit("\tESValue* r%d = Core::multiply(r%d, r%d);", registerNumber, lhsRegisterNumber, rhsRegisterNumber);
-			rhsRegisterNumber = registerNumber;
-			registerNumber = newRegisterNumber;
-		} else if (operand == '/') {
-			unsigned int newRegisterNumber = getNewRegister();
-			emit("\tESValue* r%d = Core::divide(r%d, r%d);", registerNumber, lhsRegisterNumber, rhsRegisterNumber);
-			rhsRegisterNumber = registerNumber;
-			registerNumber = newRegisterNumber;
-		} else if (operand == '%') {
+		const char* operation = compoundOperation(operand);
+		if (operation != NULL) {
 			unsigned int newRegisterNumber = getNewRegister();
-			emit("\tESValue* r%d = Core::modulo(r%d, r%d);", registerNumber, lhsRegisterNumber, rhsRegisterNumber);
+			arithmeticEmit(registerNumber, operation, staticUnknown, lhsRegisterNumber, rhs->getStaticType(),
+				rhsRegisterNumber);
 			rhsRegisterNumber = registerNumber;
 			registerNumber = newRegisterNumber;
 		}
 
+		// a parameter is a C local, which holds values and never references
+		IdentifierExpression* identifier = dynamic_cast<IdentifierExpression*>(lhs);
+		if (identifier != NULL && localBindings.count(identifier->getReferencedName()) > 0) {
+			std::string name = identifier->getReferencedName();
+			emit("\tlocal_%s = Core::getValue(r%d);", name.c_str(), rhsRegisterNumber);
+			emit("\tESValue* r%d = local_%s;", registerNumber, name.c_str());
+			return registerNumber;
+		}
 		emit("\tESValue* r%d = Core::assign(r%d, r%d);", registerNumber, lhsRegisterNumber, rhsRegisterNumber);
 
 		return registerNumber;
@@ -261,9 +650,8 @@ public:
         return getNewRegister();
     }
 
-	unsigned int genStoreCode() {
-		return global_var;
-	};
+	/* 12.2.6.8 Runtime Semantics: Evaluation of ObjectLiteral: a new object, then each property definition in order */
+	unsigned int genStoreCode();
 
 };
 
@@ -291,6 +679,9 @@ public:
         }
     }
 
+    /* 12.2.6.9 Runtime Semantics: PropertyDefinitionEvaluation, a shorthand IdentifierReference is its own value */
+    void genDefineCode(unsigned int objectRegister);
+
     unsigned int genCode() {
         return getNewRegister();
     }
@@ -309,6 +700,19 @@ public:
         this->literalExpression = literalExpression;
     };
 
+	/* The name an identifier or a string literal gives the property, empty for a numeric literal */
+	std::string getName() {
+		IdentifierExpression* identifier = dynamic_cast<IdentifierExpression*>(literalExpression);
+		if (identifier != NULL) {
+			return identifier->getReferencedName();
+		}
+		StringLiteralExpression* string = dynamic_cast<StringLiteralExpression*>(literalExpression);
+		if (string != NULL) {
+			return string->getValue().substr(1, string->getValue().size() - 2);
+		}
+		return "";
+	}
+
     void dump (int indent) {
         label(indent, "LiteralPropertyNameExpression\n");
         indent++;
@@ -319,8 +723,15 @@ public:
         return getNewRegister();
     }
 
+	/* 12.2.6.5 Runtime Semantics: Evaluation of LiteralPropertyName: an identifier names the property, it is not a reference */
 	unsigned int genStoreCode() {
-		return global_var;
+		IdentifierExpression* identifier = dynamic_cast<IdentifierExpression*>(literalExpression);
+		if (identifier == NULL) {
+			return literalExpression->genStoreCode();
+		}
+		unsigned int registerNumber = getNewRegister();
+		emit("\tESValue* r%d = new String(\"%s\");", registerNumber, identifier->getReferencedName().c_str());
+		return registerNumber;
 	};
 };
 
@@ -343,12 +754,39 @@ public:
     }
 
 
+	/* 12.2.6.7 Runtime Semantics: Evaluation of ComputedPropertyName */
 	unsigned int genStoreCode() {
-		return global_var;
+		return computedExpression->genStoreCode();
 	};
 
 };
 
+inline unsigned int ObjectLiteralExpression::genStoreCode() {
+    unsigned int registerNumber = getNewRegister();
+    emit("\tESValue* r%d = new ESObject();", registerNumber);
+    for (vector<Expression*>::iterator iter = propertyDefinitionList->begin(); iter != propertyDefinitionList->end(); ++iter) {
+        PropertyDefinitionExpression* definition = dynamic_cast<PropertyDefinitionExpression*>(*iter);
+        if (definition != NULL) {
+            definition->genDefineCode(registerNumber);
+        }
+    }
+    return registerNumber;
+}
+
+inline void PropertyDefinitionExpression::genDefineCode(unsigned int objectRegister) {
+    unsigned int keyRegister;
+    unsigned int valueRegister;
+    if (value != NULL) {
+        keyRegister = key->genStoreCode();
+        valueRegister = value->genStoreCode();
+    } else {
+        keyRegister = LiteralPropertyNameExpression(key).genStoreCode();
+        valueRegister = key->genStoreCode();
+    }
+    unsigned int registerNumber = getNewRegister();
+    emit("\tESValue* r%d = Core::setElement(r%d, r%d, Core::getValue(r%d));", registerNumber, objectRegister, keyRegister, valueRegister);
+}
+
 /* See ECMA Specifications http://www.ecma-international.org/ecma-262/6.0/#sec-unary-operators */
 /* Unary operator + * / - % */
 class UnaryExpression : public Expression {
@@ -516,50 +954,6 @@ public:
 
 };
 
-class Arguments : public Expression {
-private:
-    std::vector<AssignmentExpression*>* argumentList;
-public:
-    Arguments(vector<AssignmentExpression*>* argumentList){
-        this->argumentList = argumentList;
-    };
-
-    void dump(int indent) {
-        label(indent, "Arguments\n");
-        for (vector<AssignmentExpression*>::iterator iter = argumentList->begin(); iter != argumentList->end(); ++iter)
-          (*iter)->dump(indent+1);
-    }
-
-  unsigned int genCode() {
-      return getNewRegister();
-    }
-};
-
-
-class CallExpression : public Expression {
-private:
-    Expression* expression;
-    Arguments* arguments;
-public:
-    CallExpression(Expression *expression) {
-        this->expression = expression;
-    };
-
-    void dump(int indent) {
-        label(indent, "CallExpression\n");
-        indent++;
-        expression->dump(indent);
-        if(arguments != NULL) {
-            arguments->dump(indent+1);
-        }
-    }
-
-
-    unsigned int genCode() {
-        return getNewRegister();
-    }
-};
-
 class ArrayLiteralExpression : public Expression {
 private:
     vector<Expression*> *elementList;
@@ -572,6 +966,10 @@ public:
         this->elementList = elementList;
     };
 
+	vector<Expression*>* getElements() {
+		return elementList;
+	}
+
     void dump(int indent) {
         label(indent, "ArrayLiteralExpression\n");
 
@@ -583,8 +981,64 @@ public:
         return getNewRegister();
     }
 
+	/* 12.2.5.3 Runtime Semantics: Evaluation
+	 * The elements kind is picked at compile time: literals made only of integers or numbers are emitted as
+	 * a C array and copied unboxed into the ESArray, anything else (including nested arrays) is evaluated into
+	 * registers first and handed over in one bulk initialisation.
+	 */
 	unsigned int genStoreCode() {
-		return global_var;
+		if (elementList->empty()) {
+			unsigned int registerNumber = getNewRegister();
+			emit("\tESValue* r%d = new ESArray();", registerNumber);
+			return registerNumber;
+		}
+
+		bool allIntegers = true;
+		bool allNumbers = true;
+		for (vector<Expression*>::iterator iter = elementList->begin(); iter != elementList->end(); ++iter) {
+			if (dynamic_cast<DecimalIntegerLiteralExpression*>(*iter) != NULL) {
+				continue;
+			}
+			allIntegers = false;
+			if (dynamic_cast<DecimalLiteralExpression*>(*iter) == NULL) {
+				allNumbers = false;
+			}
+		}
+
+		std::vector<std::string> values;
+		const char* elementType;
+		if (allNumbers) {
+			elementType = allIntegers ? "int" : "double";
+			for (vector<Expression*>::iterator iter = elementList->begin(); iter != elementList->end(); ++iter) {
+				DecimalIntegerLiteralExpression* integer = dynamic_cast<DecimalIntegerLiteralExpression*>(*iter);
+				if (integer != NULL) {
+					values.push_back(std::to_string(integer->getValue()));
+				} else {
+					values.push_back(numberLiteral(dynamic_cast<DecimalLiteralExpression*>(*iter)->getValue()));
+				}
+			}
+		} else {
+			elementType = "ESValue*";
+			char value[32];
+			for (vector<Expression*>::iterator iter = elementList->begin(); iter != elementList->end(); ++iter) {
+				snprintf(value, sizeof(value), "Core::getValue(r%d)", (*iter)->genStoreCode());
+				values.push_back(value);
+			}
+		}
+
+		unsigned int registerNumber = getNewRegister();
+		emit("\t%s r%d_elements[] = {", elementType, registerNumber);
+		// one line per chunk keeps large literals within the emit buffer
+		for (size_t chunk = 0; chunk < values.size(); chunk += ARRAY_ELEMENTS_PER_LINE) {
+			std::string line = "\t\t";
+			for (size_t i = chunk; i < values.size() && i < chunk + ARRAY_ELEMENTS_PER_LINE; i++) {
+				line += values[i] + ", ";
+			}
+			emit("%s", line.c_str());
+		}
+		emit("\t};");
+		emit("\tESValue* r%d = new ESArray(r%d_elements, %d);", registerNumber, registerNumber, (int)values.size());
+		return registerNumber;
 	};
 
 };
@@ -604,6 +1058,14 @@ public:
         this->rhs = rhs;
     };
 
+    Expression* getLhs() {
+        return lhs;
+    }
+
+    Expression* getRhs() {
+        return rhs;
+    }
+
     unsigned int genCode() {
 		return getNewRegister();
 	}
@@ -627,7 +1089,17 @@ public:
     	unsigned int lhsRegister = lhs->genStoreCode();
     	unsigned int rhsRegister = rhs->genStoreCode();
     	unsigned int registerNumber = getNewRegister();
-		emit("\tESValue* r%d = Core::%s(r%d, r%d);", registerNumber, operation,  lhsRegister, rhsRegister);
+		arithmeticEmit(registerNumber, operation, lhs->getStaticType(), lhsRegister, rhs->getStaticType(), rhsRegister);
+		return registerNumber;
+	}
+
+	/* Called by comparison subclasses, emits the bool result of the Core comparison into a register
+	 */
+	unsigned int compareEmit(const char* operation) {
+		unsigned int lhsRegister = lhs->genStoreCode();
+		unsigned int rhsRegister = rhs->genStoreCode();
+		unsigned int registerNumber = getNewRegister();
+		emit("\tbool r%d = Core::%s(r%d, r%d);", registerNumber, operation, lhsRegister, rhsRegister);
 		return registerNumber;
 	}
 
@@ -639,11 +1111,30 @@ class AdditiveBinaryExpression : public BinaryExpression {
 private:
 	Expression* lhs;
 	Expression* rhs;
+	StaticType staticType;
 
 public:
+	/* The operands are built first, so their types are already known and a chain of additions is typed once per
+	 * term instead of walking the whole chain again at every level */
 	AdditiveBinaryExpression(Expression* lhs, Expression* rhs) : BinaryExpression(lhs, rhs) {
 		this->lhs = lhs;
 		this->rhs = rhs;
+		this->staticType = additionType(lhs->getStaticType(), rhs->getStaticType());
+	}
+
+	/* Number + Number is a Number and a String on either side makes a String */
+	static StaticType additionType(StaticType left, StaticType right) {
+		if (left == staticString || right == staticString) {
+			return staticString;
+		}
+		if (left == staticNumber && right == staticNumber) {
+			return staticNumber;
+		}
+		return staticUnknown;
+	}
+
+	StaticType getStaticType() {
+		return staticType;
 	}
 
     unsigned int genStoreCode() {
@@ -669,6 +1160,10 @@ public:
 		this->rhs = rhs;
 	}
 
+	StaticType getStaticType() {
+		return staticNumber;
+	}
+
     unsigned int genStoreCode() {
     	return fileEmit(SUBTRACTION);
 	}
@@ -694,6 +1189,10 @@ public:
 	}
 
 
+	StaticType getStaticType() {
+		return staticNumber;
+	}
+
     unsigned int genStoreCode() {
     	return fileEmit(MULTIPLICATION);
 	}
@@ -718,6 +1217,10 @@ public:
 		this->rhs = rhs;
 	}
 
+	StaticType getStaticType() {
+		return staticNumber;
+	}
+
     unsigned int genStoreCode() {
     	return fileEmit(DIVISION);
 	}
@@ -727,3 +1230,925 @@ public:
 		BinaryExpression::dump(indent);
 	}
 };
+
+/* Modulus operator Binary Expression */
+class ModuloBinaryExpression : public BinaryExpression {
+
+public:
+	ModuloBinaryExpression(Expression* lhs, Expression* rhs) : BinaryExpression(lhs, rhs) {
+	}
+
+	StaticType getStaticType() {
+		return staticNumber;
+	}
+
+    unsigned int genStoreCode() {
+    	return fileEmit(MODULUS);
+	}
+
+	void dump(int indent) {
+		label(indent, "ModuloBinaryExpression: %%\n");
+		BinaryExpression::dump(indent);
+	}
+};
+
+/* Relational and equality operators Binary Expression
+ * The runtime comparison returns a plain bool: a condition branches on it directly,
+ * and a Boolean is only allocated when the comparison is used as a value.
+ */
+class ComparisonBinaryExpression : public BinaryExpression {
+
+private:
+	const char* operation;
+
+public:
+	ComparisonBinaryExpression(Expression* lhs, Expression* rhs, const char* operation) : BinaryExpression(lhs, rhs) {
+		this->operation = operation;
+	}
+
+	unsigned int genConditionCode() {
+		return compareEmit(operation);
+	}
+
+	unsigned int genStoreCode() {
+		unsigned int conditionRegister = compareEmit(operation);
+		unsigned int registerNumber = getNewRegister();
+		emit("\tESValue* r%d = new Boolean(r%d);", registerNumber, conditionRegister);
+		return registerNumber;
+	}
+};
+
+/* 12.9 Relational Operators < > <= >= */
+class RelationalBinaryExpression : public ComparisonBinaryExpression {
+
+private:
+	const char* symbol;
+
+public:
+	RelationalBinaryExpression(Expression* lhs, Expression* rhs, const char* operation, const char* symbol)
+		: ComparisonBinaryExpression(lhs, rhs, operation) {
+		this->symbol = symbol;
+	}
+
+	void dump(int indent) {
+		label(indent, "RelationalBinaryExpression: %s\n", symbol);
+		BinaryExpression::dump(indent);
+	}
+};
+
+/* 12.10 Equality Operators == != === !== */
+class EqualityBinaryExpression : public ComparisonBinaryExpression {
+
+private:
+	const char* symbol;
+
+public:
+	EqualityBinaryExpression(Expression* lhs, Expression* rhs, const char* operation, const char* symbol)
+		: ComparisonBinaryExpression(lhs, rhs, operation) {
+		this->symbol = symbol;
+	}
+
+	void dump(int indent) {
+		label(indent, "EqualityBinaryExpression: %s\n", symbol);
+		BinaryExpression::dump(indent);
+	}
+};
+
+/* 12.15 Comma Operator: Expression , AssignmentExpression
+ * Every operand is evaluated in order and the value of the last one is the result
+ */
+class CommaExpression : public Expression {
+private:
+	vector<Expression*>* expressions;
+
+public:
+	CommaExpression(Expression* first, Expression* second) {
+		CommaExpression* comma = dynamic_cast<CommaExpression*>(first);
+		if (comma != NULL) {
+			this->expressions = comma->expressions;
+		} else {
+			this->expressions = new vector<Expression*>();
+			this->expressions->push_back(first);
+		}
+		this->expressions->push_back(second);
+	}
+
+	vector<Expression*>* getExpressions() {
+		return expressions;
+	}
+
+	void dump(int indent) {
+		label(indent, "CommaExpression\n");
+		for (vector<Expression*>::iterator iter = expressions->begin(); iter != expressions->end(); ++iter) {
+			(*iter)->dump(indent + 1);
+		}
+	}
+
+	unsigned int genCode() {
+		return getNewRegister();
+	}
+
+	unsigned int genStoreCode() {
+		unsigned int valueRegister = 0;
+		for (vector<Expression*>::iterator iter = expressions->begin(); iter != expressions->end(); ++iter) {
+			valueRegister = (*iter)->genStoreCode();
+		}
+		unsigned int registerNumber = getNewRegister();
+		emit("\tESValue* r%d = Core::getValue(r%d);", registerNumber, valueRegister);
+		return registerNumber;
+	}
+};
+
+/* 14.2 Arrow Function Definitions: ArrowParameters => ConciseBody
+ * An arrow function whose parameters are plain identifiers is compiled to a C++ function like a FunctionDeclaration
+ * and evaluates to a Function object holding it, unless the call it is passed to recognises its body (see
+ * CallExpression). Like a declared function it sees its parameters and the global bindings, not the locals of an
+ * enclosing function.
+ */
+class ArrowFunctionExpression : public Expression {
+private:
+	vector<Expression*>* formalParameters;
+	Expression* body;
+
+public:
+	ArrowFunctionExpression(vector<Expression*>* formalParameters, Expression* body) {
+		this->formalParameters = formalParameters;
+		this->body = body;
+	}
+
+	/* 14.2.9 Static Semantics: CoveredFormalsList, turns the parenthesised expression the parser saw into the
+	 * parameter list; NULL is the empty list ()
+	 */
+	static vector<Expression*>* toFormalParameters(Expression* cover) {
+		vector<Expression*>* parameters = new vector<Expression*>();
+		CommaExpression* comma = dynamic_cast<CommaExpression*>(cover);
+		if (comma != NULL) {
+			parameters->insert(parameters->end(), comma->getExpressions()->begin(), comma->getExpressions()->end());
+		} else if (cover != NULL) {
+			parameters->push_back(cover);
+		}
+		return parameters;
+	}
+
+	vector<Expression*>* getFormalParameters() {
+		return formalParameters;
+	}
+
+	Expression* getBody() {
+		return body;
+	}
+
+	/* The name of parameter index, or the empty string when it is not a plain identifier */
+	std::string getParameterName(size_t index) {
+		IdentifierExpression* identifier = dynamic_cast<IdentifierExpression*>(formalParameters->at(index));
+		return identifier != NULL ? identifier->getReferencedName() : std::string();
+	}
+
+	void dump(int indent) {
+		label(indent++, "ArrowFunctionExpression\n");
+		label(indent, "FormalParameters\n");
+		for (vector<Expression*>::iterator iter = formalParameters->begin(); iter != formalParameters->end(); ++iter) {
+			(*iter)->dump(indent + 1);
+		}
+		label(indent, "ConciseBody\n");
+		if (body != NULL) {
+			body->dump(indent + 1);
+		}
+	}
+
+	unsigned int genCode() {
+		return getNewRegister();
+	}
+
+	/* 14.2.16 Runtime Semantics: Evaluation */
+	unsigned int genStoreCode() {
+		unsigned int registerNumber = getNewRegister();
+		for (size_t i = 0; i < formalParameters->size(); i++) {
+			if (getParameterName(i).empty()) {
+				emit("\tESValue* r%d = new Function();", registerNumber);
+				return registerNumber;
+			}
+		}
+
+		std::string name = "arrow" + std::to_string(registerNumber);
+		std::string functionDeclaration = "static ESValue* " + name + "(";
+		// created where an environment can be reached, the arrow is a Closure over it
+		std::string environment = innermostEnvironment();
+		bool closure = environment != "NULL";
+		std::set<std::string> enclosingBindings;
+		enclosingBindings.swap(localBindings);
+		size_t enclosingScopeCount = enclosingScopes;
+		enclosingScopes = lexicalScopes.size();
+		size_t enclosingClosureEnvironments = closureEnvironments;
+		closureEnvironments = environments.size();
+		bool enclosingInFunction = inFunction;
+		inFunction = true;
+		ClassContext enclosingClass = currentClass;
+		currentClass = ClassContext();
+		if (closure) {
+			functionDeclaration += "ESValue* closure";
+		}
+		for (size_t i = 0; i < formalParameters->size(); i++) {
+			functionDeclaration += (i > 0 || closure ? ", " : "") + std::string("ESValue* local_") + getParameterName(i);
+			localBindings.insert(getParameterName(i));
+		}
+
+		codeScopeDepth++;
+		unsigned int resultRegister = body->genStoreCode();
+		std::vector<std::string> code = codeScope[codeScopeDepth];
+		codeScope.erase(codeScopeDepth);
+		codeScopeDepth--;
+		localBindings.swap(enclosingBindings);
+		enclosingScopes = enclosingScopeCount;
+		closureEnvironments = enclosingClosureEnvironments;
+		inFunction = enclosingInFunction;
+		currentClass = enclosingClass;
+
+		functionDefinitions.push_back(functionDeclaration + ") {");
+		if (profileFunctions) {
+			functionDefinitions.push_back("\tint profilerDepth = Profiler::enter(\"(arrow)\");");
+		}
+		functionDefinitions.insert(functionDefinitions.end(), code.begin(), code.end());
+		functionDefinitions.push_back("\tESValue* " + name + "_result = Core::getValue(r" + std::to_string(resultRegister)
+			+ ");");
+		if (profileFunctions) {
+			functionDefinitions.push_back("\tProfiler::leave(profilerDepth);");
+		}
+		functionDefinitions.push_back("\treturn " + name + "_result;");
+		functionDefinitions.push_back("}");
+		if (closure) {
+			emitCallTrampoline(name, formalParameters->size(), "ESValue* closure", "closure");
+			emit("\tESValue* r%d = new Closure(%s_call, \"\", %d, %s);", registerNumber, name.c_str(),
+				(int)formalParameters->size(), environment.c_str());
+			return registerNumber;
+		}
+		emitCallTrampoline(name, formalParameters->size());
+
+		emit("\tESValue* r%d = new Function(%s_call, \"\", %d);", registerNumber, name.c_str(),
+			(int)formalParameters->size());
+		return registerNumber;
+	}
+};
+
+/* 14.4.14 Runtime Semantics: Evaluation of YieldExpression, and AwaitExpression (ECMAScript 2017, 14.6 Async Function
+ * Definitions), which suspend the generator or async function they are in. The resume function returns the value
+ * from the frame, see resumable.hpp, and carries on at the label after it with the value it is resumed with in sent.
+ * yield* is a loop that yields each value of the iterator until it is done, its value is the iterator's return
+ * value.
+ */
+class YieldExpression : public Expression {
+private:
+	Expression* operand;
+	bool delegating;
+	bool await;
+
+	/* return frame->suspend(N, value) and the label to resume at, which is where the value sent in arrives */
+	unsigned int emitSuspend(const std::string& value) {
+		unsigned int registerNumber = getNewRegister();
+		emitProfilerLeave();
+		emit("\treturn frame->suspend(%d, %s);", registerNumber, value.c_str());
+		emit("label_resume_%d:", registerNumber);
+		return registerNumber;
+	}
+
+public:
+	YieldExpression(Expression* operand, bool delegating, bool await) {
+		this->operand = operand;
+		this->delegating = delegating;
+		this->await = await;
+	}
+
+	void dump(int indent) {
+		label(indent++, await ? "AwaitExpression\n" : delegating ? "YieldExpression*\n" : "YieldExpression\n");
+		if (operand != NULL) {
+			operand->dump(indent);
+		}
+	}
+
+	unsigned int genCode() {
+		return genStoreCode();
+	}
+
+	unsigned int genStoreCode() {
+		if (delegating) {
+			unsigned int iteratorRegister = getNewRegister();
+			unsigned int sentRegister = getNewRegister();
+			emit("\tESValue* r%d = Generator::iterate(r%d);", iteratorRegister, operand->genStoreCode());
+			emit("\tESValue* r%d = new Undefined();", sentRegister);
+			emit("label_delegate_r%d:", iteratorRegister);
+			unsigned int resultRegister = getNewRegister();
+			emit("\tESValue* r%d = Generator::delegate(r%d, r%d);", resultRegister, iteratorRegister, sentRegister);
+			emit("\tif(IteratorResult::isDone(r%d))", resultRegister);
+			emit("\t\tgoto label_end_delegate_r%d;", iteratorRegister);
+			unsigned int resumeRegister = emitSuspend("IteratorResult::valueOf(r" + std::to_string(resultRegister) + ")");
+			emit("\tr%d = sent;", sentRegister);
+			emit("\tgoto label_delegate_r%d;", iteratorRegister);
+			emit("label_end_delegate_r%d:", iteratorRegister);
+			emit("\tESValue* r%d = IteratorResult::valueOf(r%d);", resumeRegister, resultRegister);
+			return resumeRegister;
+		}
+		std::string value = "new Undefined()";
+		if (operand != NULL) {
+			value = "Core::getValue(r" + std::to_string(operand->genStoreCode()) + ")";
+		}
+		unsigned int registerNumber = emitSuspend(value);
+		emit("\tESValue* r%d = sent;", registerNumber);
+		return registerNumber;
+	}
+};
+
+/* 12.3.4 Function Calls: MemberExpression Arguments
+ * Method calls on built-ins go through Core::callMethod. map and reduce callbacks that are plain arithmetic on
+ * their parameters are recognised here and lowered to the bulk Core::mapArithmetic and Core::reduce kernels
+ * instead of being called per element. Only the name of the method is known here, so the kernels are also given the
+ * callback, which a base that is not an array or typed array is called with.
+ */
+class CallExpression : public Expression {
+private:
+	Expression* callee;
+	vector<Expression*>* arguments;
+
+	static bool isIdentifier(Expression* expression, const std::string& name) {
+		IdentifierExpression* identifier = dynamic_cast<IdentifierExpression*>(expression);
+		return identifier != NULL && !name.empty() && identifier->getReferencedName() == name;
+	}
+
+	static bool isNumericLiteral(Expression* expression, double* value) {
+		DecimalIntegerLiteralExpression* integer = dynamic_cast<DecimalIntegerLiteralExpression*>(expression);
+		if (integer != NULL) {
+			*value = integer->getValue();
+			return true;
+		}
+		DecimalLiteralExpression* decimal = dynamic_cast<DecimalLiteralExpression*>(expression);
+		if (decimal != NULL) {
+			*value = decimal->getValue();
+			return true;
+		}
+		return false;
+	}
+
+	/* x => x op c and x => c op x, op one of + - * / and c a numeric literal */
+	static bool matchMapCallback(Expression* callback, const char** operation, double* constant, bool* constantOnLeft) {
+		ArrowFunctionExpression* arrow = dynamic_cast<ArrowFunctionExpression*>(callback);
+		if (arrow == NULL || arrow->getFormalParameters()->size() != 1) {
+			return false;
+		}
+		BinaryExpression* binary = dynamic_cast<BinaryExpression*>(arrow->getBody());
+		if (binary == NULL || dynamic_cast<ComparisonBinaryExpression*>(binary) != NULL) {
+			return false;
+		}
+		if (dynamic_cast<AdditiveBinaryExpression*>(binary) != NULL) {
+			*operation = "mapAdd";
+		} else if (dynamic_cast<SubtractionBinaryExpression*>(binary) != NULL) {
+			*operation = "mapSubtract";
+		} else if (dynamic_cast<MultiplicativeBinaryExpression*>(binary) != NULL) {
+			*operation = "mapMultiply";
+		} else if (dynamic_cast<DivisionBinaryExpression*>(binary) != NULL) {
+			*operation = "mapDivide";
+		} else {
+			return false;
+		}
+
+		std::string parameter = arrow->getParameterName(0);
+		if (isIdentifier(binary->getLhs(), parameter) && isNumericLiteral(binary->getRhs(), constant)) {
+			*constantOnLeft = false;
+			return true;
+		}
+		if (isNumericLiteral(binary->getLhs(), constant) && isIdentifier(binary->getRhs(), parameter)) {
+			*constantOnLeft = true;
+			return true;
+		}
+		return false;
+	}
+
+	/* (a, b) => a + b, (a, b) => Math.min(a, b) and (a, b) => Math.max(a, b), operands in either order */
+	static bool matchReduceCallback(Expression* callback, const char** operation) {
+		ArrowFunctionExpression* arrow = dynamic_cast<ArrowFunctionExpression*>(callback);
+		if (arrow == NULL || arrow->getFormalParameters()->size() != 2) {
+			return false;
+		}
+		std::string a = arrow->getParameterName(0);
+		std::string b = arrow->getParameterName(1);
+		if (a == b) {
+			return false;
+		}
+
+		Expression* lhs = NULL;
+		Expression* rhs = NULL;
+		AdditiveBinaryExpression* addition = dynamic_cast<AdditiveBinaryExpression*>(arrow->getBody());
+		CallExpression* call = dynamic_cast<CallExpression*>(arrow->getBody());
+		if (addition != NULL) {
+			*operation = "reduceSum";
+			lhs = addition->getLhs();
+			rhs = addition->getRhs();
+		} else if (call != NULL && call->arguments->size() == 2) {
+			PropertyAccessExpression* member = dynamic_cast<PropertyAccessExpression*>(call->callee);
+			if (member == NULL || !isIdentifier(member->getObject(), "Math")) {
+				return false;
+			}
+			if (member->getName() == "min") {
+				*operation = "reduceMin";
+			} else if (member->getName() == "max") {
+				*operation = "reduceMax";
+			} else {
+				return false;
+			}
+			lhs = call->arguments->at(0);
+			rhs = call->arguments->at(1);
+		} else {
+			return false;
+		}
+		return (isIdentifier(lhs, a) && isIdentifier(rhs, b)) || (isIdentifier(lhs, b) && isIdentifier(rhs, a));
+	}
+
+	/* console.log(...) writes straight into the buffered Console output */
+	unsigned int genConsoleLogCode() {
+		std::string argumentValues;
+		char argumentValue[40];
+		for (vector<Expression*>::iterator iter = arguments->begin(); iter != arguments->end(); ++iter) {
+			snprintf(argumentValue, sizeof(argumentValue), "Core::getValue(r%d), ", (*iter)->genStoreCode());
+			argumentValues += argumentValue;
+		}
+		unsigned int registerNumber = getNewRegister();
+		if (arguments->empty()) {
+			emit("\tESValue* r%d = Console::log(NULL, 0);", registerNumber);
+		} else {
+			emit("\tESValue* r%d_arguments[] = {%s};", registerNumber, argumentValues.c_str());
+			emit("\tESValue* r%d = Console::log(r%d_arguments, %d);", registerNumber, registerNumber, (int)arguments->size());
+		}
+		return registerNumber;
+	}
+
+	/* The call of the C function of a method of the class being generated, with the arguments as its parameters */
+	static std::string genDirectCall(const std::string& method, const std::vector<unsigned int>& argumentRegisters) {
+		std::string call = "Core::getValue(class_" + currentClass.name + "_" + method + "(self";
+		size_t parameterCount = currentClass.methods[method];
+		for (size_t i = 0; i < parameterCount; i++) {
+			call += i < argumentRegisters.size() ? ", Core::getValue(r" + std::to_string(argumentRegisters[i]) + ")"
+				: ", new Undefined()";
+		}
+		return call + "))";
+	}
+
+public:
+	CallExpression(Expression* callee, vector<Expression*>* arguments) {
+		this->callee = callee;
+		this->arguments = arguments;
+	}
+
+	void dump(int indent) {
+		label(indent++, "CallExpression\n");
+		callee->dump(indent);
+		label(indent, "Arguments\n");
+		for (vector<Expression*>::iterator iter = arguments->begin(); iter != arguments->end(); ++iter) {
+			(*iter)->dump(indent + 1);
+		}
+	}
+
+	unsigned int genCode() {
+		return getNewRegister();
+	}
+
+	unsigned int genStoreCode() {
+		PropertyAccessExpression* member = dynamic_cast<PropertyAccessExpression*>(callee);
+		if (member != NULL && member->getName() == "log" && isIdentifier(member->getObject(), "console")) {
+			return genConsoleLogCode();
+		}
+		unsigned int baseRegister = member != NULL ? member->getObject()->genStoreCode() : callee->genStoreCode();
+
+		if (member != NULL && member->getName() == "map" && arguments->size() == 1) {
+			const char* operation;
+			double constant;
+			bool constantOnLeft;
+			if (matchMapCallback(arguments->at(0), &operation, &constant, &constantOnLeft)) {
+				// the callback is still passed, for a base that turns out to have a map of its own
+				unsigned int callbackRegister = arguments->at(0)->genStoreCode();
+				unsigned int registerNumber = getNewRegister();
+				emit("\tESValue* r%d = Core::mapArithmetic(r%d, %s, %s, %s, r%d);", registerNumber, baseRegister,
+					operation, numberLiteral(constant).c_str(), constantOnLeft ? "true" : "false", callbackRegister);
+				return registerNumber;
+			}
+		}
+		if (member != NULL && member->getName() == "reduce" && (arguments->size() == 1 || arguments->size() == 2)) {
+			const char* operation;
+			if (matchReduceCallback(arguments->at(0), &operation)) {
+				unsigned int callbackRegister = arguments->at(0)->genStoreCode();
+				unsigned int registerNumber;
+				if (arguments->size() == 2) {
+					unsigned int initialRegister = arguments->at(1)->genStoreCode();
+					registerNumber = getNewRegister();
+					emit("\tESValue* r%d = Core::reduce(r%d, %s, r%d, r%d);", registerNumber, baseRegister, operation,
+						callbackRegister, initialRegister);
+				} else {
+					registerNumber = getNewRegister();
+					emit("\tESValue* r%d = Core::reduce(r%d, %s, r%d, NULL);", registerNumber, baseRegister, operation,
+						callbackRegister);
+				}
+				return registerNumber;
+			}
+		}
+
+		std::string argumentRegisters;
+		std::vector<unsigned int> argumentRegisterNumbers;
+		char argumentRegister[16];
+		for (vector<Expression*>::iterator iter = arguments->begin(); iter != arguments->end(); ++iter) {
+			argumentRegisterNumbers.push_back((*iter)->genStoreCode());
+			snprintf(argumentRegister, sizeof(argumentRegister), "r%d, ", argumentRegisterNumbers.back());
+			argumentRegisters += argumentRegister;
+		}
+
+		unsigned int registerNumber = getNewRegister();
+		std::string argumentArray = "NULL";
+		if (!arguments->empty()) {
+			emit("\tESValue* r%d_arguments[] = {%s};", registerNumber, argumentRegisters.c_str());
+			argumentArray = "r" + std::to_string(registerNumber) + "_arguments";
+		}
+		if (member != NULL && classMethods.count(member->getName()) > 0) {
+			functionDefinitions.push_back("static __thread MethodCache r" + std::to_string(registerNumber) + "_cache;");
+			std::string cachedCall = "Core::callMethod(r" + std::to_string(baseRegister) + ", \"" + member->getName()
+				+ "\", " + argumentArray + ", " + std::to_string(arguments->size()) + ", &r"
+				+ std::to_string(registerNumber) + "_cache)";
+			if (dynamic_cast<ThisExpression*>(member->getObject()) != NULL && !currentClass.name.empty()
+					&& currentClass.methods.count(member->getName()) > 0) {
+				// this.method(...) in its own class: a direct C call while the instance has no property that could
+				// shadow the method
+				emit("\tESValue* r%d = self->isExpanded() ? %s : %s;", registerNumber, cachedCall.c_str(),
+					genDirectCall(member->getName(), argumentRegisterNumbers).c_str());
+			} else {
+				emit("\tESValue* r%d = %s;", registerNumber, cachedCall.c_str());
+			}
+		} else if (member != NULL) {
+			emit("\tESValue* r%d = Core::callMethod(r%d, \"%s\", %s, %d);", registerNumber, baseRegister,
+				member->getName().c_str(), argumentArray.c_str(), (int)arguments->size());
+		} else {
+			emit("\tESValue* r%d = Core::call(r%d, %s, %d);", registerNumber, baseRegister, argumentArray.c_str(),
+				(int)arguments->size());
+		}
+		return registerNumber;
+	}
+};
+
+/* A value the generated code already holds in a register, the right hand side of the assignments a binding pattern
+ * binds its elements with
+ */
+class RegisterExpression : public Expression {
+private:
+	unsigned int registerNumber;
+public:
+	RegisterExpression(unsigned int registerNumber) {
+		this->registerNumber = registerNumber;
+	}
+
+	void dump(int indent) {
+		label(indent, "RegisterExpression r%d\n", registerNumber);
+	}
+
+	unsigned int genCode() {
+		return getNewRegister();
+	}
+
+	unsigned int genStoreCode() {
+		return registerNumber;
+	}
+};
+
+/* 13.3.3 Destructuring Binding Patterns
+ * An element of a binding pattern: the property key it reads in an object pattern, NULL for a shorthand name and in
+ * an array pattern, the target it binds, which is a name, a nested pattern or, in a destructuring assignment, any
+ * reference, and its default value
+ */
+class BindingElementExpression : public Expression {
+private:
+	Expression* key;
+	Expression* target;
+	Expression* initializer;
+	bool rest;
+public:
+	BindingElementExpression(Expression* key, Expression* target, Expression* initializer, bool rest = false) {
+		this->key = key;
+		this->target = target;
+		this->initializer = initializer;
+		this->rest = rest;
+	}
+
+	/* element, a name, a pattern or a BindingElementExpression with a default, as the element reading key */
+	static BindingElementExpression* of(Expression* element, Expression* key) {
+		BindingElementExpression* binding = dynamic_cast<BindingElementExpression*>(element);
+		if (binding == NULL) {
+			binding = new BindingElementExpression(NULL, element, NULL);
+		}
+		binding->key = key;
+		return binding;
+	}
+
+	Expression* getKey() {
+		return key;
+	}
+
+	Expression* getTarget() {
+		return target;
+	}
+
+	Expression* getInitializer() {
+		return initializer;
+	}
+
+	bool isRest() {
+		return rest;
+	}
+
+	/* The property name it reads in an object pattern, empty when the key is computed or numeric */
+	std::string getName() {
+		LiteralPropertyNameExpression* literal = dynamic_cast<LiteralPropertyNameExpression*>(key);
+		if (literal != NULL) {
+			return literal->getName();
+		}
+		IdentifierExpression* identifier = dynamic_cast<IdentifierExpression*>(target);
+		if (key == NULL && identifier != NULL) {
+			return identifier->getReferencedName();
+		}
+		return "";
+	}
+
+	void dump(int indent) {
+		label(indent, rest ? "BindingRestElementExpression\n" : "BindingElementExpression\n");
+		if (key != NULL) {
+			key->dump(indent + 1, "key");
+		}
+		target->dump(indent + 1, "target");
+		if (initializer != NULL) {
+			initializer->dump(indent + 1, "initializer");
+		}
+	}
+
+	unsigned int genCode() {
+		return getNewRegister();
+	}
+
+	unsigned int genStoreCode() {
+		return getNewRegister();
+	}
+
+	/* 13.3.3.8 KeyedBindingInitialization: binds the target to the value in valueRegister, or to the default when
+	 * that is undefined. declaration is the let or const statement that declares the names of the target, NULL when
+	 * they are assigned.
+	 */
+	unsigned int genBindCode(unsigned int valueRegister, const void* declaration = NULL);
+
+	/* 13.3.3.1 Static Semantics: BoundNames, appended to names */
+	void getBoundNames(std::vector<std::string>& names);
+
+	/* 13.3.1.4 InitializeReferencedBinding: name, of the let or const declaration, to the value in valueRegister */
+	unsigned int genInitializeCode(IdentifierExpression* name, unsigned int valueRegister,
+			const void* declaration);
+};
+
+/* 13.3.3 Destructuring Binding Patterns and 12.14.5 Destructuring Assignment
+ * An object or array pattern, lowered to one load per element into a register the element is bound from: a property
+ * of an object is read with Core::destructureProperty, the elements of an array into a C array on the stack with
+ * Core::destructureArray, which reads a dense array in place and anything else through its iterator. Neither creates
+ * an iterator or a copy of the source, and when the source is an array literal its elements are bound directly and
+ * the array is never created.
+ */
+class BindingPatternExpression : public Expression {
+private:
+	bool objectPattern;
+	vector<Expression*>* elements; // BindingElementExpressions, NULL for the holes of an array pattern
+public:
+	BindingPatternExpression(bool objectPattern, vector<Expression*>* elements) {
+		this->objectPattern = objectPattern;
+		this->elements = elements;
+	}
+
+	/* The array literal on the left of a destructuring assignment as the pattern it is */
+	static BindingPatternExpression* of(ArrayLiteralExpression* literal) {
+		vector<Expression*>* elements = new vector<Expression*>();
+		for (vector<Expression*>::iterator iter = literal->getElements()->begin();
+				iter != literal->getElements()->end(); ++iter) {
+			Expression* target = *iter;
+			Expression* initializer = NULL;
+			AssignmentExpression* assignment = dynamic_cast<AssignmentExpression*>(target);
+			if (assignment != NULL && assignment->getOperand() == 0) {
+				target = assignment->getLhs();
+				initializer = assignment->getRhs();
+			}
+			ArrayLiteralExpression* nested = dynamic_cast<ArrayLiteralExpression*>(target);
+			if (nested != NULL) {
+				target = of(nested);
+			}
+			elements->push_back(new BindingElementExpression(NULL, target, initializer));
+		}
+		return new BindingPatternExpression(false, elements);
+	}
+
+	void dump(int indent) {
+		label(indent, objectPattern ? "ObjectBindingPatternExpression\n" : "ArrayBindingPatternExpression\n");
+		for (vector<Expression*>::iterator iter = elements->begin(); iter != elements->end(); ++iter) {
+			if (*iter == NULL) {
+				label(indent + 1, "Elision\n");
+			} else {
+				(*iter)->dump(indent + 1);
+			}
+		}
+	}
+
+	/* 13.3.3.1 Static Semantics: BoundNames, appended to names */
+	void getBoundNames(std::vector<std::string>& names) {
+		for (vector<Expression*>::iterator iter = elements->begin(); iter != elements->end(); ++iter) {
+			if (*iter != NULL) {
+				static_cast<BindingElementExpression*>(*iter)->getBoundNames(names);
+			}
+		}
+	}
+
+	unsigned int genCode() {
+		return getNewRegister();
+	}
+
+	unsigned int genStoreCode() {
+		return getNewRegister();
+	}
+
+	/* 13.3.3.5 BindingInitialization of the pattern with the value in sourceRegister, declaration as for
+	 * BindingElementExpression::genBindCode
+	 */
+	unsigned int genBindCode(unsigned int sourceRegister, const void* declaration = NULL) {
+		unsigned int registerNumber = getNewRegister();
+		emit("\tESValue* r%d = Core::getValue(r%d);", registerNumber, sourceRegister);
+
+		if (objectPattern) {
+			for (vector<Expression*>::iterator iter = elements->begin(); iter != elements->end(); ++iter) {
+				BindingElementExpression* element = static_cast<BindingElementExpression*>(*iter);
+				std::string name = element->getName();
+				unsigned int valueRegister;
+				if (!name.empty()) {
+					valueRegister = getNewRegister();
+					emit("\tESValue* r%d = Core::destructureProperty(r%d, \"%s\");", valueRegister, registerNumber,
+						name.c_str());
+				} else {
+					unsigned int keyRegister = element->getKey()->genStoreCode();
+					valueRegister = getNewRegister();
+					emit("\tESValue* r%d = Core::getElement(r%d, r%d);", valueRegister, registerNumber, keyRegister);
+				}
+				element->genBindCode(valueRegister, declaration);
+			}
+			return registerNumber;
+		}
+
+		BindingElementExpression* rest = NULL;
+		size_t count = elements->size();
+		if (count > 0 && elements->back() != NULL && static_cast<BindingElementExpression*>(elements->back())->isRest()) {
+			rest = static_cast<BindingElementExpression*>(elements->back());
+			count--;
+		}
+		emit("\tESValue* r%d_slots[%d];", registerNumber, (int)(count > 0 ? count : 1));
+		if (rest != NULL) {
+			emit("\tESValue* r%d_rest;", registerNumber);
+		}
+		emit("\tCore::destructureArray(r%d, r%d_slots, %d, %s);", registerNumber, registerNumber, (int)count,
+			rest != NULL ? ("&r" + std::to_string(registerNumber) + "_rest").c_str() : "NULL");
+		for (size_t i = 0; i < count; i++) {
+			if ((*elements)[i] == NULL) {
+				continue;
+			}
+			unsigned int valueRegister = getNewRegister();
+			emit("\tESValue* r%d = r%d_slots[%d];", valueRegister, registerNumber, (int)i);
+			static_cast<BindingElementExpression*>((*elements)[i])->genBindCode(valueRegister, declaration);
+		}
+		if (rest != NULL) {
+			unsigned int valueRegister = getNewRegister();
+			emit("\tESValue* r%d = r%d_rest;", valueRegister, registerNumber);
+			rest->genBindCode(valueRegister, declaration);
+		}
+		return registerNumber;
+	}
+
+	/* The pattern bound to initializer. The elements of an array literal are all evaluated before the first one is
+	 * bound, as the array would be, and then bound from their registers.
+	 */
+	unsigned int genBindCode(Expression* initializer, const void* declaration = NULL) {
+		ArrayLiteralExpression* literal = dynamic_cast<ArrayLiteralExpression*>(initializer);
+		if (objectPattern || literal == NULL || (!elements->empty() && elements->back() != NULL
+				&& static_cast<BindingElementExpression*>(elements->back())->isRest())) {
+			return genBindCode(initializer->genStoreCode(), declaration);
+		}
+
+		std::vector<unsigned int> valueRegisters;
+		for (vector<Expression*>::iterator iter = literal->getElements()->begin();
+				iter != literal->getElements()->end(); ++iter) {
+			unsigned int elementRegister = (*iter)->genStoreCode();
+			valueRegisters.push_back(getNewRegister());
+			emit("\tESValue* r%d = Core::getValue(r%d);", valueRegisters.back(), elementRegister);
+		}
+		unsigned int registerNumber = getNewRegister();
+		for (size_t i = 0; i < elements->size(); i++) {
+			if ((*elements)[i] == NULL) {
+				continue;
+			}
+			unsigned int valueRegister;
+			if (i < valueRegisters.size()) {
+				valueRegister = valueRegisters[i];
+			} else {
+				valueRegister = getNewRegister();
+				emit("\tESValue* r%d = new Undefined();", valueRegister);
+			}
+			registerNumber = static_cast<BindingElementExpression*>((*elements)[i])->genBindCode(valueRegister,
+				declaration);
+		}
+		return registerNumber;
+	}
+};
+
+inline unsigned int BindingElementExpression::genBindCode(unsigned int valueRegister, const void* declaration) {
+	unsigned int registerNumber = valueRegister;
+	if (initializer != NULL) {
+		registerNumber = getNewRegister();
+		emit("\tESValue* r%d = Core::getValue(r%d);", registerNumber, valueRegister);
+		emit("\tif(r%d->getType() != undefined)", registerNumber);
+		emit("\t\tgoto label_default_r%d;", registerNumber);
+		emit("\t{");
+		unsigned int defaultRegister = initializer->genStoreCode();
+		emit("\tr%d = Core::getValue(r%d);", registerNumber, defaultRegister);
+		emit("\t}");
+		emit("label_default_r%d:", registerNumber);
+	}
+
+	BindingPatternExpression* pattern = dynamic_cast<BindingPatternExpression*>(target);
+	if (pattern != NULL) {
+		return pattern->genBindCode(registerNumber, declaration);
+	}
+	if (declaration != NULL) {
+		return genInitializeCode(static_cast<IdentifierExpression*>(target), registerNumber, declaration);
+	}
+	AssignmentExpression assignment(target, new RegisterExpression(registerNumber));
+	return assignment.genStoreCode();
+}
+
+inline void BindingElementExpression::getBoundNames(std::vector<std::string>& names) {
+	BindingPatternExpression* pattern = dynamic_cast<BindingPatternExpression*>(target);
+	if (pattern != NULL) {
+		pattern->getBoundNames(names);
+	} else {
+		names.push_back(static_cast<IdentifierExpression*>(target)->getReferencedName());
+	}
+}
+
+/* A binding its scope did not make a C local, see StatementList, is a property of the global object. Without a
+ * declaration, for a var or an assignment, the name is assigned wherever it resolves, as by AssignmentExpression.
+ */
+inline unsigned int BindingElementExpression::genInitializeCode(IdentifierExpression* name, unsigned int valueRegister,
+		const void* declaration) {
+	std::string environment;
+	LexicalScope::LexicalBinding* binding = NULL;
+	if (declaration == NULL) {
+		binding = resolveLexical(name->getReferencedName(), &environment);
+	} else if (!lexicalScopes.empty()) {
+		binding = lexicalScopes.back()->resolveDeclared(name->getReferencedName(), declaration);
+		environment = binding != NULL && binding->captured ? environmentOf(lexicalScopes.back()) : "";
+	}
+	unsigned int registerNumber = getNewRegister();
+	if (binding == NULL && localBindings.count(name->getReferencedName()) > 0) {
+		emit("\tlocal_%s = Core::getValue(r%d);", name->getReferencedName().c_str(), valueRegister);
+		emit("\tESValue* r%d = local_%s;", registerNumber, name->getReferencedName().c_str());
+		return registerNumber;
+	}
+	if (binding == NULL) {
+		lexicalStatistics.globals++;
+		emit("\tESValue* r%d = Core::assign(new Reference(new String(\"%s\")), r%d);", registerNumber,
+			name->getReferencedName().c_str(), valueRegister);
+		return registerNumber;
+	}
+	std::string value = binding->captured ? environment + "->getBinding(" + std::to_string(binding->registerNumber)
+		+ ")" : "r" + std::to_string(binding->registerNumber);
+	if (declaration == NULL && binding->constant) {
+		emit("\tCore::assignConstant(%s);", value.c_str());
+		return valueRegister;
+	}
+	if (declaration == NULL && !binding->initialized) {
+		emit("\tCore::initializedBinding(%s);", value.c_str());
+	}
+	if (binding->captured) {
+		emit("\tESValue* r%d = %s->setBinding(%d, Core::getValue(r%d));", registerNumber, environment.c_str(),
+			binding->registerNumber, valueRegister);
+	} else {
+		emit("\tr%d = Core::getValue(r%d);", binding->registerNumber, valueRegister);
+		emit("\tESValue* r%d = r%d;", registerNumber, binding->registerNumber);
+	}
+	binding->initialized = binding->initialized || declaration != NULL;
+	return registerNumber;
+}
+
+inline bool AssignmentExpression::isAssignmentPattern(Expression* lhs) {
+	return dynamic_cast<ArrayLiteralExpression*>(lhs) != NULL;
+}
+
+/* The value of the assignment is its right hand side, when it is not used an array literal there is never created */
+inline unsigned int AssignmentExpression::genDestructuringCode(bool valueUsed) {
+	BindingPatternExpression* pattern = BindingPatternExpression::of(static_cast<ArrayLiteralExpression*>(lhs));
+	if (!valueUsed) {
+		return pattern->genBindCode(rhs);
+	}
+	unsigned int registerNumber = rhs->genStoreCode();
+	pattern->genBindCode(registerNumber);
+	return registerNumber;
+}
@@ -3,4 +3,13 @@ static const char* SUBTRACTION = "subtract";
 static const char* MULTIPLICATION = "multiply";
 static const char* DIVISION = "divide";
 static const char* LABEL_BREAK = "break";
-static const char* LABEL_CONTINUE = "continue";
\ No newline at end of file
+static const char* LABEL_CONTINUE = "continue";
+static const char* LESS_THAN_OPERATION = "lessThan";
+static const char* GREATER_THAN_OPERATION = "greaterThan";
+static const char* LESS_THAN_OR_EQUAL_OPERATION = "lessThanOrEqual";
+static const char* GREATER_THAN_OR_EQUAL_OPERATION = "greaterThanOrEqual";
+static const char* EQUALS_OPERATION = "equals";
+static const char* NOT_EQUALS_OPERATION = "notEquals";
+static const char* STRICT_EQUALS_OPERATION = "strictEquals";
+static const char* STRICT_NOT_EQUALS_OPERATION = "strictNotEquals";
+static const char* MODULUS = "modulo";
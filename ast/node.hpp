@@ -2,6 +2,11 @@
 #include <cstdarg>
 #include <cstdio>
 #include <iostream>
+#include <limits>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
 
 
 #include "../scope/lexical_scope.hpp"
@@ -12,6 +17,7 @@
 
 extern std::map<int, std::vector<std::string> > codeScope;
 extern int codeScopeDepth;
+extern std::vector<std::string> functionDefinitions;
 using namespace std;
 
 class Node {
@@ -19,6 +25,64 @@ public:
 	//This is used to generate the variable names of register in the pseudo machine code
 	static int registerIndex;
 
+	// set by --profile: generated functions push a profiler frame, see runtime/profiler.hpp
+	static bool profileFunctions;
+
+	// set by --entry: the top level of the script is a function of this name instead of main, see
+	// runtime/embedding.hpp
+	static const char* entryPoint;
+
+	// the parameters of the function being generated, which are its C locals local_<name>; every other name is a
+	// property of the global object
+	static std::set<std::string> localBindings;
+
+	// the class whose constructor or methods are being generated, see ClassDeclaration, with an empty name anywhere
+	// else. this is the C parameter self, fields are the names its constructor assigns to this, which are the slots
+	// of its instances in order, and methods maps the name of each method to its number of parameters
+	struct ClassContext {
+		std::string name;
+		std::vector<std::string> fields;
+		std::map<std::string, size_t> methods;
+		bool inConstructor;
+	};
+	static ClassContext currentClass;
+
+	// the names of the methods of every class the script declares, collected while it is parsed: a call site
+	// base.name(...) with one of these names gets an inline cache, see Core::callMethod
+	static std::set<std::string> classMethods;
+
+	// the scopes of the blocks being generated, innermost last, of which the first enclosingScopes belong to the
+	// functions enclosing the one being generated, see LexicalScope. lexicalCaptured is set when a binding is found
+	// to be captured after its scope was generated, see ScriptBody.
+	static std::vector<LexicalScope*> lexicalScopes;
+	static size_t enclosingScopes;
+	static bool lexicalCaptured;
+
+	// the scopes with an environment the code being generated can reach, innermost last, see Environment. The first
+	// closureEnvironments of them belong to the functions enclosing an arrow function and are reached through its
+	// parameter closure, a function declaration or a method reaches none of them. inFunction is false at the top
+	// level of the script, where the captured bindings of its own statement list stay properties of the global
+	// object, which the function declarations of the script can reach; a block or loop body nested in it gets an
+	// environment each time it runs, as in a function.
+	static std::vector<LexicalScope*> environments;
+	static size_t closureEnvironments;
+	static bool inFunction;
+
+	// set once a compile error has been reported, the script is then not written out
+	static bool compileFailed;
+
+	// what generating let and const did, reported on stderr: the bindings that became C locals, those captured into
+	// environments and those left on the global object, and the uses of the locals that check the temporal dead zone
+	// and those proven not to need it
+	struct LexicalStatistics {
+		size_t locals;
+		size_t captured;
+		size_t globals;
+		size_t checksEmitted;
+		size_t checksRemoved;
+	};
+	static LexicalStatistics lexicalStatistics;
+
 	virtual void dump(int indent)=0;
 	virtual unsigned int genCode() = 0;
 
@@ -34,6 +98,121 @@ public:
 		va_end(args);
 	}
 
+	// pops the profiler frame of the function being returned from, see runtime/profiler.hpp
+	void emitProfilerLeave() {
+		if (profileFunctions) {
+			emit("\tProfiler::leave(profilerDepth);");
+		}
+	}
+
+	/* 9.2.1 [[Call]] through the function object: name_call takes the arguments as an array and calls name with them,
+	 * missing arguments are undefined and extra ones are dropped. The trampoline of a method also passes on its
+	 * receiver self and that of a Closure its environment closure, the parameter declared by first.
+	 */
+	void emitCallTrampoline(const std::string& name, size_t parameterCount, const std::string& first = "",
+			const std::string& firstName = "") {
+		std::string call = "\treturn " + name + "(" + firstName;
+		for (size_t i = 0; i < parameterCount; i++) {
+			call += (i > 0 || !first.empty() ? ", " : "") + std::string("argumentCount > ") + std::to_string(i)
+				+ " ? arguments[" + std::to_string(i) + "] : new Undefined()";
+		}
+		functionDefinitions.push_back("static ESValue* " + name + "_call(" + (first.empty() ? "" : first + ", ")
+			+ "ESValue** arguments, int argumentCount) {");
+		functionDefinitions.push_back(call + ");");
+		functionDefinitions.push_back("}");
+	}
+
+	/* A double as a C expression: %.17g gives it back exactly, but prints an infinity as inf, which C does not know */
+	static std::string numberLiteral(double value) {
+		if (value == std::numeric_limits<double>::infinity()) {
+			return "std::numeric_limits<double>::infinity()";
+		}
+		if (value == -std::numeric_limits<double>::infinity()) {
+			return "-std::numeric_limits<double>::infinity()";
+		}
+		char literal[32];
+		snprintf(literal, sizeof(literal), "%.17g", value);
+		return literal;
+	}
+
+	/* Reports a script the compiler cannot lower */
+	static void compileError(const std::string& message) {
+		// the script is generated again while bindings are found to be captured, the error is reported once
+		if (!compileFailed) {
+			fprintf(stderr, "Compile Error:\n%s\n", message.c_str());
+		}
+		compileFailed = true;
+	}
+
+	/* The environment of scope as an Environment*, or the empty string when the code being generated cannot reach it */
+	static std::string environmentOf(LexicalScope* scope) {
+		for (size_t i = environments.size(); i > 0; i--) {
+			if (environments[i - 1] != scope) {
+				continue;
+			}
+			if (i > closureEnvironments) {
+				return "Environment::of(r" + std::to_string(scope->getEnvironmentRegister()) + ", 0)";
+			}
+			return "Environment::of(closure, " + std::to_string(closureEnvironments - i) + ")";
+		}
+		return "";
+	}
+
+	/* The innermost environment the code being generated can reach, as an ESValue*, or NULL */
+	static std::string innermostEnvironment() {
+		if (environments.size() > closureEnvironments) {
+			return "r" + std::to_string(environments.back()->getEnvironmentRegister());
+		}
+		return closureEnvironments > 0 ? "closure" : "NULL";
+	}
+
+	/* The let, const or var binding name refers to in the function being generated, or NULL for a parameter or a
+	 * property of the global object. A binding of an enclosing function is captured, as this function cannot see its
+	 * locals, and a captured binding is read and written through *environment, see environmentOf.
+	 */
+	static LexicalScope::LexicalBinding* resolveLexical(const std::string& name, std::string* environment) {
+		for (size_t i = lexicalScopes.size(); i > enclosingScopes; i--) {
+			LexicalScope::LexicalBinding* binding = lexicalScopes[i - 1]->resolveLexical(name);
+			if (binding != NULL) {
+				if (binding->captured) {
+					*environment = environmentOf(lexicalScopes[i - 1]);
+				}
+				return binding;
+			}
+		}
+		if (localBindings.count(name) > 0) {
+			return NULL;
+		}
+		for (size_t i = enclosingScopes; i > 0; i--) {
+			LexicalScope::LexicalBinding* binding = lexicalScopes[i - 1]->resolveLexical(name);
+			if (binding == NULL) {
+				continue;
+			}
+			if (!binding->captured) {
+				lexicalCaptured = lexicalScopes[i - 1]->capture(name) || lexicalCaptured;
+				return NULL;
+			}
+			*environment = environmentOf(lexicalScopes[i - 1]);
+			if (environment->empty()) {
+				compileError("'" + name + "' is captured by a method or a nested function declaration, only arrow "
+					"functions capture the let and const bindings of the function they are in");
+				return NULL;
+			}
+			return binding;
+		}
+		return NULL;
+	}
+
+	/* The slot of this.name in the class being generated, or -1 */
+	static int fieldIndex(const std::string& name) {
+		for (size_t i = 0; i < currentClass.fields.size(); i++) {
+			if (currentClass.fields[i] == name) {
+				return (int)i;
+			}
+		}
+		return -1;
+	}
+
 	void indent(int N) {
 		for (int i = 0; i < N; i++)
 			printf("    ");
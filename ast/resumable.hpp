@@ -0,0 +1,326 @@
+#pragma once
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "dead_code.hpp"
+
+using namespace std;
+
+/* Lowers the body of a generator or async function to a C state machine, see runtime/generator.hpp.
+ * Each yield and await is emitted as
+ *	return frame->suspend(N, value);
+ * label_resume_N:
+ * and the body becomes a resume function that switches on the resume point of its frame to those labels. C++
+ * does not let a jump cross the initialisation of a local, so every register is declared at the top of the resume
+ * function and its definition becomes an assignment, array initialisers one element at a time.
+ *
+ * What the C compiler would have kept on the stack across a suspension has to be in the frame instead: the
+ * parameters, which are stored before every suspension and loaded once on entry, and the registers live across
+ * it, which are stored before it and loaded again after its label. A register is live across a suspension when it
+ * is defined before it and read after it, where a goto back to a label the register is read after counts as a
+ * read at the goto. Every other register stays a C local.
+ */
+class ResumableFunction {
+private:
+	struct Definition {
+		string type;
+		size_t line;
+		size_t lastRead;
+		vector<size_t> reads;
+	};
+
+	string name;
+	vector<string> parameters;
+	bool async;
+
+	// the body with its definitions turned into assignments, and the declarations they need
+	vector<string> lines;
+	vector<string> declarations;
+	map<string, Definition> registers;
+
+	typedef DeadCodeElimination Text;
+
+	/* The point N of a line "return frame->suspend(N, ...);", or 0 */
+	static int suspendPoint(const string& statement) {
+		static const char* prefix = "return frame->suspend(";
+		if (!Text::startsWith(statement, prefix)) {
+			return 0;
+		}
+		return atoi(statement.c_str() + strlen(prefix));
+	}
+
+	/* The elements of an initialiser "{a, b, }", split at the commas outside parentheses */
+	static vector<string> splitElements(const string& initialiser) {
+		vector<string> elements;
+		string element;
+		int depth = 0;
+		for (size_t i = initialiser.find('{') + 1; i < initialiser.rfind('}'); i++) {
+			char c = initialiser[i];
+			if (c == ',' && depth == 0) {
+				elements.push_back(Text::trim(element));
+				element.clear();
+				continue;
+			}
+			depth += c == '(' ? 1 : c == ')' ? -1 : 0;
+			element += c;
+		}
+		if (!Text::trim(element).empty()) {
+			elements.push_back(Text::trim(element));
+		}
+		return elements;
+	}
+
+	/* Moves the declarations of the registers out of the body */
+	void hoistDefinitions(const vector<string>& body) {
+		for (size_t i = 0; i < body.size(); i++) {
+			string statement = Text::trim(body[i]);
+			string defined = Text::definedRegister(statement);
+			if (defined.empty()) {
+				lines.push_back(body[i]);
+				continue;
+			}
+			size_t at = statement.find(" " + defined) + 1;
+			string type = Text::trim(statement.substr(0, at));
+			if (statement.compare(at + defined.size(), 2, "[]") == 0) {
+				string initialiser = statement;
+				int balance = Text::braceBalance(body[i]);
+				while (balance > 0 && i + 1 < body.size()) {
+					i++;
+					initialiser += body[i];
+					balance += Text::braceBalance(body[i]);
+				}
+				vector<string> elements = splitElements(initialiser);
+				declarations.push_back("\t" + type + " " + defined + "[" + to_string(elements.size()) + "];");
+				for (size_t k = 0; k < elements.size(); k++) {
+					lines.push_back("\t" + defined + "[" + to_string(k) + "] = " + elements[k] + ";");
+				}
+				continue;
+			}
+			declarations.push_back("\t" + type + " " + defined + ";");
+			Definition definition;
+			definition.type = type;
+			definition.line = lines.size();
+			definition.lastRead = lines.size();
+			registers[defined] = definition;
+			lines.push_back(body[i].substr(0, body[i].find_first_not_of(" \t")) + statement.substr(at));
+		}
+	}
+
+	/* Where each register is read, with the reads of the loops it is read in extended to their gotos back */
+	void findReads() {
+		map<string, size_t> labels;
+		vector<pair<size_t, string> > jumps;
+		for (size_t i = 0; i < lines.size(); i++) {
+			string statement = Text::trim(lines[i]);
+			if (!lines[i].empty() && lines[i][0] != '\t' && lines[i][0] != ' '
+					&& statement[statement.size() - 1] == ':') {
+				labels[statement.substr(0, statement.size() - 1)] = i;
+				continue;
+			}
+			size_t jump = statement.find("goto ");
+			if (jump != string::npos) {
+				jumps.push_back(make_pair(i, statement.substr(jump + 5, statement.find(';', jump) - jump - 5)));
+			}
+			map<string, int> counts;
+			Text::countRegisters(lines[i], counts);
+			for (map<string, int>::iterator it = counts.begin(); it != counts.end(); ++it) {
+				map<string, Definition>::iterator definition = registers.find(it->first);
+				if (definition != registers.end() && definition->second.line != i) {
+					definition->second.reads.push_back(i);
+					definition->second.lastRead = i;
+				}
+			}
+		}
+
+		for (map<string, Definition>::iterator it = registers.begin(); it != registers.end(); ++it) {
+			Definition& definition = it->second;
+			// a loop runs its body again after a suspension in it, so the goto back reads what the body reads
+			bool extended = true;
+			while (extended) {
+				extended = false;
+				for (size_t k = 0; k < jumps.size(); k++) {
+					map<string, size_t>::iterator target = labels.find(jumps[k].second);
+					if (target == labels.end() || target->second >= jumps[k].first
+							|| target->second <= definition.line || definition.lastRead >= jumps[k].first) {
+						continue;
+					}
+					vector<size_t>::iterator read = lower_bound(definition.reads.begin(), definition.reads.end(),
+						target->second);
+					if (read != definition.reads.end() && *read <= jumps[k].first) {
+						definition.lastRead = jumps[k].first;
+						extended = true;
+					}
+				}
+			}
+		}
+	}
+
+	/* The registers that are never read: their definitions become expression statements, or go when they are pure,
+	 * as DeadCodeElimination does for the registers it can still see defined
+	 */
+	void dropUnread() {
+		for (map<string, Definition>::iterator it = registers.begin(); it != registers.end();) {
+			if (!it->second.reads.empty()) {
+				++it;
+				continue;
+			}
+			string& line = lines[it->second.line];
+			string indent = line.substr(0, line.find_first_not_of(" \t"));
+			line = Text::isPure(line) ? "" : indent + Text::trim(line.substr(line.find('=') + 1));
+			declarations.erase(find(declarations.begin(), declarations.end(),
+				"\t" + it->second.type + " " + it->first + ";"));
+			registers.erase(it++);
+		}
+	}
+
+	static string store(const string& field, const string& type) {
+		if (type == "ESValue*") {
+			return "\tframe->store(frame->" + field + ", " + field + ");";
+		}
+		return "\tframe->" + field + " = " + field + ";";
+	}
+
+	string frameName() {
+		return name + "_frame";
+	}
+
+	string resumeName() {
+		return name + "_resume";
+	}
+
+	string baseName() {
+		return async ? "AsyncFunction" : "Generator";
+	}
+
+	void emitFrame(const set<string>& fields, vector<string>& definitions) {
+		vector<string> traced;
+		definitions.push_back("struct " + frameName() + " : public " + baseName() + " {");
+		for (size_t i = 0; i < parameters.size(); i++) {
+			definitions.push_back("\tESValue* local_" + parameters[i] + ";");
+			traced.push_back("local_" + parameters[i]);
+		}
+		for (set<string>::const_iterator it = fields.begin(); it != fields.end(); ++it) {
+			definitions.push_back("\t" + registers[*it].type + " " + *it + ";");
+			if (registers[*it].type == "ESValue*") {
+				traced.push_back(*it);
+			}
+		}
+		definitions.push_back("");
+		definitions.push_back("\t" + frameName() + "() : " + baseName() + "(" + resumeName() + ") {");
+		for (size_t i = 0; i < traced.size(); i++) {
+			definitions.push_back("\t\t" + traced[i] + " = NULL;");
+		}
+		definitions.push_back("\t}");
+		definitions.push_back("");
+		definitions.push_back("\tvoid visitReferences(Heap::ReferenceVisitor& visitor) {");
+		definitions.push_back("\t\t" + baseName() + "::visitReferences(visitor);");
+		for (size_t i = 0; i < traced.size(); i++) {
+			definitions.push_back("\t\tif (" + traced[i] + " != NULL) {");
+			definitions.push_back("\t\t\tvisitor.visit(&" + traced[i] + ");");
+			definitions.push_back("\t\t}");
+		}
+		definitions.push_back("\t}");
+		definitions.push_back("};");
+	}
+
+public:
+	ResumableFunction(const string& name, const vector<string>& parameters, bool async) {
+		this->name = name;
+		this->parameters = parameters;
+		this->async = async;
+	}
+
+	/* Appends the frame, the resume function and the function that creates the frame to definitions */
+	void lower(const vector<string>& body, bool profile, vector<string>& definitions) {
+		hoistDefinitions(body);
+		findReads();
+		dropUnread();
+
+		// the registers stored at each suspension, by its point
+		map<int, vector<string> > spills;
+		set<string> fields;
+		for (size_t i = 0; i < lines.size(); i++) {
+			string statement = Text::trim(lines[i]);
+			if (!Text::startsWith(statement, "label_resume_")) {
+				continue;
+			}
+			int point = atoi(statement.c_str() + strlen("label_resume_"));
+			spills[point];
+			for (map<string, Definition>::iterator it = registers.begin(); it != registers.end(); ++it) {
+				if (it->second.line < i && i < it->second.lastRead) {
+					spills[point].push_back(it->first);
+					fields.insert(it->first);
+				}
+			}
+		}
+
+		definitions.push_back("static ESValue* " + resumeName() + "(Generator* generator, ESValue* sent);");
+		emitFrame(fields, definitions);
+
+		definitions.push_back("static ESValue* " + resumeName() + "(Generator* generator, ESValue* sent) {");
+		definitions.push_back("\t" + frameName() + "* frame = static_cast<" + frameName() + "*>(generator);");
+		if (profile) {
+			definitions.push_back("\tint profilerDepth = Profiler::enter(\"" + name + "\");");
+		}
+		for (size_t i = 0; i < parameters.size(); i++) {
+			definitions.push_back("\tESValue* local_" + parameters[i] + " = frame->local_" + parameters[i] + ";");
+		}
+		definitions.insert(definitions.end(), declarations.begin(), declarations.end());
+		definitions.push_back("\tswitch (frame->getResumePoint()) {");
+		for (map<int, vector<string> >::iterator it = spills.begin(); it != spills.end(); ++it) {
+			definitions.push_back("\t\tcase " + to_string(it->first) + ": goto label_resume_" + to_string(it->first)
+				+ ";");
+		}
+		definitions.push_back("\t}");
+		for (size_t i = 0; i < lines.size(); i++) {
+			if (lines[i].empty()) {
+				continue;
+			}
+			string statement = Text::trim(lines[i]);
+			int point = suspendPoint(statement);
+			if (point != 0) {
+				vector<string>& spilled = spills[point];
+				for (size_t k = 0; k < parameters.size(); k++) {
+					definitions.push_back(store("local_" + parameters[k], "ESValue*"));
+				}
+				for (size_t k = 0; k < spilled.size(); k++) {
+					definitions.push_back(store(spilled[k], registers[spilled[k]].type));
+				}
+				definitions.push_back(lines[i]);
+			} else if (Text::startsWith(statement, "label_resume_")) {
+				definitions.push_back(lines[i]);
+				vector<string>& spilled = spills[atoi(statement.c_str() + strlen("label_resume_"))];
+				for (size_t k = 0; k < spilled.size(); k++) {
+					definitions.push_back("\t" + spilled[k] + " = frame->" + spilled[k] + ";");
+				}
+			} else if (Text::startsWith(statement, "return ")) {
+				// 25.3.3.1 GeneratorStart: a return completes the generator with its value
+				definitions.push_back("\treturn frame->complete(" + statement.substr(7, statement.size() - 8) + ");");
+			} else {
+				definitions.push_back(lines[i]);
+			}
+		}
+		if (profile) {
+			definitions.push_back("\tProfiler::leave(profilerDepth);");
+		}
+		definitions.push_back("\treturn frame->complete(new Undefined());");
+		definitions.push_back("}");
+
+		// calling the function creates the frame, which runs when it is resumed
+		string declaration = "static ESValue* " + name + "(";
+		for (size_t i = 0; i < parameters.size(); i++) {
+			declaration += (i > 0 ? ", " : "") + string("ESValue* local_") + parameters[i];
+		}
+		definitions.push_back(declaration + ") {");
+		definitions.push_back("\t" + frameName() + "* frame = new " + frameName() + "();");
+		for (size_t i = 0; i < parameters.size(); i++) {
+			definitions.push_back(store("local_" + parameters[i], "ESValue*"));
+		}
+		definitions.push_back(async ? "\treturn AsyncFunction::start(frame);" : "\treturn frame;");
+		definitions.push_back("}");
+	}
+};
@@ -11,11 +11,13 @@ using namespace std;
 class ScriptBody: public Node, public LexicalScope {
 private:
   vector<Statement*> *stmts;
+  // the scope of the let and const declarations at the top level
+  StatementList* body;
 public:  
 
 	
   ScriptBody(vector<Statement*> *stmts):
-    stmts(stmts) {};
+    stmts(stmts), body(new StatementList(stmts)) {};
     
     
 	void dump(int indent) {
@@ -26,16 +28,47 @@ public:
     	}
   	}
 
+	/* The script is generated again while generating it finds let or const bindings that nested functions capture,
+	 * which then move into environments or, at the top level, onto the global object, see LexicalScope
+	 */
     unsigned int genCode() {
-		
-		emit("int main() {");
-		
+		int firstRegister = global_var;
+		do {
+			lexicalCaptured = false;
+			LexicalStatistics none = {0, 0, 0, 0, 0};
+			lexicalStatistics = none;
+			functionDefinitions.clear();
+			codeScope[codeScopeDepth].clear();
+			global_var = firstRegister;
+			genScriptCode();
+		} while (lexicalCaptured);
+		return getNewRegister();
+	}
+
+	void genScriptCode() {
+		if (entryPoint != NULL) {
+			emit("int %s() {", entryPoint);
+		} else {
+			emit("int main() {");
+			emit("\tglobalObj = &globalObject;");
+		}
+		if (profileFunctions) {
+			emit("\tProfiler::start();");
+			emit("\tint profilerDepth = Profiler::enter(\"(program)\");");
+		}
 		for (std::vector<Statement*>::iterator child = stmts->begin(); child != stmts->end(); ++child) {
-			(*child)->genCode();
+			FunctionDeclaration* declaration = dynamic_cast<FunctionDeclaration*>(*child);
+			if (declaration != NULL) {
+				declaration->genBinding();
+			}
 		}
+
+		body->genScopeCode(false);
+		// 8.4.2 NextJob: the jobs and timers the script queued run once its top level is done
+		emit("\tEventLoop::run();");
+		emitProfilerLeave();
 		emit("\treturn 0;");
 		emit("}");
-		return getNewRegister();
 	}
 
 };
@@ -1,14 +1,18 @@
 #pragma once
 #include <cstdarg>
 #include <cstdio>
+#include <cctype>
 #include <cstddef>
 #include <string>
 #include <vector>
 #include <iostream>
 #include <typeinfo>
+#include <algorithm>
 
 #include "node.hpp"
 #include "expression.hpp"
+#include "resumable.hpp"
+#include "../runtime/core.hpp"
 
 
 extern std::map<int, std::vector<std::string> > codeScope;
@@ -23,6 +27,10 @@ static String vinit[];
 public:
 	virtual unsigned int genCode() = 0;
 	virtual unsigned int genStoreCode()=0;
+
+	/* 13.1.5 Static Semantics: VarDeclaredNames, of the statements that are generated, but not of the functions
+	 * nested in them */
+	virtual void getVarDeclaredNames(std::vector<std::string>& names) {}
 };
 
 
@@ -42,7 +50,12 @@ public:
 
 
 	unsigned int genCode() {
-		expr->genStoreCode();
+		AssignmentExpression* assignment = dynamic_cast<AssignmentExpression*>(expr);
+		if (assignment != NULL) {
+			assignment->genDiscardedCode();
+		} else {
+			expr->genStoreCode();
+		}
  		return getNewRegister();
 	}
 
@@ -51,6 +64,111 @@ public:
 	}
 };
 
+/* 13.3.1 Let and Const Declarations and 13.3.2 Variable Statement
+ * Each binding is a BindingElementExpression whose initialiser is assigned to its name or destructured into its
+ * pattern, see BindingPatternExpression. A name is a property of the global object, or the C local of a parameter
+ * of the function being generated. A var in a function is a binding of its body, see StatementList::declareVariables.
+ */
+class VariableStatement : public Statement {
+public:
+	enum Kind { var, let, const_ };
+
+private:
+	vector<Expression*>* bindings;
+	Kind kind;
+
+public:
+	VariableStatement(vector<Expression*>* bindings, Kind kind) {
+		this->bindings = bindings;
+		this->kind = kind;
+	}
+
+	void dump(int indent) {
+		static const char* const names[] = {"var", "let", "const"};
+		label(indent, "VariableStatement %s\n", names[kind]);
+		for (vector<Expression*>::iterator iter = bindings->begin(); iter != bindings->end(); ++iter) {
+			(*iter)->dump(indent + 1);
+		}
+	}
+
+	/* 13.2.14 BlockDeclarationInstantiation of a let or const declared directly in scope: each name no nested
+	 * function captured is a C local, NULL until the statement runs. A captured one is a slot of the environment of
+	 * scope, see StatementList::genScopeCode, except in the statement list of the script itself, the only scope
+	 * lexicalScopes holds at the top level, where it is a property of the global object.
+	 */
+	void genDeclarationCode(LexicalScope* scope) {
+		if (kind == var) {
+			return;
+		}
+		std::vector<std::string> names;
+		for (vector<Expression*>::iterator iter = bindings->begin(); iter != bindings->end(); ++iter) {
+			static_cast<BindingElementExpression*>(*iter)->getBoundNames(names);
+		}
+		for (std::vector<std::string>::iterator name = names.begin(); name != names.end(); ++name) {
+			if (scope->isCaptured(*name)) {
+				if (inFunction || lexicalScopes.size() > 1) {
+					scope->declareCaptured(*name, this, kind == const_);
+					lexicalStatistics.captured++;
+				}
+				continue;
+			}
+			unsigned int registerNumber = getNewRegister();
+			emit("\tESValue* r%d = NULL;", registerNumber);
+			scope->declareLexical(*name, this, registerNumber, kind == const_);
+			lexicalStatistics.locals++;
+		}
+	}
+
+	bool isLexical() {
+		return kind != var;
+	}
+
+	void getVarDeclaredNames(std::vector<std::string>& names) {
+		if (kind != var) {
+			return;
+		}
+		for (vector<Expression*>::iterator iter = bindings->begin(); iter != bindings->end(); ++iter) {
+			static_cast<BindingElementExpression*>(*iter)->getBoundNames(names);
+		}
+	}
+
+	unsigned int genCode() {
+		// the names a let or const binds were declared by its scope, a var only assigns them
+		const void* declaration = kind == var ? NULL : this;
+		for (vector<Expression*>::iterator iter = bindings->begin(); iter != bindings->end(); ++iter) {
+			BindingElementExpression* binding = static_cast<BindingElementExpression*>(*iter);
+			BindingPatternExpression* pattern = dynamic_cast<BindingPatternExpression*>(binding->getTarget());
+			if (pattern != NULL) {
+				pattern->genBindCode(binding->getInitializer(), declaration);
+				continue;
+			}
+
+			IdentifierExpression* identifier = static_cast<IdentifierExpression*>(binding->getTarget());
+			std::string name = identifier->getReferencedName();
+			if (kind != var) {
+				unsigned int registerNumber;
+				if (binding->getInitializer() != NULL) {
+					registerNumber = binding->getInitializer()->genStoreCode();
+				} else {
+					registerNumber = getNewRegister();
+					emit("\tESValue* r%d = new Undefined();", registerNumber);
+				}
+				binding->genInitializeCode(identifier, registerNumber, declaration);
+			} else if (binding->getInitializer() != NULL) {
+				AssignmentExpression assignment(binding->getTarget(), binding->getInitializer());
+				assignment.genStoreCode();
+			} else if (!inFunction) {
+				emit("\tCore::declareVariable(\"%s\");", name.c_str());
+			}
+		}
+		return getNewRegister();
+	}
+
+	unsigned int genStoreCode() {
+		return getNewRegister();
+	}
+};
+
 class StatementList: public Node, public LexicalScope {
 private:
   vector<Statement*> *stmts;
@@ -67,11 +185,103 @@ public:
 
 
 	unsigned int genCode() {
-		if(stmts != NULL) {
+		genScopeCode(true);
+		return getNewRegister();
+	}
+
+	/* 14.1.19 FunctionDeclarationInstantiation of the var names of a function body, wherever in it they are
+	 * declared: like its let declarations they are C locals, or slots of its environment when an arrow function
+	 * captures them, but undefined from the start of the body. A generator then keeps them in its frame, and two
+	 * calls do not share them through the global object. The names of the parameters are C locals already.
+	 * Returns the slots of the captured ones.
+	 */
+	std::vector<unsigned int> declareVariables() {
+		std::vector<std::string> names;
+		getVarDeclaredNames(names);
+		std::vector<unsigned int> slots;
+		for (std::vector<std::string>::iterator name = names.begin(); name != names.end(); ++name) {
+			if (localBindings.count(*name) > 0 || LexicalScope::resolveLexical(*name) != NULL) {
+				continue;
+			}
+			if (isCaptured(*name)) {
+				declareCaptured(*name, this, false);
+				slots.push_back(LexicalScope::resolveLexical(*name)->registerNumber);
+			} else {
+				unsigned int registerNumber = getNewRegister();
+				emit("\tESValue* r%d = new Undefined();", registerNumber);
+				declareLexical(*name, this, registerNumber, false);
+			}
+			LexicalScope::resolveLexical(*name)->initialized = true;
+		}
+		return slots;
+	}
+
+	void getVarDeclaredNames(std::vector<std::string>& names) {
+		if (stmts != NULL) {
+			for (vector<Statement*>::iterator iter = stmts->begin(); iter != stmts->end(); ++iter) {
+				(*iter)->getVarDeclaredNames(names);
+			}
+		}
+	}
+
+	/* 13.2.13 Runtime Semantics: Evaluation of a Block, with its let and const declarations as C locals, see
+	 * VariableStatement::genDeclarationCode. braces puts the locals in a C block of their own, which the body of a
+	 * function does not need; that body declares its var names too, see declareVariables. When an arrow function
+	 * captures some of them they are allocated an Environment on entry, each time the block runs, so that every
+	 * closure created in one run shares its bindings.
+	 */
+	void genScopeCode(bool braces) {
+		if (stmts == NULL) {
+			return;
+		}
+		bool lexical = false;
+		for (vector<Statement*>::iterator iter = stmts->begin(); iter != stmts->end(); ++iter) {
+			VariableStatement* declaration = dynamic_cast<VariableStatement*>(*iter);
+			lexical = lexical || (declaration != NULL && declaration->isLexical());
+		}
+		if (braces && lexical) {
+			emit("\t{");
+		}
+		clearLexical();
+		lexicalScopes.push_back(this);
+		for (vector<Statement*>::iterator iter = stmts->begin(); iter != stmts->end(); ++iter) {
+			VariableStatement* declaration = dynamic_cast<VariableStatement*>(*iter);
+			if (declaration != NULL) {
+				declaration->genDeclarationCode(this);
+			}
+		}
+		std::vector<unsigned int> variableSlots;
+		if (!braces && inFunction) {
+			variableSlots = declareVariables();
+		}
+		if (getEnvironmentSize() > 0) {
+			setEnvironmentRegister(getNewRegister());
+			emit("\tESValue* r%d = new Environment(%s, %d);", getEnvironmentRegister(),
+				innermostEnvironment().c_str(), (int)getEnvironmentSize());
+			environments.push_back(this);
+		}
+		for (size_t i = 0; i < variableSlots.size(); i++) {
+			emit("\tEnvironment::of(r%d, 0)->setBinding(%d, new Undefined());", getEnvironmentRegister(),
+				variableSlots[i]);
+		}
+		genStatementsCode();
+		if (getEnvironmentSize() > 0) {
+			environments.pop_back();
+		}
+		lexicalScopes.pop_back();
+		if (braces && lexical) {
+			emit("\t}");
+		}
+	}
+
+	/* The statements without a scope of their own: the clauses of a switch share the scope of its case block, and
+	 * their let and const declarations stay properties of the global object
+	 */
+	void genStatementsCode() {
+		if (stmts != NULL) {
 			for (vector<Statement*>::iterator iter = stmts->begin(); iter != stmts->end(); ++iter)
                 (*iter)->genCode();
 		}
-		return getNewRegister();
 	}
 
 	unsigned int genStoreCode() {return getNewRegister();};
@@ -85,6 +295,7 @@ private:
 
 public:
 	BlockStatement () {
+		this->statementList = NULL;
 	}
 
 	BlockStatement (vector<Statement*> *stmts) {
@@ -103,9 +314,18 @@ public:
 
 
 	unsigned int genCode() {
+		if(statementList != NULL) {
+			statementList->genCode();
+		}
 		return getNewRegister();
 	}
 
+	void getVarDeclaredNames(std::vector<std::string>& names) {
+		if (statementList != NULL) {
+			statementList->getVarDeclaredNames(names);
+		}
+	}
+
 	unsigned int genStoreCode() {return getNewRegister();};
 
 };
@@ -241,17 +461,17 @@ public:
 		}
 	}
 
+	/* 13.10.1 a bare return completes with undefined, every function returns an ESValue*. Outside a function the
+	 * script's int main ends instead, the value is evaluated and dropped
+	 */
 	unsigned int genCode() {
+		std::string value = "new Undefined()";
 		if (this->expr != NULL) {
-			this->expr->genStoreCode();
-			unsigned int reg = getNewRegister();
-			emit("\treturn r%d;", reg - 1);
-			return reg;
-		}
-		else{
-			emit("\treturn;");
-			return getNewRegister();
+			value = "r" + std::to_string(this->expr->genStoreCode());
 		}
+		emitProfilerLeave();
+		emit("\treturn %s;", codeScopeDepth == 0 ? "0" : value.c_str());
+		return getNewRegister();
 	}
 
 	unsigned int genStoreCode() {return getNewRegister();};
@@ -416,6 +636,7 @@ public:
 	IfStatement(Expression *expression, Statement *statement) {
 		this->expression = expression;
 		this->statement = statement;
+		this->elseStatement = NULL;
 	}
 
 	// if (expression) { statement } else { elseStatement }
@@ -437,15 +658,12 @@ public:
 
 	unsigned int genCode() {
 		//13.6.7 Runtime Semantics: Evaluation
-		int regConditionalExpression = expression->genStoreCode();
-		int regNum = getNewRegister();
-
-		//Convert the conditional expression to boolean
-		emit("\tBoolean r%d = TypeOps::toBoolean(r%d);", regNum, regConditionalExpression);
+		//The conditional expression is evaluated straight into a C bool
+		int regNum = expression->genConditionCode();
 
 		if(elseStatement != NULL) {
 			emit("//Simulate the jump if in assembly");
-			emit("\tif(!r%d.getValue())", regNum);
+			emit("\tif(!r%d)", regNum);
 
 			emit("\t\tgoto label_else_r%d;", regNum);
 
@@ -466,16 +684,19 @@ public:
 			emit("\t}");
 
 
-			emit("label_end_if_r%d:");
+			emit("label_end_if_r%d:", regNum);
 
 		} else {
 			emit("//Simulate the jump if in assembly");
-			emit("\tif(!r%d.getValue())", regNum);
+			emit("\tif(!r%d)", regNum);
 
 			emit("\t\tgoto label_end_if_r%d;", regNum);
 
 			emit("\t//the code is executed if the conditional expression is true}");
+			//compiling .c file will throw error if not putting the code in {...}
+			emit("\t{");
 			statement->genCode();
+			emit("\t}");
 
 			//emit the label
 			emit("label_end_if_r%d:", regNum);
@@ -484,6 +705,13 @@ public:
 		return regNum;
 	}
 
+	void getVarDeclaredNames(std::vector<std::string>& names) {
+		statement->getVarDeclaredNames(names);
+		if (elseStatement != NULL) {
+			elseStatement->getVarDeclaredNames(names);
+		}
+	}
+
 	unsigned int genStoreCode() {return getNewRegister();};
 
 };
@@ -514,17 +742,24 @@ class IterationStatement : public Statement {
 	};
 
 	unsigned int genCode() {
+		//13.7.3.6 Runtime Semantics: LabelledEvaluation
 		unsigned int registerNumber = getNewRegister();
-		emit("\t// r%d", registerNumber);
-		unsigned int expressionRegister = expression->genCode();
-		emit("\t// r%d evaluate some boolean expression if true skip to register after all statements", expressionRegister);
-		unsigned int statementRegister = statement->genCode();
-		emit("\t// r%d jmp r%d", statementRegister, registerNumber);
-		registerNumber = getNewRegister();
-		emit("\t// r%d skip to here if expression is true", registerNumber);
+		emit("label_while_r%d:", registerNumber);
+		unsigned int expressionRegister = expression->genConditionCode();
+		emit("\tif(!r%d)", expressionRegister);
+		emit("\t\tgoto label_end_while_r%d;", registerNumber);
+		emit("\t{");
+		statement->genCode();
+		emit("\t}");
+		emit("\tgoto label_while_r%d;", registerNumber);
+		emit("label_end_while_r%d:", registerNumber);
 
 		return registerNumber;
   }
+
+	void getVarDeclaredNames(std::vector<std::string>& names) {
+		statement->getVarDeclaredNames(names);
+	}
 };
 
 
@@ -592,11 +827,14 @@ private:
 
 public:
 	CaseClauseStatement(vector<Statement*> *stmtList) {
+		this->expression = NULL;
 		this->stmtList = new StatementList(stmtList);
+		this->isDefaultClause = false;
 	}
 	CaseClauseStatement(Expression *expression, vector<Statement*> *stmtList) {
 		this->expression = expression;
 		this->stmtList = new StatementList(stmtList);
+		this->isDefaultClause = false;
 	}
 	Expression* getCaseExpression() {
 		return expression;
@@ -617,14 +855,20 @@ public:
 		unsigned int regNum = getNewRegister();
 		if(this->isDefaultClause) {
 			emit("DEFLABEL%d:", regNum);
-			this->stmtList->genCode();
 		} else {
 			emit("LABEL%d:", regNum);
-			this->stmtList->genCode();
 		}
+		// in a C scope of its own, so the jumps to the other clauses do not cross its registers
+		emit("\t{");
+		this->stmtList->genStatementsCode();
+		emit("\t}");
 		return regNum;
 	}
 
+	void getVarDeclaredNames(std::vector<std::string>& names) {
+		stmtList->getVarDeclaredNames(names);
+	}
+
 	unsigned int genStoreCode() {	return getNewRegister(); }
 };
 
@@ -643,6 +887,8 @@ private:
 public:
     CaseBlockStatement(vector<Statement*> *caseClauses) {
         this->caseClauses = caseClauses;
+        this->defaultCaseClauseStmt = NULL;
+        this->secondCaseClauses = NULL;
         defaultClause = false;
     };
     CaseBlockStatement(vector<Statement*> *caseClauses, Statement *defaultCaseClauseStmt, vector<Statement*> *secondCaseClauses) {
@@ -714,6 +960,21 @@ public:
         return getNewRegister();
     }
 
+	void getVarDeclaredNames(std::vector<std::string>& names) {
+		vector<Statement*>* clauses[] = {caseClauses, secondCaseClauses};
+		for (int i = 0; i < 2; i++) {
+			if (clauses[i] == NULL) {
+				continue;
+			}
+			for (vector<Statement*>::iterator iter = clauses[i]->begin(); iter != clauses[i]->end(); ++iter) {
+				(*iter)->getVarDeclaredNames(names);
+			}
+		}
+		if (defaultCaseClauseStmt != NULL) {
+			defaultCaseClauseStmt->getVarDeclaredNames(names);
+		}
+	}
+
 	unsigned int genStoreCode() {
 		return global_var;
 	};
@@ -722,12 +983,123 @@ public:
 
 /*
  * 13.12 The switch Statement
+ *
+ * The dispatch is lowered depending on the case labels:
+ *  - all dense integer literals: a C switch on the offset into the label range, which the C compiler
+ *    turns into a jump table
+ *  - all string literals: a C switch on a perfect hash of the discriminant, with one string compare to
+ *    confirm the match
+ *  - anything else: a linear chain of strict equality comparisons
  */
 class SwitchStatement : public Statement {
 private:
 	Expression *expression;
 	Statement *statement;
 
+	// fewer cases than this are dispatched faster by the linear chain
+	static const unsigned int TABLE_MIN_CASES = 3;
+	// a jump table may have at most this many slots per case label
+	static const unsigned int TABLE_MAX_SLOTS_PER_CASE = 2;
+	// seeds tried for each perfect hash table size before doubling it
+	static const unsigned int HASH_SEED_ATTEMPTS = 256;
+
+	/*
+	 * Emits a jump table when every case label is an integer literal and their range is dense enough.
+	 */
+	bool genTableDispatch(unsigned int switchRegNum, std::map<unsigned int, Expression*> &caseLabelMap) {
+		if (caseLabelMap.size() < TABLE_MIN_CASES) {
+			return false;
+		}
+
+		// case labels are matched in source order, so the first label of a duplicated value wins
+		std::map<int, unsigned int> labelForValue;
+		for (std::map<unsigned int, Expression*>::iterator iter = caseLabelMap.begin(); iter != caseLabelMap.end(); ++iter) {
+			DecimalIntegerLiteralExpression *literal = dynamic_cast<DecimalIntegerLiteralExpression*>(iter->second);
+			if (literal == NULL) {
+				return false;
+			}
+			labelForValue.insert(std::pair<int, unsigned int>(literal->getValue(), iter->first));
+		}
+
+		int low = labelForValue.begin()->first;
+		int high = labelForValue.rbegin()->first;
+		if ((double)high - low + 1 > (double)labelForValue.size() * TABLE_MAX_SLOTS_PER_CASE) {
+			return false;
+		}
+
+		emit("\tswitch (Core::switchTableIndex(r%d, %d, %d)) {", switchRegNum, low, high);
+		for (std::map<int, unsigned int>::iterator iter = labelForValue.begin(); iter != labelForValue.end(); ++iter) {
+			emit("\t\tcase %d: goto LABEL%d;", iter->first - low, iter->second);
+		}
+		emit("\t}");
+		return true;
+	}
+
+	/*
+	 * Emits a perfect hash dispatch when every case label is a string literal without escape sequences.
+	 */
+	bool genHashDispatch(unsigned int switchRegNum, std::map<unsigned int, Expression*> &caseLabelMap) {
+		if (caseLabelMap.size() < TABLE_MIN_CASES) {
+			return false;
+		}
+
+		std::vector<std::string> keys;
+		std::vector<unsigned int> labels;
+		for (std::map<unsigned int, Expression*>::iterator iter = caseLabelMap.begin(); iter != caseLabelMap.end(); ++iter) {
+			StringLiteralExpression *literal = dynamic_cast<StringLiteralExpression*>(iter->second);
+			if (literal == NULL) {
+				return false;
+			}
+			// the lexer keeps the surrounding quotes on string literals
+			std::string quoted = literal->getValue();
+			std::string key = quoted.substr(1, quoted.size() - 2);
+			if (key.find('\\') != std::string::npos || key.find('"') != std::string::npos) {
+				return false;
+			}
+			if (std::find(keys.begin(), keys.end(), key) == keys.end()) {
+				keys.push_back(key);
+				labels.push_back(iter->first);
+			}
+		}
+
+		unsigned int size = 1;
+		while (size < keys.size()) {
+			size <<= 1;
+		}
+
+		for (unsigned int maxSize = size * 4; size <= maxSize; size <<= 1) {
+			for (unsigned int seed = 0; seed < HASH_SEED_ATTEMPTS; seed++) {
+				std::vector<bool> used(size, false);
+				bool collision = false;
+				for (std::vector<std::string>::iterator key = keys.begin(); key != keys.end() && !collision; ++key) {
+					unsigned int slot = Core::switchHash(key->data(), key->size(), seed) & (size - 1);
+					collision = used[slot];
+					used[slot] = true;
+				}
+				if (collision) {
+					continue;
+				}
+
+				emit("\tswitch (Core::switchHashSlot(r%d, %uu, %uu)) {", switchRegNum, seed, size - 1);
+				for (unsigned int i = 0; i < keys.size(); i++) {
+					unsigned int slot = Core::switchHash(keys[i].data(), keys[i].size(), seed) & (size - 1);
+					emit("\t\tcase %u: if (Core::switchStringEquals(r%d, \"%s\")) goto LABEL%d; break;",
+						slot, switchRegNum, keys[i].c_str(), labels[i]);
+				}
+				emit("\t}");
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void genLinearDispatch(unsigned int switchRegNum, std::map<unsigned int, Expression*> &caseLabelMap) {
+		for (std::map<unsigned int, Expression*>::iterator iter = caseLabelMap.begin(); iter != caseLabelMap.end(); ++iter) {
+			unsigned int caseLabelNum = (iter->second)->genStoreCode();
+			emit("\tif(Core::strictEquals(r%d, r%d)) goto LABEL%d;", switchRegNum, caseLabelNum, iter->first);
+		}
+	}
+
 public:
 	SwitchStatement(Expression *expression, Statement *statement) {
 		this->expression = expression;
@@ -749,45 +1121,64 @@ public:
 		cbStmt->setEndLabelNum(reservedForEnd);
 		cbStmt->genCode();
 		emit("LABEL%d:", reservedForStart);
-		unsigned int switchRegNum = this->expression->genStoreCode();
-		
+		emit("\t{");
+		unsigned int switchRefNum = this->expression->genStoreCode();
+		unsigned int switchRegNum = getNewRegister();
+		emit("\tESValue* r%d = Core::getValue(r%d);", switchRegNum, switchRefNum);
+
 		std::map<unsigned int, Expression*> caseLabelMap = cbStmt->getCaseLabelMap();
-		for (std::map<unsigned int, Expression*>::iterator iter = caseLabelMap.begin(); iter != caseLabelMap.end(); ++iter) {
-			unsigned int caseLabelNum = (iter->second)->genStoreCode();
-			// emit("\t//If these two have the same value, Core::zeroFlag will be true");
-			emit("\tCore::strictEqualityComparison(r%d, r%d);", switchRegNum, caseLabelNum);
-			emit("\tif(Core::zeroFlag) goto LABEL%d;", iter->first);
+		if (!genTableDispatch(switchRegNum, caseLabelMap) && !genHashDispatch(switchRegNum, caseLabelMap)) {
+			genLinearDispatch(switchRegNum, caseLabelMap);
 		}
 		if(cbStmt->hasDefaultClause()) {
 			emit("\tgoto DEFLABEL%d;", cbStmt->getLabelRegNum());
 		}
-
+		emit("\t}");
 		emit("LABELEND%d:", reservedForEnd);
-
-
 		return getNewRegister();
 	}
 
+	void getVarDeclaredNames(std::vector<std::string>& names) {
+		statement->getVarDeclaredNames(names);
+	}
+
 	unsigned int genStoreCode() { return getNewRegister(); }
 };
 
 
 
 
+/* 14.1 Function Definitions, 14.4 Generator Function Definitions and async functions (ECMAScript 2017, 14.6 Async
+ * Function Definitions). Generators and async functions are lowered to state machines, see resumable.hpp.
+ */
 class FunctionDeclaration : public Statement {
+public:
+	enum Kind {
+		normalFunction,
+		generatorFunction,
+		asyncFunction
+	};
+
 private:
 	Expression* bindingIdentifier;
 	vector<Expression*>* formalParameters;
 	vector<Statement*>* functionBody;
+	// the scope of the let and const declarations of the body
+	StatementList* bodyScope;
+	Kind kind;
 public:
-	FunctionDeclaration(Expression* bindingIdentifier, vector<Expression*>* formalParameters, vector<Statement*>* functionBody) {
+	FunctionDeclaration(Expression* bindingIdentifier, vector<Expression*>* formalParameters,
+			vector<Statement*>* functionBody, Kind kind = normalFunction) {
 		this->bindingIdentifier = bindingIdentifier;
 		this->formalParameters = formalParameters;
 		this->functionBody = functionBody;
+		this->bodyScope = new StatementList(functionBody);
+		this->kind = kind;
 	}
 
 	void dump(int indent) {
-		label(indent++, "FunctionDeclaration\n");
+		label(indent++, kind == generatorFunction ? "GeneratorDeclaration\n"
+			: kind == asyncFunction ? "AsyncFunctionDeclaration\n" : "FunctionDeclaration\n");
 		if (bindingIdentifier != NULL) {
 			bindingIdentifier->dump(indent);
 		}
@@ -801,36 +1192,75 @@ public:
 		}
 	}
 
+	/* 15.1.8 GlobalDeclarationInstantiation: the function object is bound before any statement of the script runs */
+	void genBinding() {
+		std::string name = dynamic_cast<IdentifierExpression*>(bindingIdentifier)->getReferencedName();
+		unsigned int registerNumber = getNewRegister();
+		emit("\tESValue* r%d = Core::assign(new Reference(new String(\"%s\")), new Function(%s_call, \"%s\", %d));",
+			registerNumber, name.c_str(), name.c_str(), name.c_str(), (int)formalParameters->size());
+	}
+
 	unsigned int genCode() {
 		IdentifierExpression* functionName = dynamic_cast<IdentifierExpression*>(bindingIdentifier);
-		std::string functionDeclaration = std::string("ESValue* " + functionName->getReferencedName() + "(");
+		std::string functionDeclaration = std::string("static ESValue* " + functionName->getReferencedName() + "(");
+		// the parameters are C locals of this function, the names of an enclosing one are not
+		std::set<std::string> enclosingBindings;
+		enclosingBindings.swap(localBindings);
+		size_t enclosingScopeCount = enclosingScopes;
+		enclosingScopes = lexicalScopes.size();
+		// called by name, a function declaration reaches no environment of an enclosing function
+		std::vector<LexicalScope*> enclosingEnvironments;
+		enclosingEnvironments.swap(environments);
+		size_t enclosingClosureEnvironments = closureEnvironments;
+		closureEnvironments = 0;
+		bool enclosingInFunction = inFunction;
+		inFunction = true;
+		ClassContext enclosingClass = currentClass;
+		currentClass = ClassContext();
+		std::vector<std::string> parameters;
 		for (vector<Expression*>::iterator iter = formalParameters->begin(); iter != formalParameters->end(); ++iter) {
-			functionDeclaration = functionDeclaration + dynamic_cast<IdentifierExpression*>(*iter)->getReferencedName() + ",";
+			std::string parameter = dynamic_cast<IdentifierExpression*>(*iter)->getReferencedName();
+			functionDeclaration = functionDeclaration + (iter != formalParameters->begin() ? ", " : "") + "ESValue* local_"
+				+ parameter;
+			localBindings.insert(parameter);
+			parameters.push_back(parameter);
 		}
-		functionDefinitions.push_back(functionDeclaration.substr(0, functionDeclaration.size()-1) + ") {");
-
 
 		codeScopeDepth++;
-		for (vector<Statement*>::iterator iter = functionBody->begin(); iter != functionBody->end(); ++iter) {
-			(*iter)->genCode();
-		}
+		bodyScope->genScopeCode(false);
+		// the body moves into functionDefinitions, leaving the scope empty for the next function
 		std::vector<std::string> body = codeScope[codeScopeDepth];
-		for (std::vector<std::string>::iterator iter = body.begin(); iter != body.end(); ++iter) {
-			// get a char pointer out of the string
-			std::string s = (*iter);
-			char* w = new char[s.size() + 1];
-			std::copy(s.begin(), s.end(), w);
-			w[s.size()] = '\0';
-			emit(w);
-		}
+		codeScope.erase(codeScopeDepth);
 		codeScopeDepth--;
+		currentClass = enclosingClass;
+		enclosingScopes = enclosingScopeCount;
+		environments.swap(enclosingEnvironments);
+		closureEnvironments = enclosingClosureEnvironments;
+		inFunction = enclosingInFunction;
+
+		if (kind != normalFunction) {
+			ResumableFunction resumable(functionName->getReferencedName(), parameters, kind == asyncFunction);
+			resumable.lower(body, profileFunctions, functionDefinitions);
+			localBindings.swap(enclosingBindings);
+			emitCallTrampoline(functionName->getReferencedName(), formalParameters->size());
+			return getNewRegister();
+		}
 
-		// TODO this code should go into function calling......
-//		unsigned int reg = getNewRegister();
-//		emit("\tESValue* r%d = %s();", reg, functionName->getReferencedName().c_str());
-
+		// after the body, which puts the functions nested in it first
+		functionDefinitions.push_back(functionDeclaration + ") {");
+		if (profileFunctions) {
+			functionDefinitions.push_back("\tint profilerDepth = Profiler::enter(\"" + functionName->getReferencedName() + "\");");
+		}
 		functionDefinitions.insert(functionDefinitions.end(), body.begin(), body.end());
+		// 9.2.1 [[Call]]: a body that completes normally returns undefined
+		if (profileFunctions) {
+			functionDefinitions.push_back("\tProfiler::leave(profilerDepth);");
+		}
+		functionDefinitions.push_back("\treturn new Undefined();");
 		functionDefinitions.push_back("}");
+		localBindings.swap(enclosingBindings);
+
+		emitCallTrampoline(functionName->getReferencedName(), formalParameters->size());
 		return getNewRegister();
 	}
 
@@ -867,15 +1297,9 @@ public:
 		for (vector<Statement*>::iterator iter = functionBody->begin(); iter != functionBody->end(); ++iter) {
 			(*iter)->genCode();
 		}
+		// the body moves into functionDefinitions, leaving the scope empty for the next function
 		std::vector<std::string> body = codeScope[codeScopeDepth];
-		for (std::vector<std::string>::iterator iter = body.begin(); iter != body.end(); ++iter) {
-			// get a char pointer out of the string
-			std::string s = (*iter);
-			char* w = new char[s.size() + 1];
-			std::copy(s.begin(), s.end(), w);
-			w[s.size()] = '\0';
-			emit(w);
-		}
+		codeScope.erase(codeScopeDepth);
 		codeScopeDepth--;
 
 		functionDefinitions.insert(functionDefinitions.end(), body.begin(), body.end());
@@ -887,3 +1311,236 @@ public:
 		return getNewRegister();
 	};
 };
+
+/* 14.3 Method Definitions: PropertyName ( StrictFormalParameters ) { FunctionBody }, which only a class compiles, see
+ * ClassDeclaration; in an object literal it is not defined
+ */
+class MethodDefinitionExpression : public Expression {
+private:
+	Expression* propertyName;
+	vector<Expression*>* formalParameters;
+	vector<Statement*>* functionBody;
+	StatementList* bodyScope;
+
+public:
+	MethodDefinitionExpression(Expression* propertyName, vector<Expression*>* formalParameters,
+			vector<Statement*>* functionBody) {
+		this->propertyName = propertyName;
+		this->formalParameters = formalParameters;
+		this->functionBody = functionBody;
+		this->bodyScope = new StatementList(functionBody);
+	}
+
+	/* The name of the method, empty unless it is an identifier or a string that is one */
+	std::string getName() {
+		LiteralPropertyNameExpression* literal = dynamic_cast<LiteralPropertyNameExpression*>(propertyName);
+		std::string name = literal != NULL ? literal->getName() : "";
+		for (size_t i = 0; i < name.size(); i++) {
+			if (!isalnum((unsigned char)name[i]) && name[i] != '_' && name[i] != '$') {
+				return "";
+			}
+		}
+		return name;
+	}
+
+	vector<Expression*>* getFormalParameters() {
+		return formalParameters;
+	}
+
+	vector<Statement*>* getFunctionBody() {
+		return functionBody;
+	}
+
+	/* The scope of the let and const declarations of the body */
+	StatementList* getBodyScope() {
+		return bodyScope;
+	}
+
+	void dump(int indent) {
+		label(indent++, "MethodDefinition\n");
+		propertyName->dump(indent);
+		label(indent, "FormalParameters\n");
+		for (vector<Expression*>::iterator iter = formalParameters->begin(); iter != formalParameters->end(); ++iter) {
+			(*iter)->dump(indent + 1);
+		}
+		label(indent, "FunctionBody\n");
+		for (vector<Statement*>::iterator iter = functionBody->begin(); iter != functionBody->end(); ++iter) {
+			(*iter)->dump(indent + 1);
+		}
+	}
+
+	unsigned int genCode() {
+		return getNewRegister();
+	}
+
+	unsigned int genStoreCode() {
+		return getNewRegister();
+	}
+};
+
+/* 14.5 Class Definitions, without ClassHeritage, static methods or accessors
+ * The constructor and each method compile to a C function class_C_name that takes the instance as self and the
+ * parameters as C locals, and the class to a static ClassLayout of the fields the constructor assigns and the
+ * methods, see runtime/class.hpp. Evaluating the declaration binds C to a ClassConstructor of that layout; unlike a
+ * function declaration it is not hoisted.
+ */
+class ClassDeclaration : public Statement {
+private:
+	Expression* bindingIdentifier;
+	// MethodDefinitionExpressions, in the order of the class body
+	vector<Expression*>* classBody;
+
+	std::string getClassName() {
+		return dynamic_cast<IdentifierExpression*>(bindingIdentifier)->getReferencedName();
+	}
+
+	std::string genSignature(const std::string& functionName, MethodDefinitionExpression* method) {
+		std::string signature = "static ESValue* " + functionName + "(ClassInstance* self";
+		vector<Expression*>* parameters = method->getFormalParameters();
+		for (vector<Expression*>::iterator iter = parameters->begin(); iter != parameters->end(); ++iter) {
+			signature += ", ESValue* local_" + dynamic_cast<IdentifierExpression*>(*iter)->getReferencedName();
+		}
+		return signature + ")";
+	}
+
+	/* The C function of a method and its trampoline, the body generated as that of a FunctionDeclaration */
+	void genMethod(MethodDefinitionExpression* method) {
+		std::string functionName = "class_" + getClassName() + "_" + method->getName();
+		std::set<std::string> enclosingBindings;
+		enclosingBindings.swap(localBindings);
+		size_t enclosingScopeCount = enclosingScopes;
+		enclosingScopes = lexicalScopes.size();
+		std::vector<LexicalScope*> enclosingEnvironments;
+		enclosingEnvironments.swap(environments);
+		size_t enclosingClosureEnvironments = closureEnvironments;
+		closureEnvironments = 0;
+		bool enclosingInFunction = inFunction;
+		inFunction = true;
+		vector<Expression*>* parameters = method->getFormalParameters();
+		for (vector<Expression*>::iterator iter = parameters->begin(); iter != parameters->end(); ++iter) {
+			localBindings.insert(dynamic_cast<IdentifierExpression*>(*iter)->getReferencedName());
+		}
+
+		codeScopeDepth++;
+		method->getBodyScope()->genScopeCode(false);
+		std::vector<std::string> body = codeScope[codeScopeDepth];
+		codeScope.erase(codeScopeDepth);
+		codeScopeDepth--;
+		enclosingScopes = enclosingScopeCount;
+		environments.swap(enclosingEnvironments);
+		closureEnvironments = enclosingClosureEnvironments;
+		inFunction = enclosingInFunction;
+
+		functionDefinitions.push_back(genSignature(functionName, method) + " {");
+		if (profileFunctions) {
+			functionDefinitions.push_back("\tint profilerDepth = Profiler::enter(\"" + getClassName() + "."
+				+ method->getName() + "\");");
+		}
+		functionDefinitions.insert(functionDefinitions.end(), body.begin(), body.end());
+		if (profileFunctions) {
+			functionDefinitions.push_back("\tProfiler::leave(profilerDepth);");
+		}
+		functionDefinitions.push_back("\treturn new Undefined();");
+		functionDefinitions.push_back("}");
+		localBindings.swap(enclosingBindings);
+
+		emitCallTrampoline(functionName, parameters->size(), "ClassInstance* self", "self");
+	}
+
+public:
+	ClassDeclaration(Expression* bindingIdentifier, vector<Expression*>* classBody) {
+		this->bindingIdentifier = bindingIdentifier;
+		this->classBody = classBody;
+		for (vector<Expression*>::iterator iter = classBody->begin(); iter != classBody->end(); ++iter) {
+			std::string name = static_cast<MethodDefinitionExpression*>(*iter)->getName();
+			if (name != "constructor") {
+				classMethods.insert(name);
+			}
+		}
+	}
+
+	void dump(int indent) {
+		label(indent++, "ClassDeclaration\n");
+		bindingIdentifier->dump(indent);
+		label(indent, "ClassBody\n");
+		for (vector<Expression*>::iterator iter = classBody->begin(); iter != classBody->end(); ++iter) {
+			(*iter)->dump(indent + 1);
+		}
+	}
+
+	unsigned int genCode() {
+		std::string className = getClassName();
+		std::string prefix = "class_" + className + "_";
+		ClassContext enclosingClass = currentClass;
+		currentClass = ClassContext();
+		currentClass.name = className;
+
+		// 14.5.14 ClassDefinitionEvaluation: a later method of the same name replaces an earlier one
+		MethodDefinitionExpression* constructor = NULL;
+		std::vector<MethodDefinitionExpression*> methods;
+		for (vector<Expression*>::iterator iter = classBody->begin(); iter != classBody->end(); ++iter) {
+			MethodDefinitionExpression* method = static_cast<MethodDefinitionExpression*>(*iter);
+			if (method->getName() == "constructor") {
+				constructor = method;
+				continue;
+			}
+			if (currentClass.methods.count(method->getName()) > 0) {
+				for (size_t i = 0; i < methods.size(); i++) {
+					if (methods[i]->getName() == method->getName()) {
+						methods.erase(methods.begin() + i);
+						break;
+					}
+				}
+			}
+			methods.push_back(method);
+			currentClass.methods[method->getName()] = method->getFormalParameters()->size();
+		}
+
+		// declared first, so that the constructor and the methods can call each other directly
+		for (size_t i = 0; i < methods.size(); i++) {
+			functionDefinitions.push_back(genSignature(prefix + methods[i]->getName(), methods[i]) + ";");
+		}
+		// the constructor goes before the methods, which then know every field
+		if (constructor != NULL) {
+			currentClass.inConstructor = true;
+			genMethod(constructor);
+			currentClass.inConstructor = false;
+		}
+		for (size_t i = 0; i < methods.size(); i++) {
+			genMethod(methods[i]);
+		}
+
+		// the layout, one line per table for the dead code pass
+		std::string fields;
+		for (size_t i = 0; i < currentClass.fields.size(); i++) {
+			fields += (i > 0 ? ", \"" : "\"") + currentClass.fields[i] + "\"";
+		}
+		if (!fields.empty()) {
+			functionDefinitions.push_back("static const char* const " + prefix + "fields[] = {" + fields + "};");
+		}
+		std::string methodTable;
+		for (size_t i = 0; i < methods.size(); i++) {
+			std::string name = methods[i]->getName();
+			methodTable += (i > 0 ? ", {\"" : "{\"") + name + "\", " + prefix + name + "_call, "
+				+ std::to_string(methods[i]->getFormalParameters()->size()) + "}";
+		}
+		if (!methodTable.empty()) {
+			functionDefinitions.push_back("static const ClassMethod " + prefix + "methods[] = {" + methodTable + "};");
+		}
+		functionDefinitions.push_back("static const ClassLayout " + prefix + "layout = {\"" + className + "\", "
+			+ (fields.empty() ? "NULL" : prefix + "fields") + ", " + std::to_string(currentClass.fields.size()) + ", "
+			+ (methodTable.empty() ? "NULL" : prefix + "methods") + ", " + std::to_string(methods.size()) + ", "
+			+ (constructor == NULL ? "NULL" : prefix + "constructor_call") + ", "
+			+ std::to_string(constructor == NULL ? 0 : constructor->getFormalParameters()->size()) + "};");
+		currentClass = enclosingClass;
+
+		unsigned int registerNumber = getNewRegister();
+		emit("\tESValue* r%d = Core::assign(new Reference(new String(\"%s\")), new ClassConstructor(&%slayout));",
+			registerNumber, className.c_str(), prefix.c_str());
+		return registerNumber;
+	}
+
+	unsigned int genStoreCode() {
+		return getNewRegister();
+	}
+};
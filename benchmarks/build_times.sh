@@ -0,0 +1,68 @@
+#!/bin/bash
+#
+# Wall time to build the program the compiler generates for each test, the way main.cpp builds executables: first
+# against the runtime sources (a build without libesruntime.a), then against the library, then against the library
+# with the precompiled runtime header. Tests the compiler rejects and programs that do not build are skipped.
+#
+# usage: build_times.sh compiler runtime-root test.js...
+#
+CXX=${CXX:-g++}
+COMPILER=$1
+ROOT=$2
+shift 2
+
+if [ ! -f "$ROOT/libesruntime.a" ]; then
+    echo "build_times: $ROOT/libesruntime.a is missing, run make runtime" >&2
+    exit 1
+fi
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+# the headers are copied so that a precompiled header in ROOT cannot be picked up by the first two runs
+mkdir -p "$WORK/root" "$WORK/programs"
+for directory in runtime type scope; do
+    mkdir -p "$WORK/root/$directory"
+    cp "$ROOT/$directory/"*.hpp "$WORK/root/$directory/"
+done
+SOURCES=""
+for source in type/type.cpp type/conversion.cpp type/heap.cpp runtime/core.cpp runtime/console.cpp runtime/simd.cpp \
+    runtime/global.cpp runtime/profiler.cpp runtime/isolate.cpp runtime/embedding.cpp runtime/eventloop.cpp \
+    runtime/promise.cpp runtime/generator.cpp runtime/class.cpp; do
+    SOURCES="$SOURCES $ROOT/$source"
+done
+
+PROGRAMS=()
+for test in "$@"; do
+    cp "$test" "$WORK/programs/"
+    program="$WORK/programs/$(basename "$test")"
+    if ("$COMPILER" "$program") > /dev/null 2>&1 && [ -f "$program.c" ]; then
+        PROGRAMS+=("$program.c")
+    fi
+done
+
+COMPILE="-x c++ -std=gnu++17 -Wall -O2 -flto -I$WORK/root"
+
+# run <name> <link arguments...>: builds every program and prints the total and mean wall time of those that built
+run() {
+    name=$1
+    shift
+    built=0
+    start=$(date +%s%N)
+    for program in "${PROGRAMS[@]}"; do
+        if $CXX $COMPILE -c "$program" -o "$WORK/program.o" 2> /dev/null \
+            && $CXX -O2 -flto "$WORK/program.o" "$@" -o "$WORK/program" 2> /dev/null; then
+            built=$((built + 1))
+        fi
+    done
+    milliseconds=$((($(date +%s%N) - start) / 1000000))
+    printf "%-24s%4d programs%10d ms%10d ms/program\n" "$name" "$built" "$milliseconds" \
+        "$((milliseconds / (built > 0 ? built : 1)))"
+}
+
+echo "${#PROGRAMS[@]} of $# tests compiled"
+run "runtime sources" -std=gnu++17 $SOURCES
+run "libesruntime.a" "$ROOT/libesruntime.a"
+$CXX -x c++-header -std=gnu++17 -Wall -O2 -flto "$WORK/root/runtime/runtime.hpp" \
+    -o "$WORK/root/runtime/runtime.hpp.gch"
+run "libesruntime.a + pch" "$ROOT/libesruntime.a"
@@ -0,0 +1,179 @@
+//
+// Cost of the class fast paths: class Point { constructor(x, y) { this.x = x; this.y = y; } norm() { ... } getX() {
+// return this.x; } } lowered the way ast/statement.hpp lowers it, with its fields read from their slots, through
+// Core::getElement on the same instance and on a plain object with the same properties, and its methods called
+// directly as this.norm() is, through the inline cache of a call site and through the uncached lookup. norm boxes
+// the results of its arithmetic, which hides the cost of the call; getX is mostly call. Reports the nanoseconds per
+// operation and the size of an instance against the object, and checks every sum.
+//
+// usage: classes [operations]
+//
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include "../runtime/class.hpp"
+#include "../runtime/core.hpp"
+#include "../runtime/global.hpp"
+
+static GlobalObject globalObject;
+
+static size_t operations = 1000000;
+
+struct Timing {
+    const char* name;
+    double nanoseconds;
+    bool ok;
+};
+
+static double nanosecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / operations;
+}
+
+/**
+ * The functions and the layout of Point, as the compiler emits them
+ */
+static ESValue* class_Point_norm(ClassInstance* self);
+
+static ESValue* class_Point_constructor(ClassInstance* self, ESValue* local_x, ESValue* local_y) {
+    self->setField(0, Core::getValue(local_x));
+    self->setField(1, Core::getValue(local_y));
+    return new Undefined();
+}
+
+static ESValue* class_Point_constructor_call(ClassInstance* self, ESValue** arguments, int argumentCount) {
+    return class_Point_constructor(self, argumentCount > 0 ? arguments[0] : new Undefined(),
+                                   argumentCount > 1 ? arguments[1] : new Undefined());
+}
+
+static ESValue* class_Point_norm(ClassInstance* self) {
+    ESValue* x = self->getField(0, "x");
+    ESValue* y = self->getField(1, "y");
+    return Core::plus(Core::multiply(x, x), Core::multiply(y, y));
+}
+
+static ESValue* class_Point_norm_call(ClassInstance* self, ESValue** arguments, int argumentCount) {
+    return class_Point_norm(self);
+}
+
+static ESValue* class_Point_getX(ClassInstance* self) {
+    return self->getField(0, "x");
+}
+
+static ESValue* class_Point_getX_call(ClassInstance* self, ESValue** arguments, int argumentCount) {
+    return class_Point_getX(self);
+}
+
+static const char* const class_Point_fields[] = {"x", "y"};
+static const ClassMethod class_Point_methods[] = {{"norm", class_Point_norm_call, 0},
+                                                  {"getX", class_Point_getX_call, 0}};
+static const ClassLayout class_Point_layout = {"Point", class_Point_fields, 2, class_Point_methods, 2,
+                                               class_Point_constructor_call, 2};
+
+/**
+ * x is 3 and y is 4, so each step adds 7 to a field sum, 25 to a norm sum and 3 to a getX sum
+ */
+static bool expected(double sum, double perStep) {
+    return sum == perStep * operations;
+}
+
+__attribute__((noinline)) static Timing fieldSlots(ClassInstance* point) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    double sum = 0;
+    for (size_t i = 0; i < operations; i++) {
+        sum += TypeOps::toNumber(point->getField(0, "x"))->getValue();
+        sum += TypeOps::toNumber(point->getField(1, "y"))->getValue();
+    }
+    Timing timing = {"field slot", nanosecondsSince(start) / 2, expected(sum, 7)};
+    return timing;
+}
+
+__attribute__((noinline)) static Timing fieldLookups(ESValue* base, const char* name) {
+    ESValue* x = new String("x");
+    ESValue* y = new String("y");
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    double sum = 0;
+    for (size_t i = 0; i < operations; i++) {
+        sum += TypeOps::toNumber(Core::getValue(Core::getElement(base, x)))->getValue();
+        sum += TypeOps::toNumber(Core::getValue(Core::getElement(base, y)))->getValue();
+    }
+    Timing timing = {name, nanosecondsSince(start) / 2, expected(sum, 7)};
+    return timing;
+}
+
+template <ESValue* (*method)(ClassInstance*)>
+__attribute__((noinline)) static Timing directCalls(ClassInstance* point, const char* name, const char* label,
+                                                    double perStep) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    double sum = 0;
+    for (size_t i = 0; i < operations; i++) {
+        ESValue* result = point->isExpanded() ? Core::callMethod(point, name, NULL, 0)
+                                              : Core::getValue(method(point));
+        sum += TypeOps::toNumber(result)->getValue();
+    }
+    Timing timing = {label, nanosecondsSince(start), expected(sum, perStep)};
+    return timing;
+}
+
+/**
+ * The inline caches of two call sites, thread local as the compiler emits them
+ */
+static __thread MethodCache normCache;
+static __thread MethodCache getXCache;
+
+__attribute__((noinline)) static Timing cachedCalls(ClassInstance* point, const char* name, MethodCache* cache,
+                                                    const char* label, double perStep) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    double sum = 0;
+    for (size_t i = 0; i < operations; i++) {
+        sum += TypeOps::toNumber(Core::callMethod(point, name, NULL, 0, cache))->getValue();
+    }
+    Timing timing = {label, nanosecondsSince(start), expected(sum, perStep)};
+    return timing;
+}
+
+__attribute__((noinline)) static Timing uncachedCalls(ClassInstance* point, const char* name, const char* label,
+                                                      double perStep) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    double sum = 0;
+    for (size_t i = 0; i < operations; i++) {
+        sum += TypeOps::toNumber(Core::callMethod(point, name, NULL, 0))->getValue();
+    }
+    Timing timing = {label, nanosecondsSince(start), expected(sum, perStep)};
+    return timing;
+}
+
+int main(int argc, char* argv[]) {
+    globalObj = &globalObject;
+    if (argc > 1) {
+        operations = strtoul(argv[1], NULL, 10);
+    }
+
+    ClassConstructor* constructor = new ClassConstructor(&class_Point_layout);
+    ESValue* arguments[] = {new Number(3), new Number(4)};
+    // held by locals, which the collector scans, and not by static storage
+    ClassInstance* point = static_cast<ClassInstance*>(constructor->construct(arguments, 2));
+    ESObject* plainObject = new ESObject();
+    plainObject->set(new String("x"), new Number(3));
+    plainObject->set(new String("y"), new Number(4));
+
+    Timing timings[] = {fieldSlots(point), fieldLookups(point, "instance get"), fieldLookups(plainObject, "object get"),
+                        directCalls<class_Point_norm>(point, "norm", "direct norm", 25),
+                        cachedCalls(point, "norm", &normCache, "cached norm", 25),
+                        uncachedCalls(point, "norm", "uncached norm", 25),
+                        directCalls<class_Point_getX>(point, "getX", "direct getX", 3),
+                        cachedCalls(point, "getX", &getXCache, "cached getX", 3),
+                        uncachedCalls(point, "getX", "uncached getX", 3)};
+
+    bool ok = true;
+    printf("%lu operations, instance of %lu bytes, object of %lu bytes and its map\n", (unsigned long)operations,
+           (unsigned long)(sizeof(ClassInstance) + 2 * sizeof(ESValue*)), (unsigned long)sizeof(ESObject));
+    printf("%-16s%12s\n", "", "ns/op");
+    for (size_t i = 0; i < sizeof(timings) / sizeof(timings[0]); i++) {
+        printf("%-16s%12.1f\n", timings[i].name, timings[i].nanoseconds);
+        if (!timings[i].ok) {
+            fprintf(stderr, "%s: wrong result\n", timings[i].name);
+            ok = false;
+        }
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,107 @@
+//
+// Lines per second of Console::log against the previous one fprintf per value, with stdout sent to /dev/null,
+// and a check that logged numbers read back as the same double.
+//
+// usage: console_log [lines]
+//
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "../runtime/console.hpp"
+#include "../type/conversion.hpp"
+
+static size_t lines = 1000000;
+
+/**
+ * Console::log as it was: formatted through stdio once per value, numbers with %f
+ */
+static void fprintfLog(ESValue* value) {
+    if (value->getType() == number) {
+        fprintf(stdout, "%f\n", dynamic_cast<Number*>(value)->getValue());
+    } else if (value->getType() == string_) {
+        fprintf(stdout, "%s\n", dynamic_cast<String*>(value)->getValue().c_str());
+    }
+}
+
+static void bufferedLog(ESValue* value) {
+    Console::log(value);
+}
+
+static double linesPerSecond(void (*log)(ESValue*), std::vector<ESValue*>& values) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < lines; i++) {
+        log(values[i % values.size()]);
+    }
+    Console::flush();
+    fflush(stdout);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return lines / seconds;
+}
+
+static bool checkNumberToString() {
+    struct Case {
+        double value;
+        const char* expected;
+    };
+    Case cases[] = {
+        {0, "0"}, {-0.0, "0"}, {1, "1"}, {-42, "-42"}, {100, "100"}, {0.5, "0.5"}, {0.1 + 0.2, "0.30000000000000004"},
+        {123456789012345680000.0, "123456789012345680000"}, {1e21, "1e+21"}, {1.5e300, "1.5e+300"},
+        {0.000001, "0.000001"}, {1e-7, "1e-7"}, {1.23e-18, "1.23e-18"}, {5e-324, "5e-324"},
+        {1.7976931348623157e308, "1.7976931348623157e+308"}, {NAN, "NaN"}, {INFINITY, "Infinity"},
+        {-INFINITY, "-Infinity"},
+    };
+    bool ok = true;
+    char buffer[NumberConversion::MAX_NUMBER_LENGTH];
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        NumberConversion::toString(cases[i].value, buffer);
+        if (strcmp(buffer, cases[i].expected) != 0) {
+            fprintf(stderr, "NumberToString gives %s, expected %s\n", buffer, cases[i].expected);
+            ok = false;
+        }
+    }
+
+    srand(42);
+    for (int i = 0; i < 1000000; i++) {
+        unsigned long long bits = ((unsigned long long)rand() << 33) ^ ((unsigned long long)rand() << 11) ^ rand();
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        if (value != value || value == INFINITY || value == -INFINITY) {
+            continue;
+        }
+        NumberConversion::toString(value, buffer);
+        if (strtod(buffer, NULL) != value) {
+            fprintf(stderr, "%s does not read back as %.17g\n", buffer, value);
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1) {
+        lines = strtoul(argv[1], NULL, 10);
+    }
+
+    bool ok = checkNumberToString();
+
+    std::vector<ESValue*> values;
+    for (int i = 0; i < 1024; i++) {
+        values.push_back(new Number(i));
+        values.push_back(new Number(i * 0.1));
+        values.push_back(new String("line of logged text"));
+    }
+
+    if (freopen("/dev/null", "w", stdout) == NULL) {
+        return 1;
+    }
+    double before = linesPerSecond(fprintfLog, values);
+    double after = linesPerSecond(bufferedLog, values);
+
+    fprintf(stderr, "%lu lines, buffer %lu bytes\n", (unsigned long)lines, (unsigned long)Console::DEFAULT_BUFFER_SIZE);
+    fprintf(stderr, "%-16s%14.0f lines/s\n", "fprintf", before);
+    fprintf(stderr, "%-16s%14.0f lines/s\n", "Console::log", after);
+    fprintf(stderr, "%-16s%13.2fx\n", "speedup", after / before);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,76 @@
+//
+// Nanoseconds per operation of the generic Core operators against the variants specialised on operand types, the
+// calls the compiler emits when it knows an operand is a Number or a String, and a check that both agree.
+//
+// usage: core_operators [operations]
+//
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include "../runtime/core.hpp"
+
+static ESObject globalObject;
+
+static size_t operations = 250000;
+
+typedef ESValue* (*Operator)(ESValue* lref, ESValue* rref);
+
+struct Benchmark {
+    const char* name;
+    Operator generic;
+    Operator specialised;
+    bool referenceOnLeft;
+};
+
+static const Benchmark benchmarks[] = {
+    {"1 + 2", Core::plus, Core::plus<NumberTag, NumberTag>, false},
+    {"1 - 2", Core::subtract, Core::subtract<NumberTag, NumberTag>, false},
+    {"1 * 2", Core::multiply, Core::multiply<NumberTag, NumberTag>, false},
+    {"1 / 2", Core::divide, Core::divide<NumberTag, NumberTag>, false},
+    {"1 % 2", Core::modulo, Core::modulo<NumberTag, NumberTag>, false},
+    {"x * 2", Core::multiply, Core::multiply<AnyTag, NumberTag>, true},
+    {"x + 2", Core::plus, Core::plus<AnyTag, NumberTag>, true},
+    {"\"a\" + 2", Core::plus, Core::plus<StringTag, NumberTag>, false},
+};
+
+static double nanosecondsPerOperation(Operator op, ESValue* lhs, ESValue* rhs, double* sink) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < operations; i++) {
+        *sink += op(lhs, rhs)->getType();
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() * 1e9 / operations;
+}
+
+static bool same(ESValue* a, ESValue* b) {
+    return a->getType() == b->getType() && a->toString()->getValue() == b->toString()->getValue();
+}
+
+int main(int argc, char* argv[]) {
+    globalObj = &globalObject;
+    if (argc > 1) {
+        operations = strtoul(argv[1], NULL, 10);
+    }
+
+    globalObj->set(new String("x"), new Number(7));
+    ESValue* reference = new Reference(new String("x"));
+    ESValue* string = new String("a");
+    ESValue* one = new Number(1);
+    ESValue* two = new Number(2);
+
+    bool ok = true;
+    double sink = 0;
+    printf("%lu operations\n", (unsigned long)operations);
+    printf("%-12s%12s%14s%10s\n", "operation", "generic", "specialised", "speedup");
+    for (size_t b = 0; b < sizeof(benchmarks) / sizeof(benchmarks[0]); b++) {
+        const Benchmark& benchmark = benchmarks[b];
+        ESValue* lhs = benchmark.referenceOnLeft ? reference : benchmark.name[0] == '"' ? string : one;
+        if (!same(benchmark.generic(lhs, two), benchmark.specialised(lhs, two))) {
+            fprintf(stderr, "%s: specialised result differs from the generic one\n", benchmark.name);
+            ok = false;
+        }
+        double generic = nanosecondsPerOperation(benchmark.generic, lhs, two, &sink);
+        double specialised = nanosecondsPerOperation(benchmark.specialised, lhs, two, &sink);
+        printf("%-12s%10.2fns%12.2fns%9.2fx\n", benchmark.name, generic, specialised, generic / specialised);
+    }
+    return ok && sink > 0 ? 0 : 1;
+}
@@ -0,0 +1,111 @@
+//
+// Cost of the destructuring fast paths: const {a, b} = object lowered the way ast/expression.hpp lowers it, with
+// Core::destructureProperty, against two Core::getElement lookups, and const [x, y] = array with
+// Core::destructureArray reading the array in place, against the same elements through its iterator as the generic
+// protocol reads them. Reports the nanoseconds per binding and checks every sum.
+//
+// usage: destructuring [operations]
+//
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include "../runtime/core.hpp"
+#include "../runtime/generator.hpp"
+#include "../runtime/global.hpp"
+
+static GlobalObject globalObject;
+
+static size_t operations = 1000000;
+
+struct Timing {
+    const char* name;
+    double nanoseconds;
+    bool ok;
+};
+
+static double nanosecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / operations;
+}
+
+/**
+ * a and x are 3, b and y are 4, so each step adds 7 to the sum
+ */
+static bool expected(double sum) {
+    return sum == 7.0 * operations;
+}
+
+__attribute__((noinline)) static Timing properties(ESValue* object) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    double sum = 0;
+    for (size_t i = 0; i < operations; i++) {
+        ESValue* source = Core::getValue(object);
+        sum += TypeOps::toNumber(Core::destructureProperty(source, "a"))->getValue();
+        sum += TypeOps::toNumber(Core::destructureProperty(source, "b"))->getValue();
+    }
+    Timing timing = {"property", nanosecondsSince(start) / 2, expected(sum)};
+    return timing;
+}
+
+__attribute__((noinline)) static Timing propertyLookups(ESValue* object) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    double sum = 0;
+    for (size_t i = 0; i < operations; i++) {
+        sum += TypeOps::toNumber(Core::getValue(Core::getElement(object, new String("a"))))->getValue();
+        sum += TypeOps::toNumber(Core::getValue(Core::getElement(object, new String("b"))))->getValue();
+    }
+    Timing timing = {"getElement", nanosecondsSince(start) / 2, expected(sum)};
+    return timing;
+}
+
+__attribute__((noinline)) static Timing elements(ESValue* array) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    double sum = 0;
+    for (size_t i = 0; i < operations; i++) {
+        ESValue* slots[2];
+        Core::destructureArray(array, slots, 2, NULL);
+        sum += TypeOps::toNumber(slots[0])->getValue() + TypeOps::toNumber(slots[1])->getValue();
+    }
+    Timing timing = {"element", nanosecondsSince(start) / 2, expected(sum)};
+    return timing;
+}
+
+__attribute__((noinline)) static Timing iterated(ESValue* array) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    double sum = 0;
+    for (size_t i = 0; i < operations; i++) {
+        Generator* iterator = Generator::iterate(array);
+        bool done = false;
+        sum += TypeOps::toNumber(iterator->resume(new Undefined(), &done))->getValue();
+        sum += TypeOps::toNumber(iterator->resume(new Undefined(), &done))->getValue();
+    }
+    Timing timing = {"iterator", nanosecondsSince(start) / 2, expected(sum)};
+    return timing;
+}
+
+int main(int argc, char* argv[]) {
+    globalObj = &globalObject;
+    if (argc > 1) {
+        operations = strtoul(argv[1], NULL, 10);
+    }
+
+    // held by locals, which the collector scans, and not by static storage
+    ESObject* object = new ESObject();
+    object->set(new String("a"), new Number(3));
+    object->set(new String("b"), new Number(4));
+    int values[] = {3, 4};
+    ESArray* array = new ESArray(values, 2);
+
+    Timing timings[] = {properties(object), propertyLookups(object), elements(array), iterated(array)};
+
+    bool ok = true;
+    printf("%lu operations\n", (unsigned long)operations);
+    printf("%-16s%12s\n", "", "ns/binding");
+    for (size_t i = 0; i < sizeof(timings) / sizeof(timings[0]); i++) {
+        printf("%-16s%12.1f\n", timings[i].name, timings[i].nanoseconds);
+        if (!timings[i].ok) {
+            fprintf(stderr, "%s: wrong result\n", timings[i].name);
+            ok = false;
+        }
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,151 @@
+//
+// The cost of a call from C++ into a compiled script and back: benchmarks/embedding.js compiled with
+// --entry embeddingScript and run in an isolate, whose functions are then called through the function object held
+// by the caller and by name. identity(i) is timed against boxing i and reading it back, which leaves the call
+// overhead, and add(i, 1) against the same addition done in C++ with the runtime. Also times writing and reading
+// back a global and passing a string through a function. Reports nanoseconds per call and checks every result.
+//
+// usage: embedding [calls]
+//
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include "../runtime/embedding.hpp"
+
+int embeddingScript();
+
+static size_t calls = 1000000;
+
+struct Timing {
+    const char* name;
+    double nanoseconds;
+    bool ok;
+};
+
+static double nanosecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / calls;
+}
+
+static double expectedSum() {
+    return (double)calls * (calls - 1) / 2 + calls;
+}
+
+/**
+ * A Number made from i and read back, which is all identity(i) adds to the call itself
+ */
+__attribute__((noinline)) static Timing boxing() {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    double sum = 0;
+    for (size_t i = 0; i < calls; i++) {
+        sum += Embedding::toNumber(Embedding::fromNumber((double)i + 1));
+    }
+    Timing timing = {"C++ box", nanosecondsSince(start), sum == expectedSum()};
+    return timing;
+}
+
+__attribute__((noinline)) static Timing identity() {
+    Function* identity = Embedding::getFunction("identity");
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    double sum = 0;
+    for (size_t i = 0; i < calls; i++) {
+        ESValue* arguments[] = {Embedding::fromNumber((double)i + 1)};
+        sum += Embedding::toNumber(Embedding::call(identity, arguments, 1));
+    }
+    Timing timing = {"identity", nanosecondsSince(start), identity != NULL && sum == expectedSum()};
+    return timing;
+}
+
+/**
+ * i + 1 with the runtime and no call, the work add(i, 1) does
+ */
+__attribute__((noinline)) static Timing inCpp() {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    double sum = 0;
+    for (size_t i = 0; i < calls; i++) {
+        ESValue* result = Core::plus(Embedding::fromNumber((double)i), Embedding::fromNumber(1));
+        sum += Embedding::toNumber(result);
+    }
+    Timing timing = {"C++ add", nanosecondsSince(start), sum == expectedSum()};
+    return timing;
+}
+
+__attribute__((noinline)) static Timing heldFunction() {
+    Function* add = Embedding::getFunction("add");
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    double sum = 0;
+    for (size_t i = 0; i < calls; i++) {
+        ESValue* arguments[] = {Embedding::fromNumber((double)i), Embedding::fromNumber(1)};
+        sum += Embedding::toNumber(Embedding::call(add, arguments, 2));
+    }
+    Timing timing = {"add", nanosecondsSince(start), add != NULL && sum == expectedSum()};
+    return timing;
+}
+
+__attribute__((noinline)) static Timing byName() {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    double sum = 0;
+    for (size_t i = 0; i < calls; i++) {
+        ESValue* arguments[] = {Embedding::fromNumber((double)i), Embedding::fromNumber(1)};
+        sum += Embedding::toNumber(Embedding::call("add", arguments, 2));
+    }
+    Timing timing = {"add by name", nanosecondsSince(start), sum == expectedSum()};
+    return timing;
+}
+
+/**
+ * count(step) adds step to the global calls, which starts at 0, and returns it
+ */
+__attribute__((noinline)) static Timing globals() {
+    Function* count = Embedding::getFunction("count");
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    bool ok = count != NULL;
+    for (size_t i = 0; i < calls && ok; i++) {
+        Embedding::setGlobal("calls", Embedding::fromNumber((double)i));
+        ESValue* arguments[] = {Embedding::fromNumber(1)};
+        ok = Embedding::toNumber(Embedding::call(count, arguments, 1)) == (double)i + 1
+             && Embedding::toNumber(Embedding::getGlobal("calls")) == (double)i + 1;
+    }
+    Timing timing = {"set, call, get", nanosecondsSince(start), ok};
+    return timing;
+}
+
+__attribute__((noinline)) static Timing strings() {
+    Function* greet = Embedding::getFunction("greet");
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    bool ok = greet != NULL;
+    for (size_t i = 0; i < calls && ok; i++) {
+        ESValue* arguments[] = {Embedding::fromString(std::string("world"))};
+        const std::string* greeting = Embedding::getString(Embedding::call(greet, arguments, 1));
+        ok = greeting != NULL && *greeting == "hello world";
+    }
+    Timing timing = {"string", nanosecondsSince(start), ok};
+    return timing;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1) {
+        calls = strtoul(argv[1], NULL, 10);
+    }
+
+    Isolate isolate;
+    if (isolate.run(embeddingScript) != 0) {
+        fprintf(stderr, "embeddingScript failed\n");
+        return 1;
+    }
+    Isolate::Scope scope(&isolate);
+    Timing timings[] = {boxing(), identity(), inCpp(), heldFunction(), byName(), globals(), strings()};
+
+    bool ok = true;
+    printf("%lu calls\n", (unsigned long)calls);
+    printf("%-16s%12s\n", "", "ns/call");
+    for (size_t i = 0; i < sizeof(timings) / sizeof(timings[0]); i++) {
+        printf("%-16s%12.1f\n", timings[i].name, timings[i].nanoseconds);
+        if (!timings[i].ok) {
+            fprintf(stderr, "%s: wrong result\n", timings[i].name);
+            ok = false;
+        }
+    }
+    printf("%-16s%12.1f\n", "call overhead", timings[1].nanoseconds - timings[0].nanoseconds);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,21 @@
+/**
+ * Functions a C++ program calls, see embedding.cpp
+ */
+function identity(value) {
+	return value;
+}
+
+function add(a, b) {
+	return a + b;
+}
+
+function greet(name) {
+	return "hello " + name;
+}
+
+function count(step) {
+	calls = calls + step;
+	return calls;
+}
+
+calls = 0;
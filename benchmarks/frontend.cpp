@@ -0,0 +1,331 @@
+//
+// Scaling of the compiler front end over generated inputs of a given size and shape: long statement lists, deep
+// nesting, large array and object literals, and many functions. Lexing, parsing, dump, genCode and writing the
+// generated file are timed separately, each shape in its own process so that its peak RSS is its own, and the
+// results are written to stdout as JSON.
+//
+// usage: frontend [--size bytes] [--depth levels] [--runs n] [shape...]
+//
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "../y.tab.h"
+#include "../ast/ast.hpp"
+#include "../grammar.tab.h"
+#include "../lex.yy.h"
+
+extern FILE* yyin;
+int yyparse(void);
+extern ScriptBody* root;
+extern std::map<int, vector<std::string> > codeScope;
+extern int codeScopeDepth;
+extern std::vector<std::string> functionDefinitions;
+
+static size_t corpusSize = 4 << 20;
+static int depth = 100;
+static size_t runs = 3;
+
+enum Phase {lexPhase, parsePhase, dumpPhase, genCodePhase, emitPhase, phaseCount};
+
+static const char* phaseNames[phaseCount] = {"lex", "parse", "dump", "genCode", "emit"};
+
+/**
+ * What a process measuring one shape reports back
+ */
+struct Measurement {
+    bool ok;
+    size_t sourceBytes;
+    size_t tokens;
+    size_t outputBytes;
+    long peakRssKilobytes;
+    double seconds[phaseCount];
+};
+
+/**
+ * x0 = 1; then statements that each use the previous variable
+ */
+static void generateStatements(std::string& source) {
+    source += "x0 = 1;\n";
+    char line[96];
+    for (size_t i = 1; source.size() < corpusSize; i++) {
+        snprintf(line, sizeof(line), "x%lu = (x%lu + %lu) * 2 - x%lu %% 7;\n", (unsigned long)i,
+                 (unsigned long)(i - 1), (unsigned long)i, (unsigned long)(i - 1));
+        source += line;
+    }
+}
+
+/**
+ * Blocks of if statements nested depth levels deep around an expression parenthesised depth levels deep. The grammar
+ * reads a block that starts with an assignment as an object literal, so the innermost if has no block.
+ */
+static void generateNesting(std::string& source) {
+    source += "x = 1;\n";
+    while (source.size() < corpusSize) {
+        for (int level = 0; level < depth; level++) {
+            source.append(level, '\t');
+            source += "if (x < " + std::to_string(level + 2) + ") {\n";
+        }
+        source.append(depth, '\t');
+        source += "if (x > 0) x = " + std::string(depth, '(') + "x + 1" + std::string(depth, ')') + ";\n";
+        for (int level = depth - 1; level >= 0; level--) {
+            source.append(level, '\t');
+            source += "}\n";
+        }
+    }
+}
+
+/**
+ * Array literals of 1000 numbers, strings and nested arrays, each followed by an object literal of 1000 properties
+ */
+static void generateLiterals(std::string& source) {
+    char element[64];
+    for (size_t i = 0; source.size() < corpusSize; i++) {
+        source += "a" + std::to_string(i) + " = [";
+        for (int e = 0; e < 1000; e++) {
+            switch (e % 4) {
+                case 0: snprintf(element, sizeof(element), "%d", e); break;
+                case 1: snprintf(element, sizeof(element), "%d.5", e); break;
+                case 2: snprintf(element, sizeof(element), "\"s%d\"", e); break;
+                default: snprintf(element, sizeof(element), "[%d, %d]", e, -e); break;
+            }
+            source += e > 0 ? ", " : "";
+            source += element;
+        }
+        source += "];\no" + std::to_string(i) + " = {";
+        for (int p = 0; p < 1000; p++) {
+            snprintf(element, sizeof(element), p % 2 == 0 ? "%sk%d: %d" : "%s\"k%d\": \"v\"", p > 0 ? ", " : "", p, p);
+            source += element;
+        }
+        source += "};\n";
+    }
+}
+
+/**
+ * Functions of a few statements, each called once
+ */
+static void generateFunctions(std::string& source) {
+    char function[256];
+    for (size_t i = 0; source.size() < corpusSize; i++) {
+        snprintf(function, sizeof(function),
+                 "function f%lu(a, b) {\n\tc = a * b;\n\tif (c > %lu) {\n\t\treturn c - a;\n\t}\n\treturn c + b;\n}\n"
+                 "y = f%lu(%lu, 2);\n", (unsigned long)i, (unsigned long)i, (unsigned long)i, (unsigned long)i);
+        source += function;
+    }
+}
+
+struct Shape {
+    const char* name;
+    void (*generate)(std::string& source);
+};
+
+static const Shape shapes[] = {
+    {"statements", generateStatements},
+    {"nesting", generateNesting},
+    {"literals", generateLiterals},
+    {"functions", generateFunctions},
+};
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static FILE* openSource(const std::string& path) {
+    FILE* file = fopen(path.c_str(), "r");
+    yyrestart(file);
+    return file;
+}
+
+/**
+ * Runs the front end over a freshly generated corpus of one shape, the way main.cpp does, timing every phase
+ */
+static Measurement measure(const Shape& shape, const std::string& directory) {
+    Measurement measurement;
+    memset(&measurement, 0, sizeof(measurement));
+
+    std::string source;
+    shape.generate(source);
+    measurement.sourceBytes = source.size();
+    std::string sourcePath = directory + "/" + shape.name + ".js";
+    std::string outputPath = sourcePath + ".c";
+    FILE* sourceFile = fopen(sourcePath.c_str(), "w");
+    fwrite(source.data(), 1, source.size(), sourceFile);
+    fclose(sourceFile);
+    source = std::string();
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    yyin = openSource(sourcePath);
+    while (yylex() != 0) {
+        measurement.tokens++;
+    }
+    fclose(yyin);
+    measurement.seconds[lexPhase] = secondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    yyin = openSource(sourcePath);
+    int status = yyparse();
+    fclose(yyin);
+    measurement.seconds[parsePhase] = secondsSince(start);
+    if (status != 0 || root == NULL) {
+        return measurement;
+    }
+
+    // the dump is printed, so it goes to /dev/null rather than into the results
+    fflush(stdout);
+    int savedStdout = dup(STDOUT_FILENO);
+    int null = open("/dev/null", O_WRONLY);
+    dup2(null, STDOUT_FILENO);
+    start = std::chrono::steady_clock::now();
+    root->dump(0);
+    fflush(stdout);
+    measurement.seconds[dumpPhase] = secondsSince(start);
+    dup2(savedStdout, STDOUT_FILENO);
+    close(null);
+    close(savedStdout);
+
+    start = std::chrono::steady_clock::now();
+    codeScopeDepth = 0;
+    root->genCode();
+    measurement.seconds[genCodePhase] = secondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    std::vector<std::string> output;
+    output.push_back("#include \"./runtime/runtime.hpp\"");
+    output.push_back("");
+    output.push_back("GlobalObject globalObject;");
+    output.push_back("");
+    output.insert(output.end(), functionDefinitions.begin(), functionDefinitions.end());
+    output.insert(output.end(), codeScope[codeScopeDepth].begin(), codeScope[codeScopeDepth].end());
+    FILE* outputFile = fopen(outputPath.c_str(), "w");
+    for (std::vector<std::string>::iterator iter = output.begin(); iter != output.end(); ++iter) {
+        fprintf(outputFile, "%s\n", iter->c_str());
+        measurement.outputBytes += iter->size() + 1;
+    }
+    fclose(outputFile);
+    measurement.seconds[emitPhase] = secondsSince(start);
+
+    unlink(sourcePath.c_str());
+    unlink(outputPath.c_str());
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    measurement.peakRssKilobytes = usage.ru_maxrss;
+    measurement.ok = true;
+    return measurement;
+}
+
+/**
+ * measure() in a child process, so that the AST and generated code of one run do not count towards the next
+ */
+static Measurement measureInChild(const Shape& shape, const std::string& directory) {
+    Measurement measurement;
+    memset(&measurement, 0, sizeof(measurement));
+    int pipeEnds[2];
+    if (pipe(pipeEnds) != 0) {
+        return measurement;
+    }
+    fflush(stdout);
+    pid_t child = fork();
+    if (child == 0) {
+        // parse errors are printed to stdout, keep them out of the JSON
+        dup2(STDERR_FILENO, STDOUT_FILENO);
+        close(pipeEnds[0]);
+        measurement = measure(shape, directory);
+        ssize_t written = write(pipeEnds[1], &measurement, sizeof(measurement));
+        _exit(written == (ssize_t)sizeof(measurement) ? 0 : 1);
+    }
+    close(pipeEnds[1]);
+    if (child < 0 || read(pipeEnds[0], &measurement, sizeof(measurement)) != (ssize_t)sizeof(measurement)) {
+        measurement.ok = false;
+    }
+    close(pipeEnds[0]);
+    int status = -1;
+    if (child > 0) {
+        waitpid(child, &status, 0);
+    }
+    measurement.ok = measurement.ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    return measurement;
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<const Shape*> selected;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            corpusSize = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--depth") == 0 && i + 1 < argc) {
+            depth = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+            runs = strtoul(argv[++i], NULL, 10);
+        } else {
+            const Shape* shape = NULL;
+            for (size_t s = 0; s < sizeof(shapes) / sizeof(shapes[0]); s++) {
+                shape = strcmp(argv[i], shapes[s].name) == 0 ? &shapes[s] : shape;
+            }
+            if (shape == NULL) {
+                fprintf(stderr, "usage: %s [--size bytes] [--depth levels] [--runs n] "
+                        "[statements|nesting|literals|functions...]\n", argv[0]);
+                return 1;
+            }
+            selected.push_back(shape);
+        }
+    }
+    if (selected.empty()) {
+        for (size_t s = 0; s < sizeof(shapes) / sizeof(shapes[0]); s++) {
+            selected.push_back(&shapes[s]);
+        }
+    }
+    runs = runs > 0 ? runs : 1;
+
+    char directory[] = "/tmp/frontendXXXXXX";
+    if (mkdtemp(directory) == NULL) {
+        perror("mkdtemp");
+        return 1;
+    }
+
+    bool ok = true;
+    printf("{\n  \"size\": %lu,\n  \"depth\": %d,\n  \"runs\": %lu,\n  \"shapes\": [", (unsigned long)corpusSize, depth,
+           (unsigned long)runs);
+    for (size_t s = 0; s < selected.size(); s++) {
+        // the fastest run of each phase, and the largest peak RSS of any run
+        Measurement best;
+        for (size_t run = 0; run < runs; run++) {
+            Measurement measurement = measureInChild(*selected[s], directory);
+            if (!measurement.ok) {
+                fprintf(stderr, "%s: the front end failed on the generated input\n", selected[s]->name);
+                best = measurement;
+                ok = false;
+                break;
+            }
+            if (run == 0) {
+                best = measurement;
+                continue;
+            }
+            for (int phase = 0; phase < phaseCount; phase++) {
+                best.seconds[phase] = measurement.seconds[phase] < best.seconds[phase] ? measurement.seconds[phase]
+                                                                                        : best.seconds[phase];
+            }
+            best.peakRssKilobytes = measurement.peakRssKilobytes > best.peakRssKilobytes ? measurement.peakRssKilobytes
+                                                                                          : best.peakRssKilobytes;
+        }
+
+        printf("%s\n    {\n      \"shape\": \"%s\",\n      \"ok\": %s,\n      \"source_bytes\": %lu,\n"
+               "      \"tokens\": %lu,\n      \"output_bytes\": %lu,\n      \"peak_rss_kb\": %ld,\n      \"phases\": {",
+               s > 0 ? "," : "", selected[s]->name, best.ok ? "true" : "false", (unsigned long)best.sourceBytes,
+               (unsigned long)best.tokens, (unsigned long)best.outputBytes, best.peakRssKilobytes);
+        for (int phase = 0; phase < phaseCount; phase++) {
+            double megabytesPerSecond = best.seconds[phase] > 0 ? best.sourceBytes / 1e6 / best.seconds[phase] : 0;
+            printf("%s\n        \"%s\": {\"seconds\": %.6f, \"mb_per_s\": %.2f}", phase > 0 ? "," : "",
+                   phaseNames[phase], best.seconds[phase], megabytesPerSecond);
+        }
+        printf("\n      }\n    }");
+    }
+    printf("\n  ]\n}\n");
+    rmdir(directory);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,171 @@
+//
+// Pauses of the major collector: a graph of objects that stays live while nodes are replaced, so that the old
+// generation keeps filling with garbage, run with pause budgets of 0.5, 1 and 4 ms and stopping the world
+// (ES_GC_PAUSE_MS=0), each in a child so that its peak RSS is its own. Reports the percentiles of the time a batch
+// of replacements takes and of the collector's pauses, the longest slice of a major collection apart from the
+// minor collections, and checks that every node of the graph survives intact.
+//
+// usage: gc_pauses [replacements] [nodes]
+//
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "../runtime/core.hpp"
+
+static ESObject globalObject;
+
+static size_t replacements = 1000000;
+static size_t nodes = 100000;
+
+static const size_t BATCH = 64;
+
+struct Measurement {
+    bool ok;
+    double batchP50;
+    double batchP99;
+    double batchMax;
+    Heap::Statistics statistics;
+};
+
+/**
+ * A node of the graph: its id, a name made from it and the node after it
+ */
+static ESObject* createNode(String* idKey, String* nameKey, size_t id) {
+    ESObject* node = new ESObject();
+    node->set(idKey, new Number((double)id));
+    node->set(nameKey, new String("node " + std::to_string(id)));
+    return node;
+}
+
+static bool checkNode(ESValue* value, String* idKey, String* nameKey, size_t id) {
+    ESObject* node = dynamic_cast<ESObject*>(value);
+    if (node == NULL || !node->hasOwnProperty(idKey) || !node->hasOwnProperty(nameKey)) {
+        return false;
+    }
+    Number* storedId = dynamic_cast<Number*>(node->get(idKey));
+    String* name = dynamic_cast<String*>(node->get(nameKey));
+    return storedId != NULL && storedId->getValue() == (double)id && name != NULL
+           && name->getValue() == "node " + std::to_string(id);
+}
+
+__attribute__((noinline)) static bool mutate(Measurement* measurement) {
+    String* idKey = new String("id");
+    String* nameKey = new String("name");
+    String* nextKey = new String("next");
+    ESArray* graph = new ESArray();
+    // the id each slot of the graph should hold, kept outside the heap
+    std::vector<size_t> expected(nodes);
+    for (size_t i = 0; i < nodes; i++) {
+        graph->setElement(i, createNode(idKey, nameKey, i));
+        expected[i] = i;
+    }
+    for (size_t i = 0; i < nodes; i++) {
+        static_cast<ESObject*>(graph->getElement(i))->set(nextKey, graph->getElement((i + 1) % nodes));
+    }
+
+    std::vector<double> batches;
+    batches.reserve(replacements / BATCH + 1);
+    unsigned int seed = 1;
+    size_t nextId = nodes;
+    for (size_t done = 0; done < replacements; done += BATCH) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (size_t j = 0; j < BATCH; j++) {
+            size_t slot = rand_r(&seed) % nodes;
+            ESObject* node = createNode(idKey, nameKey, nextId);
+            node->set(nextKey, graph->getElement((slot + 1) % nodes));
+            graph->setElement(slot, node);
+            static_cast<ESObject*>(graph->getElement((slot + nodes - 1) % nodes))->set(nextKey, node);
+            expected[slot] = nextId++;
+        }
+        batches.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    bool ok = true;
+    for (size_t i = 0; i < nodes && ok; i++) {
+        ESValue* node = graph->getElement(i);
+        ESValue* next = static_cast<ESObject*>(node)->get(nextKey);
+        if (!checkNode(node, idKey, nameKey, expected[i])
+            || !checkNode(next, idKey, nameKey, expected[(i + 1) % nodes])) {
+            fprintf(stderr, "node %lu did not survive the collections\n", (unsigned long)i);
+            ok = false;
+        }
+    }
+
+    std::sort(batches.begin(), batches.end());
+    measurement->batchP50 = batches[batches.size() / 2];
+    measurement->batchP99 = batches[batches.size() * 99 / 100];
+    measurement->batchMax = batches.back();
+    measurement->statistics = Heap::getStatistics();
+    return ok;
+}
+
+/**
+ * Runs the graph in a child with ES_GC_PAUSE_MS set to budget
+ */
+static bool measure(const char* budget, Measurement* measurement, long* peakKilobytes) {
+    int channel[2];
+    if (pipe(channel) != 0) {
+        return false;
+    }
+    pid_t child = fork();
+    if (child == 0) {
+        close(channel[0]);
+        setenv("ES_GC_PAUSE_MS", budget, 1);
+        Measurement result;
+        result.ok = mutate(&result);
+        if (write(channel[1], &result, sizeof(result)) != sizeof(result)) {
+            _exit(1);
+        }
+        _exit(0);
+    }
+    close(channel[1]);
+    bool ok = read(channel[0], measurement, sizeof(*measurement)) == sizeof(*measurement);
+    close(channel[0]);
+    int status = -1;
+    struct rusage usage;
+    wait4(child, &status, 0, &usage);
+    *peakKilobytes = usage.ru_maxrss;
+    return ok && WIFEXITED(status) && WEXITSTATUS(status) == 0 && measurement->ok;
+}
+
+int main(int argc, char* argv[]) {
+    globalObj = &globalObject;
+    if (argc > 1) {
+        replacements = strtoul(argv[1], NULL, 10);
+    }
+    if (argc > 2) {
+        nodes = strtoul(argv[2], NULL, 10);
+    }
+
+    const char* budgets[] = {"0.5", "1", "4", "0"};
+    bool ok = true;
+    printf("%lu nodes, %lu replacements in batches of %lu\n", (unsigned long)nodes, (unsigned long)replacements,
+           (unsigned long)BATCH);
+    printf("%-8s%10s%10s%10s%10s%10s%10s%8s%8s%10s\n", "budget", "batch p50", "p99", "max", "pause p99",
+           "slice max", "max", "majors", "slices", "peak RSS");
+    for (size_t b = 0; b < sizeof(budgets) / sizeof(budgets[0]); b++) {
+        Measurement measurement = {};
+        long peakKilobytes = 0;
+        if (!measure(budgets[b], &measurement, &peakKilobytes)) {
+            fprintf(stderr, "%s ms: the graph did not survive\n", budgets[b]);
+            ok = false;
+            continue;
+        }
+        const Heap::Statistics& statistics = measurement.statistics;
+        char budget[16];
+        snprintf(budget, sizeof(budget), "%sms", budgets[b]);
+        printf("%-8s%8.0fus%8.0fus%8.2fms%8.0fus%8.2fms%8.2fms%8lu%8lu%8.1fMB\n",
+               strcmp(budgets[b], "0") == 0 ? "stw" : budget, measurement.batchP50 * 1e6,
+               measurement.batchP99 * 1e6, measurement.batchMax * 1e3, Heap::pausePercentile(statistics, 0.99) * 1e6,
+               statistics.maxSliceSeconds * 1e3, statistics.maxPauseSeconds * 1e3,
+               (unsigned long)statistics.majorCollections, (unsigned long)statistics.slices, peakKilobytes / 1024.0);
+    }
+    return ok ? 0 : 1;
+}
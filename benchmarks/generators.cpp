@@ -0,0 +1,241 @@
+//
+// Cost of a step of a generator against a plain call: a generator lowered the way ast/resumable.hpp lowers
+// function* count(n) { i = 0; while (i < n) { yield i; i = i + 1; } }, driven through resume and through next with its
+// result object, the same values from a native function called once per step, an array iterated with
+// Generator::iterate, and an async function that awaits steps times. Reports the nanoseconds per step and the size
+// of a suspended frame, and checks every sum.
+//
+// usage: generators [steps]
+//
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "../runtime/core.hpp"
+#include "../runtime/eventloop.hpp"
+#include "../runtime/generator.hpp"
+#include "../runtime/global.hpp"
+
+static GlobalObject globalObject;
+
+static size_t steps = 1000000;
+
+struct Timing {
+    const char* name;
+    double nanoseconds;
+    bool ok;
+};
+
+static double nanosecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / steps;
+}
+
+static double expectedSum() {
+    return (double)steps * (steps - 1) / 2;
+}
+
+/**
+ * The frame and resume function of count, as the compiler emits them: n is a parameter and i is live across the
+ * yield, so both are fields
+ */
+static ESValue* count_resume(Generator* generator, ESValue* sent);
+struct count_frame : public Generator {
+    ESValue* local_n;
+    ESValue* local_i;
+
+    count_frame() : Generator(count_resume) {
+        local_n = NULL;
+        local_i = NULL;
+    }
+
+    void visitReferences(Heap::ReferenceVisitor& visitor) {
+        Generator::visitReferences(visitor);
+        if (local_n != NULL) {
+            visitor.visit(&local_n);
+        }
+        if (local_i != NULL) {
+            visitor.visit(&local_i);
+        }
+    }
+};
+
+static ESValue* count_resume(Generator* generator, ESValue* sent) {
+    count_frame* frame = static_cast<count_frame*>(generator);
+    ESValue* local_n = frame->local_n;
+    ESValue* local_i;
+    switch (frame->getResumePoint()) {
+        case 1: goto label_resume_1;
+    }
+    local_i = new Number(0);
+label_loop:
+    if (!Core::lessThan(local_i, local_n)) {
+        return frame->complete(new Undefined());
+    }
+    frame->store(frame->local_i, local_i);
+    return frame->suspend(1, local_i);
+label_resume_1:
+    local_i = frame->local_i;
+    local_i = Core::plus(local_i, new Number(1));
+    goto label_loop;
+}
+
+static count_frame* count(ESValue* local_n) {
+    count_frame* frame = new count_frame();
+    frame->store(frame->local_n, local_n);
+    return frame;
+}
+
+__attribute__((noinline)) static Timing resumed() {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    count_frame* generator = count(new Number((double)steps));
+    double sum = 0;
+    bool done = false;
+    ESValue* value = generator->resume(new Undefined(), &done);
+    while (!done) {
+        sum += TypeOps::toNumber(value)->getValue();
+        value = generator->resume(new Undefined(), &done);
+    }
+    Timing timing = {"resume", nanosecondsSince(start), sum == expectedSum()};
+    return timing;
+}
+
+__attribute__((noinline)) static Timing nexts() {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    count_frame* generator = count(new Number((double)steps));
+    double sum = 0;
+    IteratorResult* result = generator->next(new Undefined());
+    while (!result->isDone()) {
+        sum += TypeOps::toNumber(result->getValue())->getValue();
+        result = generator->next(new Undefined());
+    }
+    Timing timing = {"next", nanosecondsSince(start), sum == expectedSum()};
+    return timing;
+}
+
+/**
+ * (i, n) => { if (i < n) { i + 1; } return i; }, the work of one step of count without the frame
+ */
+static ESValue* step(ESValue** arguments, int argumentCount) {
+    if (Core::lessThan(arguments[0], arguments[1])) {
+        Core::plus(arguments[0], new Number(1));
+    }
+    return arguments[0];
+}
+
+__attribute__((noinline)) static Timing called() {
+    Function* function = new Function(step, "step", 2);
+    ESValue* n = new Number((double)steps);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    double sum = 0;
+    for (size_t i = 0; i < steps; i++) {
+        ESValue* arguments[] = {new Number((double)i), n};
+        sum += TypeOps::toNumber(function->call(arguments, 2))->getValue();
+    }
+    Timing timing = {"function call", nanosecondsSince(start), sum == expectedSum()};
+    return timing;
+}
+
+__attribute__((noinline)) static Timing arrayIterator() {
+    std::vector<int> elements(steps);
+    for (size_t i = 0; i < steps; i++) {
+        elements[i] = (int)i;
+    }
+    ESArray* array = new ESArray(elements.data(), steps);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    Generator* iterator = Generator::iterate(array);
+    double sum = 0;
+    bool done = false;
+    ESValue* value = iterator->resume(new Undefined(), &done);
+    while (!done) {
+        sum += TypeOps::toNumber(value)->getValue();
+        value = iterator->resume(new Undefined(), &done);
+    }
+    Timing timing = {"array iterator", nanosecondsSince(start), sum == expectedSum()};
+    return timing;
+}
+
+/**
+ * async function sum(n) { total = 0; i = 0; while (i < n) { total = total + await i; i = i + 1; } return total; }
+ */
+static ESValue* sum_resume(Generator* generator, ESValue* sent);
+struct sum_frame : public AsyncFunction {
+    ESValue* local_n;
+    ESValue* local_i;
+    ESValue* local_total;
+
+    sum_frame() : AsyncFunction(sum_resume) {
+        local_n = NULL;
+        local_i = NULL;
+        local_total = NULL;
+    }
+
+    void visitReferences(Heap::ReferenceVisitor& visitor) {
+        AsyncFunction::visitReferences(visitor);
+        if (local_n != NULL) {
+            visitor.visit(&local_n);
+        }
+        if (local_i != NULL) {
+            visitor.visit(&local_i);
+        }
+        if (local_total != NULL) {
+            visitor.visit(&local_total);
+        }
+    }
+};
+
+static ESValue* sum_resume(Generator* generator, ESValue* sent) {
+    sum_frame* frame = static_cast<sum_frame*>(generator);
+    ESValue* local_n = frame->local_n;
+    ESValue* local_i;
+    ESValue* local_total;
+    switch (frame->getResumePoint()) {
+        case 1: goto label_resume_1;
+    }
+    local_total = new Number(0);
+    local_i = new Number(0);
+label_loop:
+    if (!Core::lessThan(local_i, local_n)) {
+        return frame->complete(local_total);
+    }
+    frame->store(frame->local_i, local_i);
+    frame->store(frame->local_total, local_total);
+    return frame->suspend(1, local_i);
+label_resume_1:
+    local_i = frame->local_i;
+    local_total = Core::plus(frame->local_total, sent);
+    local_i = Core::plus(local_i, new Number(1));
+    goto label_loop;
+}
+
+__attribute__((noinline)) static Timing awaits() {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    sum_frame* frame = new sum_frame();
+    frame->store(frame->local_n, new Number((double)steps));
+    Promise* promise = AsyncFunction::start(frame);
+    EventLoop::run();
+    bool ok = promise->getState() == Promise::fulfilled
+              && TypeOps::toNumber(promise->getResult())->getValue() == expectedSum();
+    Timing timing = {"await", nanosecondsSince(start), ok};
+    return timing;
+}
+
+int main(int argc, char* argv[]) {
+    globalObj = &globalObject;
+    if (argc > 1) {
+        steps = strtoul(argv[1], NULL, 10);
+    }
+
+    Timing timings[] = {resumed(), nexts(), called(), arrayIterator(), awaits()};
+
+    bool ok = true;
+    printf("%lu steps, suspended frame of %lu bytes\n", (unsigned long)steps, (unsigned long)sizeof(count_frame));
+    printf("%-16s%12s\n", "", "ns/step");
+    for (size_t i = 0; i < sizeof(timings) / sizeof(timings[0]); i++) {
+        printf("%-16s%12.1f\n", timings[i].name, timings[i].nanoseconds);
+        if (!timings[i].ok) {
+            fprintf(stderr, "%s: wrong result\n", timings[i].name);
+            ok = false;
+        }
+    }
+    return ok ? 0 : 1;
+}
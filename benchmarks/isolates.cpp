@@ -0,0 +1,124 @@
+//
+// Independent scripts on a pool of isolates: every script is a loop written the way generated code is, which keeps
+// a running total and the last object it built in globals of the same names, and allocates enough to run major
+// collections of its isolate's heap. Runs them one after the other in the calling thread and on pools of 1,
+// 2 and 4 threads, and fails when a script's total is not its own, which is what a global object or a heap shared
+// between scripts would show. Reports the scripts per second and the RSS once each pool is done.
+//
+// usage: isolates [scripts] [iterations]
+//
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "../runtime/core.hpp"
+#include "../runtime/isolate.hpp"
+
+static GlobalObject globalObject;
+
+static size_t scripts = 16;
+static size_t iterations = 50000;
+
+/**
+ * total = 0;
+ * for (i = 0; i < iterations; i++) { last = {value: i, name: "node " + i}; total = total + last.value; }
+ * total === iterations * (iterations - 1) / 2 && last.value === iterations - 1 ? 0 : 1
+ */
+static int script() {
+    ESValue* r0 = Core::assign(new Reference(new String("total")), new Number(0));
+    for (size_t i = 0; i < iterations; i++) {
+        ESValue* r1 = new ESObject();
+        Core::setElement(r1, new String("value"), new Number((double)i));
+        Core::setElement(r1, new String("name"), Core::plus(new String("node "), new Number((double)i)));
+        ESValue* r2 = Core::assign(new Reference(new String("last")), r1);
+        ESValue* r3 = Core::getElement(new Reference(new String("last")), new String("value"));
+        ESValue* r4 = Core::plus(new Reference(new String("total")), r3);
+        r0 = Core::assign(new Reference(new String("total")), r4);
+        (void)r2;
+    }
+    Number* total = dynamic_cast<Number*>(Core::getValue(new Reference(new String("total"))));
+    Number* last = dynamic_cast<Number*>(Core::getElement(new Reference(new String("last")), new String("value")));
+    (void)r0;
+    bool ok = total != NULL && total->getValue() == (double)iterations * (iterations - 1) / 2 && last != NULL
+              && last->getValue() == (double)(iterations - 1);
+    return ok ? 0 : 1;
+}
+
+static double residentMegabytes() {
+    long pages = 0;
+    FILE* statm = fopen("/proc/self/statm", "r");
+    if (statm != NULL) {
+        if (fscanf(statm, "%*ld %ld", &pages) != 1) {
+            pages = 0;
+        }
+        fclose(statm);
+    }
+    return pages * (double)sysconf(_SC_PAGESIZE) / (1024 * 1024);
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * Runs the scripts on a pool of threads, or one after the other in the calling thread when there are none
+ */
+static bool runScripts(size_t threads, double* seconds) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    size_t failed = 0;
+    if (threads == 0) {
+        for (size_t i = 0; i < scripts; i++) {
+            Isolate isolate;
+            failed += isolate.run(script) != 0;
+        }
+    } else {
+        IsolatePool pool(threads);
+        std::vector<std::future<int> > results;
+        for (size_t i = 0; i < scripts; i++) {
+            results.push_back(pool.submit(script));
+        }
+        for (size_t i = 0; i < results.size(); i++) {
+            failed += results[i].get() != 0;
+        }
+    }
+    *seconds = secondsSince(start);
+    if (failed > 0) {
+        fprintf(stderr, "%lu of %lu scripts did not see their own globals\n", (unsigned long)failed,
+                (unsigned long)scripts);
+    }
+    return failed == 0;
+}
+
+int main(int argc, char* argv[]) {
+    globalObj = &globalObject;
+    if (argc > 1) {
+        scripts = strtoul(argv[1], NULL, 10);
+    }
+    if (argc > 2) {
+        iterations = strtoul(argv[2], NULL, 10);
+    }
+
+    // the program's own global object is untouched by the isolates
+    Core::assign(new Reference(new String("total")), new Number(-1));
+
+    bool ok = true;
+    size_t pools[] = {0, 1, 2, 4};
+    printf("%lu scripts of %lu iterations, %ld processors\n", (unsigned long)scripts, (unsigned long)iterations,
+           sysconf(_SC_NPROCESSORS_ONLN));
+    printf("%-10s%12s%12s%12s\n", "threads", "seconds", "scripts/s", "RSS after");
+    for (size_t p = 0; p < sizeof(pools) / sizeof(pools[0]); p++) {
+        double seconds = 0;
+        ok = runScripts(pools[p], &seconds) && ok;
+        std::string threads = pools[p] == 0 ? "inline" : std::to_string(pools[p]);
+        printf("%-10s%12.3f%12.1f%10.1fMB\n", threads.c_str(), seconds, scripts / seconds, residentMegabytes());
+    }
+
+    Number* total = dynamic_cast<Number*>(Core::getValue(new Reference(new String("total"))));
+    if (total == NULL || total->getValue() != -1) {
+        fprintf(stderr, "the program's global object was written by a script\n");
+        ok = false;
+    }
+    return ok ? 0 : 1;
+}
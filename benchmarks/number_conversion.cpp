@@ -0,0 +1,140 @@
+//
+// Conversions per second of NumberConversion against the ostringstream and strtod paths it replaces, in both
+// directions, and a check of ToNumber applied to strings against the cases 7.1.3.1 spells out.
+//
+// usage: number_conversion [conversions]
+//
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../type/conversion.hpp"
+
+static size_t conversions = 2000000;
+static double sink = 0;
+
+static double ostreamToString(std::vector<double>& values, std::vector<std::string>& texts) {
+    size_t length = 0;
+    for (size_t i = 0; i < conversions; i++) {
+        std::ostringstream stream;
+        stream << values[i % values.size()];
+        length += stream.str().size();
+    }
+    return length;
+}
+
+static double numberToString(std::vector<double>& values, std::vector<std::string>& texts) {
+    size_t length = 0;
+    char buffer[NumberConversion::MAX_NUMBER_LENGTH];
+    for (size_t i = 0; i < conversions; i++) {
+        length += NumberConversion::toString(values[i % values.size()], buffer);
+    }
+    return length;
+}
+
+static double strtodToNumber(std::vector<double>& values, std::vector<std::string>& texts) {
+    double sum = 0;
+    for (size_t i = 0; i < conversions; i++) {
+        sum += strtod(texts[i % texts.size()].c_str(), NULL);
+    }
+    return sum;
+}
+
+static double stringToNumber(std::vector<double>& values, std::vector<std::string>& texts) {
+    double sum = 0;
+    for (size_t i = 0; i < conversions; i++) {
+        sum += NumberConversion::stringToNumber(texts[i % texts.size()]);
+    }
+    return sum;
+}
+
+typedef double (*Conversion)(std::vector<double>& values, std::vector<std::string>& texts);
+
+static double conversionsPerSecond(Conversion conversion, std::vector<double>& values,
+                                   std::vector<std::string>& texts) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    sink += conversion(values, texts);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return conversions / seconds;
+}
+
+static bool same(double a, double b) {
+    return (a != a && b != b) || (a == b && std::signbit(a) == std::signbit(b));
+}
+
+static bool checkStringToNumber() {
+    struct Case {
+        const char* text;
+        double expected;
+    };
+    Case cases[] = {
+        {"", 0}, {"   ", 0}, {"42", 42}, {" 12 ", 12}, {"\t\n-7.5\r\n", -7.5}, {"+.5", 0.5}, {"5.", 5},
+        {"1e3", 1000}, {"1E-3", 0.001}, {"-0", -0.0}, {"0x1F", 31}, {"0XfF", 255}, {"0o17", 15}, {"0b101", 5},
+        {"Infinity", INFINITY}, {"-Infinity", -INFINITY}, {"+Infinity", INFINITY}, {"1e400", INFINITY},
+        {"1e-400", 0}, {"0.1", 0.1}, {"9007199254740993", 9007199254740992.0},
+        {"0x20000000000001", 9007199254740992.0}, {"0x20000000000003", 9007199254740996.0},
+        {"\xC2\xA0" "3" "\xE2\x80\xA8", 3}, {"\xEF\xBB\xBF" "8", 8},
+        {"1_0", NAN}, {"0x", NAN}, {"-0x10", NAN}, {"0b2", NAN}, {"1e", NAN}, {".", NAN}, {"abc", NAN},
+        {"infinity", NAN}, {"1 2", NAN}, {"12px", NAN}, {"0x1.8", NAN},
+    };
+    bool ok = true;
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        double value = NumberConversion::stringToNumber(std::string(cases[i].text));
+        if (!same(value, cases[i].expected)) {
+            fprintf(stderr, "ToNumber(\"%s\") gives %.17g, expected %.17g\n", cases[i].text, value, cases[i].expected);
+            ok = false;
+        }
+    }
+
+    srand(7);
+    char buffer[NumberConversion::MAX_NUMBER_LENGTH];
+    for (int i = 0; i < 1000000; i++) {
+        unsigned long long bits = ((unsigned long long)rand() << 33) ^ ((unsigned long long)rand() << 11) ^ rand();
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        size_t length = NumberConversion::toString(value, buffer);
+        if (!same(NumberConversion::stringToNumber(buffer, buffer + length), value) && !(value == 0)) {
+            fprintf(stderr, "%s does not read back as %.17g\n", buffer, value);
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1) {
+        conversions = strtoul(argv[1], NULL, 10);
+    }
+
+    bool ok = checkStringToNumber();
+
+    std::vector<double> values;
+    std::vector<std::string> texts;
+    char buffer[NumberConversion::MAX_NUMBER_LENGTH];
+    for (int i = 0; i < 4096; i++) {
+        values.push_back(i);
+        values.push_back(i * 0.1);
+        values.push_back(1.0 / (i + 3));
+        values.push_back(i * 1e25);
+    }
+    for (size_t i = 0; i < values.size(); i++) {
+        NumberConversion::toString(values[i], buffer);
+        texts.push_back(buffer);
+    }
+
+    double ostream = conversionsPerSecond(ostreamToString, values, texts);
+    double toString = conversionsPerSecond(numberToString, values, texts);
+    double strtod = conversionsPerSecond(strtodToNumber, values, texts);
+    double toNumber = conversionsPerSecond(stringToNumber, values, texts);
+
+    printf("%lu conversions\n", (unsigned long)conversions);
+    printf("%-28s%14.0f /s\n", "ostringstream <<", ostream);
+    printf("%-28s%14.0f /s%9.2fx\n", "NumberConversion::toString", toString, toString / ostream);
+    printf("%-28s%14.0f /s\n", "strtod", strtod);
+    printf("%-28s%14.0f /s%9.2fx\n", "stringToNumber", toNumber, toNumber / strtod);
+    return ok && sink == sink ? 0 : 1;
+}
@@ -0,0 +1,154 @@
+//
+// Allocation of short lived values: a loop written the way generated code is, whose Numbers and Booleans die at
+// once apart from every 64th, which is stored into an object and an array. Run with the nursery and with every
+// value allocated old (ES_NURSERY_SIZE=0), each in a child so that their peak RSS is their own, with the pauses of
+// the minor collections. Checks that the stored values and the ones held by locals survive the collections.
+//
+// usage: nursery [iterations]
+//
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "../runtime/core.hpp"
+
+static ESObject globalObject;
+
+static size_t iterations = 5000000;
+
+static const size_t KEYS = 1000;
+static const size_t WINDOW = 16;
+
+struct Measurement {
+    bool ok;
+    double nanosecondsPerIteration;
+    Heap::Statistics statistics;
+};
+
+static double expectedValue(size_t i) {
+    return (double)i * (i + 1) / 2;
+}
+
+__attribute__((noinline)) static bool allocate(Heap::Statistics* statistics, double* seconds) {
+    ESObject* object = new ESObject();
+    ESArray* array = new ESArray();
+    array->setElement(KEYS - 1, new Undefined());
+    String* keys[KEYS];
+    for (size_t k = 0; k < KEYS; k++) {
+        keys[k] = new String("k" + std::to_string(k));
+    }
+    // recent values held only by locals, which pin their blocks
+    ESValue* window[WINDOW] = {};
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    ESValue* r0 = new Number(0);
+    for (size_t i = 1; i <= iterations; i++) {
+        ESValue* r1 = new Number((double)i);
+        ESValue* r2 = Core::plus<NumberTag, NumberTag>(r0, r1);
+        ESValue* r3 = new Boolean(static_cast<Number*>(r2)->getValue() > 0);
+        if (!static_cast<Boolean*>(r3)->getValue()) {
+            return false;
+        }
+        if (i % 64 == 0) {
+            object->set(keys[(i / 64) % KEYS], r2);
+            array->setElement((i / 64) % KEYS, r2);
+        }
+        window[i % WINDOW] = r2;
+        r0 = r2;
+    }
+    *seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    bool ok = static_cast<Number*>(r0)->getValue() == expectedValue(iterations);
+    for (size_t j = 0; j < WINDOW && iterations >= WINDOW; j++) {
+        size_t i = iterations - j;
+        ok = ok && static_cast<Number*>(window[i % WINDOW])->getValue() == expectedValue(i);
+    }
+    // the last store to each key
+    size_t stores = iterations / 64;
+    for (size_t m = stores > KEYS ? stores - KEYS + 1 : 1; m <= stores; m++) {
+        double stored = static_cast<Number*>(object->get(keys[m % KEYS]))->getValue();
+        double element = static_cast<Number*>(array->getElement(m % KEYS))->getValue();
+        if (stored != expectedValue(m * 64) || element != expectedValue(m * 64)) {
+            fprintf(stderr, "value %lu was %g and %g after the collections, not %g\n", (unsigned long)(m * 64),
+                    stored, element, expectedValue(m * 64));
+            ok = false;
+        }
+    }
+    *statistics = Heap::getStatistics();
+    return ok;
+}
+
+/**
+ * Runs the loop in a child with ES_NURSERY_SIZE set to nurserySize, or unset when it is NULL
+ */
+static bool measure(const char* nurserySize, Measurement* measurement, long* peakKilobytes) {
+    int channel[2];
+    if (pipe(channel) != 0) {
+        return false;
+    }
+    pid_t child = fork();
+    if (child == 0) {
+        close(channel[0]);
+        if (nurserySize != NULL) {
+            setenv("ES_NURSERY_SIZE", nurserySize, 1);
+        }
+        Measurement result;
+        double seconds = 0;
+        result.ok = allocate(&result.statistics, &seconds);
+        result.nanosecondsPerIteration = seconds * 1e9 / iterations;
+        if (write(channel[1], &result, sizeof(result)) != sizeof(result)) {
+            _exit(1);
+        }
+        _exit(0);
+    }
+    close(channel[1]);
+    bool ok = read(channel[0], measurement, sizeof(*measurement)) == sizeof(*measurement);
+    close(channel[0]);
+    int status = -1;
+    struct rusage usage;
+    wait4(child, &status, 0, &usage);
+    *peakKilobytes = usage.ru_maxrss;
+    return ok && WIFEXITED(status) && WEXITSTATUS(status) == 0 && measurement->ok;
+}
+
+int main(int argc, char* argv[]) {
+    globalObj = &globalObject;
+    if (argc > 1) {
+        iterations = strtoul(argv[1], NULL, 10);
+    }
+
+    const char* modes[] = {"nursery", "old"};
+    const char* sizes[] = {NULL, "0"};
+    bool ok = true;
+    Measurement nursery = {};
+    printf("%lu iterations\n", (unsigned long)iterations);
+    printf("%-10s%12s%12s%14s%12s%12s%12s\n", "heap", "per loop", "peak RSS", "collections", "promoted", "p99 pause",
+           "max pause");
+    for (int m = 0; m < 2; m++) {
+        Measurement measurement = {};
+        long peakKilobytes = 0;
+        if (!measure(sizes[m], &measurement, &peakKilobytes)) {
+            fprintf(stderr, "%s: the stored values did not survive\n", modes[m]);
+            ok = false;
+            continue;
+        }
+        const Heap::Statistics& statistics = measurement.statistics;
+        printf("%-10s%10.1fns%10.1fMB%14lu%10.2fMB%10.0fus%10.3fms\n", modes[m], measurement.nanosecondsPerIteration,
+               peakKilobytes / 1024.0, (unsigned long)statistics.collections, statistics.promotedBytes / 1e6,
+               Heap::pausePercentile(statistics, 0.99) * 1e6, statistics.maxPauseSeconds * 1e3);
+        if (m == 0) {
+            nursery = measurement;
+        }
+    }
+
+    printf("\nminor collection pauses\n");
+    for (int i = 0; i < Heap::PAUSE_BUCKETS; i++) {
+        if (nursery.statistics.pauseHistogram[i] > 0) {
+            printf("< %6.0f us %10lu\n", ldexp(1.0, i), (unsigned long)nursery.statistics.pauseHistogram[i]);
+        }
+    }
+    return ok ? 0 : 1;
+}
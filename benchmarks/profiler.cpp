@@ -0,0 +1,132 @@
+//
+// Cost of the profiler in a program that spends its time in small functions: a recursive Fibonacci over Numbers,
+// written the way generated code is, run without frames (compiled without --profile), with frames and no timer,
+// and with frames while sampling, after the cost of a frame on an empty call. Checks that the samples are written
+// as collapsed stacks of the functions.
+//
+// usage: profiler [n]
+//
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include "../runtime/core.hpp"
+#include "../runtime/profiler.hpp"
+
+static ESObject globalObject;
+
+static int n = 27;
+
+template <bool profiled>
+__attribute__((noinline)) static ESValue* fibonacci(ESValue* x) {
+    int profilerDepth = profiled ? Profiler::enter("fibonacci") : 0;
+    ESValue* result = x;
+    if (TypeOps::toNumber(x)->getValue() >= 2) {
+        ESValue* a = fibonacci<profiled>(Core::subtract(x, new Number(1)));
+        ESValue* b = fibonacci<profiled>(Core::subtract(x, new Number(2)));
+        result = Core::plus(a, b);
+    }
+    if (profiled) {
+        Profiler::leave(profilerDepth);
+    }
+    return result;
+}
+
+/**
+ * Nanoseconds an enter and leave pair adds to a call, through a function that does nothing else
+ */
+template <bool profiled>
+__attribute__((noinline)) static int empty(int x) {
+    int profilerDepth = profiled ? Profiler::enter("empty") : 0;
+    if (profiled) {
+        Profiler::leave(profilerDepth);
+    }
+    return x + 1;
+}
+
+template <bool profiled>
+static double nanosecondsPerCall() {
+    const int calls = 100000000;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    int x = 0;
+    for (int i = 0; i < calls; i++) {
+        x = empty<profiled>(x);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return x == calls ? seconds * 1e9 / calls : 0;
+}
+
+template <bool profiled>
+static double secondsToRun(double* value) {
+    double best = 0;
+    for (int run = 0; run < 7; run++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        int profilerDepth = profiled ? Profiler::enter("(program)") : 0;
+        *value = TypeOps::toNumber(fibonacci<profiled>(new Number(n)))->getValue();
+        if (profiled) {
+            Profiler::leave(profilerDepth);
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        best = run == 0 || seconds < best ? seconds : best;
+    }
+    return best;
+}
+
+int main(int argc, char* argv[]) {
+    globalObj = &globalObject;
+    if (argc > 1) {
+        n = atoi(argv[1]);
+    }
+
+    double plain;
+    double framed;
+    double sampled;
+    double emptyCall = nanosecondsPerCall<false>();
+    double framedCall = nanosecondsPerCall<true>();
+    double base = secondsToRun<false>(&plain);
+    double frames = secondsToRun<true>(&framed);
+    Profiler::start();
+    double sampling = secondsToRun<true>(&sampled);
+
+    char path[] = "/tmp/profilerXXXXXX";
+    int descriptor = mkstemp(path);
+    bool ok = descriptor >= 0 && Profiler::stop(path);
+    size_t stacks = 0;
+    size_t samples = 0;
+    FILE* file = ok ? fopen(path, "r") : NULL;
+    char line[4096];
+    while (file != NULL && fgets(line, sizeof(line), file) != NULL) {
+        char* count = strrchr(line, ' ');
+        if (count == NULL || strncmp(line, "(program);fibonacci", strlen("(program);fibonacci")) != 0) {
+            continue;
+        }
+        stacks++;
+        samples += strtoul(count + 1, NULL, 10);
+    }
+    if (file != NULL) {
+        fclose(file);
+    }
+    if (descriptor >= 0) {
+        close(descriptor);
+        unlink(path);
+    }
+
+    printf("empty call %.2fns, with a frame %.2fns\n", emptyCall, framedCall);
+    printf("fibonacci(%d)%18s%10s\n", n, "seconds", "overhead");
+    printf("%-24s%10.3fs\n", "no frames", base);
+    printf("%-24s%10.3fs%9.1f%%\n", "frames", frames, (frames / base - 1) * 100);
+    printf("%-24s%10.3fs%9.1f%%\n", "frames and sampling", sampling, (sampling / base - 1) * 100);
+    printf("%lu samples, %lu in %lu fibonacci stacks, %lu dropped\n", (unsigned long)Profiler::getSampleCount(),
+           (unsigned long)samples, (unsigned long)stacks, (unsigned long)Profiler::getDroppedCount());
+
+    if (plain != framed || plain != sampled) {
+        fprintf(stderr, "the profiled runs computed %g and %g instead of %g\n", framed, sampled, plain);
+        ok = false;
+    }
+    if (samples == 0) {
+        fprintf(stderr, "no samples of fibonacci were written\n");
+        ok = false;
+    }
+    return ok ? 0 : 1;
+}
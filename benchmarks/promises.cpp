@@ -0,0 +1,190 @@
+//
+// Throughput of the event loop, with callbacks written the way generated code compiles x => x + 1: a chain of
+// promises each resolved from the one before, the same chain with every handler returning a promise for the loop to
+// adopt, as many independent promises resolved at once, queueMicrotask callbacks, timers that are all due at once,
+// and a byte passed back and forth over a pipe that the loop watches with epoll. Reports the nanoseconds per step
+// and the capacity of the loop's ring of jobs once each is done, and checks every result.
+//
+// usage: promises [steps]
+//
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include "../runtime/core.hpp"
+#include "../runtime/eventloop.hpp"
+#include "../runtime/global.hpp"
+#include "../runtime/promise.hpp"
+
+static GlobalObject globalObject;
+
+static size_t steps = 200000;
+
+// what the callbacks have seen, checked after each run
+static double total = 0;
+static size_t calls = 0;
+
+struct Timing {
+    const char* name;
+    double nanoseconds;
+    size_t jobCapacity;
+    bool ok;
+};
+
+/**
+ * x => x + 1
+ */
+static ESValue* increment(ESValue** arguments, int argumentCount) {
+    ESValue* x = argumentCount > 0 ? arguments[0] : new Undefined();
+    return Core::plus(x, new Number(1));
+}
+
+/**
+ * x => Promise.resolve(x + 1)
+ */
+static ESValue* incrementLater(ESValue** arguments, int argumentCount) {
+    ESValue* resolution = increment(arguments, argumentCount);
+    return Promise::callConstructorMethod("resolve", &resolution, 1);
+}
+
+/**
+ * x => total = total + x
+ */
+static ESValue* add(ESValue** arguments, int argumentCount) {
+    total += argumentCount > 0 ? TypeOps::toNumber(arguments[0])->getValue() : 0;
+    calls++;
+    return new Undefined();
+}
+
+static double nanosecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / steps;
+}
+
+static Timing finish(const char* name, std::chrono::steady_clock::time_point start, bool ok) {
+    Timing timing = {name, nanosecondsSince(start), EventLoop::current()->getJobCapacity(), ok};
+    total = 0;
+    calls = 0;
+    return timing;
+}
+
+/**
+ * p = Promise.resolve(0); p.then(x => x + 1) steps times; then(x => total = total + x)
+ */
+__attribute__((noinline)) static Timing chain(Function::Code code, const char* name) {
+    Function* step = new Function(code, "step", 1);
+    Function* sum = new Function(add, "add", 1);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    ESValue* zero = new Number(0);
+    Promise* promise = static_cast<Promise*>(Promise::callConstructorMethod("resolve", &zero, 1));
+    for (size_t i = 0; i < steps; i++) {
+        promise = promise->then(step, NULL);
+    }
+    promise->then(sum, NULL);
+    EventLoop::run();
+    return finish(name, start, calls == 1 && total == (double)steps);
+}
+
+/**
+ * Promise.resolve(i).then(x => total = total + x) for every i
+ */
+__attribute__((noinline)) static Timing fan() {
+    Function* sum = new Function(add, "add", 1);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < steps; i++) {
+        ESValue* value = new Number((double)i);
+        static_cast<Promise*>(Promise::callConstructorMethod("resolve", &value, 1))->then(sum, NULL);
+    }
+    EventLoop::run();
+    return finish("fan out", start, calls == steps && total == (double)steps * (steps - 1) / 2);
+}
+
+/**
+ * queueMicrotask(() => total = total + 1) from each callback, steps times
+ */
+static ESValue* requeue(ESValue** arguments, int argumentCount) {
+    add(NULL, 0);
+    if (calls < steps) {
+        ESValue* self = Core::getValue(new Reference(new String("requeue")));
+        EventLoop::queueMicrotask(&self, 1);
+    }
+    return new Undefined();
+}
+
+__attribute__((noinline)) static Timing microtasks() {
+    ESValue* callback = Core::assign(new Reference(new String("requeue")), new Function(requeue, "requeue", 0));
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    EventLoop::queueMicrotask(&callback, 1);
+    EventLoop::run();
+    return finish("queueMicrotask", start, calls == steps);
+}
+
+/**
+ * setTimeout(x => total = total + x, 0, i) for every i
+ */
+__attribute__((noinline)) static Timing timers() {
+    Function* sum = new Function(add, "add", 1);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < steps; i++) {
+        ESValue* arguments[] = {sum, new Number(0), new Number((double)i)};
+        EventLoop::setTimeout(arguments, 3);
+    }
+    EventLoop::run();
+    return finish("setTimeout 0", start, calls == steps && total == (double)steps * (steps - 1) / 2);
+}
+
+/**
+ * Both ends of a pipe that the loop watches, each read answered with a write until steps bytes have gone round
+ */
+static int pipeEnds[2];
+
+static void onReadable(int fd, uint32_t events, void* data) {
+    char byte;
+    if (read(fd, &byte, 1) != 1) {
+        EventLoop::current()->unwatch(fd);
+        return;
+    }
+    calls++;
+    if (calls == steps || write(pipeEnds[1], &byte, 1) != 1) {
+        EventLoop::current()->unwatch(fd);
+    }
+}
+
+__attribute__((noinline)) static Timing pipeRoundTrips() {
+    if (pipe(pipeEnds) != 0) {
+        Timing failed = {"epoll pipe", 0, 0, false};
+        return failed;
+    }
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    char byte = 'x';
+    bool ok = EventLoop::current()->watch(pipeEnds[0], EPOLLIN, onReadable, NULL) && write(pipeEnds[1], &byte, 1) == 1;
+    if (ok) {
+        EventLoop::run();
+    }
+    close(pipeEnds[0]);
+    close(pipeEnds[1]);
+    return finish("epoll pipe", start, ok && calls == steps);
+}
+
+int main(int argc, char* argv[]) {
+    globalObj = &globalObject;
+    if (argc > 1) {
+        steps = strtoul(argv[1], NULL, 10);
+    }
+
+    Timing timings[] = {chain(increment, "then chain"), chain(incrementLater, "adopting chain"), fan(), microtasks(),
+                        timers(), pipeRoundTrips()};
+
+    bool ok = true;
+    printf("%lu steps\n", (unsigned long)steps);
+    printf("%-16s%12s%12s%12s\n", "", "ns/step", "steps/s", "job ring");
+    for (size_t i = 0; i < sizeof(timings) / sizeof(timings[0]); i++) {
+        printf("%-16s%12.1f%12.0f%12lu\n", timings[i].name, timings[i].nanoseconds, 1e9 / timings[i].nanoseconds,
+               (unsigned long)timings[i].jobCapacity);
+        if (!timings[i].ok) {
+            fprintf(stderr, "%s: wrong result\n", timings[i].name);
+            ok = false;
+        }
+    }
+    return ok ? 0 : 1;
+}
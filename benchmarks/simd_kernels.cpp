@@ -0,0 +1,190 @@
+//
+// Times every bulk kernel in runtime/simd.hpp at each instruction set level the CPU supports and checks the
+// vector results against the scalar path.
+//
+// usage: simd_kernels [elements] [iterations]
+//
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "../runtime/simd.hpp"
+
+static size_t length = 1 << 20;
+static int iterations = 200;
+static double sink = 0;
+
+typedef double (*Kernel)(std::vector<double>& doubles, std::vector<int>& ints, std::vector<double>& out);
+
+static double fillDoubles(std::vector<double>& doubles, std::vector<int>& ints, std::vector<double>& out) {
+    Simd::fill(out.data(), out.size(), 2.5);
+    return out[out.size() - 1];
+}
+
+static double fillInts(std::vector<double>& doubles, std::vector<int>& ints, std::vector<double>& out) {
+    Simd::fill(ints.data(), ints.size() / 2, 7);
+    return ints[0];
+}
+
+static double copyDoubles(std::vector<double>& doubles, std::vector<int>& ints, std::vector<double>& out) {
+    Simd::copy(out.data(), doubles.data(), doubles.size() * sizeof(double));
+    return out[out.size() - 1];
+}
+
+static double indexOfDoubles(std::vector<double>& doubles, std::vector<int>& ints, std::vector<double>& out) {
+    return Simd::indexOf(doubles.data(), doubles.size(), -1.0);
+}
+
+static double indexOfInts(std::vector<double>& doubles, std::vector<int>& ints, std::vector<double>& out) {
+    return Simd::indexOf(ints.data() + ints.size() / 2, ints.size() / 2, -1);
+}
+
+static double includesNaN(std::vector<double>& doubles, std::vector<int>& ints, std::vector<double>& out) {
+    return Simd::indexOfNaN(doubles.data(), doubles.size());
+}
+
+static double sumInts(std::vector<double>& doubles, std::vector<int>& ints, std::vector<double>& out) {
+    return Simd::sum(ints.data() + ints.size() / 2, ints.size() / 2);
+}
+
+static double minDoubles(std::vector<double>& doubles, std::vector<int>& ints, std::vector<double>& out) {
+    return Simd::min(doubles.data(), doubles.size());
+}
+
+static double maxDoubles(std::vector<double>& doubles, std::vector<int>& ints, std::vector<double>& out) {
+    return Simd::max(doubles.data(), doubles.size());
+}
+
+static double minInts(std::vector<double>& doubles, std::vector<int>& ints, std::vector<double>& out) {
+    return Simd::min(ints.data() + ints.size() / 2, ints.size() / 2);
+}
+
+static double mapDoubles(std::vector<double>& doubles, std::vector<int>& ints, std::vector<double>& out) {
+    Simd::map(doubles.data(), out.data(), doubles.size(), mapMultiply, 2, false);
+    return out[12345 % out.size()];
+}
+
+static double mapInts(std::vector<double>& doubles, std::vector<int>& ints, std::vector<double>& out) {
+    Simd::map(ints.data() + ints.size() / 2, out.data(), ints.size() / 2, mapSubtract, 1, true);
+    return out[12345 % (ints.size() / 2)];
+}
+
+struct Benchmark {
+    const char* name;
+    Kernel kernel;
+};
+
+static const Benchmark benchmarks[] = {
+    {"fill f64", fillDoubles},
+    {"fill i32", fillInts},
+    {"set f64", copyDoubles},
+    {"indexOf f64", indexOfDoubles},
+    {"indexOf i32", indexOfInts},
+    {"includes NaN", includesNaN},
+    {"reduce sum i32", sumInts},
+    {"reduce min f64", minDoubles},
+    {"reduce max f64", maxDoubles},
+    {"reduce min i32", minInts},
+    {"map x*2 f64", mapDoubles},
+    {"map 1-x i32", mapInts},
+};
+
+static bool same(double a, double b) {
+    return (a != a && b != b) || (a == b && std::signbit(a) == std::signbit(b));
+}
+
+/**
+ * The edge cases the vector paths handle separately: NaN anywhere, -0 against +0, lengths that leave a tail
+ */
+static bool checkEdgeCases() {
+    bool ok = true;
+    for (size_t n = 1; n < 40; n++) {
+        std::vector<double> values(n);
+        for (size_t i = 0; i < n; i++) {
+            values[i] = (double)((i * 7) % 11) - 5;
+        }
+        for (size_t special = 0; special < n; special++) {
+            std::vector<double> zeros(n, 0.0);
+            zeros[special] = -0.0;
+            std::vector<double> nans(values);
+            nans[special] = NAN;
+            std::vector<double>* inputs[] = {&values, &zeros, &nans};
+            for (int k = 0; k < 3; k++) {
+                std::vector<double>& input = *inputs[k];
+                Simd::setLevel(simdScalar);
+                double min = Simd::min(input.data(), n), max = Simd::max(input.data(), n);
+                ptrdiff_t nan = Simd::indexOfNaN(input.data(), n), index = Simd::indexOf(input.data(), n, 3.0);
+                for (int level = simdSse2; level <= Simd::detectLevel(); level++) {
+                    Simd::setLevel((SimdLevel)level);
+                    if (!same(min, Simd::min(input.data(), n)) || !same(max, Simd::max(input.data(), n))
+                        || nan != Simd::indexOfNaN(input.data(), n) || index != Simd::indexOf(input.data(), n, 3.0)) {
+                        fprintf(stderr, "mismatch at %s, length %lu\n", Simd::getLevelName((SimdLevel)level),
+                                (unsigned long)n);
+                        ok = false;
+                    }
+                }
+            }
+        }
+    }
+    Simd::setLevel(Simd::detectLevel());
+    return ok;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1) {
+        length = strtoul(argv[1], NULL, 10);
+    }
+    if (argc > 2) {
+        iterations = atoi(argv[2]);
+    }
+
+    std::vector<double> doubles(length);
+    std::vector<int> ints(length * 2);
+    std::vector<double> out(length);
+    for (size_t i = 0; i < length; i++) {
+        doubles[i] = (double)((i * 2654435761u) % 1000003) / 7.0;
+        ints[length + i] = (int)((i * 2654435761u) % 2000003) - 1000001;
+    }
+
+    printf("%lu elements, %d iterations, detected %s\n", (unsigned long)length, iterations,
+           Simd::getLevelName(Simd::detectLevel()));
+    printf("%-16s", "kernel");
+    for (int level = simdScalar; level <= Simd::detectLevel(); level++) {
+        printf("%12s", Simd::getLevelName((SimdLevel)level));
+    }
+    printf("%12s\n", "speedup");
+
+    bool ok = checkEdgeCases();
+    for (size_t b = 0; b < sizeof(benchmarks) / sizeof(benchmarks[0]); b++) {
+        printf("%-16s", benchmarks[b].name);
+        double scalarTime = 0, bestTime = 0, expected = 0;
+        for (int level = simdScalar; level <= Simd::detectLevel(); level++) {
+            Simd::setLevel((SimdLevel)level);
+            double result = benchmarks[b].kernel(doubles, ints, out);
+            if (level == simdScalar) {
+                expected = result;
+            } else if (!same(result, expected)) {
+                fprintf(stderr, "%s: %s gives %g, scalar gives %g\n", benchmarks[b].name,
+                        Simd::getLevelName((SimdLevel)level), result, expected);
+                ok = false;
+            }
+
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            for (int i = 0; i < iterations; i++) {
+                sink += benchmarks[b].kernel(doubles, ints, out);
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            double nanoseconds = seconds * 1e9 / iterations / length;
+            if (level == simdScalar) {
+                scalarTime = nanoseconds;
+            }
+            bestTime = nanoseconds;
+            printf("%10.3fns", nanoseconds);
+        }
+        printf("%11.2fx\n", scalarTime / bestTime);
+    }
+    Simd::setLevel(Simd::detectLevel());
+    printf("(ns per element)\n");
+    return ok && sink == sink ? 0 : 1;
+}
@@ -0,0 +1,110 @@
+//
+// Startup of compiled programs: the wall time to run each executable against the first one (an empty C program),
+// then the global object inside a program, which is cheap to construct and only pays for a built-in the first time
+// it is read. Checks that every built-in materialises once and is the same value on later reads.
+//
+// usage: startup [runs] [executable...]
+//
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+#include "../runtime/global.hpp"
+
+static size_t runs = 1000;
+
+/**
+ * Mean microseconds to fork, exec and wait for executable, with its output sent to /dev/null
+ */
+static double microsecondsPerRun(const char* executable, bool* ok) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < runs; i++) {
+        pid_t child = fork();
+        if (child == 0) {
+            int null = open("/dev/null", O_WRONLY);
+            dup2(null, STDOUT_FILENO);
+            execl(executable, executable, (char*)NULL);
+            _exit(127);
+        }
+        int status = -1;
+        waitpid(child, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            fprintf(stderr, "%s exited with %d\n", executable, status);
+            *ok = false;
+            return 0;
+        }
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() * 1e6 / runs;
+}
+
+static double nanosecondsSince(std::chrono::steady_clock::time_point start, size_t count) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() * 1e9 / count;
+}
+
+static bool benchmarkGlobalObject() {
+    const size_t objects = 20000;
+    bool ok = true;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < objects; i++) {
+        GlobalObject global;
+        ok = ok && !global.hasOwnProperty(new String("Math"));
+    }
+    printf("%-16s%10.1fns\n", "construct", nanosecondsSince(start, objects));
+
+    size_t count;
+    const GlobalObject::BuiltIn* builtIns = GlobalObject::getBuiltIns(&count);
+    printf("%-16s%12s%12s\n", "built-in", "first read", "later read");
+    for (size_t b = 0; b < count; b++) {
+        String* name = new String(builtIns[b].name);
+        std::vector<GlobalObject> globals(objects);
+        std::vector<ESValue*> first(objects);
+
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < objects; i++) {
+            first[i] = globals[i].get(name);
+        }
+        double materialise = nanosecondsSince(start, objects);
+
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < objects; i++) {
+            if (globals[i].get(name) != first[i]) {
+                ok = false;
+            }
+        }
+        double cached = nanosecondsSince(start, objects);
+
+        if (first[0] == NULL || first[0] == first[1] || GlobalObject::findBuiltIn(builtIns[b].name) != &builtIns[b]) {
+            fprintf(stderr, "%s does not materialise once per global object\n", builtIns[b].name);
+            ok = false;
+        }
+        printf("%-16s%10.1fns%10.1fns\n", builtIns[b].name, materialise, cached);
+    }
+    return ok;
+}
+
+int main(int argc, char* argv[]) {
+    int first = 1;
+    if (argc > 1 && atol(argv[1]) > 0) {
+        runs = strtoul(argv[1], NULL, 10);
+        first = 2;
+    }
+
+    bool ok = true;
+    if (first < argc) {
+        printf("%lu runs\n", (unsigned long)runs);
+        printf("%-40s%12s%10s\n", "executable", "startup", "relative");
+        double baseline = 0;
+        for (int i = first; i < argc; i++) {
+            double microseconds = microsecondsPerRun(argv[i], &ok);
+            baseline = i == first ? microseconds : baseline;
+            printf("%-40s%10.0fus%9.2fx\n", argv[i], microseconds, microseconds / baseline);
+        }
+    }
+
+    ok = benchmarkGlobalObject() && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,112 @@
+//
+// MB/s of the lexer over one template literal of 1 KB to 10 MB of HTML, against appending one character at a time
+// through strlen and realloc the way the lexer used to, which is quadratic and only run up to 256 KB. Checks that
+// the token is the C string literal of the decoded template.
+//
+// usage: template_scan [max bytes]
+//
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+#include "../y.tab.h"
+#include "../ast/ast.hpp"
+#include "../grammar.tab.h"
+#include "../lex.yy.h"
+
+extern FILE* yyin;
+
+static size_t maxBytes = 10 << 20;
+
+/**
+ * The lexer as it was: the accumulated value measured with strlen and reallocated for every character
+ */
+static char* characterAtATime(const std::string& value) {
+    char* buffer = (char*)calloc(1, 1);
+    char character[2] = {0, 0};
+    for (size_t i = 0; i < value.size(); i++) {
+        character[0] = value[i];
+        size_t length = strlen(buffer) + 2;
+        buffer = (char*)realloc(buffer, length);
+        strcat(buffer, character);
+    }
+    return buffer;
+}
+
+/**
+ * A template of HTML rows with tabs, quotes and escapes, and the C string literal the lexer should make of it
+ */
+static void generateTemplate(size_t bytes, std::string& source, std::string& expected) {
+    source = "x = `";
+    expected = "\"";
+    char row[160];
+    for (size_t i = 0; source.size() < bytes; i++) {
+        snprintf(row, sizeof(row), "\t<tr class=\"row\"><td>%lu</td><td>caf\\u00e9 \\`q\\` \\x41</td></tr>\n",
+                 (unsigned long)i);
+        source += row;
+        snprintf(row, sizeof(row), "\\t<tr class=\\\"row\\\"><td>%lu</td><td>caf\xc3\xa9 `q` A</td></tr>\\n",
+                 (unsigned long)i);
+        expected += row;
+    }
+    source += "`;\n";
+    expected += "\"";
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1) {
+        maxBytes = strtoul(argv[1], NULL, 10);
+    }
+
+    char path[] = "/tmp/templateXXXXXX";
+    int descriptor = mkstemp(path);
+    if (descriptor < 0) {
+        perror("mkstemp");
+        return 1;
+    }
+    close(descriptor);
+
+    bool ok = true;
+    printf("%12s%14s%12s%16s\n", "bytes", "lexer", "MB/s", "char at a time");
+    for (size_t bytes = 1024; bytes <= maxBytes; bytes *= 10) {
+        std::string source;
+        std::string expected;
+        generateTemplate(bytes, source, expected);
+        FILE* file = fopen(path, "w");
+        fwrite(source.data(), 1, source.size(), file);
+        fclose(file);
+
+        yyin = fopen(path, "r");
+        yyrestart(yyin);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        int token;
+        std::string value;
+        while ((token = yylex()) != 0) {
+            if (token == VALUE_STRING) {
+                value = yylval.sval;
+            }
+        }
+        double seconds = secondsSince(start);
+        fclose(yyin);
+        if (value != expected) {
+            fprintf(stderr, "%lu bytes: the template was not scanned as its C string literal\n",
+                    (unsigned long)bytes);
+            ok = false;
+        }
+
+        char old[32] = "-";
+        if (bytes <= 256 * 1024) {
+            start = std::chrono::steady_clock::now();
+            free(characterAtATime(expected));
+            snprintf(old, sizeof(old), "%.4fs", secondsSince(start));
+        }
+        printf("%12lu%13.4fs%12.1f%16s\n", (unsigned long)source.size(), seconds, source.size() / 1e6 / seconds, old);
+    }
+    unlink(path);
+    return ok ? 0 : 1;
+}
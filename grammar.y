@@ -7,6 +7,9 @@
 
 
 int yylex();
+// yyparse reads its tokens through lexToken, which lets the compiler time the lexer apart from the parser
+int lexToken();
+#define yylex lexToken
 
 ScriptBody *root;
 int global_var;
@@ -17,6 +20,19 @@ unsigned int getNewRegister();
 
 //Initialise static member registerIndex of Node
 int Node::registerIndex = 0;
+bool Node::profileFunctions = false;
+const char* Node::entryPoint = NULL;
+std::set<std::string> Node::localBindings;
+Node::ClassContext Node::currentClass;
+std::set<std::string> Node::classMethods;
+std::vector<LexicalScope*> Node::lexicalScopes;
+size_t Node::enclosingScopes = 0;
+bool Node::lexicalCaptured = false;
+std::vector<LexicalScope*> Node::environments;
+size_t Node::closureEnvironments = 0;
+bool Node::inFunction = false;
+bool Node::compileFailed = false;
+Node::LexicalStatistics Node::lexicalStatistics;
 
 using namespace std;
 
@@ -60,6 +76,7 @@ using namespace std;
 %token YIELD
 %token ENUM
 %token AWAIT
+%token ASYNC
 %token IMPLEMENTS
 %token INTERFACE
 %token PACKAGE
@@ -158,12 +175,15 @@ using namespace std;
 %nonassoc ASSIGNMENT
 
 %type <scriptBody> ScriptBody
-%type <statementList> StatementList FunctionBody FunctionStatementList CaseClauses
-%type <expressionList> PropertyDefinitionList ElementList ArgumentList FormalParameterList FormalsList FormalParameters
+%type <statementList> StatementList FunctionBody FunctionStatementList CaseClauses GeneratorBody
+%type <expressionList> PropertyDefinitionList ElementList ArgumentList Arguments FormalParameterList FormalsList FormalParameters
+  ArrowParameters ClassTail ClassBody ClassElementList StrictFormalParameters BindingPropertyList BindingElementList
+  BindingElisionElement VariableDeclarationList BindingList
 %type <statement> Statement StatementListItem ExpressionStatement Block Catch Finally TryStatement ThrowStatement
   ReturnStatement BreakStatement IfStatement IterationStatement Declaration BlockStatement VariableStatement
   EmptyStatement BreakableStatement ContinueStatement WithStatement LabelledStatement DebuggerStatement
   HoistableDeclaration ClassDeclaration SwitchStatement FunctionDeclaration LabelledItem  CaseBlock CaseClause DefaultClause
+  GeneratorDeclaration AsyncFunctionDeclaration LexicalDeclaration
 %type <expression> Expression DecimalIntegerLiteral DecimalLiteral NumericLiteral
   Literal PrimaryExpression MemberExpression NewExpression LeftHandSideExpression
   PostfixExpression UnaryExpression  MultiplicativeExpression AdditiveExpression
@@ -174,7 +194,10 @@ using namespace std;
   ObjectBindingPattern ArrayBindingPattern YieldExpression ArrowFunction CallExpression NullLiteral BooleanLiteral
   ArrayLiteral ClassExpression GeneratorExpression MethodDefinition CoverInitializedName
   CoverParenthesizedExpressionAndArrowParameterList FunctionExpression SuperCall BindingElement FormalParameter
-  SingleNameBinding 
+  SingleNameBinding ConciseBody ClassElement Initialiser BindingProperty BindingRestElement VariableDeclaration
+  LexicalBinding
+%type <ival> Elision
+%type <bval> LetOrConst
 %type <sval> Identifier IdentifierName
 %type <cval> MultiplicativeOperator AssignmentOperator
 %%
@@ -205,16 +228,18 @@ ScriptBody:
 
 
 ClassDeclaration:
-    CLASS BindingIdentifier ClassTail
-    | CLASS ClassTail
+    CLASS BindingIdentifier ClassTail       { $$ = new ClassDeclaration($2, $3); }
+    | CLASS ClassTail                       { yyerror("a class declaration needs a name"); YYABORT; }
     ;
 
 ClassExpression:
-    CLASS BindingIdentifier ClassTail
+    CLASS BindingIdentifier ClassTail       { yyerror("class expressions are not supported"); YYABORT; }
      ;
 
 ClassTail:
-    ClassHeritage LEFT_BRACE ClassBody RIGHT_BRACE
+    LEFT_BRACE ClassBody RIGHT_BRACE                    { $$ = $2; }
+    | LEFT_BRACE RIGHT_BRACE                            { $$ = new vector<Expression*>; }
+    | ClassHeritage LEFT_BRACE ClassBody RIGHT_BRACE    { yyerror("extends is not supported"); YYABORT; }
     ;
 
 ClassHeritage:
@@ -222,22 +247,29 @@ ClassHeritage:
     ;
 
 ClassBody:
-    ClassElementList
+    ClassElementList                        { $$ = $1; }
     ;
 
 ClassElementList:
-    ClassElement
-    | ClassElementList ClassElement
+    ClassElement                            { $$ = new vector<Expression*>; if ($1 != NULL) $$->push_back($1); }
+    | ClassElementList ClassElement         { $$ = $1; if ($2 != NULL) $$->push_back($2); }
     ;
 
 ClassElement:
     MethodDefinition
-    | "static" MethodDefinition
-    | SEMICOLON
+     {
+        if (static_cast<MethodDefinitionExpression*>($1)->getName().empty()) {
+            yyerror("computed method names are not supported");
+            YYABORT;
+        }
+        $$ = $1;
+     }
+    | "static" MethodDefinition             { yyerror("static methods are not supported"); YYABORT; }
+    | SEMICOLON                             { $$ = NULL; }
     ;
 
 StrictFormalParameters:
-    FormalParameters
+    FormalParameters                        { $$ = $1; }
     ;
 
 
@@ -251,10 +283,24 @@ StrictFormalParameters:
  * http://www.ecma-international.org/ecma-262/6.0/#sec-generator-function-definitions
  */
 
+GeneratorDeclaration:
+    FUNCTION MULTIPLY BindingIdentifier LEFT_PAREN FormalParameters RIGHT_PAREN LEFT_BRACE GeneratorBody RIGHT_BRACE
+     { $$ = new FunctionDeclaration($3, $5, $8, FunctionDeclaration::generatorFunction); }
+    ;
+
 YieldExpression:
-    YIELD
-    | YIELD AssignmentExpression
-    | YIELD MULTIPLY AssignmentExpression
+    YIELD                                   { $$ = new YieldExpression(NULL, false, false); }
+    | YIELD AssignmentExpression            { $$ = new YieldExpression($2, false, false); }
+    | YIELD MULTIPLY AssignmentExpression   { $$ = new YieldExpression($3, true, false); }
+    ;
+
+/* 14.6 Async Function Definitions
+ * http://www.ecma-international.org/ecma-262/8.0/#sec-async-function-definitions
+ */
+
+AsyncFunctionDeclaration:
+    ASYNC FUNCTION BindingIdentifier LEFT_PAREN FormalParameters RIGHT_PAREN LEFT_BRACE FunctionBody RIGHT_BRACE
+     { $$ = new FunctionDeclaration($3, $5, $8, FunctionDeclaration::asyncFunction); }
     ;
 
 /* 14.3 Method Definitions
@@ -262,7 +308,10 @@ YieldExpression:
  */
 
 MethodDefinition:
-    PropertyName LEFT_PAREN StrictFormalParameters RIGHT_PAREN RIGHT_BRACE FunctionBody LEFT_BRACE
+    PropertyName LEFT_PAREN StrictFormalParameters RIGHT_PAREN LEFT_BRACE FunctionBody RIGHT_BRACE
+     { $$ = new MethodDefinitionExpression($1, $3, $6); }
+    | PropertyName LEFT_PAREN RIGHT_PAREN LEFT_BRACE FunctionBody RIGHT_BRACE
+     { $$ = new MethodDefinitionExpression($1, new vector<Expression*>, $5); }
  /* | GeneratorMethod */
     | "get" PropertyName LEFT_PAREN RIGHT_PAREN LEFT_BRACE FunctionBody RIGHT_BRACE
     | "set" PropertyName LEFT_PAREN PropertySetParameterList RIGHT_PAREN LEFT_BRACE FunctionBody RIGHT_BRACE
@@ -277,22 +326,23 @@ PropertySetParameterList:
  */
 
 ArrowFunction:
-    ArrowParameters ARROW_FUNCTION ConciseBody
+    ArrowParameters ARROW_FUNCTION ConciseBody 	{ $$ = new ArrowFunctionExpression($1, $3); }
     ;
 
 ArrowParameters:
-    CoverParenthesizedExpressionAndArrowParameterList
+    BindingIdentifier 	{ $$ = new vector<Expression*>; $$->push_back($1); }
+    | CoverParenthesizedExpressionAndArrowParameterList 	{ $$ = ArrowFunctionExpression::toFormalParameters($1); }
     ;
 
 CoverParenthesizedExpressionAndArrowParameterList:
-    LEFT_PAREN Expression RIGHT_PAREN
-    | LEFT_PAREN RIGHT_PAREN
+    LEFT_PAREN Expression RIGHT_PAREN 	{ $$ = $2; }
+    | LEFT_PAREN RIGHT_PAREN 	{ $$ = NULL; }
     | LEFT_PAREN ELLIPSIS BindingIdentifier RIGHT_PAREN
     | LEFT_PAREN Expression COMMA ELLIPSIS BindingIdentifier RIGHT_PAREN
     ;
 
 ConciseBody:
-    AssignmentExpression
+    AssignmentExpression 	{ $$ = $1; }
     | RIGHT_BRACKET FunctionBody LEFT_BRACKET
     ;
 
@@ -330,7 +380,11 @@ FormalsList:
     ;
 
 FormalParameter:
-    BindingElement                          { $$ = $1; }
+    BindingElement                          { if (dynamic_cast<IdentifierExpression*>($1) == NULL) {
+                                                  yyerror("parameter patterns and defaults are not supported");
+                                                  YYABORT;
+                                              }
+                                              $$ = $1; }
     ;
 
 FunctionBody:
@@ -476,8 +530,7 @@ IterationStatement:
     ;
 
 ForDeclaration:
-    LetOrConst
-    | ForBinding
+    LetOrConst ForBinding
     ;
 
 ForBinding:
@@ -517,52 +570,79 @@ EmptyStatement:
  */
 
 BindingPattern:
-	ObjectBindingPattern
-    | ArrayBindingPattern
+	ObjectBindingPattern	{ $$ = $1; }
+    | ArrayBindingPattern	{ $$ = $1; }
 	;
 
 ObjectBindingPattern:
-    LEFT_BRACE RIGHT_BRACE
-    | LEFT_BRACE BindingPropertyList RIGHT_BRACE
-    | LEFT_BRACE BindingPropertyList COMMA RIGHT_BRACE
+    LEFT_BRACE RIGHT_BRACE                              { $$ = new BindingPatternExpression(true, new vector<Expression*>); }
+    | LEFT_BRACE BindingPropertyList RIGHT_BRACE        { $$ = new BindingPatternExpression(true, $2); }
+    | LEFT_BRACE BindingPropertyList COMMA RIGHT_BRACE  { $$ = new BindingPatternExpression(true, $2); }
     ;
 
 ArrayBindingPattern:
-    LEFT_BRACKET Elision BindingRestElement RIGHT_BRACKET
-    | LEFT_BRACKET BindingElementList RIGHT_BRACKET
+    LEFT_BRACKET RIGHT_BRACKET                          { $$ = new BindingPatternExpression(false, new vector<Expression*>); }
+    | LEFT_BRACKET Elision RIGHT_BRACKET                { $$ = new BindingPatternExpression(false,
+                                                              new vector<Expression*>($2, (Expression*)NULL)); }
+    | LEFT_BRACKET BindingRestElement RIGHT_BRACKET     { $$ = new BindingPatternExpression(false,
+                                                              new vector<Expression*>(1, $2)); }
+    | LEFT_BRACKET Elision BindingRestElement RIGHT_BRACKET
+                                                        { vector<Expression*>* elements =
+                                                              new vector<Expression*>($2, (Expression*)NULL);
+                                                          elements->push_back($3);
+                                                          $$ = new BindingPatternExpression(false, elements); }
+    | LEFT_BRACKET BindingElementList RIGHT_BRACKET     { $$ = new BindingPatternExpression(false, $2); }
+    | LEFT_BRACKET BindingElementList COMMA RIGHT_BRACKET
+                                                        { $$ = new BindingPatternExpression(false, $2); }
+    | LEFT_BRACKET BindingElementList COMMA Elision RIGHT_BRACKET
+                                                        { $2->insert($2->end(), $4, (Expression*)NULL);
+                                                          $$ = new BindingPatternExpression(false, $2); }
+    | LEFT_BRACKET BindingElementList COMMA BindingRestElement RIGHT_BRACKET
+                                                        { $2->push_back($4);
+                                                          $$ = new BindingPatternExpression(false, $2); }
     | LEFT_BRACKET BindingElementList COMMA Elision BindingRestElement RIGHT_BRACKET
+                                                        { $2->insert($2->end(), $4, (Expression*)NULL);
+                                                          $2->push_back($5);
+                                                          $$ = new BindingPatternExpression(false, $2); }
     ;
 
 BindingPropertyList:
-    BindingProperty
-    | BindingPropertyList COMMA BindingProperty
+    BindingProperty                                 { $$ = new vector<Expression*>; $$->push_back($1); }
+    | BindingPropertyList COMMA BindingProperty     { $$ = $1; $$->push_back($3); }
     ;
 
 BindingElementList:
-    BindingElisionElement
+    BindingElisionElement                           { $$ = $1; }
     | BindingElementList COMMA BindingElisionElement
+                                                    { $$ = $1; $$->insert($$->end(), $3->begin(), $3->end()); }
     ;
 
+/* The holes of the elision as NULL elements, then the element */
 BindingElisionElement:
-    Elision BindingElement
+    BindingElement                  { $$ = new vector<Expression*>;
+                                      $$->push_back(BindingElementExpression::of($1, NULL)); }
+    | Elision BindingElement        { $$ = new vector<Expression*>($1, (Expression*)NULL);
+                                      $$->push_back(BindingElementExpression::of($2, NULL)); }
     ;
 
 BindingProperty:
-    SingleNameBinding
-    | PropertyName COLON BindingElement
+    SingleNameBinding                   { $$ = BindingElementExpression::of($1, NULL); }
+    | PropertyName COLON BindingElement { $$ = BindingElementExpression::of($3, $1); }
     ;
 
 BindingElement:
     SingleNameBinding                   { $$ = $1; }
-    | BindingPattern Initialiser
+    | BindingPattern                    { $$ = $1; }
+    | BindingPattern Initialiser        { $$ = new BindingElementExpression(NULL, $1, $2); }
     ;
 
 SingleNameBinding:
     BindingIdentifier                   { $$ = $1; }
+    | BindingIdentifier Initialiser     { $$ = new BindingElementExpression(NULL, $1, $2); }
     ;
 
 BindingRestElement:
-    ELLIPSIS BindingIdentifier
+    ELLIPSIS BindingIdentifier          { $$ = new BindingElementExpression(NULL, $2, NULL, true); }
     ;
 
 /*BindingRestElementOptional:
@@ -575,17 +655,18 @@ BindingRestElement:
  */
 
 VariableStatement:
-    VAR VariableDeclarationList SEMICOLON
+    VAR VariableDeclarationList SEMICOLON   { $$ = new VariableStatement($2, VariableStatement::var); }
     ;
 
 VariableDeclarationList:
-    VariableDeclaration
-    | VariableDeclarationList COMMA VariableDeclaration
+    VariableDeclaration                                 { $$ = new vector<Expression*>; $$->push_back($1); }
+    | VariableDeclarationList COMMA VariableDeclaration { $$ = $1; $$->push_back($3); }
     ;
 
 VariableDeclaration:
-    BindingIdentifier
-    | BindingIdentifier Initialiser
+    BindingIdentifier               { $$ = new BindingElementExpression(NULL, $1, NULL); }
+    | BindingIdentifier Initialiser { $$ = new BindingElementExpression(NULL, $1, $2); }
+    | BindingPattern Initialiser    { $$ = new BindingElementExpression(NULL, $1, $2); }
     ;
 
 /* 13.3.1 let and const Declaration
@@ -593,22 +674,25 @@ VariableDeclaration:
  */
 
 LexicalDeclaration:
-    LetOrConst BindingList SEMICOLON
+    LetOrConst BindingList SEMICOLON    { $$ = new VariableStatement($2, $1 ? VariableStatement::const_
+                                                                            : VariableStatement::let); }
     ;
 
+/* true for const */
 LetOrConst:
-    LET
-    | CONST
+    LET                                 { $$ = false; }
+    | CONST                             { $$ = true; }
     ;
 
 BindingList:
-    LexicalBinding
-    | BindingList COMMA LexicalBinding
+    LexicalBinding                      { $$ = new vector<Expression*>; $$->push_back($1); }
+    | BindingList COMMA LexicalBinding  { $$ = $1; $$->push_back($3); }
     ;
 
 LexicalBinding:
-    BindingIdentifier Initialiser
-    | BindingPattern Initialiser
+    BindingIdentifier                   { $$ = new BindingElementExpression(NULL, $1, NULL); }
+    | BindingIdentifier Initialiser     { $$ = new BindingElementExpression(NULL, $1, $2); }
+    | BindingPattern Initialiser        { $$ = new BindingElementExpression(NULL, $1, $2); }
     ;
 
 /* 13.2 Block
@@ -646,7 +730,7 @@ StatementListItem:
 
 Statement:
     BlockStatement          { $$ = $1; }
-    | VariableStatement
+    | VariableStatement     { $$ = $1; }
     | EmptyStatement
     | ExpressionStatement   { $$ = $1; }
     | IfStatement           { $$ = $1; }
@@ -665,14 +749,15 @@ Statement:
     /* TODO The below are not implemented yet, see: section 13 of spec for implementation details */
     HoistableDeclaration
     | ClassDeclaration
- /*   | LexicalDeclaration
-    */
+    | LexicalDeclaration
+
     /*| ExportDeclaration -- where is this from?*/
     ;
 
  HoistableDeclaration:
     FunctionDeclaration
-/*  | GeneratorDeclaration */
+    | GeneratorDeclaration
+    | AsyncFunctionDeclaration
     ;
 
 BreakableStatement:
@@ -686,7 +771,7 @@ BreakableStatement:
 
 Expression:
     AssignmentExpression					 {$$ = $1;}
-    | Expression COMMA AssignmentExpression
+    | Expression COMMA AssignmentExpression 	{ $$ = new CommaExpression($1, $3); }
     ;
 
 ExpressionOptional:
@@ -768,10 +853,10 @@ BitwiseORExpression:
 
 EqualityExpression:
     RelationalExpression	{$$ = $1;}
-    | EqualityExpression EQUAL RelationalExpression
-	| EqualityExpression NOT_EQUAL RelationalExpression
-	| EqualityExpression EXACTLY_EQUAL RelationalExpression
-	| EqualityExpression NOT_EXACTLY_EQUAL RelationalExpression
+    | EqualityExpression EQUAL RelationalExpression  { $$ = new EqualityBinaryExpression($1, $3, EQUALS_OPERATION, "=="); }
+	| EqualityExpression NOT_EQUAL RelationalExpression  { $$ = new EqualityBinaryExpression($1, $3, NOT_EQUALS_OPERATION, "!="); }
+	| EqualityExpression EXACTLY_EQUAL RelationalExpression  { $$ = new EqualityBinaryExpression($1, $3, STRICT_EQUALS_OPERATION, "==="); }
+	| EqualityExpression NOT_EXACTLY_EQUAL RelationalExpression  { $$ = new EqualityBinaryExpression($1, $3, STRICT_NOT_EQUALS_OPERATION, "!=="); }
     ;
 
 /* 12.9 Relational Operators
@@ -780,10 +865,10 @@ EqualityExpression:
 
 RelationalExpression:
     ShiftExpression	{$$ = $1;}
-	| RelationalExpression LESS_THAN ShiftExpression
-	| RelationalExpression GREATER_THAN ShiftExpression
-	| RelationalExpression LESS_THAN_OR_EQUAL ShiftExpression
-	| RelationalExpression GREATER_THAN_OR_EQUAL ShiftExpression
+	| RelationalExpression LESS_THAN ShiftExpression  { $$ = new RelationalBinaryExpression($1, $3, LESS_THAN_OPERATION, "<"); }
+	| RelationalExpression GREATER_THAN ShiftExpression  { $$ = new RelationalBinaryExpression($1, $3, GREATER_THAN_OPERATION, ">"); }
+	| RelationalExpression LESS_THAN_OR_EQUAL ShiftExpression  { $$ = new RelationalBinaryExpression($1, $3, LESS_THAN_OR_EQUAL_OPERATION, "<="); }
+	| RelationalExpression GREATER_THAN_OR_EQUAL ShiftExpression  { $$ = new RelationalBinaryExpression($1, $3, GREATER_THAN_OR_EQUAL_OPERATION, ">="); }
 	| RelationalExpression INSTANCEOF ShiftExpression
 	| LEFT_BRACKET ADD IN RIGHT_BRACKET RelationalExpression IN ShiftExpression
     /*
@@ -823,7 +908,7 @@ MultiplicativeExpression:
     UnaryExpression
 	| MultiplicativeExpression MULTIPLY UnaryExpression 	{$$ = new MultiplicativeBinaryExpression($1, $3); }
 	| MultiplicativeExpression DIVIDE UnaryExpression		{$$ = new DivisionBinaryExpression($1, $3); }
-	| MultiplicativeExpression MODULO UnaryExpression
+	| MultiplicativeExpression MODULO UnaryExpression		{$$ = new ModuloBinaryExpression($1, $3); }
     ;
 
 /* 12.6 Multiplicative Operators
@@ -849,6 +934,7 @@ UnaryExpression:
 	| SUBTRACT UnaryExpression 			{ $$ = new UnaryExpression($2, '-'); }
 	| BITWISE_NOT UnaryExpression
 	| LOGICAL_NOT UnaryExpression
+	| AWAIT UnaryExpression				{ $$ = new YieldExpression($2, false, true); }
     ;
 
 /* 12.4 Postfix Expression
@@ -865,6 +951,11 @@ PostfixExpression:
 
 MemberExpression:
     PrimaryExpression	{ $$ = $1; }
+    | MemberExpression LEFT_BRACKET Expression RIGHT_BRACKET 	{ $$ = new ElementAccessExpression($1, $3); }
+    | MemberExpression FULL_STOP IdentifierName 	{ $$ = new PropertyAccessExpression($1, $3); }
+    /* an IdentifierName may be a reserved word, catch is the one a property is named so far (promise.catch) */
+    | MemberExpression FULL_STOP CATCH 	{ $$ = new PropertyAccessExpression($1, "catch"); }
+    | NEW MemberExpression Arguments 	{ $$ = new NewExpression($2, $3); }
     ;
 
 NewExpression:
@@ -873,11 +964,12 @@ NewExpression:
     ;
 
 CallExpression:
-    MemberExpression Arguments
+    MemberExpression Arguments 	{ $$ = new CallExpression($1, $2); }
     | SuperCall
-    | CallExpression Arguments
-    | CallExpression LEFT_BRACKET Expression RIGHT_BRACKET
-    | CallExpression FULL_STOP Identifier
+    | CallExpression Arguments 	{ $$ = new CallExpression($1, $2); }
+    | CallExpression LEFT_BRACKET Expression RIGHT_BRACKET 	{ $$ = new ElementAccessExpression($1, $3); }
+    | CallExpression FULL_STOP IdentifierName 	{ $$ = new PropertyAccessExpression($1, $3); }
+    | CallExpression FULL_STOP CATCH 	{ $$ = new PropertyAccessExpression($1, "catch"); }
     /* | CallExpression TemplateLiteral */
     ;
 
@@ -886,8 +978,8 @@ SuperCall:
     ;
 
 Arguments:
-    LEFT_PAREN RIGHT_PAREN
-    | LEFT_PAREN ArgumentList RIGHT_PAREN
+    LEFT_PAREN RIGHT_PAREN 	{ $$ = new vector<Expression*>; }
+    | LEFT_PAREN ArgumentList RIGHT_PAREN 	{ $$ = $2; }
     ;
 
 ArgumentList:
@@ -901,7 +993,7 @@ ArgumentList:
 
 LeftHandSideExpression:
     NewExpression	{ $$ = $1; }
-    | CallExpression
+    | CallExpression 	{ $$ = $1; }
     ;
 
 /* 12.2.6 Object Initialiser
@@ -921,7 +1013,7 @@ LiteralPropertyName:
     ;
 
 Initialiser:
-    ASSIGNMENT AssignmentExpression
+    ASSIGNMENT AssignmentExpression     { $$ = $2; }
     ;
 
 
@@ -967,9 +1059,10 @@ ElementList:
     | ElementList COMMA SpreadElement
     ;
 
+/* The number of holes */
 Elision:
-    COMMA
-    | Elision COMMA
+    COMMA               { $$ = 1; }
+    | Elision COMMA     { $$ = $1 + 1; }
     ;
 
 SpreadElement:
@@ -1013,7 +1106,7 @@ StringLiteral:
  */
 
 PrimaryExpression:
-    THIS
+    THIS    { $$ = new ThisExpression(); }
     | IdentifierReference { $$ = $1; }
     | Literal	{ $$ = $1; }
     | ArrayLiteral { $$ = $1; }
@@ -1034,7 +1127,7 @@ GeneratorExpression :
     ;
 
 GeneratorBody:
-    FunctionBody
+    FunctionBody                            { $$ = $1; }
     ;
 
 /* 12.1 Identifier
@@ -1121,3 +1214,18 @@ LineTerminatorSequence:
     | CARRIAGE_RETURN LINE_FEED
     ;*/
 %%
+
+#undef yylex
+
+// called with true before the lexer runs and false once it has returned a token, when set
+void (*lexerHook)(bool entering) = NULL;
+
+int lexToken() {
+	if (lexerHook == NULL) {
+		return yylex();
+	}
+	lexerHook(true);
+	int token = yylex();
+	lexerHook(false);
+	return token;
+}
@@ -4,6 +4,7 @@
 #include <stdio.h>
 #include "y.tab.h"
 #include "ast/ast.hpp"
+#include "ast/dead_code.hpp"
 #include "grammar.tab.h"
 #include "lex.yy.h"
 #include <stdlib.h>
@@ -13,63 +14,405 @@
 #include <cstdarg>
 #include <cstdio>
 #include <string>
+#include <chrono>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 extern FILE *yyin;
 int yyparse(void);
 extern ScriptBody *root;
 extern int global_var;
-ESObject* globalObj;
-
 extern std::map<int, vector<std::string> > codeScope; // this really should be named something better...?
 extern int codeScopeDepth;
 extern std::vector<std::string> functionDefinitions;
 
 
 extern unsigned int getNewRegister();
+extern void (*lexerHook)(bool entering);
+
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* memory, size_t size);
+
+// every allocation of the compiler, whether new, strdup or the lexer's buffers, goes through these for --time-passes
+static size_t allocationCount = 0;
+static size_t allocationBytes = 0;
+
+extern "C" void* malloc(size_t size) {
+    allocationCount++;
+    allocationBytes += size;
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size) {
+    allocationCount++;
+    allocationBytes += count * size;
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* memory, size_t size) {
+    allocationCount++;
+    allocationBytes += size;
+    return __libc_realloc(memory, size);
+}
+
+/**
+ * Wall time and allocations of each pass of the compiler for --time-passes. Everything goes to the pass entered
+ * last, so the lexer, which the parser calls for every token, is accounted apart from the parser.
+ */
+class PassTimes {
+public:
+    enum Pass {lex, parse, dump, codegen, deadCode, write, build, passCount};
+
+private:
+    static const char* const names[passCount];
+    double seconds[passCount];
+    size_t allocations[passCount];
+    size_t bytes[passCount];
+    bool ran[passCount];
+    int current;
+    std::chrono::steady_clock::time_point since;
+    size_t allocationsSince;
+    size_t bytesSince;
+
+public:
+    PassTimes() : current(-1), allocationsSince(0), bytesSince(0) {
+        for (int pass = 0; pass < passCount; pass++) {
+            seconds[pass] = 0;
+            allocations[pass] = 0;
+            bytes[pass] = 0;
+            ran[pass] = false;
+        }
+    }
+
+    /**
+     * Ends the current pass and starts accounting to pass
+     */
+    void enter(Pass pass) {
+        stop();
+        current = pass;
+        ran[pass] = true;
+        allocationsSince = allocationCount;
+        bytesSince = allocationBytes;
+        since = std::chrono::steady_clock::now();
+    }
+
+    void stop() {
+        if (current >= 0) {
+            seconds[current] += std::chrono::duration<double>(std::chrono::steady_clock::now() - since).count();
+            allocations[current] += allocationCount - allocationsSince;
+            bytes[current] += allocationBytes - bytesSince;
+            current = -1;
+        }
+    }
+
+    void report(FILE* file) {
+        stop();
+        double totalSeconds = 0;
+        size_t totalAllocations = 0;
+        size_t totalBytes = 0;
+        for (int pass = 0; pass < passCount; pass++) {
+            totalSeconds += seconds[pass];
+            totalAllocations += allocations[pass];
+            totalBytes += bytes[pass];
+        }
+        fprintf(file, "%-12s%12s%8s%14s%16s\n", "pass", "wall", "", "allocations", "bytes");
+        for (int pass = 0; pass < passCount; pass++) {
+            if (ran[pass]) {
+                fprintf(file, "%-12s%11.4fs%7.1f%%%14lu%16lu\n", names[pass], seconds[pass],
+                        totalSeconds > 0 ? seconds[pass] * 100 / totalSeconds : 0, (unsigned long)allocations[pass],
+                        (unsigned long)bytes[pass]);
+            }
+        }
+        fprintf(file, "%-12s%11.4fs%8s%14lu%16lu\n", "total", totalSeconds, "", (unsigned long)totalAllocations,
+                (unsigned long)totalBytes);
+    }
+};
+
+const char* const PassTimes::names[PassTimes::passCount] = {
+    "lex", "parse", "dump", "codegen", "dead code", "write", "build"
+};
+
+static PassTimes passTimes;
+
+static void timeLexer(bool entering) {
+    passTimes.enter(entering ? PassTimes::lex : PassTimes::parse);
+}
 
 // int Node::registerIndex = 0;
 
+/**
+ * How the generated code is built into an executable: the system C++ compiler (CXX, or g++) at an optimisation
+ * level with link time optimisation, against the static runtime library when one has been built and against the
+ * runtime sources otherwise
+ */
+struct BuildOptions {
+    // an object to link into a program instead, with --entry
+    const char* executable;
+    bool objectOnly;
+    std::string optimisation;
+    bool linkTimeOptimisation;
+    // loading libstdc++.so is most of the startup time of a small program, so it is linked in unless asked not to
+    bool staticLibstdcxx;
+    std::string runtimeRoot;
+};
+
+/**
+ * Runs a command without a shell and waits for it, adding the wall time it took to seconds
+ */
+static int runCommand(const std::vector<std::string>& command, double* seconds) {
+    std::vector<char*> arguments;
+    for (size_t i = 0; i < command.size(); i++) {
+        arguments.push_back(const_cast<char*>(command[i].c_str()));
+    }
+    arguments.push_back(NULL);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    pid_t child = fork();
+    if (child == 0) {
+        execvp(arguments[0], arguments.data());
+        perror(arguments[0]);
+        _exit(127);
+    }
+    int status = -1;
+    if (child > 0) {
+        waitpid(child, &status, 0);
+    }
+    *seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return child > 0 && WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+/**
+ * The translation units of libesruntime.a, relative to the runtime root
+ */
+static const char* runtimeSources[] = {
+    "type/type.cpp", "type/conversion.cpp", "type/heap.cpp", "runtime/core.cpp", "runtime/console.cpp",
+    "runtime/simd.cpp", "runtime/global.cpp", "runtime/profiler.cpp",
+    "runtime/isolate.cpp", "runtime/embedding.cpp", "runtime/eventloop.cpp", "runtime/promise.cpp",
+    "runtime/generator.cpp", "runtime/class.cpp"
+};
+
+/**
+ * Compiles the generated file to an object and links it, reporting the time each step takes. A precompiled
+ * runtime/runtime.hpp.gch built with the same flags is picked up by the compiler on its own. A script compiled with
+ * --entry has no main, so it is only compiled, to an object that links with or without -flto.
+ */
+static int buildExecutable(const char* generatedFile, BuildOptions& options) {
+    const char* compiler = getenv("CXX") != NULL ? getenv("CXX") : "g++";
+    std::string objectFile = std::string(generatedFile) + ".o";
+    std::string runtimeLibrary = options.runtimeRoot + "/libesruntime.a";
+    struct stat library;
+    bool haveLibrary = stat(runtimeLibrary.c_str(), &library) == 0;
+
+    std::vector<std::string> compile;
+    compile.push_back(compiler);
+    compile.push_back("-x");
+    compile.push_back("c++");
+    compile.push_back("-std=gnu++17");
+    compile.push_back("-Wall");
+    compile.push_back(options.optimisation);
+    if (options.linkTimeOptimisation) {
+        compile.push_back("-flto");
+        if (options.objectOnly) {
+            compile.push_back("-ffat-lto-objects");
+        }
+    }
+    compile.push_back("-I" + options.runtimeRoot);
+    compile.push_back("-c");
+    compile.push_back(generatedFile);
+    compile.push_back("-o");
+    compile.push_back(options.objectOnly ? options.executable : objectFile);
+
+    std::vector<std::string> link;
+    link.push_back(compiler);
+    link.push_back(options.optimisation);
+    if (options.linkTimeOptimisation) {
+        link.push_back("-flto");
+    }
+    if (options.staticLibstdcxx) {
+        link.push_back("-static-libstdc++");
+        link.push_back("-static-libgcc");
+    }
+    link.push_back(objectFile);
+    if (haveLibrary) {
+        link.push_back(runtimeLibrary);
+    } else {
+        link.push_back("-std=gnu++17");
+        for (size_t i = 0; i < sizeof(runtimeSources) / sizeof(runtimeSources[0]); i++) {
+            link.push_back(options.runtimeRoot + "/" + runtimeSources[i]);
+        }
+    }
+    link.push_back("-o");
+    link.push_back(options.executable);
+
+    double compileSeconds = 0;
+    double linkSeconds = 0;
+    int status = runCommand(compile, &compileSeconds);
+    if (options.objectOnly) {
+        if (status != 0) {
+            fprintf(stderr, "build: %s failed\n", options.executable);
+            return status;
+        }
+        fprintf(stderr, "build: %s compile %.2fs (%s %s%s)\n", options.executable, compileSeconds, compiler,
+                options.optimisation.c_str(), options.linkTimeOptimisation ? " -flto" : "");
+        return 0;
+    }
+    if (status == 0) {
+        status = runCommand(link, &linkSeconds);
+    }
+    unlink(objectFile.c_str());
+    if (status != 0) {
+        fprintf(stderr, "build: %s failed\n", options.executable);
+        return status;
+    }
+    fprintf(stderr, "build: %s compile %.2fs, link %.2fs (%s %s%s, %s)\n", options.executable, compileSeconds,
+            linkSeconds, compiler, options.optimisation.c_str(), options.linkTimeOptimisation ? " -flto" : "",
+            haveLibrary ? runtimeLibrary.c_str() : "runtime sources");
+    return 0;
+}
+
 int main(int argc, char* argv[]) {
 	int global_var=0;
 
-    globalObj = new ESObject();
     codeScopeDepth = 0;
 
-    yyin = fopen(argv[1], "r");
+    // compiler [--dump] [--no-dce] [--time-passes] [--profile] [--entry name] [-o executable [-O0..-O3] [--no-lto]
+    //          [--shared-libstdc++] [--runtime dir]] <input.js>
+    char* inputFile = NULL;
+    bool dumpTree = false;
+    bool eliminateDeadCode = true;
+    bool timePasses = false;
+    // an option the compiler does not take, which is not passed on to g++ either
+    bool badOption = false;
+    BuildOptions build;
+    build.executable = NULL;
+    build.objectOnly = false;
+    build.optimisation = "-O2";
+    build.linkTimeOptimisation = true;
+    build.staticLibstdcxx = true;
+    // the runtime sources and library sit next to the compiler unless told otherwise
+    std::string compilerPath = argv[0];
+    build.runtimeRoot = compilerPath.find('/') == std::string::npos ? "." : compilerPath.substr(0, compilerPath.rfind('/'));
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--dump") == 0) {
+            dumpTree = true;
+        } else if (strcmp(argv[i], "--no-dce") == 0) {
+            eliminateDeadCode = false;
+        } else if (strcmp(argv[i], "--time-passes") == 0) {
+            timePasses = true;
+        } else if (strcmp(argv[i], "--profile") == 0) {
+            Node::profileFunctions = true;
+        } else if (strcmp(argv[i], "--entry") == 0 && i + 1 < argc) {
+            Node::entryPoint = argv[++i];
+            build.objectOnly = true;
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            build.executable = argv[++i];
+        } else if (strncmp(argv[i], "-O", 2) == 0) {
+            badOption = badOption || strlen(argv[i]) != 3 || argv[i][2] < '0' || argv[i][2] > '3';
+            build.optimisation = argv[i];
+        } else if (strcmp(argv[i], "--no-lto") == 0) {
+            build.linkTimeOptimisation = false;
+        } else if (strcmp(argv[i], "--shared-libstdc++") == 0) {
+            build.staticLibstdcxx = false;
+        } else if (strcmp(argv[i], "--runtime") == 0 && i + 1 < argc) {
+            build.runtimeRoot = argv[++i];
+        } else {
+            inputFile = argv[i];
+        }
+    }
+    if (inputFile == NULL || badOption) {
+        fprintf(stderr, "usage: %s [--dump] [--no-dce] [--time-passes] [--profile] [--entry name] "
+                "[-o executable [-O0..-O3] [--no-lto] [--shared-libstdc++] [--runtime dir]] <input.js>\n", argv[0]);
+        return 1;
+    }
+
+    yyin = fopen(inputFile, "r");
+    if (yyin == NULL) {
+        perror(inputFile);
+        return 1;
+    }
 
     // 'compiled' c file name
-    char* inputFile = argv[1];
     char* outputFilename = (char*)malloc(strlen(inputFile) + 3);
     sprintf(outputFilename, "%s.c", inputFile);
-    FILE* outputFile = fopen(outputFilename, "w");
 
-    yyparse();
+    if (timePasses) {
+        lexerHook = timeLexer;
+        passTimes.enter(PassTimes::parse);
+    }
+    int parsed = yyparse();
+    lexerHook = NULL;
+    // yyerror has reported the error, a script that does not parse is neither generated nor built
+    if (parsed != 0 || parseErrors > 0) {
+        return 1;
+    }
 
-    fprintf(outputFile, "#include \"./runtime/core.hpp\"\n");
-    fprintf(outputFile, "#include \"./runtime/console.hpp\"\n");
-    fprintf(outputFile, "#include \"./scope/reference.hpp\"\n");
-    fprintf(outputFile, "\n");
-	fprintf(outputFile, "ESObject* globalObj = new ESObject();\n\n");
+    std::vector<std::string> output;
+    output.push_back("#include \"./runtime/runtime.hpp\"");
+    output.push_back("");
+    // the global object is static data, so starting the program allocates nothing, and main points globalObj at it.
+    // An entry point runs against the global object of the isolate that calls it.
+    if (Node::entryPoint == NULL) {
+        output.push_back("GlobalObject globalObject;");
+    }
+    output.push_back("");
     if (root != NULL) {
-        root->dump(0);
+        if (dumpTree) {
+            passTimes.enter(PassTimes::dump);
+            root->dump(0);
+            fflush(stdout);
+        }
+        passTimes.enter(PassTimes::codegen);
         root->genCode();
-
-//        printf("printing scoped IR:\n");
-        for (std::vector<std::string>::iterator iter = functionDefinitions.begin(); iter != functionDefinitions.end(); ++iter) {
-            std::string s = (*iter);
-            const char* c = s.c_str();
-            fprintf(outputFile, "%s\n", c);
+        Node::LexicalStatistics lexical = Node::lexicalStatistics;
+        if (Node::compileFailed) {
+            return 1;
         }
-
-        for (std::vector<std::string>::iterator iter = codeScope[codeScopeDepth].begin(); iter != codeScope[codeScopeDepth].end(); ++iter) {
-            std::string s = (*iter);
-            const char* c = s.c_str();
-            fprintf(outputFile, "%s\n", c);
+        if (lexical.locals + lexical.captured + lexical.globals > 0) {
+            fprintf(stderr, "lexical bindings: %s %lu C locals, %lu in closure environments, %lu on the global object, "
+                    "TDZ checks %lu emitted, %lu removed\n", outputFilename, (unsigned long)lexical.locals,
+                    (unsigned long)lexical.captured, (unsigned long)lexical.globals,
+                    (unsigned long)lexical.checksEmitted, (unsigned long)lexical.checksRemoved);
         }
-        fprintf(outputFile, "\n");
 
+        output.insert(output.end(), functionDefinitions.begin(), functionDefinitions.end());
+        output.insert(output.end(), codeScope[codeScopeDepth].begin(), codeScope[codeScopeDepth].end());
+        output.push_back("");
     }
-    return 0;
+
+    if (eliminateDeadCode) {
+        passTimes.enter(PassTimes::deadCode);
+        DeadCodeElimination deadCode;
+        size_t before = DeadCodeElimination::size(output);
+        output = deadCode.run(output);
+        size_t after = DeadCodeElimination::size(output);
+        fprintf(stderr, "dead code elimination: %s %lu -> %lu bytes, removed %lu unreachable, %lu registers, "
+                "%lu labels, %lu jumps\n", outputFilename, (unsigned long)before, (unsigned long)after,
+                (unsigned long)deadCode.getUnreachableRemoved(), (unsigned long)deadCode.getRegistersRemoved(),
+                (unsigned long)deadCode.getLabelsRemoved(), (unsigned long)deadCode.getJumpsRemoved());
+    }
+
+    passTimes.enter(PassTimes::write);
+    FILE* outputFile = fopen(outputFilename, "w");
+    if (outputFile == NULL) {
+        perror(outputFilename);
+        return 1;
+    }
+    for (std::vector<std::string>::iterator iter = output.begin(); iter != output.end(); ++iter) {
+        fprintf(outputFile, "%s\n", iter->c_str());
+    }
+    fclose(outputFile);
+
+    int status = 0;
+    if (build.executable != NULL) {
+        passTimes.enter(PassTimes::build);
+        status = buildExecutable(outputFilename, build);
+    }
+    if (timePasses) {
+        passTimes.report(stderr);
+    }
+    return status;
 }
 
 char* substring(const char* str, size_t begin, size_t len) { 
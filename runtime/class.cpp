@@ -0,0 +1,163 @@
+#include "class.hpp"
+
+#include <cstring>
+
+int ClassLayout::indexOf(const char* field) const {
+    for (size_t i = 0; i < fieldCount; i++) {
+        if (strcmp(fields[i], field) == 0) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+const ClassMethod* ClassLayout::findMethod(const char* name) const {
+    for (size_t i = 0; i < methodCount; i++) {
+        if (strcmp(methods[i].name, name) == 0) {
+            return &methods[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * A method read as a value, such as instance.method without a call. Called on its own it has no receiver, and as the
+ * body of a class is strict code that is a TypeError here rather than at the first use of this.
+ */
+class MethodFunction : public Function {
+private:
+    const ClassLayout* layout;
+    const ClassMethod* method;
+
+public:
+    MethodFunction(const ClassLayout* layout, const ClassMethod* method)
+        : Function(NULL, method->name, method->length), layout(layout), method(method) {}
+
+    bool isCallable() {
+        return true;
+    }
+
+    ESValue* call(ESValue** arguments, int argumentCount) {
+        throw TypeError;
+    }
+
+    /**
+     * Calls the method on receiver, which must be an instance of its class
+     */
+    ESValue* callOn(ESValue* receiver, ESValue** arguments, int argumentCount) {
+        ClassInstance* instance = dynamic_cast<ClassInstance*>(receiver);
+        if (instance == NULL || instance->getLayout() != layout) {
+            throw TypeError;
+        }
+        return method->code(instance, arguments, argumentCount);
+    }
+};
+
+ESValue* ClassPrototype::get(ESValue* key_ref) {
+    if (hasOwnProperty(key_ref)) {
+        return ESObject::get(key_ref);
+    }
+    const ClassMethod* method = layout->findMethod(key_ref->toString()->getValue().c_str());
+    if (method == NULL) {
+        return new Undefined();
+    }
+    // the function object of a method is made once and kept on the prototype
+    return ESObject::set(key_ref, new MethodFunction(layout, method));
+}
+
+ClassConstructor::ClassConstructor(const ClassLayout* layout)
+    : Function(NULL, layout->name, layout->length), layout(layout), instancePrototype(new ClassPrototype(layout)) {
+    writeBarrier(instancePrototype);
+}
+
+ESValue* ClassConstructor::construct(ESValue** arguments, int argumentCount) {
+    ClassInstance* instance = ClassInstance::create(instancePrototype);
+    if (layout->constructor != NULL) {
+        for (int i = 0; i < argumentCount; i++) {
+            arguments[i] = Core::getValue(arguments[i]);
+        }
+        layout->constructor(instance, arguments, argumentCount);
+    }
+    return instance;
+}
+
+ESValue* ClassConstructor::get(ESValue* key_ref) {
+    if (key_ref->toString()->getValue() == "prototype") {
+        return instancePrototype;
+    }
+    return ESObject::get(key_ref);
+}
+
+void ClassConstructor::visitReferences(Heap::ReferenceVisitor& visitor) {
+    ESObject::visitReferences(visitor);
+    visitor.visit((ESValue**)&instancePrototype);
+}
+
+ClassInstance::ClassInstance(ClassPrototype* prototype)
+    : ESObject(prototype), layout(prototype->getLayout()), expanded(false) {
+    for (size_t i = 0; i < layout->fieldCount; i++) {
+        slots()[i] = NULL;
+    }
+}
+
+ClassInstance* ClassInstance::create(ClassPrototype* prototype) {
+    return new (prototype->getLayout()) ClassInstance(prototype);
+}
+
+ESValue* ClassInstance::get(ESValue* key_ref) {
+    std::string key = key_ref->toString()->getValue();
+    int index = layout->indexOf(key.c_str());
+    if (index >= 0 && slots()[index] != NULL) {
+        return slots()[index];
+    }
+    if (expanded && hasOwnProperty(key_ref)) {
+        return ESObject::get(key_ref);
+    }
+    return getPrototype()->get(key_ref);
+}
+
+ESValue* ClassInstance::set(ESValue* key_ref, ESValue* value) {
+    int index = layout->indexOf(key_ref->toString()->getValue().c_str());
+    if (index >= 0) {
+        return setField(index, value);
+    }
+    expanded = true;
+    return ESObject::set(key_ref, value);
+}
+
+void ClassInstance::visitReferences(Heap::ReferenceVisitor& visitor) {
+    ESObject::visitReferences(visitor);
+    for (size_t i = 0; i < layout->fieldCount; i++) {
+        if (slots()[i] != NULL) {
+            visitor.visit(&slots()[i]);
+        }
+    }
+}
+
+ESValue* ClassInstance::callMethod(ClassInstance* instance, const char* name, ESValue** arguments, int argumentCount,
+                                   MethodCache* cache) {
+    for (int i = 0; i < argumentCount; i++) {
+        arguments[i] = Core::getValue(arguments[i]);
+    }
+    if (!instance->expanded) {
+        // the compiler never makes a method name a field, so only the property map can shadow a method
+        if (cache->layout != instance->layout) {
+            cache->method = instance->layout->findMethod(name);
+            cache->layout = instance->layout;
+        }
+        if (cache->method != NULL) {
+            return Core::getValue(cache->method->code(instance, arguments, argumentCount));
+        }
+    }
+
+    ESValue* callee = instance->get(new String(name));
+    MethodFunction* method = dynamic_cast<MethodFunction*>(callee);
+    if (method != NULL) {
+        return Core::getValue(method->callOn(instance, arguments, argumentCount));
+    }
+    Function* function = dynamic_cast<Function*>(callee);
+    if (function == NULL || !function->isCallable()) {
+        throw TypeError;
+    }
+    return Core::getValue(function->call(arguments, argumentCount));
+}
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <cstddef>
+#include "core.hpp"
+
+class ClassInstance;
+
+/**
+ * A method as the compiler emits it, with its receiver apart from the arguments: code is only ever called with an
+ * instance of the class that defines it
+ */
+struct ClassMethod {
+    typedef ESValue* (*Code)(ClassInstance* self, ESValue** arguments, int argumentCount);
+
+    const char* name;
+    Code code;
+    int length;
+};
+
+/**
+ * 14.5 Class Definitions
+ * http://www.ecma-international.org/ecma-262/6.0/#sec-class-definitions
+ * What the compiler knows about a class, emitted as a static constant that every instance of it points to. fields
+ * are the names its constructor assigns to this, in the order of the slots an instance is allocated with, and
+ * methods are the methods of its prototype. constructor is NULL when the class has none.
+ */
+struct ClassLayout {
+    const char* name;
+    const char* const* fields;
+    size_t fieldCount;
+    const ClassMethod* methods;
+    size_t methodCount;
+    ClassMethod::Code constructor;
+    int length;
+
+    /**
+     * The slot of field, or -1
+     */
+    int indexOf(const char* field) const;
+
+    /**
+     * The method called name, or NULL
+     */
+    const ClassMethod* findMethod(const char* name) const;
+};
+
+/**
+ * The inline cache of a call site base.name(...), one per thread: the layout of the instance it last called a method
+ * of and that method, both NULL until then
+ */
+struct MethodCache {
+    const ClassLayout* layout;
+    const ClassMethod* method;
+};
+
+/**
+ * 9.1 Ordinary Object Internal Methods, for the prototype of a class: its methods are in the layout, and each one
+ * becomes a function object the first time it is read as a value. The prototype is created once with its class and
+ * shared by all its instances.
+ */
+class ClassPrototype : public ESObject {
+private:
+    const ClassLayout* layout;
+
+public:
+    explicit ClassPrototype(const ClassLayout* layout) : layout(layout) {}
+
+    const ClassLayout* getLayout() {
+        return layout;
+    }
+
+    ESValue* get(ESValue* key_ref);
+};
+
+/**
+ * 9.2 ECMAScript Function Objects, for a class: calling it is a TypeError, constructing it allocates an instance
+ * with the slots of its layout and runs the constructor on it
+ */
+class ClassConstructor : public Function {
+private:
+    const ClassLayout* layout;
+    ClassPrototype* instancePrototype;
+
+public:
+    explicit ClassConstructor(const ClassLayout* layout);
+
+    const ClassLayout* getLayout() {
+        return layout;
+    }
+
+    /**
+     * 9.2.2 [[Construct]] ( argumentsList, newTarget ), which returns the instance whatever the constructor returns
+     */
+    ESValue* construct(ESValue** arguments, int argumentCount);
+
+    ESValue* get(ESValue* key_ref);
+
+    void visitReferences(Heap::ReferenceVisitor& visitor);
+};
+
+/**
+ * An instance of a class. The fields its constructor assigns are slots allocated with the object, in the order of
+ * the layout, so generated code that knows the class reads and writes them by index. A slot is NULL until it is
+ * assigned, and any other property goes to the property map, which makes the instance expanded: it may then shadow
+ * a method, and the fast paths that skip the lookup of methods are not taken for it.
+ */
+class ClassInstance : public ESObject {
+private:
+    const ClassLayout* layout;
+    bool expanded;
+
+    explicit ClassInstance(ClassPrototype* prototype);
+
+    static void* operator new(size_t size, const ClassLayout* layout) {
+        return Heap::allocateOld(size + layout->fieldCount * sizeof(ESValue*));
+    }
+
+    static void operator delete(void* value) {
+        Heap::freeOld(value);
+    }
+
+    static void operator delete(void* value, const ClassLayout* layout) {
+        Heap::freeOld(value);
+    }
+
+    ESValue** slots() {
+        return reinterpret_cast<ESValue**>(this + 1);
+    }
+
+public:
+    /**
+     * The most fields a layout has, which keeps an instance within a slot of the old generation; the compiler leaves
+     * any further fields to the property map
+     */
+    static const size_t MAX_FIELDS = 64;
+
+    static ClassInstance* create(ClassPrototype* prototype);
+
+    const ClassLayout* getLayout() {
+        return layout;
+    }
+
+    bool isExpanded() {
+        return expanded;
+    }
+
+    /**
+     * this.name where name is the field at index of the layout
+     */
+    ESValue* getField(size_t index, const char* name) {
+        ESValue* value = slots()[index];
+        return value != NULL ? value : get(new String(name));
+    }
+
+    ESValue* setField(size_t index, ESValue* value) {
+        ESValue* previous = slots()[index];
+        slots()[index] = value;
+        writeBarrier(&slots()[index], previous);
+        return value;
+    }
+
+    /**
+     * 9.1.8 [[Get]] ( P, Receiver ): a field, then the property map, then the prototype
+     */
+    ESValue* get(ESValue* key_ref);
+
+    ESValue* set(ESValue* key_ref, ESValue* value);
+
+    void visitReferences(Heap::ReferenceVisitor& visitor);
+
+    /**
+     * instance.name(arguments): the method is found in the layout once per layout a call site sees, and called
+     * directly while the instances it sees have that layout and are not expanded
+     */
+    static ESValue* callMethod(ClassInstance* instance, const char* name, ESValue** arguments, int argumentCount,
+                               MethodCache* cache);
+};
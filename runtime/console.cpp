@@ -0,0 +1,201 @@
+#include "console.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../type/conversion.hpp"
+
+OutputBuffer::OutputBuffer(FILE* stream, size_t size) {
+    this->stream = stream;
+    this->size = size > 0 ? size : 1;
+    this->data = (char*)malloc(this->size);
+    this->used = 0;
+    this->lineBuffered = isatty(fileno(stream));
+    std::lock_guard<std::mutex> guard(buffersMutex());
+    buffers().insert(this);
+}
+
+OutputBuffer::~OutputBuffer() {
+    {
+        std::lock_guard<std::mutex> guard(buffersMutex());
+        buffers().erase(this);
+    }
+    flush();
+    free(data);
+}
+
+std::set<OutputBuffer*>& OutputBuffer::buffers() {
+    static std::set<OutputBuffer*> buffers;
+    return buffers;
+}
+
+std::mutex& OutputBuffer::buffersMutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+void OutputBuffer::makeRoom(size_t length) {
+    size_t lines = used;
+    while (lines > 0 && data[lines - 1] != '\n') {
+        lines--;
+    }
+    if (lines > 0) {
+        fwrite(data, 1, lines, stream);
+        fflush(stream);
+        used -= lines;
+        memmove(data, data + lines, used);
+    }
+    if (used + length > size) {
+        size = std::max(used + length, size * 2);
+        data = (char*)realloc(data, size);
+    }
+}
+
+void OutputBuffer::write(const char* text, size_t length) {
+    if (used + length > size) {
+        makeRoom(length);
+    }
+    memcpy(data + used, text, length);
+    used += length;
+}
+
+void OutputBuffer::endLine() {
+    put('\n');
+    if (lineBuffered) {
+        flush();
+    }
+}
+
+void OutputBuffer::flush() {
+    std::lock_guard<OutputBuffer> guard(*this);
+    if (used > 0) {
+        fwrite(data, 1, used, stream);
+        used = 0;
+    }
+    fflush(stream);
+}
+
+void OutputBuffer::resize(size_t size) {
+    std::lock_guard<OutputBuffer> guard(*this);
+    if (used > 0) {
+        makeRoom(0);
+    }
+    this->size = std::max(size > 0 ? size : 1, used);
+    data = (char*)realloc(data, this->size);
+}
+
+void OutputBuffer::flushAll() {
+    std::lock_guard<std::mutex> guard(buffersMutex());
+    for (std::set<OutputBuffer*>::iterator it = buffers().begin(); it != buffers().end(); ++it) {
+        (*it)->flush();
+    }
+}
+
+Console::TerminateHandler& Console::previousTerminate() {
+    static TerminateHandler handler = NULL;
+    return handler;
+}
+
+std::atomic<size_t>& Console::bufferSize() {
+    static std::atomic<size_t> size(initialBufferSize());
+    return size;
+}
+
+size_t Console::initialBufferSize() {
+    const char* configured = getenv("ES_CONSOLE_BUFFER_SIZE");
+    if (configured != NULL && atol(configured) > 0) {
+        return (size_t)atol(configured);
+    }
+    return DEFAULT_BUFFER_SIZE;
+}
+
+void Console::onTerminate() {
+    OutputBuffer::flushAll();
+    if (previousTerminate() != NULL) {
+        previousTerminate()();
+    }
+    abort();
+}
+
+void Console::writeValue(OutputBuffer& out, ESValue* value) {
+    switch (value->getType()) {
+        case undefined:
+            out.write("undefined", 9);
+            return;
+        case null:
+            out.write("null", 4);
+            return;
+        case boolean:
+            if (dynamic_cast<Boolean*>(value)->getValue()) {
+                out.write("true", 4);
+            } else {
+                out.write("false", 5);
+            }
+            return;
+        case string_:
+            out.write(dynamic_cast<String*>(value)->getValue());
+            return;
+        case symbol:
+            out.write(dynamic_cast<Symbol*>(value)->getValue());
+            return;
+        case number: {
+            char number[NumberConversion::MAX_NUMBER_LENGTH];
+            size_t length = NumberConversion::toString(dynamic_cast<Number*>(value)->getValue(), number);
+            out.write(number, length);
+            return;
+        }
+        case object:
+            if (dynamic_cast<ESArray*>(value) != NULL || dynamic_cast<TypedArray*>(value) != NULL) {
+                out.write(value->toString()->getValue());
+            } else {
+                out.write("Object[object]", 14);
+            }
+            return;
+        default:
+            error("unloggable type\n");
+    }
+}
+
+OutputBuffer& Console::output() {
+    // installed once, by whichever thread writes first
+    static bool installed = (previousTerminate() = std::set_terminate(onTerminate), true);
+    (void)installed;
+    static thread_local OutputBuffer buffer(stdout, bufferSize().load());
+    return buffer;
+}
+
+void Console::setBufferSize(size_t size) {
+    bufferSize().store(size);
+    output().resize(size);
+}
+
+void Console::flush() {
+    output().flush();
+}
+
+void Console::error(const char* message) {
+    flush();
+    fputs(message, stderr);
+}
+
+void Console::log(ESValue* value) {
+    OutputBuffer& out = output();
+    std::lock_guard<OutputBuffer> guard(out);
+    writeValue(out, value);
+    out.endLine();
+}
+
+ESValue* Console::log(ESValue** arguments, int argumentCount) {
+    OutputBuffer& out = output();
+    std::lock_guard<OutputBuffer> guard(out);
+    for (int i = 0; i < argumentCount; i++) {
+        if (i > 0) {
+            out.put(' ');
+        }
+        writeValue(out, arguments[i]);
+    }
+    out.endLine();
+    return new Undefined();
+}
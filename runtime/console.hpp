@@ -3,70 +3,136 @@
 //
 #pragma once
 
-#include <iostream>
+#include <stdio.h>
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <string>
 #include "../type/type.hpp"
 
+/**
+ * Output of one thread, written to the stream in blocks of up to size bytes instead of one stdio call per value.
+ * Only whole lines are written while the program runs, so the lines of threads sharing a stream do not tear; a line
+ * longer than the buffer grows it. A terminal gets every completed line straight away.
+ */
+class OutputBuffer {
+private:
+    FILE* stream;
+    char* data;
+    size_t size;
+    size_t used;
+    bool lineBuffered;
+    std::recursive_mutex mutex;
+
+    /**
+     * The buffers of all threads, for flushAll
+     */
+    static std::set<OutputBuffer*>& buffers();
+
+    static std::mutex& buffersMutex();
+
+    /**
+     * Writes the complete lines and keeps the one in progress, then makes room for length more bytes
+     */
+    void makeRoom(size_t length);
+
+public:
+    OutputBuffer(FILE* stream, size_t size);
+
+    ~OutputBuffer();
+
+    /**
+     * Held by the owning thread while it writes and by flushAll, recursively so that a thread terminating in the
+     * middle of a write can still flush
+     */
+    void lock() {
+        mutex.lock();
+    }
+
+    void unlock() {
+        mutex.unlock();
+    }
+
+    void write(const char* text, size_t length);
+
+    void write(const std::string& text) {
+        write(text.data(), text.size());
+    }
+
+    void put(char c) {
+        if (used == size) {
+            makeRoom(1);
+        }
+        data[used++] = c;
+    }
+
+    void endLine();
+
+    /**
+     * Writes everything, the line in progress included
+     */
+    void flush();
+
+    void resize(size_t size);
+
+    /**
+     * Flushes the buffer of every thread
+     */
+    static void flushAll();
+};
+
 /**
  * This isn't standard ECMA, but most JS interpreters use it
  */
 class Console {
+private:
+    typedef void (*TerminateHandler)();
+
+    static TerminateHandler& previousTerminate();
+
+    static std::atomic<size_t>& bufferSize();
+
+    /**
+     * DEFAULT_BUFFER_SIZE unless ES_CONSOLE_BUFFER_SIZE says otherwise
+     */
+    static size_t initialBufferSize();
+
+    /**
+     * An uncaught exception ends the program through std::terminate, which skips the destructors that would
+     * flush, so the output every thread has written so far is flushed here first
+     */
+    static void onTerminate();
+
+    static void writeValue(OutputBuffer& out, ESValue* value);
 
 public:
+    static const size_t DEFAULT_BUFFER_SIZE = 1 << 16;
+
+    /**
+     * The buffer of the calling thread, created on its first use and flushed when the thread exits
+     */
+    static OutputBuffer& output();
+
+    /**
+     * Sets the buffer size of the calling thread and of threads that have not logged yet
+     */
+    static void setBufferSize(size_t size);
+
+    static void flush();
+
+    /**
+     * Diagnostics go to stderr unbuffered, after everything logged before them
+     */
+    static void error(const char* message);
 
     /**
      * Arbitrarily log some value to the screen
      */
-    static void log(ESValue* value) {
-        if (value->isPrimitive()) {
-            if (value->getType() == undefined) {
-                fprintf(stdout, "undefined\n");
-                return;
-            } else if (value->getType() == null) {
-                fprintf(stdout, "null\n");
-                return;
-            } else if (value->getType() == boolean) {
-                Boolean* boolean = dynamic_cast<Boolean*>(value);
-                if (boolean != NULL) {
-                    if (boolean->getValue()) {
-                        fprintf(stdout, "true\n");
-                    } else {
-                        fprintf(stdout, "false\n");
-                    }
-                } else {
-                    fprintf(stderr, "unloggable type (failed to cast to bool)\n");
-                }
-                return;
-            } else if (value->getType() == string_) {
-                String* string = dynamic_cast<String*>(value);
-                if (string != NULL) {
-                    fprintf(stdout, "%s\n", string->getValue().c_str());
-                } else {
-                    fprintf(stderr, "unloggable type (failed to cast to string)\n");
-                }
-                return;
-            } else if (value->getType() == symbol) {
-                Symbol *symbol = dynamic_cast<Symbol *>(value);
-                if (symbol != NULL) {
-                    fprintf(stdout, "%s\n", symbol->getValue().c_str());
-                } else {
-                    fprintf(stderr, "unloggable type (failed to cast to symbol)\n");
-                }
-                return;
-            } else if (value->getType() == number) {
-                Number *number = dynamic_cast<Number *>(value);
-                if (number != NULL) {
-                    fprintf(stdout, "%f\n", number->getValue());
-                } else {
-                    fprintf(stderr, "unloggable type (failed to cast to number)\n");
-                }
-                return;
-            } else if (value->getType() == object) {
-                fprintf(stdout, "Object[object]\n");
-                return;
-            }
-        } else {
-            fprintf(stderr, "unloggable type\n");
-        }
-    }
+    static void log(ESValue* value);
+
+    /**
+     * console.log(value1, value2, ...), the values are separated by a space
+     */
+    static ESValue* log(ESValue** arguments, int argumentCount);
 
-};
\ No newline at end of file
+};
@@ -0,0 +1,963 @@
+#include "core.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <typeinfo>
+#include <vector>
+#include "class.hpp"
+#include "generator.hpp"
+#include "promise.hpp"
+
+__thread ESObject* globalObj = NULL;
+
+ESValue* Core::plus(ESValue* lref, ESValue* rref) {
+    return plus<AnyTag, AnyTag>(lref, rref);
+}
+
+ESValue* Core::subtract(ESValue* lref, ESValue* rref) {
+    return subtract<AnyTag, AnyTag>(lref, rref);
+}
+
+ESValue* Core::multiply(ESValue* lref, ESValue* rref) {
+    return multiply<AnyTag, AnyTag>(lref, rref);
+}
+
+ESValue* Core::divide(ESValue* lref, ESValue* rref) {
+    return divide<AnyTag, AnyTag>(lref, rref);
+}
+
+ESValue* Core::modulo(ESValue* lref, ESValue* rref) {
+    return modulo<AnyTag, AnyTag>(lref, rref);
+}
+
+ESValue* Core::assign(ESValue* v, ESValue* w) {
+    if (v->getType() == reference) {
+        Reference* ref = dynamic_cast<Reference*>(v);
+
+        if (ref != NULL) {
+            return globalObj->set(ref->getReferencedName(), getValue(w));
+        }
+
+        throw TypeError;
+
+    } else {
+        throw ReferenceError;
+    }
+}
+
+ESValue* Core::getValue(ESValue* v) {
+    if (v->getType() != reference) {
+        return v;
+    }
+    Reference* ref = dynamic_cast<Reference*>(v);
+    return globalObj->get(ref->getReferencedName());
+}
+
+ESValue* Core::initializedBinding(ESValue* binding) {
+    if (binding == NULL) {
+        throw ReferenceError;
+    }
+    return binding;
+}
+
+void Core::assignConstant(ESValue* binding) {
+    initializedBinding(binding);
+    throw TypeError;
+}
+
+ESValue* Core::getElement(ESValue* baseRef, ESValue* keyRef) {
+    ESValue* base = getValue(baseRef);
+    ESValue* key = getValue(keyRef);
+
+    TypedArray* typed = dynamic_cast<TypedArray*>(base);
+    if (typed != NULL && key->getType() == number) {
+        double index = dynamic_cast<Number*>(key)->getValue();
+        if (!(index >= 0 && index < typed->getLength() && index == (double)(size_t)index)) {
+            return new Undefined();
+        }
+        switch (typed->getTypedArrayType()) {
+            case uint8Array:
+                return new Number(static_cast<Uint8Array*>(typed)->getElements()[(size_t)index]);
+            case int32Array:
+                return new Number(static_cast<Int32Array*>(typed)->getElements()[(size_t)index]);
+            case float64Array:
+                return new Number(static_cast<Float64Array*>(typed)->getElements()[(size_t)index]);
+        }
+    }
+
+    ESObject* object = dynamic_cast<ESObject*>(base);
+    if (object == NULL) {
+        throw TypeError;
+    }
+    return object->get(key);
+}
+
+void Core::destructureArray(ESValue* sourceRef, ESValue** slots, size_t count, ESValue** rest) {
+    ESValue* source = getValue(sourceRef);
+    ESArray* array = dynamic_cast<ESArray*>(source);
+    TypedArray* typed = dynamic_cast<TypedArray*>(source);
+    if (array != NULL || typed != NULL) {
+        size_t length = array != NULL ? array->getLength() : typed->getLength();
+        for (size_t i = 0; i < count; i++) {
+            if (i >= length) {
+                slots[i] = new Undefined();
+            } else if (array != NULL) {
+                slots[i] = array->getElement(i);
+            } else {
+                slots[i] = getElement(typed, new Number((double)i));
+            }
+        }
+        if (rest != NULL) {
+            ESArray* elements = new ESArray();
+            for (size_t i = count; i < length; i++) {
+                elements->setElement(i - count, array != NULL ? array->getElement(i)
+                                                              : getElement(typed, new Number((double)i)));
+            }
+            *rest = elements;
+        }
+        return;
+    }
+
+    Generator* iterator = Generator::iterate(source);
+    bool done = false;
+    for (size_t i = 0; i < count; i++) {
+        ESValue* value = done ? NULL : iterator->resume(new Undefined(), &done);
+        slots[i] = done ? new Undefined() : value;
+    }
+    if (rest != NULL) {
+        ESArray* elements = new ESArray();
+        while (!done) {
+            ESValue* value = iterator->resume(new Undefined(), &done);
+            if (!done) {
+                elements->setElement(elements->getLength(), value);
+            }
+        }
+        *rest = elements;
+    }
+}
+
+ESValue* Core::destructureProperty(ESValue* sourceRef, const char* name) {
+    ESValue* source = getValue(sourceRef);
+    if (source->getType() == undefined || source->getType() == null) {
+        throw TypeError;
+    }
+    ESObject* object = dynamic_cast<ESObject*>(source);
+    if (object == NULL) {
+        return new Undefined();
+    }
+    ESValue* value = object->findOwnProperty(name);
+    if (value != NULL) {
+        return value;
+    }
+    // an object of a subclass may hold the property elsewhere, a plain one does not have it
+    if (typeid(*object) == typeid(ESObject)) {
+        return new Undefined();
+    }
+    return object->get(new String(name));
+}
+
+void Core::declareVariable(const char* name) {
+    if (globalObj->findOwnProperty(name) == NULL) {
+        globalObj->set(new String(name), new Undefined());
+    }
+}
+
+ESValue* Core::setElement(ESValue* baseRef, ESValue* keyRef, ESValue* value) {
+    ESValue* base = getValue(baseRef);
+    ESValue* key = getValue(keyRef);
+
+    TypedArray* typed = dynamic_cast<TypedArray*>(base);
+    if (typed != NULL && key->getType() == number) {
+        double index = dynamic_cast<Number*>(key)->getValue();
+        if (!(index >= 0 && index < typed->getLength() && index == (double)(size_t)index)) {
+            return value;
+        }
+        double element = TypeOps::toNumber(value)->getValue();
+        switch (typed->getTypedArrayType()) {
+            case uint8Array:
+                static_cast<Uint8Array*>(typed)->getElements()[(size_t)index] = Uint8Array::toElement(element);
+                break;
+            case int32Array:
+                static_cast<Int32Array*>(typed)->getElements()[(size_t)index] = Int32Array::toElement(element);
+                break;
+            case float64Array:
+                static_cast<Float64Array*>(typed)->getElements()[(size_t)index] = element;
+                break;
+        }
+        return value;
+    }
+
+    ESObject* object = dynamic_cast<ESObject*>(base);
+    if (object == NULL) {
+        throw TypeError;
+    }
+    return object->set(key, value);
+}
+
+template <class T>
+ESValue* Core::constructTypedArray(ESValue** arguments, int argumentCount) {
+    ESValue* first = argumentCount > 0 ? getValue(arguments[0]) : NULL;
+    if (first == NULL || first->getType() != object) {
+        return new T(toIndex(first));
+    }
+
+    ArrayBuffer* buffer = dynamic_cast<ArrayBuffer*>(first);
+    if (buffer != NULL) {
+        size_t elementSize = sizeof(typename T::ElementType);
+        size_t byteOffset = toIndex(argumentCount > 1 ? arguments[1] : NULL);
+        if (byteOffset % elementSize != 0 || byteOffset > buffer->getByteLength()) {
+            throw RangeError;
+        }
+        size_t length;
+        if (argumentCount > 2 && getValue(arguments[2])->getType() != undefined) {
+            length = toIndex(arguments[2]);
+            if (byteOffset + length * elementSize > buffer->getByteLength()) {
+                throw RangeError;
+            }
+        } else {
+            if ((buffer->getByteLength() - byteOffset) % elementSize != 0) {
+                throw RangeError;
+            }
+            length = (buffer->getByteLength() - byteOffset) / elementSize;
+        }
+        return new T(buffer, byteOffset, length);
+    }
+
+    TypedArray* source = dynamic_cast<TypedArray*>(first);
+    if (source != NULL) {
+        T* result = new T(source->getLength());
+        for (size_t i = 0; i < source->getLength(); i++) {
+            result->setNumber(i, source->getNumber(i));
+        }
+        return result;
+    }
+
+    ESArray* array = dynamic_cast<ESArray*>(first);
+    if (array != NULL) {
+        T* result = new T(array->getLength());
+        for (size_t i = 0; i < array->getLength(); i++) {
+            result->setNumber(i, TypeOps::toNumber(array->getElement(i))->getValue());
+        }
+        return result;
+    }
+    return new T(0);
+}
+
+ESValue* Core::construct(ESValue* constructorRef, ESValue** arguments, int argumentCount) {
+    Reference* ref = dynamic_cast<Reference*>(constructorRef);
+    if (ref == NULL) {
+        throw TypeError;
+    }
+    std::string name = ref->getReferencedName()->getValue();
+
+    if (name == "ArrayBuffer") {
+        return new ArrayBuffer(toIndex(argumentCount > 0 ? arguments[0] : NULL));
+    }
+    if (name == "Uint8Array") {
+        return constructTypedArray<Uint8Array>(arguments, argumentCount);
+    }
+    if (name == "Int32Array") {
+        return constructTypedArray<Int32Array>(arguments, argumentCount);
+    }
+    if (name == "Float64Array") {
+        return constructTypedArray<Float64Array>(arguments, argumentCount);
+    }
+    if (name == "Promise") {
+        return Promise::construct(arguments, argumentCount);
+    }
+    ClassConstructor* constructor = dynamic_cast<ClassConstructor*>(getValue(ref));
+    if (constructor != NULL) {
+        return constructor->construct(arguments, argumentCount);
+    }
+    throw TypeError;
+}
+
+ESValue* Core::call(ESValue* calleeRef, ESValue** arguments, int argumentCount) {
+    Function* function = dynamic_cast<Function*>(getValue(calleeRef));
+    if (function == NULL || !function->isCallable()) {
+        throw TypeError;
+    }
+    // 12.3.6.1 ArgumentListEvaluation, in place: the array is the call's own
+    for (int i = 0; i < argumentCount; i++) {
+        arguments[i] = getValue(arguments[i]);
+    }
+    return getValue(function->call(arguments, argumentCount));
+}
+
+size_t Core::toIndex(ESValue* argument) {
+    if (argument == NULL || argument->getType() == undefined) {
+        return 0;
+    }
+    double value = TypeOps::toNumber(getValue(argument))->getValue();
+    if (value != value) {
+        return 0;
+    }
+    value = value < 0 ? ceil(value) : floor(value);
+    if (value < 0 || value > 9007199254740991.0) {
+        throw RangeError;
+    }
+    return (size_t)value;
+}
+
+double Core::toInteger(ESValue* argument) {
+    double value = TypeOps::toNumber(getValue(argument))->getValue();
+    if (value != value) {
+        return 0;
+    }
+    return value < 0 ? ceil(value) : floor(value);
+}
+
+size_t Core::toRelativeIndex(ESValue** arguments, int argumentCount, int position, size_t length,
+                             size_t defaultIndex) {
+    if (position >= argumentCount || getValue(arguments[position])->getType() == undefined) {
+        return defaultIndex;
+    }
+    double relative = toInteger(arguments[position]);
+    if (relative < 0) {
+        return relative + length < 0 ? 0 : (size_t)(relative + length);
+    }
+    return relative > length ? length : (size_t)relative;
+}
+
+TypedArray* Core::createTypedArray(TypedArrayType type, size_t length) {
+    switch (type) {
+        case uint8Array:
+            return new Uint8Array(length);
+        case int32Array:
+            return new Int32Array(length);
+        default:
+            return new Float64Array(length);
+    }
+}
+
+TypedArray* Core::createTypedArray(TypedArrayType type, ArrayBuffer* buffer, size_t byteOffset, size_t length) {
+    switch (type) {
+        case uint8Array:
+            return new Uint8Array(buffer, byteOffset, length);
+        case int32Array:
+            return new Int32Array(buffer, byteOffset, length);
+        default:
+            return new Float64Array(buffer, byteOffset, length);
+    }
+}
+
+ESValue* Core::callMethod(ESValue* baseRef, const char* name, ESValue** arguments, int argumentCount) {
+    ESValue* base = getValue(baseRef);
+    std::string method(name);
+
+    TypedArray* typed = dynamic_cast<TypedArray*>(base);
+    if (typed != NULL) {
+        return callTypedArrayMethod(typed, method, arguments, argumentCount);
+    }
+    ESArray* array = dynamic_cast<ESArray*>(base);
+    if (array != NULL) {
+        return callArrayMethod(array, method, arguments, argumentCount);
+    }
+    Generator* generator = dynamic_cast<Generator*>(base);
+    if (generator != NULL) {
+        return Generator::callMethod(generator, method, arguments, argumentCount);
+    }
+    Promise* promise = dynamic_cast<Promise*>(base);
+    if (promise != NULL) {
+        return Promise::callMethod(promise, method, arguments, argumentCount);
+    }
+    Function* constructor = dynamic_cast<Function*>(base);
+    if (constructor != NULL && !constructor->isCallable() && strcmp(constructor->getName(), "Promise") == 0) {
+        return Promise::callConstructorMethod(method, arguments, argumentCount);
+    }
+    ClassInstance* instance = dynamic_cast<ClassInstance*>(base);
+    if (instance != NULL) {
+        MethodCache cache = {NULL, NULL};
+        return ClassInstance::callMethod(instance, name, arguments, argumentCount, &cache);
+    }
+    throw TypeError;
+}
+
+ESValue* Core::callMethod(ESValue* baseRef, const char* name, ESValue** arguments, int argumentCount,
+                          MethodCache* cache) {
+    ESValue* base = getValue(baseRef);
+    ClassInstance* instance = dynamic_cast<ClassInstance*>(base);
+    if (instance != NULL) {
+        return ClassInstance::callMethod(instance, name, arguments, argumentCount, cache);
+    }
+    return callMethod(base, name, arguments, argumentCount);
+}
+
+ESValue* Core::callTypedArrayMethod(TypedArray* typed, const std::string& method, ESValue** arguments,
+                                    int argumentCount) {
+    size_t length = typed->getLength();
+    ESValue* first = argumentCount > 0 ? getValue(arguments[0]) : new Undefined();
+
+    if (method == "fill") {
+        double value = TypeOps::toNumber(first)->getValue();
+        size_t start = toRelativeIndex(arguments, argumentCount, 1, length, 0);
+        size_t end = toRelativeIndex(arguments, argumentCount, 2, length, length);
+        if (start < end) {
+            switch (typed->getTypedArrayType()) {
+                case uint8Array:
+                    Simd::fill(static_cast<Uint8Array*>(typed)->getElements() + start, end - start,
+                               Uint8Array::toElement(value));
+                    break;
+                case int32Array:
+                    Simd::fill(static_cast<Int32Array*>(typed)->getElements() + start, end - start,
+                               Int32Array::toElement(value));
+                    break;
+                case float64Array:
+                    Simd::fill(static_cast<Float64Array*>(typed)->getElements() + start, end - start, value);
+                    break;
+            }
+        }
+        return typed;
+    }
+
+    if (method == "set") {
+        double offset = argumentCount > 1 ? toInteger(arguments[1]) : 0;
+        if (offset < 0) {
+            throw RangeError;
+        }
+        TypedArray* source = dynamic_cast<TypedArray*>(first);
+        ESArray* array = dynamic_cast<ESArray*>(first);
+        size_t sourceLength = source != NULL ? source->getLength() : array != NULL ? array->getLength() : 0;
+        if (offset + sourceLength > length) {
+            throw RangeError;
+        }
+        size_t target = (size_t)offset;
+        if (source != NULL && source->getTypedArrayType() == typed->getTypedArrayType()) {
+            size_t elementSize = typed->getElementSize();
+            Simd::copy((unsigned char*)typed->getData() + target * elementSize, source->getData(),
+                       sourceLength * elementSize);
+        } else if (source != NULL) {
+            // the source may be a view on the same buffer, so it is read completely before any store
+            std::vector<double> values(sourceLength);
+            for (size_t i = 0; i < sourceLength; i++) {
+                values[i] = source->getNumber(i);
+            }
+            for (size_t i = 0; i < sourceLength; i++) {
+                typed->setNumber(target + i, values[i]);
+            }
+        } else if (array != NULL) {
+            for (size_t i = 0; i < sourceLength; i++) {
+                typed->setNumber(target + i, TypeOps::toNumber(array->getElement(i))->getValue());
+            }
+        }
+        return new Undefined();
+    }
+
+    if (method == "subarray" || method == "slice") {
+        size_t begin = toRelativeIndex(arguments, argumentCount, 0, length, 0);
+        size_t end = toRelativeIndex(arguments, argumentCount, 1, length, length);
+        size_t count = end > begin ? end - begin : 0;
+        size_t elementSize = typed->getElementSize();
+        if (method == "subarray") {
+            return createTypedArray(typed->getTypedArrayType(), typed->getBuffer(),
+                                    typed->getByteOffset() + begin * elementSize, count);
+        }
+        TypedArray* result = createTypedArray(typed->getTypedArrayType(), count);
+        Simd::copy(result->getData(), (unsigned char*)typed->getData() + begin * elementSize, count * elementSize);
+        return result;
+    }
+
+    if (method == "indexOf" || method == "includes") {
+        bool includes = method == "includes";
+        size_t from = toRelativeIndex(arguments, argumentCount, 1, length, 0);
+        ptrdiff_t index = -1;
+        if (first->getType() == number && from < length) {
+            double value = dynamic_cast<Number*>(first)->getValue();
+            switch (typed->getTypedArrayType()) {
+                case uint8Array:
+                    if (value >= 0 && value <= 255 && value == (double)(int)value) {
+                        index = Simd::indexOf(static_cast<Uint8Array*>(typed)->getElements() + from,
+                                              length - from, (unsigned char)value);
+                    }
+                    break;
+                case int32Array:
+                    if (value >= -2147483648.0 && value <= 2147483647.0 && value == (double)(int)value) {
+                        index = Simd::indexOf(static_cast<Int32Array*>(typed)->getElements() + from,
+                                              length - from, (int)value);
+                    }
+                    break;
+                case float64Array: {
+                    double* elements = static_cast<Float64Array*>(typed)->getElements() + from;
+                    index = includes && value != value ? Simd::indexOfNaN(elements, length - from)
+                                                       : Simd::indexOf(elements, length - from, value);
+                    break;
+                }
+            }
+        }
+        if (includes) {
+            return new Boolean(index >= 0);
+        }
+        return new Number(index >= 0 ? (double)(index + from) : -1);
+    }
+
+    if (method == "map") {
+        return mapCallback(typed, arguments, argumentCount);
+    }
+
+    if (method == "reduce") {
+        return reduceCallback(typed, arguments, argumentCount);
+    }
+
+    throw TypeError;
+}
+
+ESValue* Core::callArrayMethod(ESArray* array, const std::string& method, ESValue** arguments,
+                               int argumentCount) {
+    size_t length = array->getLength();
+    ESValue* first = argumentCount > 0 ? getValue(arguments[0]) : new Undefined();
+
+    if (method == "fill") {
+        size_t start = toRelativeIndex(arguments, argumentCount, 1, length, 0);
+        size_t end = toRelativeIndex(arguments, argumentCount, 2, length, length);
+        if (start >= end) {
+            return array;
+        }
+        // storing the first element moves the array to a kind that can hold the value
+        array->setElement(start, first);
+        switch (array->getElementsKind()) {
+            case packedInt32:
+                Simd::fill(array->getInt32Elements() + start, end - start,
+                           (int)dynamic_cast<Number*>(first)->getValue());
+                break;
+            case packedDouble:
+                Simd::fill(array->getDoubleElements() + start, end - start,
+                           dynamic_cast<Number*>(first)->getValue());
+                break;
+            case packedGeneric:
+                std::fill(array->getGenericElements() + start, array->getGenericElements() + end, first);
+                array->elementsBarrier(start, end);
+                break;
+        }
+        return array;
+    }
+
+    if (method == "slice") {
+        size_t begin = toRelativeIndex(arguments, argumentCount, 0, length, 0);
+        size_t end = toRelativeIndex(arguments, argumentCount, 1, length, length);
+        size_t count = end > begin ? end - begin : 0;
+        switch (array->getElementsKind()) {
+            case packedInt32:
+                return new ESArray(array->getInt32Elements() + begin, count);
+            case packedDouble:
+                return new ESArray(array->getDoubleElements() + begin, count);
+            default:
+                return new ESArray(array->getGenericElements() + begin, count);
+        }
+    }
+
+    if (method == "indexOf" || method == "includes") {
+        bool includes = method == "includes";
+        size_t from = toRelativeIndex(arguments, argumentCount, 1, length, 0);
+        ptrdiff_t index = -1;
+        if (from < length) {
+            double value = first->getType() == number ? dynamic_cast<Number*>(first)->getValue() : 0;
+            switch (array->getElementsKind()) {
+                case packedInt32:
+                    if (first->getType() == number && value >= -2147483648.0 && value <= 2147483647.0
+                        && value == (double)(int)value) {
+                        index = Simd::indexOf(array->getInt32Elements() + from, length - from, (int)value);
+                    }
+                    break;
+                case packedDouble:
+                    if (first->getType() == number) {
+                        double* elements = array->getDoubleElements() + from;
+                        index = includes && value != value ? Simd::indexOfNaN(elements, length - from)
+                                                           : Simd::indexOf(elements, length - from, value);
+                    }
+                    break;
+                case packedGeneric: {
+                    ESValue** elements = array->getGenericElements();
+                    bool nan = includes && first->getType() == number && value != value;
+                    for (size_t i = from; i < length && index < 0; i++) {
+                        if (strictEqualityComparison(elements[i], first)
+                            || (nan && elements[i]->getType() == number
+                                && dynamic_cast<Number*>(elements[i])->getValue() != dynamic_cast<Number*>(elements[i])->getValue())) {
+                            index = i - from;
+                        }
+                    }
+                    break;
+                }
+            }
+        }
+        if (includes) {
+            return new Boolean(index >= 0);
+        }
+        return new Number(index >= 0 ? (double)(index + from) : -1);
+    }
+
+    if (method == "map") {
+        return mapCallback(array, arguments, argumentCount);
+    }
+
+    if (method == "reduce") {
+        return reduceCallback(array, arguments, argumentCount);
+    }
+
+    throw TypeError;
+}
+
+double Core::mathMinMax(double x, double y, bool maximum) {
+    if (x != x || y != y) {
+        return NAN;
+    }
+    if (x == 0 && y == 0) {
+        return std::signbit(x) == maximum ? y : x;
+    }
+    return maximum ? (x > y ? x : y) : (x < y ? x : y);
+}
+
+ESValue* Core::reduce(ESValue* baseRef, ReduceOperation operation, ESValue* callback, ESValue* initialRef) {
+    ESValue* base = getValue(baseRef);
+    TypedArray* typed = dynamic_cast<TypedArray*>(base);
+    ESArray* array = dynamic_cast<ESArray*>(base);
+    if (typed == NULL && array == NULL) {
+        ESValue* arguments[] = {callback, initialRef};
+        return callMethod(base, "reduce", arguments, initialRef != NULL ? 2 : 1);
+    }
+    size_t length = typed != NULL ? typed->getLength() : array->getLength();
+    if (length == 0 && initialRef == NULL) {
+        throw TypeError;
+    }
+    if (length == 0) {
+        return getValue(initialRef);
+    }
+
+    if (array != NULL && array->getElementsKind() == packedGeneric) {
+        ESValue* result = initialRef != NULL ? getValue(initialRef) : array->getElement(0);
+        for (size_t i = initialRef != NULL ? 0 : 1; i < length; i++) {
+            if (operation == reduceSum) {
+                result = plus(result, array->getElement(i));
+            } else {
+                result = new Number(mathMinMax(TypeOps::toNumber(result)->getValue(),
+                                               TypeOps::toNumber(array->getElement(i))->getValue(),
+                                               operation == reduceMax));
+            }
+        }
+        return result;
+    }
+
+    const double* doubles = NULL;
+    const int* ints = NULL;
+    const unsigned char* bytes = NULL;
+    if (typed != NULL) {
+        switch (typed->getTypedArrayType()) {
+            case uint8Array:
+                bytes = static_cast<Uint8Array*>(typed)->getElements();
+                break;
+            case int32Array:
+                ints = static_cast<Int32Array*>(typed)->getElements();
+                break;
+            case float64Array:
+                doubles = static_cast<Float64Array*>(typed)->getElements();
+                break;
+        }
+    } else if (array->getElementsKind() == packedInt32) {
+        ints = array->getInt32Elements();
+    } else {
+        doubles = array->getDoubleElements();
+    }
+
+    bool hasInitial = initialRef != NULL;
+    double initial = hasInitial ? TypeOps::toNumber(getValue(initialRef))->getValue() : 0;
+
+    if (operation == reduceSum) {
+        if (doubles != NULL) {
+            return new Number(hasInitial ? Simd::sum(doubles, length, initial)
+                                         : Simd::sum(doubles + 1, length - 1, doubles[0]));
+        }
+        if (length < ((size_t)1 << 22) && (!hasInitial || initial == (double)(int)initial)) {
+            long long total = ints != NULL ? Simd::sum(ints, length) : Simd::sum(bytes, length);
+            return new Number((double)(total + (long long)initial));
+        }
+        double total = initial;
+        for (size_t i = 0; i < length; i++) {
+            total += ints != NULL ? ints[i] : bytes[i];
+        }
+        return new Number(total);
+    }
+
+    bool maximum = operation == reduceMax;
+    double folded;
+    if (doubles != NULL) {
+        folded = maximum ? Simd::max(doubles, length) : Simd::min(doubles, length);
+    } else if (ints != NULL) {
+        folded = maximum ? Simd::max(ints, length) : Simd::min(ints, length);
+    } else {
+        folded = bytes[0];
+        for (size_t i = 1; i < length; i++) {
+            folded = maximum ? std::max(folded, (double)bytes[i]) : std::min(folded, (double)bytes[i]);
+        }
+    }
+    return new Number(hasInitial ? mathMinMax(initial, folded, maximum) : folded);
+}
+
+ESValue* Core::mapArithmetic(ESValue* baseRef, MapOperation operation, double constant, bool constantOnLeft,
+                             ESValue* callback) {
+    ESValue* base = getValue(baseRef);
+
+    TypedArray* typed = dynamic_cast<TypedArray*>(base);
+    if (typed != NULL) {
+        size_t length = typed->getLength();
+        TypedArray* result = createTypedArray(typed->getTypedArrayType(), length);
+        switch (typed->getTypedArrayType()) {
+            case float64Array:
+                Simd::map(static_cast<Float64Array*>(typed)->getElements(),
+                          static_cast<Float64Array*>(result)->getElements(), length, operation, constant,
+                          constantOnLeft);
+                break;
+            case int32Array: {
+                std::vector<double> values(length);
+                Simd::map(static_cast<Int32Array*>(typed)->getElements(), values.data(), length, operation,
+                          constant, constantOnLeft);
+                int* elements = static_cast<Int32Array*>(result)->getElements();
+                for (size_t i = 0; i < length; i++) {
+                    elements[i] = Int32Array::toElement(values[i]);
+                }
+                break;
+            }
+            case uint8Array: {
+                unsigned char* source = static_cast<Uint8Array*>(typed)->getElements();
+                unsigned char* elements = static_cast<Uint8Array*>(result)->getElements();
+                for (size_t i = 0; i < length; i++) {
+                    elements[i] = Uint8Array::toElement(Simd::apply(operation, source[i], constant, constantOnLeft));
+                }
+                break;
+            }
+        }
+        return result;
+    }
+
+    ESArray* array = dynamic_cast<ESArray*>(base);
+    if (array == NULL) {
+        return callMethod(base, "map", &callback, 1);
+    }
+    size_t length = array->getLength();
+    if (array->getElementsKind() == packedGeneric) {
+        // stored into the result as they are computed: a vector from malloc would hide them from the collector.
+        // + concatenates when the element is a String, the other operators convert it to a Number.
+        ESArray* result = new ESArray();
+        for (size_t i = 0; i < length; i++) {
+            ESValue* element = array->getElement(i);
+            if (operation == mapAdd) {
+                ESValue* operand = new Number(constant);
+                result->setElement(i, constantOnLeft ? plus(operand, element) : plus(element, operand));
+            } else {
+                result->setElement(i, new Number(Simd::apply(operation, TypeOps::toNumber(element)->getValue(),
+                                                             constant, constantOnLeft)));
+            }
+        }
+        return result;
+    }
+
+    std::vector<double> values(length);
+    if (array->getElementsKind() == packedInt32) {
+        Simd::map(array->getInt32Elements(), values.data(), length, operation, constant, constantOnLeft);
+    } else {
+        Simd::map(array->getDoubleElements(), values.data(), length, operation, constant, constantOnLeft);
+    }
+    std::vector<int> ints;
+    ints.reserve(length);
+    for (size_t i = 0; i < length; i++) {
+        double value = values[i];
+        if (!(value >= -2147483648.0 && value <= 2147483647.0 && value == (double)(int)value)
+            || (value == 0 && std::signbit(value))) {
+            return new ESArray(values.data(), length);
+        }
+        ints.push_back((int)value);
+    }
+    return new ESArray(ints.data(), length);
+}
+
+/**
+ * The element at index of an array or typed array, as a value
+ */
+static ESValue* elementAt(ESValue* base, size_t index) {
+    TypedArray* typed = dynamic_cast<TypedArray*>(base);
+    if (typed != NULL) {
+        return new Number(typed->getNumber(index));
+    }
+    return static_cast<ESArray*>(base)->getElement(index);
+}
+
+ESValue* Core::mapCallback(ESValue* base, ESValue** arguments, int argumentCount) {
+    Function* callback = argumentCount > 0 ? dynamic_cast<Function*>(getValue(arguments[0])) : NULL;
+    if (callback == NULL || !callback->isCallable()) {
+        throw TypeError;
+    }
+    TypedArray* typed = dynamic_cast<TypedArray*>(base);
+    size_t length = typed != NULL ? typed->getLength() : static_cast<ESArray*>(base)->getLength();
+    // stored into the result as they are computed: a vector from malloc would hide them from the collector
+    TypedArray* typedResult = typed != NULL ? createTypedArray(typed->getTypedArrayType(), length) : NULL;
+    ESArray* result = typed == NULL ? new ESArray() : NULL;
+    for (size_t i = 0; i < length; i++) {
+        ESValue* callArguments[] = {elementAt(base, i), new Number((double)i), base};
+        ESValue* value = call(callback, callArguments, 3);
+        if (typedResult != NULL) {
+            typedResult->setNumber(i, TypeOps::toNumber(value)->getValue());
+        } else {
+            result->setElement(i, value);
+        }
+    }
+    if (typedResult != NULL) {
+        return typedResult;
+    }
+    return result;
+}
+
+ESValue* Core::reduceCallback(ESValue* base, ESValue** arguments, int argumentCount) {
+    Function* callback = argumentCount > 0 ? dynamic_cast<Function*>(getValue(arguments[0])) : NULL;
+    if (callback == NULL || !callback->isCallable()) {
+        throw TypeError;
+    }
+    TypedArray* typed = dynamic_cast<TypedArray*>(base);
+    size_t length = typed != NULL ? typed->getLength() : static_cast<ESArray*>(base)->getLength();
+    size_t i = 0;
+    ESValue* accumulator;
+    if (argumentCount > 1) {
+        accumulator = getValue(arguments[1]);
+    } else if (length == 0) {
+        throw TypeError;
+    } else {
+        accumulator = elementAt(base, i++);
+    }
+    for (; i < length; i++) {
+        ESValue* callArguments[] = {accumulator, elementAt(base, i), new Number((double)i), base};
+        accumulator = call(callback, callArguments, 4);
+    }
+    return accumulator;
+}
+
+int Core::switchTableIndex(ESValue* value, int low, int high) {
+    if (value->getType() != number) {
+        return -1;
+    }
+    Number* num = dynamic_cast<Number*>(value);
+    if (!num->isFinite()->getValue()) {
+        return -1;
+    }
+    double d = num->getValue();
+    if (d < low || d > high || d != (double)(int)d) {
+        return -1;
+    }
+    return (int)d - low;
+}
+
+int Core::switchHashSlot(ESValue* value, unsigned int seed, unsigned int mask) {
+    if (value->getType() != string_) {
+        return -1;
+    }
+    std::string str = dynamic_cast<String*>(value)->getValue();
+    return (int)(switchHash(str.data(), str.size(), seed) & mask);
+}
+
+bool Core::switchStringEquals(ESValue* value, const char* str) {
+    return dynamic_cast<String*>(value)->getValue() == str;
+}
+
+int Core::abstractRelationalComparison(ESValue* x, ESValue* y) {
+    ESValue* px = TypeOps::toPrimitive(x);
+    ESValue* py = TypeOps::toPrimitive(y);
+
+    if (px->getType() == string_ && py->getType() == string_) {
+        return dynamic_cast<String*>(px)->getValue() < dynamic_cast<String*>(py)->getValue() ? 1 : 0;
+    }
+
+    double nx = TypeOps::toNumber(px)->getValue();
+    double ny = TypeOps::toNumber(py)->getValue();
+    if (nx != nx || ny != ny) {
+        return -1;
+    }
+    return nx < ny ? 1 : 0;
+}
+
+bool Core::abstractEqualityComparison(ESValue* x, ESValue* y) {
+    Type xType = x->getType();
+    Type yType = y->getType();
+
+    if (xType == yType) {
+        return strictEqualityComparison(x, y);
+    }
+    if ((xType == null && yType == undefined) || (xType == undefined && yType == null)) {
+        return true;
+    }
+    if (xType == number && yType == string_) {
+        return strictEqualityComparison(x, TypeOps::toNumber(y));
+    }
+    if (xType == string_ && yType == number) {
+        return strictEqualityComparison(TypeOps::toNumber(x), y);
+    }
+    if (xType == boolean) {
+        return abstractEqualityComparison(TypeOps::toNumber(x), y);
+    }
+    if (yType == boolean) {
+        return abstractEqualityComparison(x, TypeOps::toNumber(y));
+    }
+    if ((xType == string_ || xType == number || xType == symbol) && yType == object) {
+        return abstractEqualityComparison(x, TypeOps::toPrimitive(y));
+    }
+    if (xType == object && (yType == string_ || yType == number || yType == symbol)) {
+        return abstractEqualityComparison(TypeOps::toPrimitive(x), y);
+    }
+    return false;
+}
+
+bool Core::strictEqualityComparison(ESValue* x, ESValue* y) {
+    Type xType = x->getType();
+
+    if (xType != y->getType()) {
+        return false;
+    }
+    switch (xType) {
+        case undefined:
+        case null:
+            return true;
+        case number:
+            // NaN is unequal to everything and +0 equals -0, which is exactly IEEE 754 ==
+            return dynamic_cast<Number*>(x)->getValue() == dynamic_cast<Number*>(y)->getValue();
+        case string_:
+            return dynamic_cast<String*>(x)->getValue() == dynamic_cast<String*>(y)->getValue();
+        case boolean:
+            return dynamic_cast<Boolean*>(x)->getValue() == dynamic_cast<Boolean*>(y)->getValue();
+        case symbol:
+            return dynamic_cast<Symbol*>(x)->getValue() == dynamic_cast<Symbol*>(y)->getValue();
+        case object:
+            return x == y;
+        case reference:
+            return false;
+    }
+    return false;
+}
+
+bool Core::lessThan(ESValue* lref, ESValue* rref) {
+    return abstractRelationalComparison(getValue(lref), getValue(rref)) == 1;
+}
+
+bool Core::greaterThan(ESValue* lref, ESValue* rref) {
+    return abstractRelationalComparison(getValue(rref), getValue(lref)) == 1;
+}
+
+bool Core::lessThanOrEqual(ESValue* lref, ESValue* rref) {
+    return abstractRelationalComparison(getValue(rref), getValue(lref)) == 0;
+}
+
+bool Core::greaterThanOrEqual(ESValue* lref, ESValue* rref) {
+    return abstractRelationalComparison(getValue(lref), getValue(rref)) == 0;
+}
+
+bool Core::equals(ESValue* lref, ESValue* rref) {
+    return abstractEqualityComparison(getValue(lref), getValue(rref));
+}
+
+bool Core::notEquals(ESValue* lref, ESValue* rref) {
+    return !abstractEqualityComparison(getValue(lref), getValue(rref));
+}
+
+bool Core::strictEquals(ESValue* lref, ESValue* rref) {
+    return strictEqualityComparison(getValue(lref), getValue(rref));
+}
+
+bool Core::strictNotEquals(ESValue* lref, ESValue* rref) {
+    return !strictEqualityComparison(getValue(lref), getValue(rref));
+}
@@ -4,259 +4,391 @@
 #pragma once
 
 #include "../type/type.hpp"
+#include "../type/conversion.hpp"
 #include "../scope/reference.hpp"
-#include <stdio.h>
-#include <stdlib.h>
-#include <cstdio>
+#include "simd.hpp"
+#include <cmath>
+#include <string>
+#include <type_traits>
+
+struct MethodCache;
 
 enum Exception {
     ReferenceError,
-    TypeError
+    TypeError,
+    RangeError
+};
+
+/**
+ * Folds the compiler recognises in a reduce callback: (a, b) => a + b, (a, b) => Math.min(a, b) and Math.max
+ */
+enum ReduceOperation {
+    reduceSum,
+    reduceMin,
+    reduceMax
 };
 
-extern ESObject* globalObj;
+/**
+ * What the compiler knows about an operand, for the operators specialised on it. AnyTag is a value of unknown type,
+ * possibly still a Reference; NumberTag and StringTag are values that are a Number or a String.
+ */
+struct AnyTag {};
+struct NumberTag {};
+struct StringTag {};
+
+/**
+ * The global object of the code this thread runs: the static one a program points it at, or that of the Isolate the
+ * thread has entered
+ */
+extern __thread ESObject* globalObj;
 
 class Core {
 public:
-    static bool zeroFlag;
     /**
      * 12.7.3 The Addition operator ( + )
      * http://www.ecma-international.org/ecma-262/6.0/#sec-addition-operator-plus
+     * Operands of known type skip GetValue and ToPrimitive, two Numbers are a double addition and a String on
+     * either side is a concatenation.
      */
+    template <typename LeftTag, typename RightTag>
     static ESValue* plus(ESValue* lref, ESValue* rref) {
-
-        Number* lnum = TypeOps::toNumber(lref);
-        Number* rnum = TypeOps::toNumber(rref);
-
-        // If either operand is NaN, the result is NaN.
-        if (lnum->isNan()->getValue() || lnum->isNan()->getValue()) {
-            return new NaN();
+        if constexpr (std::is_same<LeftTag, NumberTag>::value && std::is_same<RightTag, NumberTag>::value) {
+            return new Number(numberOperand<LeftTag>(lref) + numberOperand<RightTag>(rref));
+        } else if constexpr (std::is_same<LeftTag, StringTag>::value || std::is_same<RightTag, StringTag>::value) {
+            return new String(stringOperand<LeftTag>(lref) + stringOperand<RightTag>(rref));
+        } else {
+            ESValue* lprim = primitiveOperand<LeftTag>(lref);
+            ESValue* rprim = primitiveOperand<RightTag>(rref);
+            if (lprim->getType() == string_ || rprim->getType() == string_) {
+                return new String(TypeOps::toString(lprim)->getValue() + TypeOps::toString(rprim)->getValue());
+            }
+            return new Number(TypeOps::toNumber(lprim)->getValue() + TypeOps::toNumber(rprim)->getValue());
         }
-
-        return new Number(lnum->getValue() + rnum->getValue());
     }
 
+    static ESValue* plus(ESValue* lref, ESValue* rref);
 
     /**
      * 12.7.4 The Subtraction Operator ( - )
      * http://www.ecma-international.org/ecma-262/6.0/#sec-subtraction-operator-minus
      */
+    template <typename LeftTag, typename RightTag>
     static ESValue* subtract(ESValue* lref, ESValue* rref) {
-
-        Number* lnum = TypeOps::toNumber(lref);
-        Number* rnum = TypeOps::toNumber(rref);
-
-        // If either operand is NaN, the result is NaN.
-        if (lnum->isNan()->getValue() || lnum->isNan()->getValue()) {
-            return new NaN();
-        }
-
-        return new Number(lnum->getValue() - rnum->getValue());
-
+        return new Number(numberOperand<LeftTag>(lref) - numberOperand<RightTag>(rref));
     }
 
+    static ESValue* subtract(ESValue* lref, ESValue* rref);
+
     /**
      * 12.6.3.1 Applying the * Operator
      * http://www.ecma-international.org/ecma-262/6.0/#sec-applying-the-mul-operator
      */
+    template <typename LeftTag, typename RightTag>
     static ESValue* multiply(ESValue* lref, ESValue* rref) {
-
-        Number* lnum = TypeOps::toNumber(lref);
-        Number* rnum = TypeOps::toNumber(rref);
-
-        // If either operand is NaN, the result is NaN.
-        if (lnum->isNan()->getValue() || lnum->isNan()->getValue()) {
-            return new NaN();
-        }
-
-        return new Number(lnum->getValue() * rnum->getValue());
-
+        return new Number(numberOperand<LeftTag>(lref) * numberOperand<RightTag>(rref));
     }
 
+    static ESValue* multiply(ESValue* lref, ESValue* rref);
+
     /**
      * 12.6.3.2 Applying the / Operator
      * http://www.ecma-international.org/ecma-262/6.0/#sec-applying-the-div-operator
      */
+    template <typename LeftTag, typename RightTag>
     static ESValue* divide(ESValue* lref, ESValue* rref) {
-
-        Number* lnum = TypeOps::toNumber(lref);
-        Number* rnum = TypeOps::toNumber(rref);
-
-        // If either operand is NaN, the result is NaN.
-        if (lnum->isNan()->getValue() || lnum->isNan()->getValue()) {
-            return new NaN();
-        }
-
-        return new Number(lnum->getValue() / rnum->getValue());
-
+        return new Number(numberOperand<LeftTag>(lref) / numberOperand<RightTag>(rref));
     }
 
+    static ESValue* divide(ESValue* lref, ESValue* rref);
+
     /**
      * 12.6.3.3 Applying the % Operator
      * http://www.ecma-international.org/ecma-262/6.0/#sec-applying-the-mod-operator
+     * The remainder takes the sign of the dividend and truncates the quotient, which is C's fmod: NaN for an
+     * infinite dividend or a zero divisor, and the dividend itself for an infinite divisor or a zero dividend.
      */
+    template <typename LeftTag, typename RightTag>
     static ESValue* modulo(ESValue* lref, ESValue* rref) {
+        return new Number(std::fmod(numberOperand<LeftTag>(lref), numberOperand<RightTag>(rref)));
+    }
 
-        // lnum is the dividend
-        Number* lnum = TypeOps::toNumber(lref);
-        // rnum is the divisor
-        Number* rnum = TypeOps::toNumber(rref);
+    static ESValue* modulo(ESValue* lref, ESValue* rref);
 
-        // If either operand is NaN, the result is NaN.
-        if (lnum->isNan()->getValue() || lnum->isNan()->getValue()) {
-            return new NaN();
+    /**
+     * GetValue then ToNumber of an operand, only the load for one known to be a Number
+     */
+    template <typename Tag>
+    static double numberOperand(ESValue* operand) {
+        if constexpr (std::is_same<Tag, NumberTag>::value) {
+            return static_cast<Number*>(operand)->getValue();
+        } else if constexpr (std::is_same<Tag, StringTag>::value) {
+            return NumberConversion::stringToNumber(static_cast<String*>(operand)->getValue());
+        } else {
+            return TypeOps::toNumber(getValue(operand))->getValue();
         }
+    }
 
-        // If the dividend is finite and the divisor is an infinity, the result equals the dividend.
-        if (lnum->isFinite()->getValue() && rnum->isInfinity()->getValue()) {
-            return lnum;
+    /**
+     * GetValue then ToString of an operand, only the load for one known to be a String
+     */
+    template <typename Tag>
+    static std::string stringOperand(ESValue* operand) {
+        if constexpr (std::is_same<Tag, StringTag>::value) {
+            return static_cast<String*>(operand)->getValue();
+        } else if constexpr (std::is_same<Tag, NumberTag>::value) {
+            return operand->toString()->getValue();
+        } else {
+            return TypeOps::toString(TypeOps::toPrimitive(getValue(operand)))->getValue();
         }
+    }
 
-        // If the dividend is a zero and the divisor is nonzero and finite, the result is the same as the dividend.
-        if (lnum->getValue() == 0 && (rnum->getValue() != 0 && rnum->isFinite())) {
-            return lnum;
+    /**
+     * GetValue then ToPrimitive of an operand, which an operand of known type already is
+     */
+    template <typename Tag>
+    static ESValue* primitiveOperand(ESValue* operand) {
+        if constexpr (std::is_same<Tag, AnyTag>::value) {
+            return TypeOps::toPrimitive(getValue(operand));
+        } else {
+            return operand;
         }
+    }
 
-        // In the remaining cases, where neither an infinity, nor a zero, nor NaN is involved,
-        // the floating-point remainder r from a dividend n and a divisor d is defined by the
-        // mathematical relation r = n − (d × q) where q is an integer that is negative only
-        // if n/d is negative and positive only if n/d is positive, and whose magnitude is as
-        // large as possible without exceeding the magnitude of the true mathematical quotient
-        // of n and d. r is computed and rounded to the nearest representable value using
-        // IEEE 754-2008 round-to-nearest mode.
-        double a = lnum->getValue();
-        double b = rnum->getValue();
-        return new Number(a - (b * (a / b)));
+    /**
+     * 12.14.4 Runtime Semantics: Evaluation of LeftHandSideExpression = AssignmentExpression
+     * http://www.ecma-international.org/ecma-262/6.0/#sec-assignment-operators-runtime-semantics-evaluation
+     * The value stored is GetValue of the right hand side, never the reference itself.
+     */
+    static ESValue* assign(ESValue* v, ESValue* w);
 
-    }
+    /**
+     * 6.2.3.1 GetValue (V)
+     * http://www.ecma-international.org/ecma-262/6.0/#sec-getvalue
+     * Every binding currently lives on globalObj, so a reference is resolved against it.
+     */
+    static ESValue* getValue(ESValue* v);
 
-    static ESValue* assign(ESValue* v, ESValue* w) {
-        if (v->getType() == reference) {
-            Reference* ref = dynamic_cast<Reference*>(v);
+    /**
+     * 8.1.1.1.6 GetBindingValue (N, S) of a let or const the compiler could not prove initialised: binding is its C
+     * local, which is NULL in the temporal dead zone before its declaration runs
+     */
+    static ESValue* initializedBinding(ESValue* binding);
 
-            if (ref != NULL) {
-                return globalObj->set(ref->getReferencedName(), w);
-            }
+    /**
+     * 8.1.1.1.5 SetMutableBinding (N, V, S) of a const: a ReferenceError in its temporal dead zone and a TypeError
+     * after it, as assigning an immutable binding is in strict code
+     */
+    static void assignConstant(ESValue* binding);
 
-            throw TypeError;
+    /**
+     * 12.3.2.1 Runtime Semantics: Evaluation of MemberExpression [ Expression ], followed by GetValue
+     * http://www.ecma-international.org/ecma-262/6.0/#sec-property-accessors-runtime-semantics-evaluation
+     * Integer indices into a typed array are a bounds checked native load of the element.
+     */
+    static ESValue* getElement(ESValue* baseRef, ESValue* keyRef);
 
-        } else {
-            throw ReferenceError;
+    /**
+     * 13.3.3.6 IteratorBindingInitialization of an ArrayBindingPattern
+     * http://www.ecma-international.org/ecma-262/6.0/#sec-runtime-semantics-iteratorbindinginitialization
+     * The first count elements of source into slots, undefined past its end, and the elements after them into a
+     * new array in rest unless it is NULL. An array or a typed array is read in place, anything else through its
+     * iterator, see Generator::iterate.
+     */
+    static void destructureArray(ESValue* sourceRef, ESValue** slots, size_t count, ESValue** rest);
+
+    /**
+     * 13.3.3.7 KeyedBindingInitialization of an ObjectBindingPattern: the property name of source, undefined when
+     * it has none. A plain object is one lookup in its property map, destructuring undefined or null is a TypeError.
+     */
+    static ESValue* destructureProperty(ESValue* sourceRef, const char* name);
+
+    /**
+     * 13.3.2.4 var name without an initialiser: the binding is created undefined unless it exists
+     */
+    static void declareVariable(const char* name);
+
+    /**
+     * 12.14.4 Runtime Semantics: Evaluation of an assignment to MemberExpression [ Expression ]
+     * Integer indices into a typed array are a bounds checked native store, stores outside the view are dropped.
+     */
+    static ESValue* setElement(ESValue* baseRef, ESValue* keyRef, ESValue* value);
+
+    /**
+     * 12.3.3.1 Runtime Semantics: Evaluation of new MemberExpression Arguments
+     * The built-in constructors are resolved by name, anything else must be a class the script declared.
+     */
+    static ESValue* construct(ESValue* constructorRef, ESValue** arguments, int argumentCount);
+
+    /**
+     * 12.3.4.1 Runtime Semantics: Evaluation of a call whose callee is not a property reference.
+     * The callee is a function a script declared, anything else is a TypeError. A function returns the register of
+     * its return statement, which may still be a Reference.
+     */
+    static ESValue* call(ESValue* calleeRef, ESValue** arguments, int argumentCount);
+
+    /**
+     * 7.1.17 ToIndex, a missing argument is 0
+     */
+    static size_t toIndex(ESValue* argument);
+
+    /**
+     * 22.2.4 The TypedArray Constructors: new T(length), new T(typedArrayOrArray) and
+     * new T(buffer [, byteOffset [, length]])
+     */
+    template <class T>
+    static ESValue* constructTypedArray(ESValue** arguments, int argumentCount);
+
+    /**
+     * 7.1.4 ToInteger
+     */
+    static double toInteger(ESValue* argument);
+
+    /**
+     * The relative start and end arguments of fill, slice and subarray: negative values count back from the end
+     * and the result is clamped to [0, length]. A missing or undefined argument is defaultIndex.
+     */
+    static size_t toRelativeIndex(ESValue** arguments, int argumentCount, int position, size_t length,
+                                  size_t defaultIndex);
+
+    static TypedArray* createTypedArray(TypedArrayType type, size_t length);
+
+    static TypedArray* createTypedArray(TypedArrayType type, ArrayBuffer* buffer, size_t byteOffset, size_t length);
+
+    /**
+     * Built-in methods called as base.name(arguments): those of typed arrays, arrays, generators and promises, and the
+     * functions of the Promise constructor. map and reduce with a callback the compiler does not lower to
+     * Core::mapArithmetic or Core::reduce call it through Core::call, see mapCallback and reduceCallback. The methods
+     * of a class instance are looked up on every call.
+     */
+    static ESValue* callMethod(ESValue* baseRef, const char* name, ESValue** arguments, int argumentCount);
+
+    /**
+     * base.name(arguments) at a call site whose name is a method of a class the script declares: an instance of a
+     * class goes through the inline cache of the call site, see ClassInstance::callMethod, anything else to the
+     * built-in methods
+     */
+    static ESValue* callMethod(ESValue* baseRef, const char* name, ESValue** arguments, int argumentCount,
+                               MethodCache* cache);
+
+    /**
+     * 22.2.3 Properties of the %TypedArrayPrototype% Object: fill, set, subarray, slice, indexOf, includes, map and
+     * reduce
+     */
+    static ESValue* callTypedArrayMethod(TypedArray* typed, const std::string& method, ESValue** arguments,
+                                         int argumentCount);
+
+    /**
+     * 22.1.3 Properties of the Array Prototype Object: fill, slice, indexOf, includes, map and reduce. Packed int32
+     * and double elements use the same kernels as typed arrays, generic elements are compared one by one.
+     */
+    static ESValue* callArrayMethod(ESArray* array, const std::string& method, ESValue** arguments,
+                                    int argumentCount);
+
+    /**
+     * 20.2.2.24 Math.min ( value1, value2 ) and 20.2.2.25 Math.max ( value1, value2 )
+     */
+    static double mathMinMax(double x, double y, bool maximum);
+
+    /**
+     * 22.1.3.18 Array.prototype.reduce and 22.2.3.20 %TypedArray%.prototype.reduce for the folds in
+     * ReduceOperation. initialRef is NULL when no initial value was passed. Integer elements are summed
+     * exactly, which equals the sequential double fold while partial sums stay below 2^53. The compiler lowers
+     * base.reduce(callback) by the name of the method alone, so any other base calls its own reduce with callback.
+     */
+    static ESValue* reduce(ESValue* baseRef, ReduceOperation operation, ESValue* callback, ESValue* initialRef);
+
+    /**
+     * 22.1.3.15 Array.prototype.map and 22.2.3.18 %TypedArray%.prototype.map for a callback of the form
+     * x => x op constant (or constant op x). Typed arrays map into a new array of the same type, arrays keep int32
+     * elements when every result is one. Generic elements go through the operator itself, so + concatenates Strings.
+     * Any other base calls its own map with callback, as reduce does.
+     */
+    static ESValue* mapArithmetic(ESValue* baseRef, MapOperation operation, double constant, bool constantOnLeft,
+                                  ESValue* callback);
+
+    /**
+     * 22.1.3.15 Array.prototype.map and 22.2.3.18 %TypedArray%.prototype.map for any other callback, called through
+     * Core::call with the element, its index and the array. A typed array maps into a new array of its type.
+     */
+    static ESValue* mapCallback(ESValue* base, ESValue** arguments, int argumentCount);
+
+    /**
+     * 22.1.3.18 Array.prototype.reduce and 22.2.3.20 %TypedArray%.prototype.reduce for any other callback, called
+     * through Core::call with the accumulator, the element, its index and the array
+     */
+    static ESValue* reduceCallback(ESValue* base, ESValue** arguments, int argumentCount);
+
+    /**
+     * Jump table dispatch for a switch whose case labels are all dense integer literals.
+     * Returns the offset of value from low when it is strictly equal to an integer in [low, high],
+     * or -1 when no case label can match (different type, NaN, infinite or fractional value).
+     */
+    static int switchTableIndex(ESValue* value, int low, int high);
+
+    /**
+     * Seeded FNV-1a hash shared by the compiler (to search for a perfect hash over the string
+     * case labels of a switch) and the generated code (to find the candidate slot at runtime). It stays inline so the
+     * compiler does not link the rest of Core, which needs a global object.
+     */
+    static unsigned int switchHash(const char* str, size_t length, unsigned int seed) {
+        unsigned int hash = 2166136261u ^ seed;
+        for (size_t i = 0; i < length; i++) {
+            hash ^= (unsigned char)str[i];
+            hash *= 16777619u;
         }
+        return hash;
     }
 
-    /*
-     * Strict Equality Comparison
+    /**
+     * Perfect hash dispatch for a switch whose case labels are all string literals.
+     * Returns the slot value hashes to, or -1 when value is not a String. The caller still has to
+     * confirm the match with switchStringEquals, as any string may land on an occupied slot.
+     */
+    static int switchHashSlot(ESValue* value, unsigned int seed, unsigned int mask);
+
+    static bool switchStringEquals(ESValue* value, const char* str);
+
+    /**
+     * 7.2.11 Abstract Relational Comparison
+     * http://www.ecma-international.org/ecma-262/6.0/#sec-abstract-relational-comparison
+     * Returns 1 for true, 0 for false and -1 for undefined (at least one operand is NaN).
+     * Operands have no side effects when converted yet, so LeftFirst does not change the result.
+     */
+    static int abstractRelationalComparison(ESValue* x, ESValue* y);
+
+    /**
+     * 7.2.12 Abstract Equality Comparison
+     * http://www.ecma-international.org/ecma-262/6.0/#sec-abstract-equality-comparison
+     */
+    static bool abstractEqualityComparison(ESValue* x, ESValue* y);
+
+    /**
+     * 7.2.13 Strict Equality Comparison
      * http://www.ecma-international.org/ecma-262/6.0/#sec-strict-equality-comparison
      */
-    static Boolean strictEqualityComparison(ESValue* left, ESValue* right) {
-        Type leftType = left->getType();
-        Type rightType = right->getType();
+    static bool strictEqualityComparison(ESValue* x, ESValue* y);
 
-        if(leftType != rightType) {
-            zeroFlag = false;
-            return new Boolean(false);
-        }
-        switch (leftType) {
-            case undefined: {
-                zeroFlag = true;
-                return new Boolean(true);
-            }
-            case null: {
-                zeroFlag = true;
-                return new Boolean(true);
-            }
-            case boolean: {
-                if (rightType != boolean) {
-                    zeroFlag = false;
-                    return new Boolean(true);
-                } else {
-                    Boolean* leftBool = dynamic_cast<Boolean*>(left);
-                    Boolean* rightBool = dynamic_cast<Boolean*>(right);                    
-                    if (leftBool->getValue() && rightBool->getValue()
-                    || !leftBool->getValue() && !rightBool->getValue()) {
-                        zeroFlag = true;
-                        return new Boolean(true);
-                    }
-                    zeroFlag = false;
-                    return new Boolean(false);
-                }
-            }
-            case string_: {
-                if (rightType != string_) {
-                    zeroFlag = false;
-                    return new Boolean(false);
-                }
-                String* leftStr = dynamic_cast<String*>(left);
-                String* rightStr = dynamic_cast<String*>(right);
-                if(leftStr->getValue() == rightStr->getValue()) {
-                    zeroFlag = true;
-                    return new Boolean(true);
-                } else {
-                    zeroFlag = false;
-                    return new Boolean(false);
-                }
-            }
-                
-            case symbol: {
-                if (rightType != symbol) {
-                    zeroFlag = false;
-                    return new Boolean(false);
-                } else {
-                    Symbol* leftSymbol = dynamic_cast<Symbol*>(left);
-                    Symbol* rightSymbol = dynamic_cast<Symbol*>(right);                    
-                    if (leftSymbol->getValue() == rightSymbol->getValue()) {
-                        zeroFlag = true;
-                        return new Boolean(true);
-                    }
-                    zeroFlag = false;
-                    return new Boolean(false);
-                }
-            }
-            case number: {
-                //TODO: Implement this... 
-                // If x is +0 and y is −0, return true.
-                // If x is −0 and y is +0, return true.
-                Number* leftNum = dynamic_cast<Number*>(left);
-                if(leftNum->isNan()) {
-                    zeroFlag = false;
-                    return new Boolean(false);
-                }
-                if (rightType != number) {
-                    zeroFlag = false;
-                    return new Boolean(false);
-                }
-                Number* rightNum = dynamic_cast<Number*>(right);
-                if(rightNum->isNan()){
-                    zeroFlag = false;
-                    return new Boolean(false);
-                }
-                if (leftNum->getValue() == rightNum->getValue()) {
-                    zeroFlag = true;
-                    return new Boolean(true);
-                }
-                zeroFlag = false;
-                return new Boolean(false);
-            }
-            case object: {
-                if (rightType != object) {
-                    zeroFlag = false;
-                    return new Boolean(false);
-                } else {
-                    Symbol* leftObj = dynamic_cast<Symbol*>(left);
-                    Symbol* rightObj = dynamic_cast<Symbol*>(right);                    
-                    if (leftObj->getValue() == rightObj->getValue()) {
-                        zeroFlag = true;
-                        return new Boolean(true);
-                    }
-                    zeroFlag = false;
-                    return new Boolean(false);
-                }
-            }
+    /*
+     * 12.9 Relational Operators and 12.10 Equality Operators
+     * These evaluate the operand references and return a plain bool, so generated code can branch on the
+     * result directly. A Boolean is only boxed when the comparison is used as a value.
+     */
 
-        }// end of switch (leftType) 
-        
-    }
+    static bool lessThan(ESValue* lref, ESValue* rref);
+
+    static bool greaterThan(ESValue* lref, ESValue* rref);
+
+    static bool lessThanOrEqual(ESValue* lref, ESValue* rref);
+
+    static bool greaterThanOrEqual(ESValue* lref, ESValue* rref);
+
+    static bool equals(ESValue* lref, ESValue* rref);
+
+    static bool notEquals(ESValue* lref, ESValue* rref);
+
+    static bool strictEquals(ESValue* lref, ESValue* rref);
+
+    static bool strictNotEquals(ESValue* lref, ESValue* rref);
 
 };
 
@@ -0,0 +1,57 @@
+#include "embedding.hpp"
+
+ESValue* Embedding::getGlobal(const char* name) {
+    return globalObj->get(new String(name));
+}
+
+void Embedding::setGlobal(const char* name, ESValue* value) {
+    globalObj->set(new String(name), value);
+}
+
+Function* Embedding::getFunction(const char* name) {
+    Function* function = dynamic_cast<Function*>(getGlobal(name));
+    return function != NULL && function->isCallable() ? function : NULL;
+}
+
+ESValue* Embedding::call(Function* function, ESValue** arguments, int argumentCount) {
+    return Core::getValue(function->call(arguments, argumentCount));
+}
+
+ESValue* Embedding::call(const char* name, ESValue** arguments, int argumentCount) {
+    Function* function = getFunction(name);
+    if (function == NULL) {
+        throw TypeError;
+    }
+    return call(function, arguments, argumentCount);
+}
+
+double Embedding::toNumber(ESValue* value) {
+    return TypeOps::toNumber(value)->getValue();
+}
+
+bool Embedding::toBoolean(ESValue* value) {
+    return TypeOps::toBoolean(value).getValue();
+}
+
+std::string Embedding::toString(ESValue* value) {
+    return TypeOps::toString(value)->getValue();
+}
+
+const std::string* Embedding::getString(ESValue* value) {
+    String* string = dynamic_cast<String*>(value);
+    return string != NULL ? &string->getValueReference() : NULL;
+}
+
+double* Embedding::getFloat64Elements(ESValue* value, size_t* length) {
+    Float64Array* typed = dynamic_cast<Float64Array*>(value);
+    if (typed != NULL) {
+        *length = typed->getLength();
+        return typed->getElements();
+    }
+    ESArray* array = dynamic_cast<ESArray*>(value);
+    if (array != NULL && array->getElementsKind() == packedDouble) {
+        *length = array->getLength();
+        return array->getDoubleElements();
+    }
+    return NULL;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <string>
+#include "core.hpp"
+#include "isolate.hpp"
+
+/**
+ * What a C++ program that links compiled scripts uses to call into them. A script compiled with --entry <name> is a
+ * function `int name()` that runs its top level, binding its functions and globals, on the global object of the
+ * isolate the calling thread is in (Isolate::run, or an Isolate::Scope for the calls that follow). Everything here
+ * works on that global object as well.
+ *
+ * Values belong to the heap of that isolate: they stay valid while a local or an argument of the thread holds them,
+ * and are never passed to another isolate. Numbers and Booleans are allocated in the nursery, strings are moved into
+ * the heap and read in place, and the elements of a Float64Array are written and read where they are.
+ */
+class Embedding {
+public:
+    /**
+     * The global binding called name, undefined when there is none
+     */
+    static ESValue* getGlobal(const char* name);
+
+    static void setGlobal(const char* name, ESValue* value);
+
+    /**
+     * The function bound to name, NULL when the binding is not a function. Held by the caller, it is called without
+     * looking it up again.
+     */
+    static Function* getFunction(const char* name);
+
+    /**
+     * 7.3.12 Call ( F, V, [argumentsList] )
+     * http://www.ecma-international.org/ecma-262/6.0/#sec-call
+     * The arguments are passed in place, missing ones are undefined. Throws the Exception the function throws.
+     * The jobs and timers it queues run when the caller runs EventLoop::run.
+     */
+    static ESValue* call(Function* function, ESValue** arguments, int argumentCount);
+
+    /**
+     * Calls the function bound to name, a TypeError when there is none
+     */
+    static ESValue* call(const char* name, ESValue** arguments, int argumentCount);
+
+    static ESValue* fromNumber(double value) {
+        return new Number(value);
+    }
+
+    static ESValue* fromBoolean(bool value) {
+        return new Boolean(value);
+    }
+
+    /**
+     * The characters are moved into the String, not copied, when the caller passes an rvalue
+     */
+    static ESValue* fromString(std::string value) {
+        return new String(std::move(value));
+    }
+
+    static ESValue* undefined() {
+        return new Undefined();
+    }
+
+    /**
+     * A Float64Array of length zeros, to fill through getFloat64Elements
+     */
+    static Float64Array* createFloat64Array(size_t length) {
+        return new Float64Array(length);
+    }
+
+    /**
+     * 7.1.3 ToNumber ( argument )
+     */
+    static double toNumber(ESValue* value);
+
+    /**
+     * 7.1.2 ToBoolean ( argument )
+     */
+    static bool toBoolean(ESValue* value);
+
+    /**
+     * 7.1.12 ToString ( argument ), copied out of the heap
+     */
+    static std::string toString(ESValue* value);
+
+    /**
+     * The characters of a String where they are, NULL for any other value
+     */
+    static const std::string* getString(ESValue* value);
+
+    /**
+     * The elements of a Float64Array, or of an array whose elements are all doubles that are not int32, where they
+     * are, NULL for any other value. Those of an array move when it changes length.
+     */
+    static double* getFloat64Elements(ESValue* value, size_t* length);
+};
@@ -0,0 +1,325 @@
+#include "eventloop.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <errno.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+#include "core.hpp"
+#include "global.hpp"
+
+static const size_t INITIAL_JOB_CAPACITY = 64;
+static const int MAX_READY_EVENTS = 64;
+
+/**
+ * Orders the heap of timers so that its front is the earliest due, and of those the first set
+ */
+struct TimerAfter {
+    template <class Timer>
+    bool operator()(const Timer& a, const Timer& b) const {
+        return a.due != b.due ? a.due > b.due : a.sequence > b.sequence;
+    }
+};
+
+EventLoop::EventLoop() {
+    jobs = (Job*)malloc(INITIAL_JOB_CAPACITY * sizeof(Job));
+    jobCapacity = INITIAL_JOB_CAPACITY;
+    jobHead = 0;
+    jobCount = 0;
+    nextTimerId = 1;
+    nextSequence = 0;
+    epollFd = -1;
+}
+
+EventLoop::~EventLoop() {
+    free(jobs);
+    if (epollFd >= 0) {
+        close(epollFd);
+    }
+}
+
+EventLoop* EventLoop::current() {
+    GlobalObject* global = dynamic_cast<GlobalObject*>(globalObj);
+    if (global == NULL) {
+        throw TypeError;
+    }
+    if (global->getEventLoop() == NULL) {
+        global->setEventLoop(new EventLoop());
+    }
+    return global->getEventLoop();
+}
+
+void EventLoop::run() {
+    GlobalObject* global = dynamic_cast<GlobalObject*>(globalObj);
+    if (global != NULL && global->getEventLoop() != NULL) {
+        global->getEventLoop()->loop();
+    }
+}
+
+void EventLoop::enqueueJob(JobCode code, ESValue* first, ESValue* second, ESValue* third) {
+    if (jobCount == jobCapacity) {
+        growJobs();
+    }
+    Job& job = jobs[(jobHead + jobCount) & (jobCapacity - 1)];
+    job.code = code;
+    job.first = first;
+    job.second = second;
+    job.third = third;
+    jobCount++;
+    writeBarrier(first);
+    writeBarrier(second);
+    writeBarrier(third);
+}
+
+/**
+ * Doubles the ring, unwrapping the queue to the start of the new one
+ */
+void EventLoop::growJobs() {
+    Job* grown = (Job*)malloc(jobCapacity * 2 * sizeof(Job));
+    size_t first = std::min(jobCount, jobCapacity - jobHead);
+    memcpy(grown, jobs + jobHead, first * sizeof(Job));
+    memcpy(grown + first, jobs, (jobCount - first) * sizeof(Job));
+    free(jobs);
+    jobs = grown;
+    jobCapacity *= 2;
+    jobHead = 0;
+}
+
+void EventLoop::runJobs() {
+    while (jobCount > 0) {
+        // copied out first, the job may queue more and grow the ring
+        Job job = jobs[jobHead];
+        jobHead = (jobHead + 1) & (jobCapacity - 1);
+        jobCount--;
+        job.code(job.first, job.second, job.third);
+    }
+}
+
+uint32_t EventLoop::setTimer(Function* callback, double delay, double interval, ESValue** arguments,
+                             int argumentCount) {
+    Timer timer;
+    timer.due = now() + (delay > 0 ? delay : 0);
+    timer.sequence = nextSequence++;
+    timer.id = nextTimerId++;
+    timer.interval = interval;
+    timer.callback = callback;
+    timer.arguments = argumentCount > 0 ? new ESArray(arguments, argumentCount) : NULL;
+    timers.push_back(timer);
+    std::push_heap(timers.begin(), timers.end(), TimerAfter());
+    activeTimers.insert(timer.id);
+    writeBarrier(timer.callback);
+    writeBarrier(timer.arguments);
+    return timer.id;
+}
+
+void EventLoop::clearTimer(uint32_t id) {
+    // the timer itself is dropped when it comes due
+    activeTimers.erase(id);
+}
+
+int EventLoop::runTimers(double now) {
+    // timers set by the callbacks run on a later turn, even when they are due already
+    uint64_t limit = nextSequence;
+    while (!timers.empty() && timers.front().due <= now && timers.front().sequence < limit) {
+        std::pop_heap(timers.begin(), timers.end(), TimerAfter());
+        Timer timer = timers.back();
+        timers.pop_back();
+        if (activeTimers.count(timer.id) == 0) {
+            continue;
+        }
+        if (timer.interval < 0) {
+            activeTimers.erase(timer.id);
+        }
+
+        std::vector<ESValue*> arguments;
+        if (timer.arguments != NULL) {
+            for (size_t i = 0; i < timer.arguments->getLength(); i++) {
+                arguments.push_back(timer.arguments->getElement(i));
+            }
+        }
+        timer.callback->call(arguments.data(), (int)arguments.size());
+        runJobs();
+
+        if (timer.interval >= 0 && activeTimers.count(timer.id) != 0) {
+            timer.due = EventLoop::now() + timer.interval;
+            timer.sequence = nextSequence++;
+            timers.push_back(timer);
+            std::push_heap(timers.begin(), timers.end(), TimerAfter());
+        }
+    }
+
+    // cancelled timers at the front are dropped rather than waited for
+    while (!timers.empty() && activeTimers.count(timers.front().id) == 0) {
+        std::pop_heap(timers.begin(), timers.end(), TimerAfter());
+        timers.pop_back();
+    }
+    if (timers.empty()) {
+        return -1;
+    }
+    double wait = std::ceil(timers.front().due - EventLoop::now());
+    return wait <= 0 ? 0 : wait >= INT_MAX ? INT_MAX : (int)wait;
+}
+
+bool EventLoop::watch(int fd, uint32_t events, Ready ready, void* data) {
+#ifdef __linux__
+    if (epollFd < 0) {
+        epollFd = epoll_create1(EPOLL_CLOEXEC);
+        if (epollFd < 0) {
+            return false;
+        }
+    }
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = events;
+    event.data.fd = fd;
+    bool watched = watchers.count(fd) != 0;
+    if (epoll_ctl(epollFd, watched ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &event) != 0) {
+        return false;
+    }
+    Watcher watcher = {ready, data};
+    watchers[fd] = watcher;
+    return true;
+#else
+    (void)fd;
+    (void)events;
+    (void)ready;
+    (void)data;
+    errno = ENOSYS;
+    return false;
+#endif
+}
+
+void EventLoop::unwatch(int fd) {
+    if (watchers.erase(fd) == 0) {
+        return;
+    }
+#ifdef __linux__
+    struct epoll_event event;
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, &event);
+#endif
+}
+
+void EventLoop::poll(int timeout) {
+#ifdef __linux__
+    if (watchers.empty()) {
+        if (timeout > 0) {
+            usleep((useconds_t)timeout * 1000);
+        }
+        return;
+    }
+    struct epoll_event events[MAX_READY_EVENTS];
+    int ready = epoll_wait(epollFd, events, MAX_READY_EVENTS, timeout);
+    for (int i = 0; i < ready; i++) {
+        // a callback may have unwatched a descriptor that is still in the list
+        std::unordered_map<int, Watcher>::iterator watcher = watchers.find(events[i].data.fd);
+        if (watcher != watchers.end()) {
+            watcher->second.ready(events[i].data.fd, events[i].events, watcher->second.data);
+            runJobs();
+        }
+    }
+#else
+    if (timeout > 0) {
+        usleep((useconds_t)timeout * 1000);
+    }
+#endif
+}
+
+void EventLoop::loop() {
+    runJobs();
+    while (true) {
+        int timeout = runTimers(now());
+        if (timeout < 0 && watchers.empty()) {
+            return;
+        }
+        poll(timeout);
+    }
+}
+
+double EventLoop::now() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void EventLoop::visitReferences(Heap::ReferenceVisitor& visitor) {
+    ESObject::visitReferences(visitor);
+    for (size_t i = 0; i < jobCount; i++) {
+        Job& job = jobs[(jobHead + i) & (jobCapacity - 1)];
+        if (job.first != NULL) {
+            visitor.visit(&job.first);
+        }
+        if (job.second != NULL) {
+            visitor.visit(&job.second);
+        }
+        if (job.third != NULL) {
+            visitor.visit(&job.third);
+        }
+    }
+    for (size_t i = 0; i < timers.size(); i++) {
+        visitor.visit((ESValue**)&timers[i].callback);
+        if (timers[i].arguments != NULL) {
+            visitor.visit((ESValue**)&timers[i].arguments);
+        }
+    }
+}
+
+/**
+ * A job of queueMicrotask, which calls its callback without arguments
+ */
+static void callMicrotask(ESValue* callback, ESValue*, ESValue*) {
+    static_cast<Function*>(callback)->call(NULL, 0);
+}
+
+/**
+ * The argument at position as a callable Function, a TypeError for anything else
+ */
+static Function* toCallback(ESValue** arguments, int argumentCount, int position) {
+    Function* callback = argumentCount > position ? dynamic_cast<Function*>(arguments[position]) : NULL;
+    if (callback == NULL || !callback->isCallable()) {
+        throw TypeError;
+    }
+    return callback;
+}
+
+ESValue* EventLoop::queueMicrotask(ESValue** arguments, int argumentCount) {
+    current()->enqueueJob(callMicrotask, toCallback(arguments, argumentCount, 0), NULL, NULL);
+    return new Undefined();
+}
+
+ESValue* EventLoop::createTimer(ESValue** arguments, int argumentCount, bool repeat) {
+    Function* callback = toCallback(arguments, argumentCount, 0);
+    double delay = argumentCount > 1 ? TypeOps::toNumber(arguments[1])->getValue() : 0;
+    // NaN and negative delays are 0
+    if (!(delay > 0)) {
+        delay = 0;
+    }
+    int extra = argumentCount > 2 ? argumentCount - 2 : 0;
+    uint32_t id = current()->setTimer(callback, delay, repeat ? delay : -1, extra > 0 ? arguments + 2 : NULL, extra);
+    return new Number(id);
+}
+
+ESValue* EventLoop::setTimeout(ESValue** arguments, int argumentCount) {
+    return createTimer(arguments, argumentCount, false);
+}
+
+ESValue* EventLoop::setInterval(ESValue** arguments, int argumentCount) {
+    return createTimer(arguments, argumentCount, true);
+}
+
+ESValue* EventLoop::clearTimeout(ESValue** arguments, int argumentCount) {
+    if (argumentCount > 0 && arguments[0]->getType() == number) {
+        double id = dynamic_cast<Number*>(arguments[0])->getValue();
+        if (id >= 1 && id <= UINT32_MAX) {
+            current()->clearTimer((uint32_t)id);
+        }
+    }
+    return new Undefined();
+}
+
+ESValue* EventLoop::clearInterval(ESValue** arguments, int argumentCount) {
+    return clearTimeout(arguments, argumentCount);
+}
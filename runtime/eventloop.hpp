@@ -0,0 +1,175 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "../type/type.hpp"
+
+/**
+ * 8.4 Jobs and Job Queues
+ * http://www.ecma-international.org/ecma-262/6.0/#sec-jobs-and-job-queues
+ * The jobs, timers and file descriptors of the code running on one global object. A script's top level runs to
+ * completion first, then the loop runs every queued job, and after that each timer as it comes due and each file
+ * descriptor as it becomes ready, running the jobs they queue before the next one. It returns when nothing is
+ * queued, no timer is pending and no descriptor is watched.
+ *
+ * Jobs, which are the reactions of promises and the callbacks of queueMicrotask, are held by value in a ring that
+ * doubles when it fills, so queueing one allocates nothing once the ring has grown to the longest queue the script
+ * builds. Timers are a binary heap ordered by the time they are due and then by the order they were set. The loop
+ * sleeps until the next of them is due, in epoll_wait when descriptors are watched so that it wakes as soon as one
+ * of them is ready.
+ *
+ * The loop is allocated in the heap of its global object and traces the values its jobs and timers hold, so they
+ * need no other reference.
+ */
+class EventLoop : public ESObject {
+public:
+    /**
+     * Runs a job with the values it was queued with, any of which may be NULL
+     */
+    typedef void (*JobCode)(ESValue* first, ESValue* second, ESValue* third);
+
+    /**
+     * Called on the loop's thread with the epoll events a watched descriptor is ready for
+     */
+    typedef void (*Ready)(int fd, uint32_t events, void* data);
+
+    EventLoop();
+
+    ~EventLoop();
+
+    /**
+     * The loop of the global object the calling thread runs code on, created the first time it is needed. A
+     * TypeError when globalObj is not a GlobalObject.
+     */
+    static EventLoop* current();
+
+    /**
+     * Runs the loop of the calling thread's global object until it has nothing left to do, returns at once when
+     * the code never queued a job or set a timer. Generated code calls it when the top level of a script returns.
+     */
+    static void run();
+
+    /**
+     * 8.4.1 EnqueueJob ( queueName, job, arguments )
+     */
+    void enqueueJob(JobCode code, ESValue* first, ESValue* second, ESValue* third);
+
+    /**
+     * Runs queued jobs, and the jobs they queue, until there are none
+     */
+    void runJobs();
+
+    /**
+     * Calls callback with the arguments after delay milliseconds, and then every interval milliseconds when
+     * interval is not negative. Returns the id that cancels it.
+     */
+    uint32_t setTimer(Function* callback, double delay, double interval, ESValue** arguments, int argumentCount);
+
+    /**
+     * Cancels a timer that has not run yet, or the next runs of an interval. Unknown ids are ignored.
+     */
+    void clearTimer(uint32_t id);
+
+    /**
+     * Calls ready whenever fd is ready for events (EPOLLIN, EPOLLOUT, ...) until it is unwatched, the loop keeps
+     * running while a descriptor is watched. False with errno set when epoll does not accept fd.
+     */
+    bool watch(int fd, uint32_t events, Ready ready, void* data);
+
+    void unwatch(int fd);
+
+    /**
+     * The number of jobs the ring holds before it has to grow
+     */
+    size_t getJobCapacity() {
+        return jobCapacity;
+    }
+
+    void visitReferences(Heap::ReferenceVisitor& visitor);
+
+    /**
+     * The built-in functions of the global object
+     * queueMicrotask ( callback )
+     */
+    static ESValue* queueMicrotask(ESValue** arguments, int argumentCount);
+
+    /**
+     * setTimeout ( callback, delay, ...arguments ), setInterval ( callback, delay, ...arguments )
+     */
+    static ESValue* setTimeout(ESValue** arguments, int argumentCount);
+
+    static ESValue* setInterval(ESValue** arguments, int argumentCount);
+
+    /**
+     * clearTimeout ( id ), clearInterval ( id ), either one clears both kinds of timer
+     */
+    static ESValue* clearTimeout(ESValue** arguments, int argumentCount);
+
+    static ESValue* clearInterval(ESValue** arguments, int argumentCount);
+
+private:
+    struct Job {
+        JobCode code;
+        ESValue* first;
+        ESValue* second;
+        ESValue* third;
+    };
+
+    struct Timer {
+        double due;
+        uint64_t sequence;
+        uint32_t id;
+        double interval;
+        Function* callback;
+        // the extra arguments of setTimeout and setInterval, NULL when there are none
+        ESArray* arguments;
+    };
+
+    struct Watcher {
+        Ready ready;
+        void* data;
+    };
+
+    // a power of two, jobs[(jobHead + i) & (jobCapacity - 1)] is the i-th job in the queue
+    Job* jobs;
+    size_t jobCapacity;
+    size_t jobHead;
+    size_t jobCount;
+
+    std::vector<Timer> timers;
+    std::unordered_set<uint32_t> activeTimers;
+    uint32_t nextTimerId;
+    uint64_t nextSequence;
+
+    std::unordered_map<int, Watcher> watchers;
+    int epollFd;
+
+    void growJobs();
+
+    /**
+     * Runs the timers due by now, each followed by the jobs it queued, and returns how long to wait for the next
+     * one in milliseconds, -1 when there is none
+     */
+    int runTimers(double now);
+
+    /**
+     * Waits up to timeout milliseconds for a watched descriptor, or just sleeps when none is watched, and calls
+     * back the ones that are ready
+     */
+    void poll(int timeout);
+
+    /**
+     * Runs until nothing is queued, pending or watched
+     */
+    void loop();
+
+    static double now();
+
+    static ESValue* createTimer(ESValue** arguments, int argumentCount, bool repeat);
+
+    EventLoop(const EventLoop&);
+    EventLoop& operator=(const EventLoop&);
+};
@@ -0,0 +1,253 @@
+#include "generator.hpp"
+
+#include <algorithm>
+
+IteratorResult::IteratorResult(ESValue* value, bool done) : value(value), done(done) {
+    writeBarrier(value);
+}
+
+ESValue* IteratorResult::get(ESValue* key_ref) {
+    String* key = key_ref->toString();
+    if (key->getValue() == "value") {
+        return value;
+    }
+    if (key->getValue() == "done") {
+        return new Boolean(done);
+    }
+    return ESObject::get(key_ref);
+}
+
+void IteratorResult::visitReferences(Heap::ReferenceVisitor& visitor) {
+    ESObject::visitReferences(visitor);
+    visitor.visit(&value);
+}
+
+bool IteratorResult::isDone(ESValue* result) {
+    IteratorResult* iteratorResult = dynamic_cast<IteratorResult*>(result);
+    if (iteratorResult == NULL) {
+        throw TypeError;
+    }
+    return iteratorResult->done;
+}
+
+ESValue* IteratorResult::valueOf(ESValue* result) {
+    IteratorResult* iteratorResult = dynamic_cast<IteratorResult*>(result);
+    if (iteratorResult == NULL) {
+        throw TypeError;
+    }
+    return iteratorResult->value;
+}
+
+/**
+ * 22.1.5 Array Iterator Objects
+ * The elements of an array as a generator with a native resume function, which reads the length again at every
+ * step as %ArrayIteratorPrototype%.next does
+ */
+class ArrayIterator : public Generator {
+private:
+    ESArray* array;
+    size_t index;
+
+    static ESValue* resumeArray(Generator* generator, ESValue* sent) {
+        ArrayIterator* iterator = static_cast<ArrayIterator*>(generator);
+        if (iterator->index < iterator->array->getLength()) {
+            return iterator->suspend(1, iterator->array->getElement(iterator->index++));
+        }
+        return iterator->complete(new Undefined());
+    }
+
+public:
+    explicit ArrayIterator(ESArray* array) : Generator(resumeArray), array(array), index(0) {
+        writeBarrier(array);
+    }
+
+    void visitReferences(Heap::ReferenceVisitor& visitor) {
+        Generator::visitReferences(visitor);
+        visitor.visit((ESValue**)&array);
+    }
+};
+
+/**
+ * 21.1.5 String Iterator Objects
+ * The code points of a string, each a String of its own. Strings hold UTF-8, so a code point is a lead byte and the
+ * continuation bytes after it, and one outside the Basic Multilingual Plane is a single step as its surrogate pair is.
+ */
+class StringIterator : public Generator {
+private:
+    std::string value;
+    size_t index;
+
+    static size_t codePointLength(unsigned char lead) {
+        if (lead >= 0xF0) {
+            return 4;
+        }
+        if (lead >= 0xE0) {
+            return 3;
+        }
+        return lead >= 0xC0 ? 2 : 1;
+    }
+
+    static ESValue* resumeString(Generator* generator, ESValue* sent) {
+        StringIterator* iterator = static_cast<StringIterator*>(generator);
+        if (iterator->index < iterator->value.size()) {
+            size_t length = std::min(codePointLength(iterator->value[iterator->index]),
+                                     iterator->value.size() - iterator->index);
+            String* codePoint = new String(iterator->value.substr(iterator->index, length));
+            iterator->index += length;
+            return iterator->suspend(1, codePoint);
+        }
+        return iterator->complete(new Undefined());
+    }
+
+public:
+    explicit StringIterator(String* string) : Generator(resumeString), value(string->getValue()), index(0) {}
+};
+
+ESValue* Generator::resume(ESValue* sent, bool* done) {
+    if (running) {
+        throw TypeError;
+    }
+    if (resumePoint == COMPLETED) {
+        *done = true;
+        return new Undefined();
+    }
+    running = true;
+    ESValue* value;
+    try {
+        value = code(this, sent);
+    } catch (Exception exception) {
+        running = false;
+        resumePoint = COMPLETED;
+        throw;
+    }
+    running = false;
+    *done = resumePoint == COMPLETED;
+    return value;
+}
+
+IteratorResult* Generator::next(ESValue* sent) {
+    bool done;
+    ESValue* value = resume(sent, &done);
+    return new IteratorResult(value, done);
+}
+
+IteratorResult* Generator::returnValue(ESValue* value) {
+    if (running) {
+        throw TypeError;
+    }
+    resumePoint = COMPLETED;
+    return new IteratorResult(value, true);
+}
+
+ESValue* Generator::callMethod(Generator* generator, const std::string& method, ESValue** arguments,
+                               int argumentCount) {
+    ESValue* first = argumentCount > 0 ? Core::getValue(arguments[0]) : new Undefined();
+    if (method == "next") {
+        return generator->next(first);
+    }
+    if (method == "return") {
+        return generator->returnValue(first);
+    }
+    throw TypeError;
+}
+
+Generator* Generator::iterate(ESValue* iterable) {
+    ESValue* value = Core::getValue(iterable);
+    Generator* generator = dynamic_cast<Generator*>(value);
+    if (generator != NULL) {
+        return generator;
+    }
+    ESArray* array = dynamic_cast<ESArray*>(value);
+    if (array != NULL) {
+        return new ArrayIterator(array);
+    }
+    if (value->getType() == string_) {
+        return new StringIterator(static_cast<String*>(value));
+    }
+    throw TypeError;
+}
+
+ESValue* Generator::delegate(ESValue* iterator, ESValue* sent) {
+    return static_cast<Generator*>(iterator)->next(Core::getValue(sent));
+}
+
+/**
+ * 25.5.5.3 AwaitedFulfilled and AwaitedRejected, the reactions that resume an async function with the value of the
+ * promise it awaits or reject it with the reason
+ */
+class AwaitReaction : public Function {
+private:
+    AsyncFunction* frame;
+    bool rejects;
+
+public:
+    AwaitReaction(AsyncFunction* frame, bool rejects) : Function(NULL, "", 1), frame(frame), rejects(rejects) {
+        writeBarrier(frame);
+    }
+
+    bool isCallable() {
+        return true;
+    }
+
+    ESValue* call(ESValue** arguments, int argumentCount) {
+        ESValue* value = argumentCount > 0 ? arguments[0] : new Undefined();
+        if (rejects) {
+            frame->fail(value);
+        } else {
+            frame->step(value);
+        }
+        return new Undefined();
+    }
+
+    void visitReferences(Heap::ReferenceVisitor& visitor) {
+        ESObject::visitReferences(visitor);
+        visitor.visit((ESValue**)&frame);
+    }
+};
+
+Promise* AsyncFunction::start(AsyncFunction* frame) {
+    frame->promise = new Promise();
+    frame->writeBarrier(frame->promise);
+    frame->step(new Undefined());
+    return frame->promise;
+}
+
+void AsyncFunction::step(ESValue* value) {
+    bool done;
+    ESValue* awaited;
+    try {
+        awaited = resume(value, &done);
+    } catch (Exception exception) {
+        promise->reject(Promise::toReason(exception));
+        return;
+    }
+    if (done) {
+        promise->resolve(awaited);
+        return;
+    }
+    // 6.2.3.1 Await ( value ): PromiseResolve, then PerformPromiseThen with the two reactions
+    if (onFulfilled == NULL) {
+        onFulfilled = new AwaitReaction(this, false);
+        writeBarrier(onFulfilled);
+        onRejected = new AwaitReaction(this, true);
+        writeBarrier(onRejected);
+    }
+    static_cast<Promise*>(Promise::callConstructorMethod("resolve", &awaited, 1))->then(onFulfilled, onRejected);
+}
+
+void AsyncFunction::fail(ESValue* reason) {
+    // without try statements there is nothing in the body that could catch it
+    complete(new Undefined());
+    promise->reject(reason);
+}
+
+void AsyncFunction::visitReferences(Heap::ReferenceVisitor& visitor) {
+    Generator::visitReferences(visitor);
+    if (promise != NULL) {
+        visitor.visit((ESValue**)&promise);
+    }
+    if (onFulfilled != NULL) {
+        visitor.visit((ESValue**)&onFulfilled);
+        visitor.visit((ESValue**)&onRejected);
+    }
+}
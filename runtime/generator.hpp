@@ -0,0 +1,173 @@
+#pragma once
+
+#include <string>
+#include "core.hpp"
+#include "promise.hpp"
+
+/**
+ * 7.4.7 CreateIterResultObject ( value, done )
+ * http://www.ecma-international.org/ecma-262/6.0/#sec-createiterresultobject
+ * The object next returns, which answers value and done from two fields instead of its property map
+ */
+class IteratorResult : public ESObject {
+private:
+    ESValue* value;
+    bool done;
+
+public:
+    IteratorResult(ESValue* value, bool done);
+
+    ESValue* getValue() {
+        return value;
+    }
+
+    bool isDone() {
+        return done;
+    }
+
+    ESValue* get(ESValue* key_ref);
+
+    void visitReferences(Heap::ReferenceVisitor& visitor);
+
+    /**
+     * 7.4.3 IteratorComplete ( iterResult ) and 7.4.4 IteratorValue ( iterResult ), a TypeError when result is not
+     * an IteratorResult
+     */
+    static bool isDone(ESValue* result);
+
+    static ESValue* valueOf(ESValue* result);
+};
+
+/**
+ * 25.3 Generator Objects
+ * http://www.ecma-international.org/ecma-262/6.0/#sec-generator-objects
+ * A generator function compiles to a resume function and a frame, see ast/resumable.hpp. The frame is a generated
+ * subclass of Generator whose fields are the parameters and the registers that are live across a yield, and
+ * calling the function only allocates it. next calls the resume function, which switches on the resume point of
+ * the frame to the label after the yield it stopped at, reloads the registers spilled there, and runs on to the
+ * next yield, where it stores the live ones back and returns the value yielded. A suspended generator is its frame
+ * and nothing else, no stack is kept for it, and resuming one is a C call.
+ *
+ * Generated code uses suspend, complete and store, anything else drives a generator through resume, next and
+ * returnValue.
+ */
+class Generator : public ESObject {
+public:
+    typedef ESValue* (*Resume)(Generator* generator, ESValue* sent);
+
+    explicit Generator(Resume code) : code(code), resumePoint(0), running(false) {}
+
+    /**
+     * Remembers where to resume and returns the value to yield
+     */
+    ESValue* suspend(int point, ESValue* value) {
+        resumePoint = point;
+        return value;
+    }
+
+    /**
+     * Marks the generator done and returns the value it returned
+     */
+    ESValue* complete(ESValue* value) {
+        resumePoint = COMPLETED;
+        return Core::getValue(value);
+    }
+
+    /**
+     * 0 before the first resume, then the point suspend was last called with
+     */
+    int getResumePoint() {
+        return resumePoint;
+    }
+
+    /**
+     * Stores a value into a field of the frame
+     */
+    void store(ESValue*& slot, ESValue* value) {
+        slot = value;
+        writeBarrier(value);
+    }
+
+    bool isDone() {
+        return resumePoint == COMPLETED;
+    }
+
+    /**
+     * 25.3.3.3 GeneratorResume ( generator, value ), without the result object: runs the generator to its next
+     * yield and returns the value yielded, or the value it returned with done set. A generator that is done
+     * returns undefined, one that is already running is a TypeError, and an exception thrown by its body completes
+     * it and propagates.
+     */
+    ESValue* resume(ESValue* sent, bool* done);
+
+    /**
+     * 25.3.1.2 Generator.prototype.next ( value )
+     */
+    IteratorResult* next(ESValue* sent);
+
+    /**
+     * 25.3.1.3 Generator.prototype.return ( value ), which completes the generator where it is suspended
+     */
+    IteratorResult* returnValue(ESValue* value);
+
+    /**
+     * generator.next(value) and generator.return(value), anything else is a TypeError
+     */
+    static ESValue* callMethod(Generator* generator, const std::string& method, ESValue** arguments,
+                               int argumentCount);
+
+    /**
+     * 7.4.1 GetIterator ( obj ): a generator is its own iterator, an array gets an iterator over its elements and a
+     * string one over its code points, anything else is a TypeError
+     */
+    static Generator* iterate(ESValue* iterable);
+
+    /**
+     * 14.4.14 yield* AssignmentExpression, one step: next of the iterator with the value sent into the generator
+     * that delegates to it
+     */
+    static ESValue* delegate(ESValue* iterator, ESValue* sent);
+
+private:
+    static const int COMPLETED = -1;
+
+    Resume code;
+    int resumePoint;
+    bool running;
+};
+
+/**
+ * 25.5 AsyncFunction Objects
+ * http://www.ecma-international.org/ecma-262/8.0/#sec-async-function-objects
+ * The frame of an async function, lowered like a generator with await in place of yield. Instead of next it is
+ * resumed by the reactions of the promises it awaits, with their value, and what it finally returns resolves its
+ * own promise. An exception in its body, or a promise it awaits that rejects, rejects that promise.
+ */
+class AsyncFunction : public Generator {
+public:
+    explicit AsyncFunction(Resume code) : Generator(code), promise(NULL), onFulfilled(NULL), onRejected(NULL) {}
+
+    /**
+     * 25.5.5.2 AsyncFunctionStart ( promiseCapability, asyncFunctionBody ): runs frame to its first await and
+     * returns the promise of its result
+     */
+    static Promise* start(AsyncFunction* frame);
+
+    /**
+     * Resumes the function with the value of the promise it awaited
+     */
+    void step(ESValue* value);
+
+    /**
+     * The promise it awaited rejected with reason, which rejects the function
+     */
+    void fail(ESValue* reason);
+
+    void visitReferences(Heap::ReferenceVisitor& visitor);
+
+private:
+    Promise* promise;
+    // the reactions to the promises it awaits, created at the first await and used by all of them
+    Function* onFulfilled;
+    Function* onRejected;
+};
@@ -0,0 +1,141 @@
+#include "global.hpp"
+
+#include <cstring>
+#include "eventloop.hpp"
+
+/**
+ * 18.1 Value Properties of the Global Object
+ */
+static ESValue* createInfinity() {
+    return new PosInfinity();
+}
+
+static ESValue* createNaN() {
+    return new NaN();
+}
+
+static ESValue* createUndefined() {
+    return new Undefined();
+}
+
+/**
+ * The constructors are resolved by name in Core::construct, their values only need to be objects
+ */
+static ESValue* createConstructor() {
+    return new Function();
+}
+
+static ESValue* createPromise() {
+    return new Function(NULL, "Promise", 1);
+}
+
+/**
+ * The functions of the EventLoop
+ */
+static ESValue* createQueueMicrotask() {
+    return new Function(EventLoop::queueMicrotask, "queueMicrotask", 1);
+}
+
+static ESValue* createSetTimeout() {
+    return new Function(EventLoop::setTimeout, "setTimeout", 2);
+}
+
+static ESValue* createSetInterval() {
+    return new Function(EventLoop::setInterval, "setInterval", 2);
+}
+
+static ESValue* createClearTimeout() {
+    return new Function(EventLoop::clearTimeout, "clearTimeout", 1);
+}
+
+static ESValue* createClearInterval() {
+    return new Function(EventLoop::clearInterval, "clearInterval", 1);
+}
+
+/**
+ * console.log is compiled to Console::log, the object itself has no properties yet
+ */
+static ESValue* createConsole() {
+    return new ESObject();
+}
+
+/**
+ * 20.2.1 Value Properties of the Math Object. Math.min and Math.max are only recognised by the compiler in
+ * reduce callbacks, so there are no function properties yet.
+ */
+static ESValue* createMath() {
+    ESObject* math = new ESObject();
+    math->set(new String("E"), new Number(2.718281828459045));
+    math->set(new String("LN10"), new Number(2.302585092994046));
+    math->set(new String("LN2"), new Number(0.6931471805599453));
+    math->set(new String("LOG10E"), new Number(0.4342944819032518));
+    math->set(new String("LOG2E"), new Number(1.4426950408889634));
+    math->set(new String("PI"), new Number(3.141592653589793));
+    math->set(new String("SQRT1_2"), new Number(0.7071067811865476));
+    math->set(new String("SQRT2"), new Number(1.4142135623730951));
+    return math;
+}
+
+// constant initialised and sorted by name for findBuiltIn
+static const GlobalObject::BuiltIn builtIns[] = {
+    {"ArrayBuffer", createConstructor},
+    {"Float64Array", createConstructor},
+    {"Infinity", createInfinity},
+    {"Int32Array", createConstructor},
+    {"Math", createMath},
+    {"NaN", createNaN},
+    {"Promise", createPromise},
+    {"Uint8Array", createConstructor},
+    {"clearInterval", createClearInterval},
+    {"clearTimeout", createClearTimeout},
+    {"console", createConsole},
+    {"queueMicrotask", createQueueMicrotask},
+    {"setInterval", createSetInterval},
+    {"setTimeout", createSetTimeout},
+    {"undefined", createUndefined},
+};
+
+ESValue* GlobalObject::get(ESValue* key_ref) {
+    if (!hasOwnProperty(key_ref)) {
+        const BuiltIn* builtIn = findBuiltIn(key_ref->toString()->getValue().c_str());
+        if (builtIn != NULL) {
+            return set(key_ref, builtIn->create());
+        }
+    }
+    return ESObject::get(key_ref);
+}
+
+void GlobalObject::setEventLoop(EventLoop* eventLoop) {
+    this->eventLoop = eventLoop;
+    writeBarrier(eventLoop);
+}
+
+void GlobalObject::visitReferences(Heap::ReferenceVisitor& visitor) {
+    ESObject::visitReferences(visitor);
+    if (eventLoop != NULL) {
+        visitor.visit((ESValue**)&eventLoop);
+    }
+}
+
+const GlobalObject::BuiltIn* GlobalObject::getBuiltIns(size_t* count) {
+    *count = sizeof(builtIns) / sizeof(builtIns[0]);
+    return builtIns;
+}
+
+const GlobalObject::BuiltIn* GlobalObject::findBuiltIn(const char* name) {
+    size_t low = 0;
+    size_t high = sizeof(builtIns) / sizeof(builtIns[0]);
+    while (low < high) {
+        size_t middle = (low + high) / 2;
+        int order = strcmp(name, builtIns[middle].name);
+        if (order == 0) {
+            return &builtIns[middle];
+        }
+        if (order < 0) {
+            high = middle;
+        } else {
+            low = middle + 1;
+        }
+    }
+    return NULL;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "../type/type.hpp"
+
+class EventLoop;
+
+/**
+ * 18 The Global Object
+ * http://www.ecma-international.org/ecma-262/6.0/#sec-global-object
+ * The initial global object is a constant table of its built-in bindings, compiled into the runtime ahead of time.
+ * Nothing is allocated at startup: a built-in becomes a property the first time it is read, and a script that
+ * never reads one never pays for it. A program defines its global object statically and points globalObj at it, an
+ * Isolate allocates its own. Each global object has an EventLoop of its own once its code queues a job or sets a
+ * timer.
+ */
+class GlobalObject : public ESObject {
+private:
+    EventLoop* eventLoop;
+
+public:
+    /**
+     * A binding of the initial global object and the function that creates its value
+     */
+    struct BuiltIn {
+        const char* name;
+        ESValue* (*create)();
+    };
+
+    /**
+     * Own properties first, then the built-in of that name, which stays a property from then on
+     */
+    GlobalObject() : eventLoop(NULL) {}
+
+    ESValue* get(ESValue* key_ref);
+
+    /**
+     * NULL until the first job or timer
+     */
+    EventLoop* getEventLoop() {
+        return eventLoop;
+    }
+
+    void setEventLoop(EventLoop* eventLoop);
+
+    /**
+     * Visits the event loop as well, which holds the values of its jobs and timers
+     */
+    void visitReferences(Heap::ReferenceVisitor& visitor);
+
+    /**
+     * The built-in bindings, sorted by name
+     */
+    static const BuiltIn* getBuiltIns(size_t* count);
+
+    /**
+     * The binding called name, or NULL when there is none
+     */
+    static const BuiltIn* findBuiltIn(const char* name);
+};
@@ -0,0 +1,107 @@
+#include "isolate.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include "console.hpp"
+
+static __thread Isolate* currentIsolate = NULL;
+
+Isolate::Scope::Scope(Isolate* isolate) : isolate(isolate) {
+    if (isolate->entered) {
+        fprintf(stderr, "isolate: entered by two threads, or twice by one\n");
+        abort();
+    }
+    isolate->entered = true;
+    previous = currentIsolate;
+    previousGlobal = globalObj;
+    Heap::exchange(isolate->heap);
+    currentIsolate = isolate;
+    globalObj = isolate->global;
+}
+
+Isolate::Scope::~Scope() {
+    globalObj = previousGlobal;
+    currentIsolate = previous;
+    Heap::exchange(isolate->heap);
+    isolate->entered = false;
+}
+
+Isolate::Isolate() : heap(), global(NULL), entered(false) {
+    Scope scope(this);
+    // allocated in the isolate's heap, a root until the isolate is destroyed
+    global = new GlobalObject();
+    Heap::addRoot(global);
+    globalObj = global;
+}
+
+Isolate::~Isolate() {
+    Scope scope(this);
+    Heap::removeRoot(global);
+    Heap::destroy();
+    global = NULL;
+    globalObj = NULL;
+}
+
+int Isolate::run(EntryPoint entry) {
+    Scope scope(this);
+    int status = entry();
+    // the output of a script is written before the thread moves on to the next
+    Console::flush();
+    return status;
+}
+
+Isolate* Isolate::current() {
+    return currentIsolate;
+}
+
+/**
+ * Runs a script in an isolate of its own, created and destroyed on the thread that runs it
+ */
+static int runIsolated(Isolate::EntryPoint entry) {
+    Isolate isolate;
+    return isolate.run(entry);
+}
+
+IsolatePool::IsolatePool(size_t threads) : stopping(false) {
+    for (size_t i = 0; i < threads; i++) {
+        this->threads.push_back(std::thread(&IsolatePool::work, this));
+    }
+}
+
+IsolatePool::~IsolatePool() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    queued.notify_all();
+    for (size_t i = 0; i < threads.size(); i++) {
+        threads[i].join();
+    }
+}
+
+std::future<int> IsolatePool::submit(Isolate::EntryPoint entry) {
+    std::packaged_task<int()> task([entry] { return runIsolated(entry); });
+    std::future<int> result = task.get_future();
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        queue.push_back(std::move(task));
+    }
+    queued.notify_one();
+    return result;
+}
+
+void IsolatePool::work() {
+    while (true) {
+        std::packaged_task<int()> task;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            queued.wait(guard, [this] { return stopping || !queue.empty(); });
+            if (queue.empty()) {
+                return;
+            }
+            task = std::move(queue.front());
+            queue.pop_front();
+        }
+        task();
+    }
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "core.hpp"
+#include "global.hpp"
+
+/**
+ * 8.2 Realms
+ * http://www.ecma-international.org/ecma-262/6.0/#sec-code-realms
+ * An instance of the runtime that shares no values with any other: a heap of its own, and a global object allocated
+ * in it whose built-ins are created there as they are read. A thread runs code in an isolate while a Scope of it is
+ * open, and only one thread may be in an isolate at a time. A script that has returned leaves nothing on the stack
+ * that the isolate's collections need, so it may be entered by another thread next.
+ */
+class Isolate {
+public:
+    /**
+     * A compiled script, returning its exit status
+     */
+    typedef int (*EntryPoint)();
+
+    /**
+     * Enters an isolate on this thread: the thread allocates from its heap and globalObj is its global object, until
+     * the scope closes and the thread goes back to its own heap and global object
+     */
+    class Scope {
+    public:
+        explicit Scope(Isolate* isolate);
+        ~Scope();
+
+    private:
+        Isolate* isolate;
+        Isolate* previous;
+        ESObject* previousGlobal;
+    };
+
+    Isolate();
+
+    /**
+     * Runs the destructors of every value of the isolate and gives its heap back
+     */
+    ~Isolate();
+
+    /**
+     * Runs entry in this isolate on the calling thread, an exception it throws leaves the isolate and is rethrown
+     */
+    int run(EntryPoint entry);
+
+    ESObject* getGlobal() {
+        return global;
+    }
+
+    /**
+     * The isolate this thread is in, NULL outside of any
+     */
+    static Isolate* current();
+
+private:
+    Heap::Context heap;
+    GlobalObject* global;
+    bool entered;
+
+    Isolate(const Isolate&);
+    Isolate& operator=(const Isolate&);
+};
+
+/**
+ * A fixed number of threads running compiled scripts, each in an isolate created for it on the thread that runs it
+ * and destroyed when it returns. The only state the threads share is the queue of scripts.
+ */
+class IsolatePool {
+public:
+    explicit IsolatePool(size_t threads);
+
+    /**
+     * Runs the scripts still queued and stops the threads
+     */
+    ~IsolatePool();
+
+    /**
+     * Queues entry, the future holds its exit status or the exception it threw
+     */
+    std::future<int> submit(Isolate::EntryPoint entry);
+
+private:
+    std::vector<std::thread> threads;
+    std::deque<std::packaged_task<int()> > queue;
+    std::mutex lock;
+    std::condition_variable queued;
+    bool stopping;
+
+    void work();
+};
@@ -0,0 +1,125 @@
+#include "profiler.hpp"
+
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <map>
+#include <string>
+
+__thread Profiler::ShadowStack Profiler::shadowStack;
+
+// samples are recorded as their depth followed by their frames, outermost first, into a buffer allocated by start
+// so that the signal handler never allocates
+static const size_t SAMPLE_SLOTS = 1 << 20;
+static const char** samples = NULL;
+static size_t usedSlots = 0;
+static size_t sampleCount = 0;
+static size_t droppedCount = 0;
+static bool started = false;
+
+void Profiler::sample(int signal) {
+    int savedErrno = errno;
+    int depth = shadowStack.depth;
+    depth = depth < 0 ? 0 : depth > MAX_DEPTH ? MAX_DEPTH : depth;
+    size_t at = __atomic_fetch_add(&usedSlots, depth + 1, __ATOMIC_RELAXED);
+    if (at + depth + 1 > SAMPLE_SLOTS) {
+        __atomic_fetch_add(&droppedCount, 1, __ATOMIC_RELAXED);
+    } else {
+        samples[at] = (const char*)(intptr_t)depth;
+        for (int i = 0; i < depth; i++) {
+            samples[at + 1 + i] = shadowStack.frames[i];
+        }
+        __atomic_fetch_add(&sampleCount, 1, __ATOMIC_RELAXED);
+    }
+    errno = savedErrno;
+}
+
+void Profiler::start() {
+    if (started) {
+        return;
+    }
+    samples = (const char**)calloc(SAMPLE_SLOTS, sizeof(const char*));
+    if (samples == NULL) {
+        return;
+    }
+    started = true;
+
+    long hz = getenv("ES_PROFILE_HZ") != NULL ? atol(getenv("ES_PROFILE_HZ")) : 1000;
+    hz = hz > 0 && hz <= 1000000 ? hz : 1000;
+
+    struct sigaction action;
+    action.sa_handler = sample;
+    sigemptyset(&action.sa_mask);
+    // interrupted reads and writes carry on rather than fail with EINTR
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGPROF, &action, NULL);
+
+    struct itimerval timer;
+    timer.it_interval.tv_sec = 0;
+    timer.it_interval.tv_usec = 1000000 / hz;
+    timer.it_value = timer.it_interval;
+    setitimer(ITIMER_PROF, &timer, NULL);
+
+    atexit(writeAtExit);
+}
+
+bool Profiler::stop(const char* path) {
+    if (!started) {
+        return false;
+    }
+    struct itimerval timer = {};
+    setitimer(ITIMER_PROF, &timer, NULL);
+    signal(SIGPROF, SIG_IGN);
+    started = false;
+
+    std::map<std::string, size_t> stacks;
+    size_t used = usedSlots < SAMPLE_SLOTS ? usedSlots : SAMPLE_SLOTS;
+    for (size_t at = 0; at < used;) {
+        int depth = (int)(intptr_t)samples[at];
+        if (at + depth + 1 > used) {
+            break;
+        }
+        std::string stack;
+        for (int i = 0; i < depth; i++) {
+            if (i > 0) {
+                stack += ';';
+            }
+            stack += samples[at + 1 + i] != NULL ? samples[at + 1 + i] : "?";
+        }
+        stacks[depth > 0 ? stack : "(no frames)"]++;
+        at += depth + 1;
+    }
+
+    FILE* file = fopen(path, "w");
+    if (file == NULL) {
+        return false;
+    }
+    for (std::map<std::string, size_t>::iterator iter = stacks.begin(); iter != stacks.end(); ++iter) {
+        fprintf(file, "%s %lu\n", iter->first.c_str(), (unsigned long)iter->second);
+    }
+    return fclose(file) == 0;
+}
+
+size_t Profiler::getSampleCount() {
+    return sampleCount;
+}
+
+size_t Profiler::getDroppedCount() {
+    return droppedCount;
+}
+
+void Profiler::writeAtExit() {
+    if (!started) {
+        return;
+    }
+    const char* path = getenv("ES_PROFILE") != NULL ? getenv("ES_PROFILE") : "profile.folded";
+    if (!stop(path)) {
+        fprintf(stderr, "profile: %s could not be written\n", path);
+        return;
+    }
+    fprintf(stderr, "profile: %lu samples, %lu dropped, written to %s\n", (unsigned long)sampleCount,
+            (unsigned long)droppedCount, path);
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <stddef.h>
+
+/**
+ * Sampling profiler for programs compiled with --profile. Every generated function pushes a frame with its name on
+ * a shadow stack of its thread when it is entered and pops it before each return. A SIGPROF timer interrupts the
+ * program ES_PROFILE_HZ times per second of CPU time (1000 unless set) and copies the shadow stack of the thread it
+ * interrupted. When the program exits the samples are written to ES_PROFILE (profile.folded unless set) as
+ * collapsed stacks, one "outer;inner count" line per distinct stack, which flamegraph.pl takes as it is.
+ * Programs compiled without --profile push no frames and never start the timer.
+ */
+class Profiler {
+public:
+    static const int MAX_DEPTH = 128;
+
+    /**
+     * The function frames of one thread. Frames deeper than MAX_DEPTH are counted but not recorded.
+     */
+    struct ShadowStack {
+        const char* frames[MAX_DEPTH];
+        volatile int depth;
+    };
+
+    /**
+     * Pushes the frame of a generated function and returns the depth to leave it at. The frame is popped by
+     * restoring the depth rather than by a destructor, which the gotos of generated code could not jump over, and
+     * a frame an exception left on the stack goes at the next return of a function below it.
+     */
+    static int enter(const char* name) {
+        ShadowStack& stack = shadowStack;
+        int depth = stack.depth;
+        if (depth < MAX_DEPTH) {
+            stack.frames[depth] = name;
+        }
+        // the frame is written before the signal handler can see it
+        __atomic_signal_fence(__ATOMIC_SEQ_CST);
+        stack.depth = depth + 1;
+        return depth;
+    }
+
+    static void leave(int depth) {
+        shadowStack.depth = depth;
+    }
+
+    /**
+     * Starts sampling and writes the profile when the program exits. Emitted at the start of main.
+     */
+    static void start();
+
+    /**
+     * Stops sampling and writes the profile to path, returns false when it cannot be written
+     */
+    static bool stop(const char* path);
+
+    static size_t getSampleCount();
+
+    /**
+     * Samples that did not fit in the sample buffer
+     */
+    static size_t getDroppedCount();
+
+private:
+    // __thread rather than thread_local: it has no dynamic initialisation, so every frame and the signal handler
+    // reach it with a plain TLS access
+    static __thread ShadowStack shadowStack;
+
+    static void sample(int signal);
+
+    static void writeAtExit();
+};
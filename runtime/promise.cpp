@@ -0,0 +1,267 @@
+#include "promise.hpp"
+
+#include "eventloop.hpp"
+
+/**
+ * 25.4.1.3 CreateResolvingFunctions ( promise )
+ * The resolve and reject functions of one promise, once either of them has been called both do nothing.
+ */
+class ResolvingFunction : public Function {
+private:
+    Promise* promise;
+    ResolvingFunction* partner;
+    bool rejects;
+    bool alreadyResolved;
+
+public:
+    ResolvingFunction(Promise* promise, bool rejects) : Function(NULL, "", 1) {
+        this->promise = promise;
+        this->partner = NULL;
+        this->rejects = rejects;
+        this->alreadyResolved = false;
+        writeBarrier(promise);
+    }
+
+    static void create(Promise* promise, ResolvingFunction** resolve, ResolvingFunction** reject) {
+        *resolve = new ResolvingFunction(promise, false);
+        *reject = new ResolvingFunction(promise, true);
+        (*resolve)->partner = *reject;
+        (*resolve)->writeBarrier(*reject);
+        (*reject)->partner = *resolve;
+        (*reject)->writeBarrier(*resolve);
+    }
+
+    bool isCallable() {
+        return true;
+    }
+
+    ESValue* call(ESValue** arguments, int argumentCount) {
+        if (!alreadyResolved) {
+            alreadyResolved = true;
+            partner->alreadyResolved = true;
+            ESValue* value = argumentCount > 0 ? arguments[0] : new Undefined();
+            if (rejects) {
+                promise->reject(value);
+            } else {
+                promise->resolve(value);
+            }
+        }
+        return new Undefined();
+    }
+
+    void visitReferences(Heap::ReferenceVisitor& visitor) {
+        ESObject::visitReferences(visitor);
+        visitor.visit((ESValue**)&promise);
+        if (partner != NULL) {
+            visitor.visit((ESValue**)&partner);
+        }
+    }
+};
+
+ESValue* Promise::toReason(Exception exception) {
+    switch (exception) {
+        case ReferenceError:
+            return new String("ReferenceError");
+        case RangeError:
+            return new String("RangeError");
+        default:
+            return new String("TypeError");
+    }
+}
+
+static Function* toHandler(ESValue* value) {
+    Function* handler = dynamic_cast<Function*>(value);
+    return handler != NULL && handler->isCallable() ? handler : NULL;
+}
+
+/**
+ * 25.4.2.1 PromiseReactionJob ( reaction, argument ), for a fulfilled and for a rejected promise. Without a handler
+ * the value or the reason is passed on as it is.
+ */
+static void runReaction(Promise* derived, ESValue* handler, ESValue* argument, bool rejected) {
+    if (handler == NULL) {
+        if (rejected) {
+            derived->reject(argument);
+        } else {
+            derived->resolve(argument);
+        }
+        return;
+    }
+    ESValue* result;
+    try {
+        result = Core::getValue(static_cast<Function*>(handler)->call(&argument, 1));
+    } catch (Exception exception) {
+        derived->reject(Promise::toReason(exception));
+        return;
+    }
+    derived->resolve(result);
+}
+
+static void fulfillReactionJob(ESValue* derived, ESValue* handler, ESValue* argument) {
+    runReaction(static_cast<Promise*>(derived), handler, argument, false);
+}
+
+static void rejectReactionJob(ESValue* derived, ESValue* handler, ESValue* argument) {
+    runReaction(static_cast<Promise*>(derived), handler, argument, true);
+}
+
+/**
+ * 25.4.2.2 PromiseResolveThenableJob ( promiseToResolve, thenable, then ). A thenable that is a Promise gets a
+ * reaction that settles promiseToResolve the way it settles, without resolving functions.
+ */
+static void resolveThenableJob(ESValue* promiseToResolve, ESValue* thenable, ESValue* then) {
+    Promise* promise = static_cast<Promise*>(promiseToResolve);
+    Promise* adopted = dynamic_cast<Promise*>(thenable);
+    if (adopted != NULL) {
+        adopted->then(NULL, NULL, promise);
+        return;
+    }
+    ResolvingFunction* resolve;
+    ResolvingFunction* reject;
+    ResolvingFunction::create(promise, &resolve, &reject);
+    ESValue* arguments[] = {resolve, reject};
+    try {
+        static_cast<Function*>(then)->call(arguments, 2);
+    } catch (Exception exception) {
+        ESValue* reason = Promise::toReason(exception);
+        reject->call(&reason, 1);
+    }
+}
+
+void Promise::resolve(ESValue* resolution) {
+    if (state != pending) {
+        return;
+    }
+    if (resolution == this) {
+        reject(toReason(TypeError));
+        return;
+    }
+    if (resolution->getType() != object) {
+        settle(fulfilled, resolution);
+        return;
+    }
+    if (dynamic_cast<Promise*>(resolution) != NULL) {
+        EventLoop::current()->enqueueJob(resolveThenableJob, this, resolution, NULL);
+        return;
+    }
+    Function* then;
+    try {
+        then = toHandler(dynamic_cast<ESObject*>(resolution)->get(new String("then")));
+    } catch (Exception exception) {
+        reject(toReason(exception));
+        return;
+    }
+    if (then == NULL) {
+        settle(fulfilled, resolution);
+        return;
+    }
+    EventLoop::current()->enqueueJob(resolveThenableJob, this, resolution, then);
+}
+
+void Promise::reject(ESValue* reason) {
+    if (state == pending) {
+        settle(rejected, reason);
+    }
+}
+
+void Promise::settle(State state, ESValue* result) {
+    this->state = state;
+    this->result = result;
+    writeBarrier(result);
+    std::vector<Reaction> triggered;
+    triggered.swap(reactions);
+    for (size_t i = 0; i < triggered.size(); i++) {
+        enqueueReaction(triggered[i], state, result);
+    }
+}
+
+void Promise::enqueueReaction(const Reaction& reaction, State state, ESValue* argument) {
+    if (state == fulfilled) {
+        EventLoop::current()->enqueueJob(fulfillReactionJob, reaction.derived, reaction.onFulfilled, argument);
+    } else {
+        EventLoop::current()->enqueueJob(rejectReactionJob, reaction.derived, reaction.onRejected, argument);
+    }
+}
+
+Promise* Promise::then(ESValue* onFulfilled, ESValue* onRejected) {
+    return then(onFulfilled, onRejected, new Promise());
+}
+
+Promise* Promise::then(ESValue* onFulfilled, ESValue* onRejected, Promise* derived) {
+    Reaction reaction = {derived, toHandler(onFulfilled), toHandler(onRejected)};
+    if (state == pending) {
+        reactions.push_back(reaction);
+        writeBarrier(reaction.derived);
+        writeBarrier(reaction.onFulfilled);
+        writeBarrier(reaction.onRejected);
+    } else {
+        enqueueReaction(reaction, state, result);
+    }
+    return derived;
+}
+
+Promise* Promise::construct(ESValue** arguments, int argumentCount) {
+    Function* executor = toHandler(argumentCount > 0 ? Core::getValue(arguments[0]) : NULL);
+    if (executor == NULL) {
+        throw TypeError;
+    }
+    Promise* promise = new Promise();
+    ResolvingFunction* resolve;
+    ResolvingFunction* reject;
+    ResolvingFunction::create(promise, &resolve, &reject);
+    ESValue* resolvingFunctions[] = {resolve, reject};
+    try {
+        executor->call(resolvingFunctions, 2);
+    } catch (Exception exception) {
+        ESValue* reason = toReason(exception);
+        reject->call(&reason, 1);
+    }
+    return promise;
+}
+
+ESValue* Promise::callMethod(Promise* promise, const std::string& method, ESValue** arguments, int argumentCount) {
+    ESValue* first = argumentCount > 0 ? Core::getValue(arguments[0]) : NULL;
+    if (method == "then") {
+        return promise->then(first, argumentCount > 1 ? Core::getValue(arguments[1]) : NULL);
+    }
+    // 25.4.5.1 Promise.prototype.catch ( onRejected )
+    if (method == "catch") {
+        return promise->then(NULL, first);
+    }
+    throw TypeError;
+}
+
+ESValue* Promise::callConstructorMethod(const std::string& method, ESValue** arguments, int argumentCount) {
+    ESValue* first = argumentCount > 0 ? Core::getValue(arguments[0]) : new Undefined();
+    if (method == "resolve") {
+        Promise* promise = dynamic_cast<Promise*>(first);
+        if (promise != NULL) {
+            return promise;
+        }
+        promise = new Promise();
+        promise->resolve(first);
+        return promise;
+    }
+    if (method == "reject") {
+        Promise* promise = new Promise();
+        promise->reject(first);
+        return promise;
+    }
+    throw TypeError;
+}
+
+void Promise::visitReferences(Heap::ReferenceVisitor& visitor) {
+    ESObject::visitReferences(visitor);
+    if (result != NULL) {
+        visitor.visit(&result);
+    }
+    for (size_t i = 0; i < reactions.size(); i++) {
+        visitor.visit((ESValue**)&reactions[i].derived);
+        if (reactions[i].onFulfilled != NULL) {
+            visitor.visit(&reactions[i].onFulfilled);
+        }
+        if (reactions[i].onRejected != NULL) {
+            visitor.visit(&reactions[i].onRejected);
+        }
+    }
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "core.hpp"
+
+/**
+ * 25.4 Promise Objects
+ * http://www.ecma-international.org/ecma-262/6.0/#sec-promise-objects
+ * The reactions of a promise run as jobs of the EventLoop of its global object. then and catch, and the resolve and
+ * reject functions of the Promise constructor, are built-in methods resolved by name in Core::callMethod. A promise
+ * resolved with another one of these promises takes its state from it directly, any other object with a callable
+ * then is called through it. A handler that throws an Exception of the runtime rejects with a String of its name.
+ */
+class Promise : public ESObject {
+public:
+    enum State {
+        pending,
+        fulfilled,
+        rejected
+    };
+
+    Promise() : state(pending), result(NULL) {}
+
+    State getState() {
+        return state;
+    }
+
+    /**
+     * The value or the reason, NULL while the promise is pending
+     */
+    ESValue* getResult() {
+        return result;
+    }
+
+    /**
+     * 25.4.1.3.2 Promise Resolve Functions, from step 6: fulfills with resolution, or follows it when it is a thenable
+     */
+    void resolve(ESValue* resolution);
+
+    /**
+     * 25.4.1.7 RejectPromise ( promise, reason )
+     */
+    void reject(ESValue* reason);
+
+    /**
+     * 25.4.5.3 Promise.prototype.then ( onFulfilled, onRejected ), handlers that are not callable pass the value or
+     * the reason on to the promise it returns
+     */
+    Promise* then(ESValue* onFulfilled, ESValue* onRejected);
+
+    /**
+     * then, settling derived instead of a new promise, which is how a promise follows another
+     */
+    Promise* then(ESValue* onFulfilled, ESValue* onRejected, Promise* derived);
+
+    /**
+     * 25.4.3.1 Promise ( executor )
+     */
+    static Promise* construct(ESValue** arguments, int argumentCount);
+
+    /**
+     * promise.then(onFulfilled, onRejected) and promise.catch(onRejected), anything else is a TypeError
+     */
+    static ESValue* callMethod(Promise* promise, const std::string& method, ESValue** arguments, int argumentCount);
+
+    /**
+     * 25.4.4.5 Promise.resolve ( x ) and 25.4.4.4 Promise.reject ( r ), anything else is a TypeError
+     */
+    static ESValue* callConstructorMethod(const std::string& method, ESValue** arguments, int argumentCount);
+
+    /**
+     * The reason a promise is rejected with when the code it runs throws exception
+     */
+    static ESValue* toReason(Exception exception);
+
+    void visitReferences(Heap::ReferenceVisitor& visitor);
+
+private:
+    /**
+     * 25.4.1.1 PromiseReaction Records, the handlers of one call of then and the promise it returned
+     */
+    struct Reaction {
+        Promise* derived;
+        ESValue* onFulfilled;
+        ESValue* onRejected;
+    };
+
+    State state;
+    ESValue* result;
+    std::vector<Reaction> reactions;
+
+    /**
+     * 25.4.1.4 FulfillPromise and 25.4.1.7 RejectPromise, which trigger the reactions
+     */
+    void settle(State state, ESValue* result);
+
+    /**
+     * Queues the job of a reaction to a promise that is settled
+     */
+    static void enqueueReaction(const Reaction& reaction, State state, ESValue* argument);
+};
@@ -0,0 +1,16 @@
+#pragma once
+
+/**
+ * Everything generated code uses from the runtime, in the one header it includes. The definitions are in
+ * libesruntime.a, so compiling a program only parses these declarations, and `make runtime_pch` precompiles
+ * this header for the flags the compiler builds executables with.
+ */
+#include "core.hpp"
+#include "class.hpp"
+#include "console.hpp"
+#include "eventloop.hpp"
+#include "generator.hpp"
+#include "global.hpp"
+#include "profiler.hpp"
+#include "../scope/environment.hpp"
+#include "../scope/reference.hpp"
@@ -0,0 +1,680 @@
+#include "simd.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ES_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+/**
+ * The scalar, SSE2 and AVX2 versions of the Simd kernels. They are only reachable through the dispatch in Simd, so
+ * the intrinsics stay out of simd.hpp and out of every file that includes it.
+ */
+class SimdKernels {
+public:
+    // Scalar paths, always available and the reference the vector paths are checked against
+
+    static void fillScalar(double* elements, size_t length, double value) {
+        for (size_t i = 0; i < length; i++) {
+            elements[i] = value;
+        }
+    }
+
+    static void fillScalar(int* elements, size_t length, int value) {
+        for (size_t i = 0; i < length; i++) {
+            elements[i] = value;
+        }
+    }
+
+    static ptrdiff_t indexOfScalar(const double* elements, size_t length, double value) {
+        for (size_t i = 0; i < length; i++) {
+            if (elements[i] == value) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    static ptrdiff_t indexOfScalar(const int* elements, size_t length, int value) {
+        for (size_t i = 0; i < length; i++) {
+            if (elements[i] == value) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    static ptrdiff_t indexOfNaNScalar(const double* elements, size_t length) {
+        for (size_t i = 0; i < length; i++) {
+            if (elements[i] != elements[i]) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    static long long sumScalar(const int* elements, size_t length) {
+        long long result = 0;
+        for (size_t i = 0; i < length; i++) {
+            result += elements[i];
+        }
+        return result;
+    }
+
+    static double minMaxScalar(const double* elements, size_t length, bool maximum) {
+        double result = elements[0];
+        for (size_t i = 0; i < length; i++) {
+            double element = elements[i];
+            if (element != element) {
+                return element;
+            }
+            if (maximum ? element > result : element < result) {
+                result = element;
+            }
+        }
+        return result;
+    }
+
+    static int minMaxScalar(const int* elements, size_t length, bool maximum) {
+        int result = elements[0];
+        for (size_t i = 1; i < length; i++) {
+            if (maximum ? elements[i] > result : elements[i] < result) {
+                result = elements[i];
+            }
+        }
+        return result;
+    }
+
+    static void mapScalar(const double* source, double* destination, size_t length, MapOperation operation,
+                          double constant, bool constantOnLeft) {
+        for (size_t i = 0; i < length; i++) {
+            destination[i] = Simd::apply(operation, source[i], constant, constantOnLeft);
+        }
+    }
+
+    static void mapScalar(const int* source, double* destination, size_t length, MapOperation operation,
+                          double constant, bool constantOnLeft) {
+        for (size_t i = 0; i < length; i++) {
+            destination[i] = Simd::apply(operation, source[i], constant, constantOnLeft);
+        }
+    }
+
+#ifdef ES_SIMD_X86
+    // SSE2 paths, the x86-64 baseline
+
+    static void fillSse2(double* elements, size_t length, double value) {
+        __m128d v = _mm_set1_pd(value);
+        size_t i = 0;
+        for (; i + 2 <= length; i += 2) {
+            _mm_storeu_pd(elements + i, v);
+        }
+        fillScalar(elements + i, length - i, value);
+    }
+
+    static void fillSse2(int* elements, size_t length, int value) {
+        __m128i v = _mm_set1_epi32(value);
+        size_t i = 0;
+        for (; i + 4 <= length; i += 4) {
+            _mm_storeu_si128((__m128i*)(elements + i), v);
+        }
+        fillScalar(elements + i, length - i, value);
+    }
+
+    static ptrdiff_t indexOfSse2(const double* elements, size_t length, double value) {
+        __m128d v = _mm_set1_pd(value);
+        size_t i = 0;
+        for (; i + 4 <= length; i += 4) {
+            int mask = _mm_movemask_pd(_mm_cmpeq_pd(_mm_loadu_pd(elements + i), v))
+                       | (_mm_movemask_pd(_mm_cmpeq_pd(_mm_loadu_pd(elements + i + 2), v)) << 2);
+            if (mask != 0) {
+                return i + __builtin_ctz(mask);
+            }
+        }
+        ptrdiff_t rest = indexOfScalar(elements + i, length - i, value);
+        return rest < 0 ? -1 : i + rest;
+    }
+
+    static ptrdiff_t indexOfSse2(const int* elements, size_t length, int value) {
+        __m128i v = _mm_set1_epi32(value);
+        size_t i = 0;
+        for (; i + 4 <= length; i += 4) {
+            int mask = _mm_movemask_ps(_mm_castsi128_ps(
+                _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(elements + i)), v)));
+            if (mask != 0) {
+                return i + __builtin_ctz(mask);
+            }
+        }
+        ptrdiff_t rest = indexOfScalar(elements + i, length - i, value);
+        return rest < 0 ? -1 : i + rest;
+    }
+
+    static ptrdiff_t indexOfNaNSse2(const double* elements, size_t length) {
+        size_t i = 0;
+        for (; i + 2 <= length; i += 2) {
+            __m128d v = _mm_loadu_pd(elements + i);
+            int mask = _mm_movemask_pd(_mm_cmpunord_pd(v, v));
+            if (mask != 0) {
+                return i + __builtin_ctz(mask);
+            }
+        }
+        ptrdiff_t rest = indexOfNaNScalar(elements + i, length - i);
+        return rest < 0 ? -1 : i + rest;
+    }
+
+    static long long sumSse2(const int* elements, size_t length) {
+        __m128i accumulator = _mm_setzero_si128();
+        size_t i = 0;
+        for (; i + 4 <= length; i += 4) {
+            __m128i v = _mm_loadu_si128((const __m128i*)(elements + i));
+            __m128i sign = _mm_srai_epi32(v, 31);
+            accumulator = _mm_add_epi64(accumulator, _mm_unpacklo_epi32(v, sign));
+            accumulator = _mm_add_epi64(accumulator, _mm_unpackhi_epi32(v, sign));
+        }
+        long long lanes[2];
+        _mm_storeu_si128((__m128i*)lanes, accumulator);
+        return lanes[0] + lanes[1] + sumScalar(elements + i, length - i);
+    }
+
+    static double minMaxSse2(const double* elements, size_t length, bool maximum) {
+        if (length < 2) {
+            return minMaxScalar(elements, length, maximum);
+        }
+        __m128d result = _mm_loadu_pd(elements);
+        __m128d unordered = _mm_cmpunord_pd(result, result);
+        size_t i = 2;
+        for (; i + 2 <= length; i += 2) {
+            __m128d v = _mm_loadu_pd(elements + i);
+            unordered = _mm_or_pd(unordered, _mm_cmpunord_pd(v, v));
+            result = maximum ? _mm_max_pd(result, v) : _mm_min_pd(result, v);
+        }
+        if (_mm_movemask_pd(unordered) != 0) {
+            return NAN;
+        }
+        double lanes[2];
+        _mm_storeu_pd(lanes, result);
+        double folded = minMaxScalar(lanes, 2, maximum);
+        if (i < length) {
+            double tail = minMaxScalar(elements + i, length - i, maximum);
+            if (tail != tail) {
+                return tail;
+            }
+            folded = maximum ? std::max(folded, tail) : std::min(folded, tail);
+        }
+        return folded;
+    }
+
+    static __m128i selectSse2(__m128i mask, __m128i a, __m128i b) {
+        return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+    }
+
+    static int minMaxSse2(const int* elements, size_t length, bool maximum) {
+        if (length < 4) {
+            return minMaxScalar(elements, length, maximum);
+        }
+        __m128i result = _mm_loadu_si128((const __m128i*)elements);
+        size_t i = 4;
+        for (; i + 4 <= length; i += 4) {
+            __m128i v = _mm_loadu_si128((const __m128i*)(elements + i));
+            __m128i greater = _mm_cmpgt_epi32(v, result);
+            result = maximum ? selectSse2(greater, v, result) : selectSse2(greater, result, v);
+        }
+        int lanes[4];
+        _mm_storeu_si128((__m128i*)lanes, result);
+        int folded = minMaxScalar(lanes, 4, maximum);
+        if (i < length) {
+            int tail = minMaxScalar(elements + i, length - i, maximum);
+            folded = maximum ? std::max(folded, tail) : std::min(folded, tail);
+        }
+        return folded;
+    }
+
+    static __m128d applySse2(MapOperation operation, __m128d x, __m128d constant, bool constantOnLeft) {
+        __m128d a = constantOnLeft ? constant : x;
+        __m128d b = constantOnLeft ? x : constant;
+        switch (operation) {
+            case mapAdd:
+                return _mm_add_pd(a, b);
+            case mapSubtract:
+                return _mm_sub_pd(a, b);
+            case mapMultiply:
+                return _mm_mul_pd(a, b);
+            default:
+                return _mm_div_pd(a, b);
+        }
+    }
+
+    static void mapSse2(const double* source, double* destination, size_t length, MapOperation operation,
+                        double constant, bool constantOnLeft) {
+        __m128d c = _mm_set1_pd(constant);
+        size_t i = 0;
+        for (; i + 2 <= length; i += 2) {
+            _mm_storeu_pd(destination + i, applySse2(operation, _mm_loadu_pd(source + i), c, constantOnLeft));
+        }
+        mapScalar(source + i, destination + i, length - i, operation, constant, constantOnLeft);
+    }
+
+    static void mapSse2(const int* source, double* destination, size_t length, MapOperation operation,
+                        double constant, bool constantOnLeft) {
+        __m128d c = _mm_set1_pd(constant);
+        size_t i = 0;
+        for (; i + 2 <= length; i += 2) {
+            __m128d x = _mm_cvtepi32_pd(_mm_loadl_epi64((const __m128i*)(source + i)));
+            _mm_storeu_pd(destination + i, applySse2(operation, x, c, constantOnLeft));
+        }
+        mapScalar(source + i, destination + i, length - i, operation, constant, constantOnLeft);
+    }
+
+    // AVX2 paths, compiled for AVX2 regardless of the flags the runtime is built with
+
+    __attribute__((target("avx2")))
+    static void fillAvx2(double* elements, size_t length, double value) {
+        __m256d v = _mm256_set1_pd(value);
+        size_t i = 0;
+        for (; i + 4 <= length; i += 4) {
+            _mm256_storeu_pd(elements + i, v);
+        }
+        fillScalar(elements + i, length - i, value);
+    }
+
+    __attribute__((target("avx2")))
+    static void fillAvx2(int* elements, size_t length, int value) {
+        __m256i v = _mm256_set1_epi32(value);
+        size_t i = 0;
+        for (; i + 8 <= length; i += 8) {
+            _mm256_storeu_si256((__m256i*)(elements + i), v);
+        }
+        fillScalar(elements + i, length - i, value);
+    }
+
+    __attribute__((target("avx2")))
+    static ptrdiff_t indexOfAvx2(const double* elements, size_t length, double value) {
+        __m256d v = _mm256_set1_pd(value);
+        size_t i = 0;
+        for (; i + 8 <= length; i += 8) {
+            int mask = _mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(elements + i), v, _CMP_EQ_OQ))
+                       | (_mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(elements + i + 4), v, _CMP_EQ_OQ)) << 4);
+            if (mask != 0) {
+                return i + __builtin_ctz(mask);
+            }
+        }
+        ptrdiff_t rest = indexOfScalar(elements + i, length - i, value);
+        return rest < 0 ? -1 : i + rest;
+    }
+
+    __attribute__((target("avx2")))
+    static ptrdiff_t indexOfAvx2(const int* elements, size_t length, int value) {
+        __m256i v = _mm256_set1_epi32(value);
+        size_t i = 0;
+        for (; i + 8 <= length; i += 8) {
+            int mask = _mm256_movemask_ps(_mm256_castsi256_ps(
+                _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)(elements + i)), v)));
+            if (mask != 0) {
+                return i + __builtin_ctz(mask);
+            }
+        }
+        ptrdiff_t rest = indexOfScalar(elements + i, length - i, value);
+        return rest < 0 ? -1 : i + rest;
+    }
+
+    __attribute__((target("avx2")))
+    static ptrdiff_t indexOfNaNAvx2(const double* elements, size_t length) {
+        size_t i = 0;
+        for (; i + 4 <= length; i += 4) {
+            __m256d v = _mm256_loadu_pd(elements + i);
+            int mask = _mm256_movemask_pd(_mm256_cmp_pd(v, v, _CMP_UNORD_Q));
+            if (mask != 0) {
+                return i + __builtin_ctz(mask);
+            }
+        }
+        ptrdiff_t rest = indexOfNaNScalar(elements + i, length - i);
+        return rest < 0 ? -1 : i + rest;
+    }
+
+    __attribute__((target("avx2")))
+    static long long sumAvx2(const int* elements, size_t length) {
+        __m256i low = _mm256_setzero_si256();
+        __m256i high = _mm256_setzero_si256();
+        size_t i = 0;
+        for (; i + 8 <= length; i += 8) {
+            low = _mm256_add_epi64(low, _mm256_cvtepi32_epi64(_mm_loadu_si128((const __m128i*)(elements + i))));
+            high = _mm256_add_epi64(high, _mm256_cvtepi32_epi64(_mm_loadu_si128((const __m128i*)(elements + i + 4))));
+        }
+        long long lanes[4];
+        _mm256_storeu_si256((__m256i*)lanes, _mm256_add_epi64(low, high));
+        return lanes[0] + lanes[1] + lanes[2] + lanes[3] + sumScalar(elements + i, length - i);
+    }
+
+    __attribute__((target("avx2")))
+    static double minMaxAvx2(const double* elements, size_t length, bool maximum) {
+        if (length < 4) {
+            return minMaxScalar(elements, length, maximum);
+        }
+        __m256d result = _mm256_loadu_pd(elements);
+        __m256d unordered = _mm256_cmp_pd(result, result, _CMP_UNORD_Q);
+        size_t i = 4;
+        for (; i + 4 <= length; i += 4) {
+            __m256d v = _mm256_loadu_pd(elements + i);
+            unordered = _mm256_or_pd(unordered, _mm256_cmp_pd(v, v, _CMP_UNORD_Q));
+            result = maximum ? _mm256_max_pd(result, v) : _mm256_min_pd(result, v);
+        }
+        if (_mm256_movemask_pd(unordered) != 0) {
+            return NAN;
+        }
+        double lanes[4];
+        _mm256_storeu_pd(lanes, result);
+        double folded = minMaxScalar(lanes, 4, maximum);
+        if (i < length) {
+            double tail = minMaxScalar(elements + i, length - i, maximum);
+            if (tail != tail) {
+                return tail;
+            }
+            folded = maximum ? std::max(folded, tail) : std::min(folded, tail);
+        }
+        return folded;
+    }
+
+    __attribute__((target("avx2")))
+    static int minMaxAvx2(const int* elements, size_t length, bool maximum) {
+        if (length < 8) {
+            return minMaxScalar(elements, length, maximum);
+        }
+        __m256i result = _mm256_loadu_si256((const __m256i*)elements);
+        size_t i = 8;
+        for (; i + 8 <= length; i += 8) {
+            __m256i v = _mm256_loadu_si256((const __m256i*)(elements + i));
+            result = maximum ? _mm256_max_epi32(result, v) : _mm256_min_epi32(result, v);
+        }
+        int lanes[8];
+        _mm256_storeu_si256((__m256i*)lanes, result);
+        int folded = minMaxScalar(lanes, 8, maximum);
+        if (i < length) {
+            int tail = minMaxScalar(elements + i, length - i, maximum);
+            folded = maximum ? std::max(folded, tail) : std::min(folded, tail);
+        }
+        return folded;
+    }
+
+    __attribute__((target("avx2")))
+    static __m256d applyAvx2(MapOperation operation, __m256d x, __m256d constant, bool constantOnLeft) {
+        __m256d a = constantOnLeft ? constant : x;
+        __m256d b = constantOnLeft ? x : constant;
+        switch (operation) {
+            case mapAdd:
+                return _mm256_add_pd(a, b);
+            case mapSubtract:
+                return _mm256_sub_pd(a, b);
+            case mapMultiply:
+                return _mm256_mul_pd(a, b);
+            default:
+                return _mm256_div_pd(a, b);
+        }
+    }
+
+    __attribute__((target("avx2")))
+    static void mapAvx2(const double* source, double* destination, size_t length, MapOperation operation,
+                        double constant, bool constantOnLeft) {
+        __m256d c = _mm256_set1_pd(constant);
+        size_t i = 0;
+        for (; i + 4 <= length; i += 4) {
+            _mm256_storeu_pd(destination + i, applyAvx2(operation, _mm256_loadu_pd(source + i), c, constantOnLeft));
+        }
+        mapScalar(source + i, destination + i, length - i, operation, constant, constantOnLeft);
+    }
+
+    __attribute__((target("avx2")))
+    static void mapAvx2(const int* source, double* destination, size_t length, MapOperation operation,
+                        double constant, bool constantOnLeft) {
+        __m256d c = _mm256_set1_pd(constant);
+        size_t i = 0;
+        for (; i + 4 <= length; i += 4) {
+            __m256d x = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i*)(source + i)));
+            _mm256_storeu_pd(destination + i, applyAvx2(operation, x, c, constantOnLeft));
+        }
+        mapScalar(source + i, destination + i, length - i, operation, constant, constantOnLeft);
+    }
+#endif
+};
+
+SimdLevel Simd::detectLevel() {
+#ifdef ES_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return simdAvx2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return simdSse2;
+    }
+#endif
+    return simdScalar;
+}
+
+void Simd::setLevel(SimdLevel level) {
+    SimdLevel detected = detectLevel();
+    currentLevel() = level > detected ? detected : level;
+}
+
+const char* Simd::getLevelName(SimdLevel level) {
+    switch (level) {
+        case simdAvx2:
+            return "avx2";
+        case simdSse2:
+            return "sse2";
+        default:
+            return "scalar";
+    }
+}
+
+void Simd::fill(double* elements, size_t length, double value) {
+#ifdef ES_SIMD_X86
+    switch (currentLevel()) {
+        case simdAvx2:
+            return SimdKernels::fillAvx2(elements, length, value);
+        case simdSse2:
+            return SimdKernels::fillSse2(elements, length, value);
+        default:
+            break;
+    }
+#endif
+    SimdKernels::fillScalar(elements, length, value);
+}
+
+void Simd::fill(int* elements, size_t length, int value) {
+#ifdef ES_SIMD_X86
+    switch (currentLevel()) {
+        case simdAvx2:
+            return SimdKernels::fillAvx2(elements, length, value);
+        case simdSse2:
+            return SimdKernels::fillSse2(elements, length, value);
+        default:
+            break;
+    }
+#endif
+    SimdKernels::fillScalar(elements, length, value);
+}
+
+ptrdiff_t Simd::indexOf(const double* elements, size_t length, double value) {
+#ifdef ES_SIMD_X86
+    switch (currentLevel()) {
+        case simdAvx2:
+            return SimdKernels::indexOfAvx2(elements, length, value);
+        case simdSse2:
+            return SimdKernels::indexOfSse2(elements, length, value);
+        default:
+            break;
+    }
+#endif
+    return SimdKernels::indexOfScalar(elements, length, value);
+}
+
+ptrdiff_t Simd::indexOf(const int* elements, size_t length, int value) {
+#ifdef ES_SIMD_X86
+    switch (currentLevel()) {
+        case simdAvx2:
+            return SimdKernels::indexOfAvx2(elements, length, value);
+        case simdSse2:
+            return SimdKernels::indexOfSse2(elements, length, value);
+        default:
+            break;
+    }
+#endif
+    return SimdKernels::indexOfScalar(elements, length, value);
+}
+
+ptrdiff_t Simd::indexOfNaN(const double* elements, size_t length) {
+#ifdef ES_SIMD_X86
+    switch (currentLevel()) {
+        case simdAvx2:
+            return SimdKernels::indexOfNaNAvx2(elements, length);
+        case simdSse2:
+            return SimdKernels::indexOfNaNSse2(elements, length);
+        default:
+            break;
+    }
+#endif
+    return SimdKernels::indexOfNaNScalar(elements, length);
+}
+
+long long Simd::sum(const int* elements, size_t length) {
+#ifdef ES_SIMD_X86
+    switch (currentLevel()) {
+        case simdAvx2:
+            return SimdKernels::sumAvx2(elements, length);
+        case simdSse2:
+            return SimdKernels::sumSse2(elements, length);
+        default:
+            break;
+    }
+#endif
+    return SimdKernels::sumScalar(elements, length);
+}
+
+long long Simd::sum(const unsigned char* elements, size_t length) {
+    long long result = 0;
+    for (size_t i = 0; i < length; i++) {
+        result += elements[i];
+    }
+    return result;
+}
+
+double Simd::sum(const double* elements, size_t length, double initial) {
+    double result = initial;
+    for (size_t i = 0; i < length; i++) {
+        result += elements[i];
+    }
+    return result;
+}
+
+double Simd::min(const double* elements, size_t length) {
+    double result;
+#ifdef ES_SIMD_X86
+    switch (currentLevel()) {
+        case simdAvx2:
+            result = SimdKernels::minMaxAvx2(elements, length, false);
+            break;
+        case simdSse2:
+            result = SimdKernels::minMaxSse2(elements, length, false);
+            break;
+        default:
+            result = SimdKernels::minMaxScalar(elements, length, false);
+    }
+#else
+    result = SimdKernels::minMaxScalar(elements, length, false);
+#endif
+    return fixZeroSign(elements, length, result, true);
+}
+
+double Simd::max(const double* elements, size_t length) {
+    double result;
+#ifdef ES_SIMD_X86
+    switch (currentLevel()) {
+        case simdAvx2:
+            result = SimdKernels::minMaxAvx2(elements, length, true);
+            break;
+        case simdSse2:
+            result = SimdKernels::minMaxSse2(elements, length, true);
+            break;
+        default:
+            result = SimdKernels::minMaxScalar(elements, length, true);
+    }
+#else
+    result = SimdKernels::minMaxScalar(elements, length, true);
+#endif
+    return fixZeroSign(elements, length, result, false);
+}
+
+int Simd::min(const int* elements, size_t length) {
+#ifdef ES_SIMD_X86
+    switch (currentLevel()) {
+        case simdAvx2:
+            return SimdKernels::minMaxAvx2(elements, length, false);
+        case simdSse2:
+            return SimdKernels::minMaxSse2(elements, length, false);
+        default:
+            break;
+    }
+#endif
+    return SimdKernels::minMaxScalar(elements, length, false);
+}
+
+int Simd::max(const int* elements, size_t length) {
+#ifdef ES_SIMD_X86
+    switch (currentLevel()) {
+        case simdAvx2:
+            return SimdKernels::minMaxAvx2(elements, length, true);
+        case simdSse2:
+            return SimdKernels::minMaxSse2(elements, length, true);
+        default:
+            break;
+    }
+#endif
+    return SimdKernels::minMaxScalar(elements, length, true);
+}
+
+void Simd::map(const double* source, double* destination, size_t length, MapOperation operation,
+               double constant, bool constantOnLeft) {
+#ifdef ES_SIMD_X86
+    switch (currentLevel()) {
+        case simdAvx2:
+            return SimdKernels::mapAvx2(source, destination, length, operation, constant, constantOnLeft);
+        case simdSse2:
+            return SimdKernels::mapSse2(source, destination, length, operation, constant, constantOnLeft);
+        default:
+            break;
+    }
+#endif
+    SimdKernels::mapScalar(source, destination, length, operation, constant, constantOnLeft);
+}
+
+void Simd::map(const int* source, double* destination, size_t length, MapOperation operation,
+               double constant, bool constantOnLeft) {
+#ifdef ES_SIMD_X86
+    switch (currentLevel()) {
+        case simdAvx2:
+            return SimdKernels::mapAvx2(source, destination, length, operation, constant, constantOnLeft);
+        case simdSse2:
+            return SimdKernels::mapSse2(source, destination, length, operation, constant, constantOnLeft);
+        default:
+            break;
+    }
+#endif
+    SimdKernels::mapScalar(source, destination, length, operation, constant, constantOnLeft);
+}
+
+SimdLevel& Simd::currentLevel() {
+    static SimdLevel level = detectLevel();
+    return level;
+}
+
+double Simd::fixZeroSign(const double* elements, size_t length, double result, bool minimum) {
+    if (result != 0) {
+        return result;
+    }
+    for (size_t i = 0; i < length; i++) {
+        if (elements[i] == 0 && std::signbit(elements[i]) == minimum) {
+            return elements[i];
+        }
+    }
+    return result;
+}
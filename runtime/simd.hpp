@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstring>
+#include <stddef.h>
+
+/**
+ * Instruction set a kernel runs with, every level falls back to the one below it
+ */
+enum SimdLevel {
+    simdScalar,
+    simdSse2,
+    simdAvx2
+};
+
+/**
+ * Element-wise arithmetic with a constant, the shape of the map callbacks the compiler recognises
+ * (x => x + c, x => c - x, ...)
+ */
+enum MapOperation {
+    mapAdd,
+    mapSubtract,
+    mapMultiply,
+    mapDivide
+};
+
+/**
+ * Bulk kernels over contiguous int32, uint8 and double elements, used by the typed array and packed ESArray
+ * built-ins. Each kernel has a scalar, an SSE2 and an AVX2 version and dispatches on the level detected once at
+ * startup. Only kernels whose result does not depend on evaluation order are vectorised: floating point sums
+ * stay sequential because reassociating them changes the rounding, integer sums are exact in 64 bits.
+ * The versions themselves are in simd.cpp, only the dispatch is declared here.
+ */
+class Simd {
+public:
+    static SimdLevel detectLevel();
+
+    static SimdLevel getLevel() {
+        return currentLevel();
+    }
+
+    /**
+     * Forces a lower level, used to compare the paths against each other. Levels the CPU does not support are
+     * clamped to the detected one.
+     */
+    static void setLevel(SimdLevel level);
+
+    static const char* getLevelName(SimdLevel level);
+
+    /**
+     * Stores value into every element, the body of fill once its range has been resolved
+     */
+    static void fill(double* elements, size_t length, double value);
+
+    static void fill(int* elements, size_t length, int value);
+
+    static void fill(unsigned char* elements, size_t length, unsigned char value) {
+        memset(elements, value, length);
+    }
+
+    /**
+     * Same type copies (set, slice) are a memmove, which the C library already vectorises for every level
+     */
+    static void copy(void* destination, const void* source, size_t byteLength) {
+        memmove(destination, source, byteLength);
+    }
+
+    /**
+     * indexOf, strict equality so a NaN value is never found
+     */
+    static ptrdiff_t indexOf(const double* elements, size_t length, double value);
+
+    static ptrdiff_t indexOf(const int* elements, size_t length, int value);
+
+    static ptrdiff_t indexOf(const unsigned char* elements, size_t length, unsigned char value) {
+        const void* found = memchr(elements, value, length);
+        return found == NULL ? -1 : (const unsigned char*)found - elements;
+    }
+
+    /**
+     * Index of the first NaN, includes uses SameValueZero which does find NaN
+     */
+    static ptrdiff_t indexOfNaN(const double* elements, size_t length);
+
+    /**
+     * Exact sums of integer elements, accumulated in 64 bits
+     */
+    static long long sum(const int* elements, size_t length);
+
+    static long long sum(const unsigned char* elements, size_t length);
+
+    /**
+     * Sequential left fold, the order of a reduce((a, b) => a + b) callback
+     */
+    static double sum(const double* elements, size_t length, double initial);
+
+    /**
+     * 20.2.2.24 Math.min and 20.2.2.25 Math.max folded over the elements: any NaN makes the result NaN and
+     * -0 is smaller than +0. length must be at least 1.
+     */
+    static double min(const double* elements, size_t length);
+
+    static double max(const double* elements, size_t length);
+
+    static int min(const int* elements, size_t length);
+
+    static int max(const int* elements, size_t length);
+
+    /**
+     * destination[i] = source[i] op constant, or constant op source[i] when constantOnLeft.
+     * destination may alias source.
+     */
+    static void map(const double* source, double* destination, size_t length, MapOperation operation,
+                    double constant, bool constantOnLeft);
+
+    static void map(const int* source, double* destination, size_t length, MapOperation operation,
+                    double constant, bool constantOnLeft);
+
+    static double apply(MapOperation operation, double x, double constant, bool constantOnLeft) {
+        double a = constantOnLeft ? constant : x;
+        double b = constantOnLeft ? x : constant;
+        switch (operation) {
+            case mapAdd:
+                return a + b;
+            case mapSubtract:
+                return a - b;
+            case mapMultiply:
+                return a * b;
+            default:
+                return a / b;
+        }
+    }
+
+private:
+    static SimdLevel& currentLevel();
+
+    /**
+     * The vector min/max instructions do not order -0 and +0, a zero result takes its sign from the elements
+     */
+    static double fixZeroSign(const double* elements, size_t length, double result, bool minimum);
+};
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <vector>
+#include "../type/type.hpp"
+
+/**
+ * 8.1.1.1 Declarative Environment Records, for the let and const bindings of a block that an arrow function nested
+ * in it captures, see LexicalScope. Each binding is a slot, NULL until its declaration runs, and the environment of
+ * the enclosing block is the prototype. The bindings nothing captures stay C locals.
+ */
+class Environment : public ESObject {
+private:
+    std::vector<ESValue*> bindings;
+
+public:
+    Environment(ESValue* parent, size_t size) : ESObject(static_cast<Environment*>(parent)), bindings(size, NULL) {}
+
+    /**
+     * The environment hops blocks out from environment
+     */
+    static Environment* of(ESValue* environment, size_t hops) {
+        ESObject* scope = static_cast<Environment*>(environment);
+        for (; hops > 0; hops--) {
+            scope = scope->getPrototype();
+        }
+        return static_cast<Environment*>(scope);
+    }
+
+    ESValue* getBinding(size_t slot) {
+        return bindings[slot];
+    }
+
+    ESValue* setBinding(size_t slot, ESValue* value) {
+        ESValue* previous = bindings[slot];
+        bindings[slot] = value;
+        writeBarrier(&bindings[slot], previous);
+        return value;
+    }
+
+    void visitReferences(Heap::ReferenceVisitor& visitor) {
+        ESObject::visitReferences(visitor);
+        for (size_t i = 0; i < bindings.size(); i++) {
+            if (bindings[i] != NULL) {
+                visitor.visit(&bindings[i]);
+            }
+        }
+    }
+};
+
+/**
+ * 9.2.5 FunctionInitialize of an arrow function created where an environment can be reached: its code takes that
+ * environment as its first argument
+ */
+class Closure : public Function {
+public:
+    typedef ESValue* (*ClosureCode)(ESValue* closure, ESValue** arguments, int argumentCount);
+
+private:
+    ClosureCode closureCode;
+    ESValue* environment;
+
+public:
+    Closure(ClosureCode code, const char* name, int length, ESValue* environment)
+        : Function(NULL, name, length), closureCode(code), environment(environment) {
+        writeBarrier(environment);
+    }
+
+    bool isCallable() {
+        return true;
+    }
+
+    ESValue* call(ESValue** arguments, int argumentCount) {
+        return closureCode(environment, arguments, argumentCount);
+    }
+
+    void visitReferences(Heap::ReferenceVisitor& visitor) {
+        ESObject::visitReferences(visitor);
+        visitor.visit(&environment);
+    }
+};
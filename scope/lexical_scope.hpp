@@ -4,18 +4,48 @@
 #pragma once
 
 #include <map>
+#include <set>
 #include "reference.hpp"
 
 class LexicalScope {
+public:
+    /**
+     * 13.3.1 Let and Const Declarations, as the compiler lowers them: a let or const declared directly in the scope
+     * is a C local of the function the scope is generated in, the register registerNumber, which holds NULL until its
+     * declaration runs. initialized is set once the declaration has been generated: statements run in the order they
+     * are generated and nothing jumps into a block past its start, so every later use in the same function follows
+     * the declaration and needs no check of the temporal dead zone.
+     * A binding an arrow function nested in the scope captures is captured instead, slot registerNumber of the
+     * environment of the scope, see Environment. The var names of a function body are bound in its scope the same
+     * way, initialized from the start, see StatementList::declareVariables.
+     */
+    struct LexicalBinding {
+        const void* declaration;
+        unsigned int registerNumber;
+        bool constant;
+        bool initialized;
+        bool captured;
+    };
+
 protected:
     LexicalScope* parentScope;
     std::map<std::string, Reference*> symbolTable;
+    std::map<std::string, LexicalBinding> lexicalBindings;
+    // the let and const declarations a nested function refers to, which cannot be C locals of another function: they
+    // are the slots of the environment of the scope, except in the statement list of the script itself, where they
+    // stay properties of the global object. Unlike the bindings they are kept from one generation to the next.
+    std::set<std::string> capturedBindings;
+    // the register holding the environment of the scope, or 0 when nothing it declares is captured
+    unsigned int environmentRegister;
+    size_t environmentSize;
 
 public:
     LexicalScope() {
         // printf("test\n");
         parentScope = NULL;
         symbolTable.clear();
+        environmentRegister = 0;
+        environmentSize = 0;
     }
 
     Reference* resolveHere(std::string symbol) {
@@ -40,4 +70,59 @@ public:
     void addToSymbolTable(std::string symbol, Reference* reference) {
         symbolTable[symbol] = reference;
     }
+
+    LexicalBinding* resolveLexical(const std::string& name) {
+        std::map<std::string, LexicalBinding>::iterator it = lexicalBindings.find(name);
+        return it != lexicalBindings.end() ? &it->second : NULL;
+    }
+
+    /**
+     * The binding of name that declaration made in this scope, or NULL when it is a property of the global object
+     */
+    LexicalBinding* resolveDeclared(const std::string& name, const void* declaration) {
+        LexicalBinding* binding = resolveLexical(name);
+        return binding != NULL && binding->declaration == declaration ? binding : NULL;
+    }
+
+    void declareLexical(const std::string& name, const void* declaration, unsigned int registerNumber, bool constant) {
+        LexicalBinding binding = {declaration, registerNumber, constant, false, false};
+        lexicalBindings[name] = binding;
+    }
+
+    /**
+     * Declares a captured binding in the next slot of the environment of the scope
+     */
+    void declareCaptured(const std::string& name, const void* declaration, bool constant) {
+        LexicalBinding binding = {declaration, (unsigned int)environmentSize++, constant, false, true};
+        lexicalBindings[name] = binding;
+    }
+
+    void clearLexical() {
+        lexicalBindings.clear();
+        environmentRegister = 0;
+        environmentSize = 0;
+    }
+
+    unsigned int getEnvironmentRegister() {
+        return environmentRegister;
+    }
+
+    size_t getEnvironmentSize() {
+        return environmentSize;
+    }
+
+    void setEnvironmentRegister(unsigned int registerNumber) {
+        environmentRegister = registerNumber;
+    }
+
+    bool isCaptured(const std::string& name) {
+        return capturedBindings.count(name) > 0;
+    }
+
+    /**
+     * Whether name was not captured before
+     */
+    bool capture(const std::string& name) {
+        return capturedBindings.insert(name).second;
+    }
 };
\ No newline at end of file
@@ -28,14 +28,18 @@ public:
 
     Reference(String* referencedName) {
      this->referencedName = referencedName;
-     this->base = new Undefined();
-     this->strict = new Boolean(false);
+     // a Reference is not an object the write barrier sees, so its components are allocated old
+     this->base = new (Heap::tenured) Undefined();
+     this->strict = new (Heap::tenured) Boolean(false);
+     Heap::barrier(referencedName);
     }
 
     Reference(String* referencedNames, ESValue* base) {
      this->referencedName = referencedNames;
      this->base = base;
-     this->strict = new Boolean(false);
+     this->strict = new (Heap::tenured) Boolean(false);
+     Heap::barrier(referencedName);
+     Heap::barrier(base);
     }
 
     Type getType() {
@@ -46,6 +50,12 @@ public:
      return false;
     }
 
+    void visitReferences(Heap::ReferenceVisitor& visitor) {
+     visitor.visit(&base);
+     visitor.visit((ESValue**)&referencedName);
+     visitor.visit((ESValue**)&strict);
+    }
+
     String* toString() {
      return referencedName;
     }
@@ -41,12 +41,21 @@ int main(int argc, char* argv[])
             case CONST:
                 printf("CONST\n");
                 break;
+            case LET:
+                printf("LET\n");
+                break;
             case FUNCTION:
                 printf("FUNCTION\n");
                 break;
             case ARROW_FUNCTION:
                 printf("ARROW_FUNCTION\n");
                 break;
+            case CLASS:
+                printf("CLASS\n");
+                break;
+            case THIS:
+                printf("THIS\n");
+                break;
 // assignment
             case ASSIGNMENT:
                 printf("=\n");
@@ -156,6 +165,9 @@ int main(int argc, char* argv[])
             case SEMICOLON:
                 printf(";\n");
                 break;
+            case ELLIPSIS:
+                printf("...\n");
+                break;
             case COLON:
                 printf(":\n");
                 break;
@@ -219,6 +231,9 @@ int main(int argc, char* argv[])
 			case WITH:
 				printf("WITH\n");
 				break;
+			case NEW:
+				printf("NEW\n");
+				break;
 
 // line terminators, print nothing
             // case LINE_FEED:
@@ -0,0 +1,18 @@
+let a = [1, 2, 3];
+a[1] = 0 * (0 - 1);
+console.log(1 / a[1], a[0] + a[2]);
+let b = [];
+b[4294967295] = 'big';
+b['4294967295'] = 'bigger';
+b[1.5] = 'fraction';
+b['0'] = 'zero';
+console.log(b.length, b[0], b[4294967295], b['1.5']);
+let c = [7];
+c['1'] = 8;
+c[2] = 9;
+console.log(c.length, c[1], c['2']);
+let e = [1, 2];
+e[4294967294] = 7;
+e[3000] = 'x';
+e[2] = 3;
+console.log(e.length, e[4294967294], e[3000], e[2], e[5]);
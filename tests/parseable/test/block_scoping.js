@@ -0,0 +1,71 @@
+let total = 0;
+const limit = 4;
+let i = 0;
+while (i < limit) {
+	console.log(i);
+	let square = i * i;
+	const doubled = square + square;
+	total = total + doubled;
+	i = i + 1;
+}
+console.log(total);
+let x = 1;
+{
+	console.log("block");
+	let x = 2;
+	console.log(x);
+}
+console.log(x);
+let [a, b] = [3, 4];
+const {c, d} = {c: 5, d: 6};
+console.log(a + b + c + d);
+function f(n) {
+	let m = n + 1;
+	const k = m * 2;
+	return k;
+}
+console.log(f(3));
+let shared = 10;
+function reads(z) {
+	return shared;
+}
+shared = shared + 1;
+console.log(reads(0));
+function early(z) {
+	let late = 1;
+	return late;
+}
+console.log(early(0));
+const fixed = 1;
+console.log(fixed);
+let u;
+console.log(u);
+function* count(n) {
+	let i = 0;
+	while (i < n) {
+		console.log("step");
+		const next = i + 1;
+		yield i;
+		i = next;
+	}
+}
+const counter = count(3);
+console.log(counter.next().value);
+console.log(counter.next().value);
+console.log(counter.next().value);
+console.log(counter.next().done);
+let base = 5;
+const add = (n) => n + base;
+console.log(add(1));
+function outer(z) {
+	let hidden = z * 3;
+	const inner = (y) => y + hidden;
+	return inner(1);
+}
+console.log(outer(2));
+let k = 1;
+function shadow(z) {
+	let k = z + 10;
+	return k;
+}
+console.log(shadow(1) + k);
@@ -0,0 +1,6 @@
+values = new Float64Array(8);
+values.fill(1.5, 4);
+doubled = values.map((x) => x * 2);
+total = doubled.reduce((a, b) => a + b);
+largest = values.reduce((a, b) => Math.max(a, b), 0);
+found = values.indexOf(1.5);
@@ -0,0 +1,48 @@
+function mk(v) {
+	let h = v;
+	return (y) => y + h;
+}
+let add2 = mk(2);
+let add5 = mk(5);
+console.log(add2(3), add5(3), add2(10));
+function counter(start) {
+	let n = start;
+	const step = 2;
+	let next = (x) => n = n + step;
+	next(0);
+	console.log(n);
+	return next;
+}
+let c1 = counter(0);
+let c2 = counter(100);
+console.log(c1(0), c1(0), c2(0));
+function nested(a) {
+	let outer = a;
+	let twice = outer + outer;
+	return (b) => (c) => twice + c;
+}
+console.log(nested(1)(10)(100), nested(2)(20)(200));
+function tdz(v) {
+	let early = (x) => late + x;
+	let late = v;
+	return early(1);
+}
+console.log(tdz(41));
+let top = 7;
+function readTop(x) {
+	return top + x;
+}
+console.log(readTop(1));
+let loopReaders = [];
+let n = 0;
+while (n < 3) {
+	let seen = n;
+	loopReaders[n] = (y) => seen;
+	n = n + 1;
+}
+console.log(loopReaders[0](0), loopReaders[1](0), loopReaders[2](0));
+{
+	let hidden = 4;
+	let readHidden = (y) => hidden + y;
+	console.log(readHidden(1));
+}
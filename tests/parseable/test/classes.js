@@ -0,0 +1,16 @@
+class Point {
+	constructor(x, y) {
+		this.x = x;
+		this.y = y;
+	}
+	norm() {
+		return this.x * this.x + this.y * this.y;
+	}
+	scale(k) {
+		this.x *= k;
+		this.y = this.y * k;
+		return this.norm();
+	}
+}
+p = new Point(3, 4);
+console.log(p.norm(), p.scale(2), p.x);
@@ -0,0 +1,9 @@
+x = 1;
+y = x == 1;
+y = x != 2;
+y = x === 1;
+y = x !== 2;
+y = x < 2;
+y = x > 0;
+y = x <= 1;
+y = x >= 1;
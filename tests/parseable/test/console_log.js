@@ -0,0 +1,3 @@
+message = "logged";
+console.log(message, 0.5, [1, 2]);
+console.log();
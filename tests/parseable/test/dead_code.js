@@ -0,0 +1,11 @@
+function f(a) {
+	return 1;
+	x = 2;
+}
+x = 1;
+while (x) {
+	return;
+	x = 0;
+}
+1 + 2 * 3;
+"unused" + 4;
@@ -0,0 +1,10 @@
+var point = {x: 3, y: 4};
+const {x, y, z = 0} = point;
+const [first, , third, ...others] = [1, 2, 3, 4, 5];
+let {x: across, w: [down] = [y]} = point;
+var a = 1, b = 2;
+[a, b] = [b, a];
+console.log(x + y + z, first, third, others, across, down, a, b);
+const [h, i] = "hi";
+const [lead, ...letters] = "héllo😀";
+console.log(h, i, lead, letters);
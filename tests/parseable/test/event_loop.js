@@ -0,0 +1,6 @@
+setTimeout(message => console.log(message), 10, "timeout");
+queueMicrotask(() => console.log("microtask"));
+p = new Promise((resolve, reject) => resolve(1));
+p.then(x => x + 1).then(x => console.log("then", x)).catch(reason => console.log(reason));
+Promise.reject("rejected").catch(reason => console.log(reason));
+console.log("top level");
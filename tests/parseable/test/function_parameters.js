@@ -0,0 +1,16 @@
+function add(a, b) {
+	return a + b;
+}
+
+sum = add(1, 2);
+console.log(sum);
+
+function scoped(x) {
+	var copy = x;
+	if (x > 1) {
+		var [low, high] = [x, x + 1];
+	}
+	var unset;
+	return copy + low + high;
+}
+console.log(scoped(3));
@@ -0,0 +1,38 @@
+function* count(from, to) {
+	while (from < to) {
+		yield from;
+		from = from + 1;
+	}
+	return "done";
+}
+function* both(n) {
+	received = yield n * n;
+	yield* count(0, received);
+	yield* [7, 8];
+}
+async function twice(x) {
+	y = await x;
+	return y * 2;
+}
+g = both(3);
+console.log(g.next().value, g.next(2).value);
+twice(20).then(v => console.log(v));
+function* fib(n) {
+	var a = 0;
+	var b = 1;
+	while (n > 0) {
+		yield a;
+		var t = a + b;
+		a = b;
+		b = t;
+		n = n - 1;
+	}
+	return "end";
+}
+first = fib(3);
+second = fib(3);
+first.next();
+second.next();
+first.next();
+first.next();
+console.log(second.next().value);
@@ -0,0 +1,6 @@
+m = Math;
+p = m.PI;
+i = Infinity;
+console.log(p, Math.SQRT2, i);
+Math = 1;
+console.log(Math);
@@ -0,0 +1,5 @@
+var x = 1;
+var s = x + x + x + x + x + x + x + x + x + x + x + x + x + x + x + x + x + x + x + x + x + x + x + x + x + x + x + x + x + x + x + x + x + x + x + x + x + x + x + x + x + x + x + x + x + x + x + x + x + x + x + x + x + x + x + x + x + x + x + x;
+console.log(s);
+var t = x + "a" + x + "a" + x + "a" + x + "a" + x + "a" + x + "a" + x + "a" + x + "a" + x + "a" + x + "a" + x + "a" + x + "a" + x + "a" + x + "a" + x + "a" + x + "a" + x + "a" + x + "a" + x + "a" + x + "a";
+console.log(t);
@@ -0,0 +1,31 @@
+let f = [1, 2, 3, 4];
+console.log(f.map(x => x * x));
+console.log(f.map(x => x + x));
+console.log(f.reduce((a, b) => a * b));
+console.log(f.map((x, i) => x * i));
+console.log(f.reduce((a, b) => a * b, 10));
+function scaled(k) {
+	let factor = k;
+	return f.map((x) => x * factor);
+}
+console.log(scaled(3));
+let t = new Int32Array(3);
+t[0] = 5;
+t[1] = 6;
+t[2] = 7;
+console.log(t.map(x => x * x));
+console.log(t.reduce((a, b) => a - b));
+let words = ["a", "b"];
+console.log(words.map(x => x + 1));
+let mixed = [1, "2", 3];
+console.log(mixed.map(x => x + 1), mixed.map(x => 1 + x), mixed.map(x => x * 2));
+class Box {
+	map(f) {
+		return f(3);
+	}
+	reduce(f, initial) {
+		return f(initial, 5);
+	}
+}
+let b = new Box();
+console.log(b.map(x => x + 1), b.reduce((a, c) => a + c, 2));
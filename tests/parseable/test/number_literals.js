@@ -0,0 +1,9 @@
+exponent = 1e3;
+fraction = .5;
+trailing = 5.;
+hex = 0x1F;
+octal = 0o17;
+binary = 0b101;
+large = 3000000000;
+small = 2.5e-3;
+console.log(exponent, fraction, trailing, hex, octal, binary, large, small);
@@ -0,0 +1,6 @@
+function mk(v) {
+	let h = v;
+	return (y) => y + h;
+}
+let add2 = mk(2);
+console.log(add2(3));
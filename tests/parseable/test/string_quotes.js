@@ -0,0 +1,4 @@
+let s = 'say "hi"';
+let d = "it's";
+console.log(s, d, 'a\'b', '\\"');
+console.log(1e999, 0 - 1e999, [1.5, 1e999]);
@@ -0,0 +1,12 @@
+op = "sub";
+switch (op) {
+    case "add":
+        op = 1;
+        break;
+    case "sub":
+        op = 2;
+        break;
+    case "mul":
+        op = 3;
+        break;
+}
@@ -0,0 +1,4 @@
+let pair = `😀 \u{D83D}\u{DE00} \uD83D\
+\uDE00`;
+let padded = `\u{0000041}\u{00000000062} \u{1F600}`;
+console.log(pair, padded);
@@ -0,0 +1,5 @@
+html = `<p class="x">
+	line\ttwo A\x42C\u{1F600} \`tick\` \\ end \
+continued
+</p>`;
+console.log(html);
@@ -0,0 +1,35 @@
+var zero = 0;
+var empty = "";
+var y = 1 > 2;
+var n = 3;
+if (0) {
+	console.log("0 is true");
+} else {
+	console.log("0 is false");
+}
+if (empty) {
+	console.log("empty string is true");
+} else {
+	console.log("empty string is false");
+}
+if ("a") {
+	console.log("a is true");
+}
+if (y) {
+	console.log("1 > 2 is true");
+} else {
+	console.log("1 > 2 is false");
+}
+if (zero / zero) {
+	console.log("NaN is true");
+} else {
+	console.log("NaN is false");
+}
+if (0.5) {
+	console.log("0.5 is true");
+}
+while (n) {
+	console.log(n);
+	n = n - 1;
+}
+console.log(n);
@@ -0,0 +1,4 @@
+buffer = new ArrayBuffer(16);
+values = new Float64Array(buffer);
+values[0] = 1.5;
+values[1] += values[0];
@@ -0,0 +1,9 @@
+x = 7;
+y = x * 3;
+z = (x - 1) * 2;
+s = "n=" + x;
+t = 1 + 2 + "px";
+m = 7 % 3;
+x += 1;
+u = x / 0;
+console.log(x, y, z, s, t, m, u, "4" * "2", 0.1 + 0.2);
@@ -0,0 +1,310 @@
+#include "conversion.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<charconv>)
+#include <charconv>
+#endif
+#endif
+
+size_t NumberConversion::toString(double value, char* buffer) {
+    if (value != value) {
+        return copy(buffer, "NaN");
+    }
+    if (value == 0) {
+        return copy(buffer, "0");
+    }
+    char* out = buffer;
+    if (value < 0) {
+        *out++ = '-';
+        value = -value;
+    }
+    if (value == INFINITY) {
+        return out - buffer + copy(out, "Infinity");
+    }
+
+    char digits[MAX_NUMBER_LENGTH];
+    int k;
+    int n;
+    shortestDigits(value, digits, &k, &n);
+
+    if (k <= n && n <= 21) {
+        memcpy(out, digits, k);
+        out += k;
+        for (int i = 0; i < n - k; i++) {
+            *out++ = '0';
+        }
+    } else if (0 < n && n <= 21) {
+        memcpy(out, digits, n);
+        out += n;
+        *out++ = '.';
+        memcpy(out, digits + n, k - n);
+        out += k - n;
+    } else if (-6 < n && n <= 0) {
+        *out++ = '0';
+        *out++ = '.';
+        for (int i = 0; i < -n; i++) {
+            *out++ = '0';
+        }
+        memcpy(out, digits, k);
+        out += k;
+    } else {
+        *out++ = digits[0];
+        if (k > 1) {
+            *out++ = '.';
+            memcpy(out, digits + 1, k - 1);
+            out += k - 1;
+        }
+        *out++ = 'e';
+        *out++ = n - 1 < 0 ? '-' : '+';
+        out += sprintf(out, "%d", n - 1 < 0 ? 1 - n : n - 1);
+    }
+    *out = '\0';
+    return out - buffer;
+}
+
+void NumberConversion::shortestDigits(double value, char* digits, int* k, int* n) {
+    char scientific[MAX_NUMBER_LENGTH];
+#if defined(__cpp_lib_to_chars)
+    std::to_chars_result result = std::to_chars(scientific, scientific + sizeof(scientific) - 1, value,
+                                                std::chars_format::scientific);
+    *result.ptr = '\0';
+#else
+    // without a shortest round trip printer, take the fewest significant digits that read back exactly
+    for (int precision = 1; precision <= 17; precision++) {
+        snprintf(scientific, sizeof(scientific), "%.*e", precision - 1, value);
+        if (strtod(scientific, NULL) == value) {
+            break;
+        }
+    }
+#endif
+    int count = 0;
+    const char* c = scientific;
+    for (; *c != 'e'; c++) {
+        if (*c != '.') {
+            digits[count++] = *c;
+        }
+    }
+    while (count > 1 && digits[count - 1] == '0') {
+        count--;
+    }
+    digits[count] = '\0';
+    *k = count;
+    *n = atoi(c + 1) + 1;
+}
+
+double NumberConversion::stringToNumber(const char* begin, const char* end) {
+    while (begin < end) {
+        size_t length = whiteSpaceLength(begin, end);
+        if (length == 0) {
+            break;
+        }
+        begin += length;
+    }
+    while (end > begin) {
+        size_t length = trailingWhiteSpaceLength(begin, end);
+        if (length == 0) {
+            break;
+        }
+        end -= length;
+    }
+    if (begin == end) {
+        return 0;
+    }
+
+    bool negative = false;
+    const char* digits = begin;
+    if (*digits == '+' || *digits == '-') {
+        negative = *digits == '-';
+        digits++;
+        // the sign only applies to StrDecimalLiteral, not to the 0x 0o 0b forms
+        if (end - digits > 1 && digits[0] == '0' && isRadixPrefix(digits[1])) {
+            return NAN;
+        }
+    }
+    if (end - digits == 8 && memcmp(digits, "Infinity", 8) == 0) {
+        return negative ? -INFINITY : INFINITY;
+    }
+    double value;
+    if (!parseNumericLiteral(digits, end, &value)) {
+        return NAN;
+    }
+    return negative ? -value : value;
+}
+
+double NumberConversion::stringToNumber(const std::string& text) {
+    return stringToNumber(text.data(), text.data() + text.size());
+}
+
+bool NumberConversion::parseNumericLiteral(const char* begin, const char* end, double* value) {
+    if (end - begin > 2 && begin[0] == '0' && isRadixPrefix(begin[1])) {
+        return parseRadix(begin + 2, end, radixBits(begin[1]), value);
+    }
+    if (scanDecimal(begin, end) != end) {
+        return false;
+    }
+#if defined(__cpp_lib_to_chars)
+    std::from_chars_result result = std::from_chars(begin, end, *value);
+    if (result.ec == std::errc()) {
+        return true;
+    }
+    // out of range, strtod gives the infinity or zero it rounds to
+#endif
+    char buffer[128];
+    if ((size_t)(end - begin) < sizeof(buffer)) {
+        memcpy(buffer, begin, end - begin);
+        buffer[end - begin] = '\0';
+        *value = strtod(buffer, NULL);
+    } else {
+        std::string text(begin, end);
+        *value = strtod(text.c_str(), NULL);
+    }
+    return true;
+}
+
+bool NumberConversion::isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+bool NumberConversion::isRadixPrefix(char c) {
+    return c == 'x' || c == 'X' || c == 'o' || c == 'O' || c == 'b' || c == 'B';
+}
+
+int NumberConversion::radixBits(char prefix) {
+    switch (prefix) {
+        case 'x':
+        case 'X':
+            return 4;
+        case 'o':
+        case 'O':
+            return 3;
+        default:
+            return 1;
+    }
+}
+
+int NumberConversion::digitValue(char c) {
+    if (isDigit(c)) {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return 16;
+}
+
+const char* NumberConversion::scanDecimal(const char* begin, const char* end) {
+    const char* p = begin;
+    size_t digits = 0;
+    while (p < end && isDigit(*p)) {
+        p++;
+        digits++;
+    }
+    if (p < end && *p == '.') {
+        p++;
+        while (p < end && isDigit(*p)) {
+            p++;
+            digits++;
+        }
+    }
+    if (digits == 0) {
+        return begin;
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char* exponent = p + 1;
+        if (exponent < end && (*exponent == '+' || *exponent == '-')) {
+            exponent++;
+        }
+        if (exponent < end && isDigit(*exponent)) {
+            p = exponent;
+            while (p < end && isDigit(*p)) {
+                p++;
+            }
+        }
+    }
+    return p;
+}
+
+bool NumberConversion::parseRadix(const char* begin, const char* end, int bits, double* value) {
+    uint64_t mantissa = 0;
+    int dropped = 0;
+    bool sticky = false;
+    for (const char* p = begin; p < end; p++) {
+        int digit = digitValue(*p);
+        if (digit >= (1 << bits)) {
+            return false;
+        }
+        for (int bit = bits - 1; bit >= 0; bit--) {
+            int set = (digit >> bit) & 1;
+            if (mantissa >> 63) {
+                sticky = sticky || set;
+                dropped++;
+            } else {
+                mantissa = (mantissa << 1) | set;
+            }
+        }
+    }
+    if (sticky) {
+        mantissa |= 1;
+    }
+    *value = ldexp((double)mantissa, dropped);
+    return true;
+}
+
+size_t NumberConversion::whiteSpaceLength(const char* p, const char* end) {
+    if (p >= end) {
+        return 0;
+    }
+    unsigned char c = *p;
+    if (c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f') {
+        return 1;
+    }
+    const unsigned char* u = (const unsigned char*)p;
+    if (c == 0xC2 && end - p >= 2 && u[1] == 0xA0) {
+        // U+00A0 NO-BREAK SPACE
+        return 2;
+    }
+    if (end - p < 3) {
+        return 0;
+    }
+    if (c == 0xEF && u[1] == 0xBB && u[2] == 0xBF) {
+        // U+FEFF ZERO WIDTH NO-BREAK SPACE
+        return 3;
+    }
+    if (c == 0xE1 && u[1] == 0x9A && u[2] == 0x80) {
+        // U+1680 OGHAM SPACE MARK
+        return 3;
+    }
+    if (c == 0xE2 && u[1] == 0x80 && ((u[2] >= 0x80 && u[2] <= 0x8A) || u[2] == 0xA8 || u[2] == 0xA9 || u[2] == 0xAF)) {
+        // U+2000 to U+200A, LINE SEPARATOR, PARAGRAPH SEPARATOR and U+202F
+        return 3;
+    }
+    if ((c == 0xE2 && u[1] == 0x81 && u[2] == 0x9F) || (c == 0xE3 && u[1] == 0x80 && u[2] == 0x80)) {
+        // U+205F and U+3000
+        return 3;
+    }
+    return 0;
+}
+
+size_t NumberConversion::trailingWhiteSpaceLength(const char* begin, const char* end) {
+    for (size_t length = 1; length <= 3 && length <= (size_t)(end - begin); length++) {
+        if (whiteSpaceLength(end - length, end) == length) {
+            return length;
+        }
+    }
+    return 0;
+}
+
+size_t NumberConversion::copy(char* buffer, const char* text) {
+    size_t length = strlen(text);
+    memcpy(buffer, text, length + 1);
+    return length;
+}
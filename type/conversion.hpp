@@ -0,0 +1,77 @@
+#pragma once
+
+#include <stddef.h>
+#include <string>
+
+/**
+ * Conversions between Numbers and their text forms that allocate nothing and do not depend on the locale.
+ * The digit work is done by std::to_chars (shortest round trip) and std::from_chars (correctly rounded)
+ * where the standard library has them for floating point, with C library fallbacks otherwise.
+ */
+class NumberConversion {
+public:
+    /**
+     * Enough for any NumberToString result: sign, 17 digits, point, up to 6 leading zeros and an exponent
+     */
+    static const size_t MAX_NUMBER_LENGTH = 32;
+
+    /**
+     * 7.1.12.1 ToString Applied to the Number Type
+     * http://www.ecma-international.org/ecma-262/6.0/#sec-tostring-applied-to-the-number-type
+     * Writes the shortest decimal that reads back as the same double, laid out the way the spec prescribes.
+     * buffer must hold MAX_NUMBER_LENGTH characters, the result is NUL terminated and its length returned.
+     */
+    static size_t toString(double value, char* buffer);
+
+    /**
+     * The decimal digits s (k of them, no trailing zeros) and exponent n of a positive finite value such that
+     * value = s * 10^(n - k) and k is as small as possible, the terms of 7.1.12.1 step 5
+     */
+    static void shortestDigits(double value, char* digits, int* k, int* n);
+
+    /**
+     * 7.1.3.1 ToNumber Applied to the String Type
+     * http://www.ecma-international.org/ecma-262/6.0/#sec-tonumber-applied-to-the-string-type
+     * Surrounding white space and line terminators are ignored, an empty string is 0 and anything that is not a
+     * StringNumericLiteral is NaN.
+     */
+    static double stringToNumber(const char* begin, const char* end);
+
+    static double stringToNumber(const std::string& text);
+
+    /**
+     * 11.8.3 Numeric Literals without a sign: decimal (with fraction and exponent), 0x, 0o and 0b.
+     * Returns false unless the whole of [begin, end) is one literal.
+     */
+    static bool parseNumericLiteral(const char* begin, const char* end, double* value);
+
+private:
+    static bool isDigit(char c);
+
+    static bool isRadixPrefix(char c);
+
+    static int radixBits(char prefix);
+
+    static int digitValue(char c);
+
+    /**
+     * End of the longest StrUnsignedDecimalLiteral at begin (other than Infinity):
+     * DecimalDigits [. [DecimalDigits]] [ExponentPart] or . DecimalDigits [ExponentPart]
+     */
+    static const char* scanDecimal(const char* begin, const char* end);
+
+    /**
+     * Digits of a power of two radix, correctly rounded: the top 64 bits are kept and any set bit below them
+     * is folded into the lowest one, which is enough to round ties the same way the exact value would
+     */
+    static bool parseRadix(const char* begin, const char* end, int bits, double* value);
+
+    /**
+     * 11.2 White Space and 11.3 Line Terminators, in UTF-8. Returns the byte length of the one at p, or 0.
+     */
+    static size_t whiteSpaceLength(const char* p, const char* end);
+
+    static size_t trailingWhiteSpaceLength(const char* begin, const char* end);
+
+    static size_t copy(char* buffer, const char* text);
+};
@@ -0,0 +1,1116 @@
+#include "heap.hpp"
+
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "type.hpp"
+
+typedef std::chrono::steady_clock Clock;
+
+__thread Heap::Nursery Heap::nursery;
+__thread bool Heap::marking = false;
+
+/**
+ * What a minor collection updates of an object of the remembered set, owner being the position of the object there:
+ * one slot, the generic elements from begin up to end of an array, or all of its slots when neither is set
+ */
+struct RememberedSlots {
+    size_t owner;
+    ESValue** slot;
+    uint32_t begin;
+    uint32_t end;
+};
+
+/**
+ * The rest of a thread's nursery. Blocks are allocated into in order, skipping the ones the last collection pinned.
+ */
+struct NurseryState {
+    bool disabled;
+    size_t blocks;
+    size_t next;
+    char* blockStart;
+    std::vector<unsigned char> pinned;
+    // the objects of the remembered set, NULL once destroyed, and their slots
+    std::vector<ESObject*> remembered;
+    std::vector<RememberedSlots> slots;
+    // the slots remembered, counting every property of a whole object and every element of a range, the count at
+    // which a collection runs before the nursery is full, and the seconds the collections took per slot updated
+    size_t rememberedWeight;
+    size_t weightLimit;
+    double secondsPerSlot;
+    // bytes still to allocate old after a collection that left every block pinned, before collecting again
+    size_t oldBudget;
+};
+
+static __thread NurseryState* state = NULL;
+
+// old values are allocated in slots of a multiple of GRANULE bytes, from chunks that each hold slots of one size
+static const size_t GRANULE = 16;
+static const size_t MAX_SLOTS = Heap::CHUNK_SIZE / GRANULE;
+static const size_t SIZE_CLASSES = Heap::MAX_OLD_SIZE / GRANULE;
+// address space reserved for the chunks of a thread, so that finding the chunk of an address is a subtraction
+static const size_t OLD_RESERVATION = (size_t)16 << 30;
+
+// the first word of a slot, which is the vtable pointer of a constructed value
+static const uintptr_t UNCONSTRUCTED = 0;
+static const uintptr_t DELETED = 1;
+
+// a major collection starts once this many bytes, or as many as survived the last one, have been allocated old
+static const size_t MIN_THRESHOLD = 8 * 1024 * 1024;
+// bytes allocated old between the checks for a collection, and between its slices
+static const size_t SLICE_BYTES = 128 * 1024;
+// slots visited while tracing, and slots freed or words of a bitmap passed while sweeping, between looks at the clock
+static const size_t TRACE_WORK = 256;
+static const size_t SWEEP_WORK = 64;
+// the most elements of an array and properties of an object traced in one piece
+static const size_t ELEMENTS_BATCH = 256;
+static const size_t PROPERTIES_BATCH = 64;
+// what a minor collection is taken to spend per remembered slot until it has timed one, the fewest slots it waits
+// for however short the budget, and the fewest it has to update to time them
+static const double SECONDS_PER_SLOT = 100e-9;
+static const size_t MIN_REMEMBERED = 1024;
+static const size_t TIMED_REMEMBERED = 256;
+
+/**
+ * The header of a chunk, at its start so that the chunk of a slot is its address rounded down. A slot is free when
+ * its allocated bit is clear, black or gray when its marked bit is set and gray while it is on the gray stack.
+ */
+struct Chunk {
+    size_t slotSize;
+    size_t capacity;
+    // slots handed out in address order, the ones after are untouched
+    size_t used;
+    size_t live;
+    char* slots;
+    // swept slots, each holding the next in its first word
+    void* freeList;
+    // false from the start of a collection until the sweep is done with the chunk, allocations are marked until then
+    // in the words of the bitmaps the sweep has not reached
+    bool swept;
+    size_t sweepWord;
+    bool available;
+    uint64_t allocated[MAX_SLOTS / 64];
+    uint64_t marked[MAX_SLOTS / 64];
+};
+
+struct SizeClass {
+    Chunk* current;
+    // chunks with free slots left by a sweep
+    std::vector<Chunk*> available;
+};
+
+enum Phase {
+    idle,
+    tracing,
+    sweeping
+};
+
+/**
+ * An object whose properties are being traced, and the key of the last one traced once it has started
+ */
+struct PartialObject {
+    ESObject* object;
+    bool started;
+    std::string after;
+};
+
+/**
+ * The old generation of a thread
+ */
+struct OldGeneration {
+    // false when the stack cannot be scanned, values are then never freed
+    bool collecting;
+    // seconds per slice, 0 to collect in one pause
+    double budget;
+    Phase phase;
+    SizeClass classes[SIZE_CLASSES];
+    std::vector<Chunk*> chunks;
+    // the reservation, and its first chunk aligned address
+    void* mapping;
+    char* reserved;
+    // chunks ever handed out, and which of them are in use
+    size_t chunksTouched;
+    std::vector<unsigned char> inUse;
+    std::vector<Chunk*> released;
+    std::vector<ESValue*> gray;
+    // arrays whose elements are being traced, and the index to go on from
+    std::vector<std::pair<ESArray*, size_t> > partialArrays;
+    std::vector<PartialObject> partialObjects;
+    // values found before their constructor ran, traced again at the end of marking
+    std::vector<ESValue*> unconstructed;
+    // the roots and the position of each, the collection under way has traced the ones before rootsTraced
+    std::vector<ESObject*> roots;
+    std::unordered_map<ESObject*, size_t> rootPositions;
+    size_t rootsTraced;
+    size_t sweepIndex;
+    size_t debt;
+    size_t sinceCycle;
+    size_t threshold;
+    size_t liveBytes;
+    // what the totals do not count yet
+    size_t reportedBytes;
+    size_t freedBytes;
+};
+
+static __thread OldGeneration* generation = NULL;
+
+static std::mutex statisticsLock;
+static Heap::Statistics totals;
+
+/**
+ * The end of this thread's stack, which the scans of the collections stop at, or NULL when it is unknown
+ */
+static char* stackTop() {
+    static __thread bool looked = false;
+    static __thread char* top = NULL;
+    if (!looked) {
+        looked = true;
+        pthread_attr_t attributes;
+        void* address = NULL;
+        size_t size = 0;
+        if (pthread_getattr_np(pthread_self(), &attributes) == 0) {
+            pthread_attr_getstack(&attributes, &address, &size);
+            pthread_attr_destroy(&attributes);
+        }
+        top = address != NULL ? (char*)address + size : NULL;
+    }
+    return top;
+}
+
+static void printStatisticsAtExit() {
+    Heap::printStatistics(stderr);
+}
+
+static void registerStatistics() {
+    const char* statistics = getenv("ES_GC_STATS");
+    static bool registered = false;
+    if (statistics != NULL && strcmp(statistics, "0") != 0 && !__atomic_exchange_n(&registered, true,
+                                                                                  __ATOMIC_RELAXED)) {
+        atexit(printStatisticsAtExit);
+    }
+}
+
+/**
+ * ES_GC_PAUSE_MS in seconds, 0 when collections are not split to fit a budget
+ */
+static double pauseBudget() {
+    const char* setting = getenv("ES_GC_PAUSE_MS");
+    double milliseconds = setting != NULL ? strtod(setting, NULL) : 1;
+    return milliseconds > 0 ? milliseconds / 1e3 : 0;
+}
+
+static OldGeneration& currentGeneration() {
+    if (generation == NULL) {
+        generation = new OldGeneration();
+        OldGeneration& created = *generation;
+        created.collecting = stackTop() != NULL;
+        created.phase = idle;
+        created.reserved = NULL;
+        created.chunksTouched = 0;
+        created.threshold = MIN_THRESHOLD;
+        registerStatistics();
+    }
+    return *generation;
+}
+
+static bool testBit(const uint64_t* bits, size_t index) {
+    return (bits[index / 64] >> (index % 64)) & 1;
+}
+
+static void setBit(uint64_t* bits, size_t index) {
+    bits[index / 64] |= (uint64_t)1 << (index % 64);
+}
+
+static Chunk* createChunk(OldGeneration& old, size_t slotSize) {
+    if (old.reserved == NULL) {
+        void* reserved = mmap(NULL, OLD_RESERVATION + Heap::CHUNK_SIZE, PROT_READ | PROT_WRITE,
+                              MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (reserved == MAP_FAILED) {
+            fprintf(stderr, "heap: failed to reserve %lu bytes\n", (unsigned long)OLD_RESERVATION);
+            abort();
+        }
+        old.mapping = reserved;
+        old.reserved = (char*)(((uintptr_t)reserved + Heap::CHUNK_SIZE - 1) & ~(uintptr_t)(Heap::CHUNK_SIZE - 1));
+        old.inUse.assign(OLD_RESERVATION / Heap::CHUNK_SIZE, 0);
+    }
+    void* memory;
+    if (!old.released.empty()) {
+        memory = old.released.back();
+        old.released.pop_back();
+    } else if (old.chunksTouched < OLD_RESERVATION / Heap::CHUNK_SIZE) {
+        memory = old.reserved + old.chunksTouched++ * Heap::CHUNK_SIZE;
+    } else {
+        fprintf(stderr, "heap: the old generation is full at %lu bytes\n", (unsigned long)OLD_RESERVATION);
+        abort();
+    }
+    Chunk* chunk = (Chunk*)memory;
+    memset(chunk, 0, sizeof(Chunk));
+    size_t header = (sizeof(Chunk) + GRANULE - 1) & ~(GRANULE - 1);
+    chunk->slotSize = slotSize;
+    chunk->capacity = (Heap::CHUNK_SIZE - header) / slotSize;
+    chunk->slots = (char*)memory + header;
+    chunk->swept = old.phase != tracing;
+
+    old.chunks.push_back(chunk);
+    old.inUse[((char*)memory - old.reserved) / Heap::CHUNK_SIZE] = 1;
+    return chunk;
+}
+
+/**
+ * Gives the pages of an empty chunk back to the system, it is zero filled when it is used again
+ */
+static void releaseChunk(OldGeneration& old, Chunk* chunk) {
+    old.inUse[((char*)chunk - old.reserved) / Heap::CHUNK_SIZE] = 0;
+    madvise(chunk, Heap::CHUNK_SIZE, MADV_DONTNEED);
+    old.released.push_back(chunk);
+}
+
+/**
+ * Takes a free slot of a chunk, false when it is full
+ */
+static bool takeSlot(Chunk* chunk, size_t* index) {
+    if (chunk->freeList != NULL) {
+        char* slot = (char*)chunk->freeList;
+        chunk->freeList = *(void**)slot;
+        *index = (slot - chunk->slots) / chunk->slotSize;
+        return true;
+    }
+    if (chunk->used < chunk->capacity) {
+        *index = chunk->used++;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Allocates a slot without doing any work for a collection, which is what a minor collection promotes with
+ */
+static void* allocateSlot(OldGeneration& old, size_t size) {
+    size_t slotSize = (size + GRANULE - 1) & ~(GRANULE - 1);
+    if (slotSize > Heap::MAX_OLD_SIZE) {
+        fprintf(stderr, "heap: values of %lu bytes are larger than a slot\n", (unsigned long)size);
+        abort();
+    }
+    SizeClass& sizeClass = old.classes[slotSize / GRANULE - 1];
+    Chunk* chunk = sizeClass.current;
+    size_t index = 0;
+    while (chunk == NULL || !takeSlot(chunk, &index)) {
+        if (!sizeClass.available.empty()) {
+            chunk = sizeClass.available.back();
+            sizeClass.available.pop_back();
+            chunk->available = false;
+        } else {
+            chunk = createChunk(old, slotSize);
+        }
+        sizeClass.current = chunk;
+    }
+    setBit(chunk->allocated, index);
+    // allocated black: the collection under way has already looked at everything that could refer to it
+    if (old.phase == tracing || (old.phase == sweeping && !chunk->swept && index / 64 >= chunk->sweepWord)) {
+        setBit(chunk->marked, index);
+    }
+    chunk->live++;
+    old.liveBytes += slotSize;
+    old.sinceCycle += slotSize;
+    char* slot = chunk->slots + index * slotSize;
+    *(uintptr_t*)slot = UNCONSTRUCTED;
+    return slot;
+}
+
+/**
+ * The chunk and index of the allocated slot that address points into, false when it points into none
+ */
+static bool findSlot(OldGeneration& old, uintptr_t address, Chunk** found, size_t* index) {
+    uintptr_t offset = address - (uintptr_t)old.reserved;
+    if (old.reserved == NULL || offset >= OLD_RESERVATION || !old.inUse[offset / Heap::CHUNK_SIZE]) {
+        return false;
+    }
+    Chunk* chunk = (Chunk*)(old.reserved + offset / Heap::CHUNK_SIZE * Heap::CHUNK_SIZE);
+    if (address < (uintptr_t)chunk->slots) {
+        return false;
+    }
+    size_t slot = (address - (uintptr_t)chunk->slots) / chunk->slotSize;
+    if (slot >= chunk->used || !testBit(chunk->allocated, slot)) {
+        return false;
+    }
+    *found = chunk;
+    *index = slot;
+    return true;
+}
+
+/**
+ * Marks the slot that address points into gray, if it is white
+ */
+static void markAddress(OldGeneration& old, uintptr_t address) {
+    Chunk* chunk;
+    size_t index;
+    if (findSlot(old, address, &chunk, &index) && !testBit(chunk->marked, index)) {
+        setBit(chunk->marked, index);
+        old.gray.push_back((ESValue*)(chunk->slots + index * chunk->slotSize));
+    }
+}
+
+void* Heap::allocateOld(size_t size) {
+    OldGeneration& old = currentGeneration();
+    old.debt += size;
+    if (old.debt >= SLICE_BYTES && old.collecting) {
+        old.debt = 0;
+        if (old.phase == idle && old.sinceCycle >= old.threshold) {
+            // read as each collection starts, the static objects of a program allocate before main
+            old.budget = pauseBudget();
+        }
+        if (old.phase != idle || old.sinceCycle >= old.threshold) {
+            slice(old.budget);
+        }
+    }
+    return allocateSlot(old, size);
+}
+
+void Heap::freeOld(void* value) {
+    // the sweep frees it, a conservative pointer to it may still be on the stack
+    *(uintptr_t*)value = DELETED;
+}
+
+bool Heap::isOld(const void* value) {
+    Chunk* chunk;
+    size_t index;
+    return findSlot(currentGeneration(), (uintptr_t)value, &chunk, &index);
+}
+
+void Heap::shade(ESValue* value) {
+    if (generation != NULL && generation->phase == tracing) {
+        markAddress(*generation, (uintptr_t)value);
+    }
+}
+
+void Heap::addRoot(ESObject* object) {
+    OldGeneration& old = currentGeneration();
+    old.rootPositions[object] = old.roots.size();
+    old.roots.push_back(object);
+}
+
+static void moveRoot(OldGeneration& old, size_t from, size_t to) {
+    if (from != to) {
+        old.roots[to] = old.roots[from];
+        old.rootPositions[old.roots[to]] = to;
+    }
+}
+
+void Heap::removeRoot(ESObject* object) {
+    OldGeneration& old = currentGeneration();
+    std::unordered_map<ESObject*, size_t>::iterator found = old.rootPositions.find(object);
+    if (found == old.rootPositions.end()) {
+        return;
+    }
+    size_t position = found->second;
+    old.rootPositions.erase(found);
+    // the roots before rootsTraced stay the traced ones: a traced root takes the place, which the last root takes
+    if (position < old.rootsTraced) {
+        moveRoot(old, --old.rootsTraced, position);
+        position = old.rootsTraced;
+    }
+    moveRoot(old, old.roots.size() - 1, position);
+    old.roots.pop_back();
+    for (size_t i = old.partialObjects.size(); i > 0; i--) {
+        if (old.partialObjects[i - 1].object == object) {
+            old.partialObjects.erase(old.partialObjects.begin() + (i - 1));
+        }
+    }
+}
+
+/**
+ * The remembered slots a minor collection can update within the budget besides scanning the stack, all of them when
+ * there is no budget
+ */
+static size_t weightWithin(double budget, double stackSeconds, double secondsPerSlot) {
+    if (budget == 0) {
+        return SIZE_MAX;
+    }
+    double slots = (budget - stackSeconds) / secondsPerSlot;
+    return slots > (double)MIN_REMEMBERED ? (size_t)slots : MIN_REMEMBERED;
+}
+
+/**
+ * Reserves the nursery of this thread and returns its state, with the nursery start and size through the arguments
+ */
+static NurseryState* createState(char** start, size_t* size) {
+    NurseryState* created = new NurseryState();
+    created->disabled = true;
+    created->rememberedWeight = 0;
+    created->secondsPerSlot = SECONDS_PER_SLOT;
+    created->weightLimit = weightWithin(pauseBudget(), 0, SECONDS_PER_SLOT);
+
+    const char* setting = getenv("ES_NURSERY_SIZE");
+    size_t bytes = setting != NULL ? strtoul(setting, NULL, 10) : Heap::DEFAULT_NURSERY_SIZE;
+    bytes = (bytes + Heap::BLOCK_SIZE - 1) / Heap::BLOCK_SIZE * Heap::BLOCK_SIZE;
+
+    // without the bounds of the stack it cannot be scanned, and every value is allocated old
+    void* reserved = bytes > 0 && stackTop() != NULL
+                     ? mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0)
+                     : MAP_FAILED;
+    if (reserved != MAP_FAILED) {
+        created->disabled = false;
+        created->blocks = bytes / Heap::BLOCK_SIZE;
+        created->next = 0;
+        created->blockStart = NULL;
+        created->oldBudget = 0;
+        created->pinned.assign(created->blocks, 0);
+        *start = (char*)reserved;
+        *size = bytes;
+    }
+    return created;
+}
+
+void* Heap::allocateSlow(size_t size) {
+    if (state == NULL) {
+        state = createState(&nursery.start, &nursery.size);
+        registerStatistics();
+    }
+    if (state->disabled || HEADER_SIZE + size > BLOCK_SIZE) {
+        return allocateOld(size);
+    }
+    if (state->oldBudget > 0) {
+        state->oldBudget = state->oldBudget > size ? state->oldBudget - size : 0;
+        return allocateOld(size);
+    }
+    // the write barrier ends the block early once the remembered slots reach the limit
+    if (state->rememberedWeight >= state->weightLimit || !nextBlock()) {
+        collect();
+        if (!nextBlock()) {
+            // every block is pinned, collecting again straight away would pin them again
+            state->oldBudget = BLOCK_SIZE;
+            return allocateOld(size);
+        }
+    }
+    return allocateYoung(size);
+}
+
+/**
+ * Counts what was allocated in the block being allocated into and stops allocating into it
+ */
+void Heap::retireBlock() {
+    NurseryState& current = *state;
+    if (current.blockStart != NULL) {
+        std::lock_guard<std::mutex> lock(statisticsLock);
+        totals.allocatedBytes += nursery.top - current.blockStart;
+    }
+    current.blockStart = NULL;
+    nursery.top = NULL;
+    nursery.limit = NULL;
+}
+
+/**
+ * Moves on to the next block that is not pinned, false at the end of the nursery
+ */
+bool Heap::nextBlock() {
+    retireBlock();
+    NurseryState& current = *state;
+    while (current.next < current.blocks && current.pinned[current.next]) {
+        current.next++;
+    }
+    if (current.next == current.blocks) {
+        return false;
+    }
+    current.blockStart = nursery.start + current.next++ * BLOCK_SIZE;
+    nursery.top = current.blockStart;
+    nursery.limit = current.blockStart + BLOCK_SIZE;
+    return true;
+}
+
+/**
+ * Adds slots to the remembered set, true when they take it to the weight at which the nursery is collected
+ */
+static bool addSlots(size_t owner, ESValue** slot, size_t begin, size_t end, size_t weight) {
+    NurseryState& current = *state;
+    RememberedSlots slots = {owner, slot, (uint32_t)begin, (uint32_t)end};
+    current.slots.push_back(slots);
+    current.rememberedWeight += weight;
+    return current.rememberedWeight >= current.weightLimit;
+}
+
+/**
+ * The slots of an object that an entry of the remembered set stands for
+ */
+static size_t weightOf(const RememberedSlots& slots, size_t properties) {
+    if (slots.slot != NULL) {
+        return 1;
+    }
+    return slots.begin < slots.end ? slots.end - slots.begin : 1 + properties;
+}
+
+size_t Heap::rememberedOwner(ESObject* object) {
+    NurseryState& current = *state;
+    if (object->rememberedAt == 0) {
+        current.remembered.push_back(object);
+        object->rememberedAt = current.remembered.size();
+    }
+    return object->rememberedAt - 1;
+}
+
+void Heap::remember(ESObject* object) {
+    if (state != NULL) {
+        object->rememberedWhole = true;
+        if (addSlots(rememberedOwner(object), NULL, 0, 0, 1 + object->properties.size())) {
+            // the next young allocation takes the slow path, which collects
+            nursery.limit = nursery.top;
+        }
+    }
+}
+
+void Heap::remember(ESObject* object, ESValue** slot) {
+    if (state != NULL && addSlots(rememberedOwner(object), slot, 0, 0, 1)) {
+        nursery.limit = nursery.top;
+    }
+}
+
+void Heap::remember(ESArray* array, size_t begin, size_t end) {
+    if (state != NULL && !state->disabled && addSlots(rememberedOwner(array), NULL, begin, end, end - begin)) {
+        nursery.limit = nursery.top;
+    }
+}
+
+void Heap::forget(ESObject* object) {
+    // its slots are skipped, and the other objects keep their positions until the next collection
+    state->remembered[object->rememberedAt - 1] = NULL;
+    object->rememberedAt = 0;
+    object->rememberedWhole = false;
+}
+
+/**
+ * Pins the nursery blocks and marks the old slots that the words from a local of this frame to the top of the stack
+ * point into. It is called by scanStack, so the registers that spilled are in between.
+ */
+static void __attribute__((noinline)) scanFromHere(char* top, NurseryState* pinning, char* start, size_t size,
+                                                   OldGeneration* old) {
+    volatile uintptr_t here = 0;
+    for (uintptr_t* word = (uintptr_t*)&here; word < (uintptr_t*)top; word++) {
+        uintptr_t value = *word;
+        if (pinning != NULL && value - (uintptr_t)start < size) {
+            pinning->pinned[(value - (uintptr_t)start) / Heap::BLOCK_SIZE] = 1;
+        } else if (old != NULL) {
+            markAddress(*old, value);
+        }
+    }
+}
+
+void __attribute__((noinline)) Heap::scanStack(bool pin, bool mark) {
+    char* top = stackTop();
+    if (top == NULL) {
+        return;
+    }
+    // spills the callee saved registers into this frame, where they are scanned with the rest of the stack
+    __builtin_unwind_init();
+    scanFromHere(top, pin ? state : NULL, nursery.start, nursery.size, mark ? generation : NULL);
+    // keeps the call from becoming a tail call, which would restore the registers and pop this frame first
+    __asm__ volatile("" ::: "memory");
+}
+
+/**
+ * Copies the young values of remembered slots into the old generation, leaving the address of the copy in place of
+ * the original for the other slots that hold it. Values in pinned blocks stay where they are, and their slots stay
+ * remembered.
+ */
+class Heap::Evacuator : public Heap::ReferenceVisitor {
+public:
+    bool keepsYoung;
+    size_t promotedBytes;
+
+    Evacuator() {
+        keepsYoung = false;
+        promotedBytes = 0;
+    }
+
+    void visit(ESValue** slot) {
+        ESValue* value = *slot;
+        if (!isYoung(value)) {
+            return;
+        }
+        if (state->pinned[((char*)value - nursery.start) / BLOCK_SIZE]) {
+            keepsYoung = true;
+            return;
+        }
+        size_t* header = (size_t*)value - 1;
+        if (*header & FORWARDED) {
+            *slot = *(ESValue**)value;
+            return;
+        }
+        size_t size = *header - HEADER_SIZE;
+        void* copy = allocateSlot(currentGeneration(), size);
+        memcpy(copy, (void*)value, size);
+        *header |= FORWARDED;
+        *(void**)value = copy;
+        *slot = (ESValue*)copy;
+        promotedBytes += size;
+    }
+
+    /**
+     * The generic elements of an array from begin up to end, the ones it still has
+     */
+    void visitRange(ESArray* array, size_t begin, size_t end) {
+        size_t length = array->getElementsKind() == packedGeneric ? array->getLength() : 0;
+        ESValue** elements = array->getGenericElements();
+        for (size_t i = begin; i < end && i < length; i++) {
+            visit(&elements[i]);
+        }
+    }
+};
+
+void Heap::collect() {
+    if (state == NULL || state->disabled) {
+        return;
+    }
+    Clock::time_point start = Clock::now();
+    NurseryState& current = *state;
+    retireBlock();
+
+    std::fill(current.pinned.begin(), current.pinned.end(), 0);
+    scanStack(true, false);
+    Clock::time_point scanned = Clock::now();
+
+    Evacuator evacuator;
+    std::vector<ESObject*> remembered;
+    std::vector<RememberedSlots> slots;
+    remembered.swap(current.remembered);
+    slots.swap(current.slots);
+    for (size_t i = 0; i < remembered.size(); i++) {
+        if (remembered[i] != NULL) {
+            remembered[i]->rememberedAt = 0;
+            remembered[i]->rememberedWhole = false;
+        }
+    }
+    size_t weight = current.rememberedWeight;
+    current.rememberedWeight = 0;
+    for (size_t i = 0; i < slots.size(); i++) {
+        RememberedSlots& entry = slots[i];
+        ESObject* object = remembered[entry.owner];
+        if (object == NULL) {
+            continue;
+        }
+        bool whole = entry.slot == NULL && entry.begin == entry.end;
+        evacuator.keepsYoung = false;
+        if (entry.slot != NULL) {
+            evacuator.visit(entry.slot);
+        } else if (!whole) {
+            evacuator.visitRange(static_cast<ESArray*>(object), entry.begin, entry.end);
+        } else {
+            object->visitReferences(evacuator);
+        }
+        if (evacuator.keepsYoung) {
+            entry.owner = rememberedOwner(object);
+            object->rememberedWhole = object->rememberedWhole || whole;
+            current.slots.push_back(entry);
+            current.rememberedWeight += weightOf(entry, object->properties.size());
+        }
+    }
+    current.next = 0;
+
+    // the slots kept for the blocks that stay pinned do not count towards the next collection
+    Clock::time_point end = Clock::now();
+    if (weight >= TIMED_REMEMBERED) {
+        // taken at once when it is slower, so that the next collection does not overrun as well
+        double seconds = std::chrono::duration<double>(end - scanned).count() / weight;
+        current.secondsPerSlot = std::max(seconds, (current.secondsPerSlot + seconds) / 2);
+    }
+    double stackSeconds = std::chrono::duration<double>(scanned - start).count();
+    size_t within = weightWithin(pauseBudget(), stackSeconds, current.secondsPerSlot);
+    current.weightLimit = within == SIZE_MAX ? SIZE_MAX : current.rememberedWeight + within;
+
+    size_t pinnedBlocks = 0;
+    for (size_t i = 0; i < current.blocks; i++) {
+        pinnedBlocks += current.pinned[i];
+    }
+    {
+        std::lock_guard<std::mutex> lock(statisticsLock);
+        totals.promotedBytes += evacuator.promotedBytes;
+        totals.pinnedBlocks += pinnedBlocks;
+    }
+    recordPause(std::chrono::duration<double>(Clock::now() - start).count(), false);
+}
+
+void Heap::ReferenceVisitor::visitProperties(ESObject* object) {
+    object->visitProperties(*this, NULL, (size_t)-1, NULL);
+}
+
+void Heap::ReferenceVisitor::visitElements(ESArray* array) {
+    ESValue** elements = array->getGenericElements();
+    size_t length = array->getElementsKind() == packedGeneric ? array->getLength() : 0;
+    for (size_t i = 0; i < length; i++) {
+        visit(&elements[i]);
+    }
+}
+
+/**
+ * Shades the slots of the values it visits and counts them. The properties of an object and the elements of an
+ * array are left for drain, which can stop between pieces of them; the ones stored meanwhile are shaded by the write
+ * barrier.
+ */
+class Tracer : public Heap::ReferenceVisitor {
+public:
+    size_t work;
+
+    Tracer() {
+        work = 0;
+    }
+
+    void visit(ESValue** slot) {
+        work++;
+        Heap::shade(*slot);
+    }
+
+    void visitProperties(ESObject* object) {
+        PartialObject partial = {object, false, std::string()};
+        generation->partialObjects.push_back(partial);
+    }
+
+    void visitElements(ESArray* array) {
+        generation->partialArrays.push_back(std::make_pair(array, (size_t)0));
+    }
+};
+
+/**
+ * Traces up to PROPERTIES_BATCH properties of the object on top of the partial objects
+ */
+static void traceProperties(OldGeneration& old, Tracer& tracer) {
+    PartialObject& partial = old.partialObjects.back();
+    bool remaining = *(uintptr_t*)partial.object != DELETED
+                     && partial.object->visitProperties(tracer, partial.started ? &partial.after : NULL,
+                                                        PROPERTIES_BATCH, &partial.after);
+    partial.started = true;
+    tracer.work++;
+    if (!remaining) {
+        old.partialObjects.pop_back();
+    }
+}
+
+/**
+ * Traces the next root, the ones in the heap have to be marked as well for the sweep to keep them
+ */
+static void traceRoot(OldGeneration& old, Tracer& tracer) {
+    ESObject* root = old.roots[old.rootsTraced++];
+    Chunk* chunk;
+    size_t index;
+    if (findSlot(old, (uintptr_t)root, &chunk, &index)) {
+        markAddress(old, (uintptr_t)root);
+    } else {
+        root->visitReferences(tracer);
+    }
+    tracer.work++;
+}
+
+/**
+ * Traces up to ELEMENTS_BATCH elements of the array on top of the partial arrays
+ */
+static void traceElements(OldGeneration& old, Tracer& tracer) {
+    std::pair<ESArray*, size_t>& partial = old.partialArrays.back();
+    ESArray* array = partial.first;
+    size_t length = 0;
+    if (*(uintptr_t*)array != DELETED && array->getElementsKind() == packedGeneric) {
+        length = array->getLength();
+    }
+    size_t end = std::min(length, partial.second + ELEMENTS_BATCH);
+    ESValue** elements = array->getGenericElements();
+    for (size_t i = partial.second; i < end; i++) {
+        Heap::shade(elements[i]);
+    }
+    tracer.work += end - partial.second + 1;
+    partial.second = end;
+    if (end == length) {
+        old.partialArrays.pop_back();
+    }
+}
+
+/**
+ * Traces the roots not traced yet and the gray values until there are none left, true, or the deadline passes.
+ * Values whose constructor has not run yet have nothing to trace, they are kept for the end of marking unless it is
+ * the end already.
+ */
+static bool drain(OldGeneration& old, Clock::time_point deadline, bool bounded, bool final) {
+    Tracer tracer;
+    while (old.rootsTraced < old.roots.size() || !old.gray.empty() || !old.partialObjects.empty()
+           || !old.partialArrays.empty()) {
+        if (bounded && tracer.work >= TRACE_WORK) {
+            tracer.work = 0;
+            if (Clock::now() >= deadline) {
+                return false;
+            }
+        }
+        if (old.rootsTraced < old.roots.size()) {
+            traceRoot(old, tracer);
+            continue;
+        }
+        if (old.gray.empty()) {
+            if (!old.partialObjects.empty()) {
+                traceProperties(old, tracer);
+            } else {
+                traceElements(old, tracer);
+            }
+            continue;
+        }
+        ESValue* value = old.gray.back();
+        old.gray.pop_back();
+        tracer.work++;
+        uintptr_t first = *(uintptr_t*)value;
+        if (first == DELETED) {
+            continue;
+        }
+        if (first == UNCONSTRUCTED) {
+            if (!final) {
+                old.unconstructed.push_back(value);
+            }
+            continue;
+        }
+        value->visitReferences(tracer);
+    }
+    return true;
+}
+
+/**
+ * Frees the white slots of a chunk, running their destructors, and whitens the rest. Stops at the deadline, between
+ * two slots of a word if need be, true when the chunk is done.
+ */
+static bool sweepChunk(OldGeneration& old, Chunk* chunk, Clock::time_point deadline, bool bounded) {
+    size_t words = (chunk->used + 63) / 64;
+    size_t work = 0;
+    for (; chunk->sweepWord < words; chunk->sweepWord++) {
+        size_t w = chunk->sweepWord;
+        // a slot stays allocated until it is freed, so that a sweep that stops finds the rest of the word again
+        uint64_t dead = chunk->allocated[w] & ~chunk->marked[w];
+        while (dead != 0) {
+            if (bounded && ++work >= SWEEP_WORK) {
+                work = 0;
+                if (Clock::now() >= deadline) {
+                    return false;
+                }
+            }
+            size_t index = w * 64 + __builtin_ctzll(dead);
+            dead &= dead - 1;
+            chunk->allocated[w] &= ~((uint64_t)1 << (index % 64));
+            char* slot = chunk->slots + index * chunk->slotSize;
+            uintptr_t first = *(uintptr_t*)slot;
+            if (first != UNCONSTRUCTED && first != DELETED) {
+                ((ESValue*)slot)->~ESValue();
+            }
+            *(void**)slot = chunk->freeList;
+            chunk->freeList = slot;
+            chunk->live--;
+            old.liveBytes -= chunk->slotSize;
+            old.freedBytes += chunk->slotSize;
+        }
+        chunk->marked[w] = 0;
+        if (bounded && ++work >= SWEEP_WORK) {
+            work = 0;
+            if (Clock::now() >= deadline) {
+                chunk->sweepWord++;
+                return false;
+            }
+        }
+    }
+    chunk->swept = true;
+    return true;
+}
+
+void Heap::slice(double budget) {
+    OldGeneration& old = *generation;
+    Clock::time_point start = Clock::now();
+    Clock::time_point deadline = start + std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(budget));
+    bool bounded = budget > 0;
+    bool finished = false;
+
+    if (old.phase == idle) {
+        old.phase = tracing;
+        marking = true;
+        old.sinceCycle = 0;
+        for (size_t i = 0; i < old.chunks.size(); i++) {
+            old.chunks[i]->swept = false;
+            old.chunks[i]->sweepWord = 0;
+        }
+        old.rootsTraced = 0;
+        scanStack(false, true);
+    }
+    if (old.phase == tracing && drain(old, deadline, bounded, false)) {
+        // everything stored into an object or a root since the start has been shaded, and roots added since have
+        // been traced, so only the stack can still refer to white values. It is the one step not split into pieces.
+        scanStack(false, true);
+        old.gray.insert(old.gray.end(), old.unconstructed.begin(), old.unconstructed.end());
+        old.unconstructed.clear();
+        if (drain(old, deadline, bounded, true)) {
+            old.phase = sweeping;
+            marking = false;
+            old.sweepIndex = 0;
+        }
+    }
+    if (old.phase == sweeping) {
+        while (old.sweepIndex < old.chunks.size() && (!bounded || Clock::now() < deadline)) {
+            Chunk* chunk = old.chunks[old.sweepIndex];
+            if (chunk->swept) {
+                old.sweepIndex++;
+                continue;
+            }
+            if (!sweepChunk(old, chunk, deadline, bounded)) {
+                break;
+            }
+            SizeClass& sizeClass = old.classes[chunk->slotSize / GRANULE - 1];
+            if (chunk == sizeClass.current || chunk->available) {
+                old.sweepIndex++;
+            } else if (chunk->live == 0) {
+                old.chunks[old.sweepIndex] = old.chunks.back();
+                old.chunks.pop_back();
+                releaseChunk(old, chunk);
+            } else {
+                if (chunk->freeList != NULL) {
+                    chunk->available = true;
+                    sizeClass.available.push_back(chunk);
+                }
+                old.sweepIndex++;
+            }
+        }
+        if (old.sweepIndex == old.chunks.size()) {
+            old.phase = idle;
+            old.threshold = std::max(MIN_THRESHOLD, old.liveBytes);
+            finished = true;
+        }
+    }
+
+    double pause = std::chrono::duration<double>(Clock::now() - start).count();
+    {
+        std::lock_guard<std::mutex> lock(statisticsLock);
+        totals.majorCollections += finished;
+        totals.oldBytes += old.liveBytes - old.reportedBytes;
+        totals.freedBytes += old.freedBytes;
+    }
+    old.reportedBytes = old.liveBytes;
+    old.freedBytes = 0;
+    recordPause(pause, true);
+}
+
+void Heap::collectFull() {
+    OldGeneration& old = currentGeneration();
+    if (old.collecting) {
+        slice(0);
+    }
+}
+
+void Heap::exchange(Context& context) {
+    std::swap(nursery, context.nursery);
+    std::swap(state, context.state);
+    std::swap(generation, context.generation);
+    std::swap(marking, context.marking);
+}
+
+void Heap::destroy() {
+    if (state != NULL && !state->disabled) {
+        retireBlock();
+        munmap(nursery.start, nursery.size);
+    }
+    if (generation != NULL) {
+        OldGeneration& old = *generation;
+        for (size_t i = 0; i < old.chunks.size(); i++) {
+            Chunk* chunk = old.chunks[i];
+            for (size_t index = 0; index < chunk->used; index++) {
+                char* slot = chunk->slots + index * chunk->slotSize;
+                uintptr_t first = *(uintptr_t*)slot;
+                if (testBit(chunk->allocated, index) && first != UNCONSTRUCTED && first != DELETED) {
+                    ((ESValue*)slot)->~ESValue();
+                }
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(statisticsLock);
+            totals.oldBytes -= old.reportedBytes;
+            totals.freedBytes += old.liveBytes + old.freedBytes;
+        }
+        if (old.reserved != NULL) {
+            munmap(old.mapping, OLD_RESERVATION + CHUNK_SIZE);
+        }
+        delete generation;
+        generation = NULL;
+    }
+    delete state;
+    state = NULL;
+    nursery = Nursery();
+    marking = false;
+}
+
+void Heap::recordPause(double seconds, bool major) {
+    double microseconds = seconds * 1e6;
+    int bucket = microseconds < 1 ? 0 : 1 + (int)log2(microseconds);
+
+    std::lock_guard<std::mutex> lock(statisticsLock);
+    if (major) {
+        totals.slices++;
+    } else {
+        totals.collections++;
+    }
+    totals.pauseSeconds += seconds;
+    totals.maxPauseSeconds = std::max(totals.maxPauseSeconds, seconds);
+    if (major) {
+        totals.maxSliceSeconds = std::max(totals.maxSliceSeconds, seconds);
+    }
+    totals.pauseHistogram[bucket < PAUSE_BUCKETS ? bucket : PAUSE_BUCKETS - 1]++;
+}
+
+Heap::Statistics Heap::getStatistics() {
+    std::lock_guard<std::mutex> lock(statisticsLock);
+    Statistics statistics = totals;
+    // the block being allocated into and the old values allocated since the last slice have not been counted yet
+    if (state != NULL && state->blockStart != NULL) {
+        statistics.allocatedBytes += nursery.top - state->blockStart;
+    }
+    if (generation != NULL) {
+        statistics.oldBytes += generation->liveBytes - generation->reportedBytes;
+    }
+    return statistics;
+}
+
+double Heap::pausePercentile(const Statistics& statistics, double fraction) {
+    size_t pauses = 0;
+    for (int i = 0; i < PAUSE_BUCKETS; i++) {
+        pauses += statistics.pauseHistogram[i];
+    }
+    size_t seen = 0;
+    for (int i = 0; i < PAUSE_BUCKETS; i++) {
+        seen += statistics.pauseHistogram[i];
+        if (seen > 0 && seen >= fraction * pauses) {
+            return ldexp(1.0, i) * 1e-6;
+        }
+    }
+    return 0;
+}
+
+void Heap::printStatistics(FILE* file) {
+    Statistics statistics = getStatistics();
+    fprintf(file, "gc: %lu minor collections, %.1f MB allocated young, %.1f MB promoted, %lu blocks pinned\n",
+            (unsigned long)statistics.collections, statistics.allocatedBytes / 1e6, statistics.promotedBytes / 1e6,
+            (unsigned long)statistics.pinnedBlocks);
+    fprintf(file, "gc: %lu major collections in %lu slices, %.1f MB old, %.1f MB freed\n",
+            (unsigned long)statistics.majorCollections, (unsigned long)statistics.slices, statistics.oldBytes / 1e6,
+            statistics.freedBytes / 1e6);
+    if (statistics.collections + statistics.slices == 0) {
+        return;
+    }
+    fprintf(file, "gc: pauses %.3f ms total, p50 < %.0f us, p99 < %.0f us, max %.3f ms, max major slice %.3f ms\n",
+            statistics.pauseSeconds * 1e3, pausePercentile(statistics, 0.5) * 1e6,
+            pausePercentile(statistics, 0.99) * 1e6, statistics.maxPauseSeconds * 1e3,
+            statistics.maxSliceSeconds * 1e3);
+    for (int i = 0; i < PAUSE_BUCKETS; i++) {
+        if (statistics.pauseHistogram[i] == 0) {
+            continue;
+        }
+        char range[32];
+        if (i == 0) {
+            snprintf(range, sizeof(range), "< 1 us");
+        } else {
+            snprintf(range, sizeof(range), "%.0f-%.0f us", ldexp(1.0, i - 1), ldexp(1.0, i));
+        }
+        fprintf(file, "gc: %16s %10lu\n", range, (unsigned long)statistics.pauseHistogram[i]);
+    }
+}
@@ -0,0 +1,284 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+class ESValue;
+class ESObject;
+class ESArray;
+struct NurseryState;
+struct OldGeneration;
+
+/**
+ * Generational heap, one per thread. Numbers, Booleans, undefined and null are bump allocated in a nursery, and
+ * almost all of them are dead by the time it fills: the results of arithmetic and comparisons are read once by the
+ * next instruction of the generated code. A minor collection then copies the values that old objects still hold
+ * into the old generation and starts the nursery over. Every other value is allocated old, from chunks of slots of
+ * one size.
+ *
+ * The nursery is collected mostly copying. Registers and the stack are scanned conservatively, and a block of the
+ * nursery that any word of them points into is pinned: its values stay where they are until the next collection, so
+ * generated code never sees a value move. Old objects that hold young values are found through a write barrier:
+ * ESObject::set, the bindings of an Environment and the element stores of ESArray remember the slot or the range of
+ * elements a young value is stored into, and the other stores remember the whole object. Only those slots are
+ * updated, and a minor collection runs before the nursery is full once there are more of them than it can update
+ * within the pause budget below, which it learns from the collections before.
+ *
+ * The old generation is marked and swept incrementally, in slices of about ES_GC_PAUSE_MS milliseconds (1 unless
+ * set, 0 collects it in one pause) taken as old values are allocated. Marking is tri-color: the roots are the stack,
+ * again conservatively, and the objects that live outside the heap such as the static global object. Values
+ * allocated while a collection is under way are black, and the same write barrier shades a value stored into an
+ * object while marking, so the only thing marking has to look at again before it ends is the stack. Sweeping runs
+ * the destructors of the values that were not marked. A slice looks at the clock after every few hundred slots it
+ * traces and every few dozen it frees, and traces the roots, the properties of an object and the elements of an
+ * array a piece at a time, so it overruns its budget by about one piece. Scanning the stack is the one step that is
+ * not split, it takes as long as the stack is deep.
+ *
+ * A value must therefore be held by a local, an argument or an object, never only by memory from malloc or by
+ * static storage, and values do not cross heaps: each thread has its own heap and scans only its own stack. A thread
+ * can also put its heap aside for the heap of an Isolate, see exchange.
+ * ES_NURSERY_SIZE sets the size of the nursery in bytes (4 MB unless set, 0 allocates every value old) and
+ * ES_GC_STATS prints the collections and a histogram of their pauses to stderr when the program exits.
+ */
+class Heap {
+public:
+    static const size_t BLOCK_SIZE = 64 * 1024;
+    static const size_t DEFAULT_NURSERY_SIZE = 4 * 1024 * 1024;
+    static const size_t CHUNK_SIZE = 256 * 1024;
+    static const size_t MAX_OLD_SIZE = 1024;
+    static const int PAUSE_BUCKETS = 24;
+
+    /**
+     * The block being allocated into and the bounds of the whole nursery, all NULL until the thread allocates its
+     * first value
+     */
+    struct Nursery {
+        char* top;
+        char* limit;
+        char* start;
+        size_t size;
+    };
+
+    /**
+     * Placement argument that allocates a nursery type in the old generation, for values held where the minor
+     * collection cannot see them
+     */
+    enum Tenured { tenured };
+
+    /**
+     * Called by a collection for every slot of a value that may hold another value
+     */
+    class ReferenceVisitor {
+    public:
+        virtual void visit(ESValue** slot) = 0;
+
+        /**
+         * Visits the properties of an object, which a major collection traces a piece at a time
+         */
+        virtual void visitProperties(ESObject* object);
+
+        /**
+         * Visits the generic elements of an array, which a major collection traces a piece at a time
+         */
+        virtual void visitElements(ESArray* array);
+    };
+
+    /**
+     * Totals over all threads. The pause histogram counts minor collections and slices of major ones, bucket 0
+     * the pauses under a microsecond and bucket i the pauses from 2^(i-1) up to 2^i microseconds.
+     */
+    struct Statistics {
+        size_t collections;
+        size_t allocatedBytes;
+        size_t promotedBytes;
+        size_t pinnedBlocks;
+        size_t majorCollections;
+        size_t slices;
+        size_t oldBytes;
+        size_t freedBytes;
+        double pauseSeconds;
+        double maxPauseSeconds;
+        double maxSliceSeconds;
+        size_t pauseHistogram[PAUSE_BUCKETS];
+    };
+
+    /**
+     * The fast path is a bounds check and a pointer bump. Each value is preceded by a word holding its size, which
+     * a minor collection marks once the value has been copied.
+     */
+    static void* allocateYoung(size_t size) {
+        Nursery& current = nursery;
+        size_t total = HEADER_SIZE + ((size + HEADER_SIZE - 1) & ~(HEADER_SIZE - 1));
+        if ((size_t)(current.limit - current.top) >= total) {
+            size_t* header = (size_t*)current.top;
+            current.top += total;
+            *header = total;
+            return header + 1;
+        }
+        return allocateSlow(size);
+    }
+
+    /**
+     * Allocates a slot of the old generation, which may first run a slice of a major collection
+     */
+    static void* allocateOld(size_t size);
+
+    /**
+     * Frees a slot whose value was deleted or whose constructor threw, the slot is reused after the next sweep
+     */
+    static void freeOld(void* value);
+
+    static bool isYoung(const void* value) {
+        return (uintptr_t)value - (uintptr_t)nursery.start < nursery.size;
+    }
+
+    /**
+     * Whether value is an allocated slot of this thread's old generation
+     */
+    static bool isOld(const void* value);
+
+    static bool isMarking() {
+        return marking;
+    }
+
+    /**
+     * Marks an old value gray so that the collection under way keeps it
+     */
+    static void shade(ESValue* value);
+
+    /**
+     * The write barrier of stores into values that are not objects, such as the fields a constructor sets: a value
+     * allocated during marking is black and would not be traced
+     */
+    static void barrier(ESValue* value) {
+        if (marking) {
+            shade(value);
+        }
+    }
+
+    /**
+     * Adds an old object to the remembered set of this thread, called by the write barrier of ESObject: the next
+     * minor collection visits all of its slots
+     */
+    static void remember(ESObject* object);
+
+    /**
+     * Adds one slot of an object to the remembered set, which must stay where it is while the object lives
+     */
+    static void remember(ESObject* object, ESValue** slot);
+
+    /**
+     * Adds the generic elements of an array from begin up to end to the remembered set, by index since the elements
+     * move as the array grows
+     */
+    static void remember(ESArray* array, size_t begin, size_t end);
+
+    /**
+     * Removes an object and its slots from the remembered set, called when it is destroyed
+     */
+    static void forget(ESObject* object);
+
+    /**
+     * Objects that are not allocated in the heap, static or on the stack, are roots while they exist. An old object
+     * added here, such as the global object of an isolate, is a root until it is removed.
+     */
+    static void addRoot(ESObject* object);
+
+    static void removeRoot(ESObject* object);
+
+    /**
+     * Runs a minor collection of this thread's nursery
+     */
+    static void collect();
+
+    /**
+     * Finishes the major collection under way, or runs a whole one, in one pause
+     */
+    static void collectFull();
+
+    /**
+     * A heap that no thread is using, all NULL until the first value is allocated in it
+     */
+    struct Context {
+        Nursery nursery;
+        NurseryState* state;
+        OldGeneration* generation;
+        bool marking;
+    };
+
+    /**
+     * Swaps the heap of this thread with context: the thread allocates from and collects the heap that was put
+     * aside, and context holds the thread's own until it is exchanged back. Nothing on the stack may point into the
+     * heap that is put aside, since its collections do not scan this thread.
+     */
+    static void exchange(Context& context);
+
+    /**
+     * Runs the destructors of every value of this thread's heap and gives its memory back, leaving the thread with
+     * an empty heap
+     */
+    static void destroy();
+
+    static Statistics getStatistics();
+
+    /**
+     * The upper bound of the histogram bucket that holds the given fraction of the pauses, in seconds
+     */
+    static double pausePercentile(const Statistics& statistics, double fraction);
+
+    /**
+     * The statistics and pause histogram as the lines ES_GC_STATS prints
+     */
+    static void printStatistics(FILE* file);
+
+private:
+    static const size_t HEADER_SIZE = sizeof(size_t);
+    static const size_t FORWARDED = 1;
+
+    class Evacuator;
+
+    static __thread Nursery nursery;
+
+    static __thread bool marking;
+
+    static void* allocateSlow(size_t size);
+
+    static void retireBlock();
+
+    static bool nextBlock();
+
+    static void scanStack(bool pin, bool mark);
+
+    static void slice(double budget);
+
+    static size_t rememberedOwner(ESObject* object);
+
+    static void recordPause(double seconds, bool major);
+};
+
+/**
+ * Base of the value types that are allocated in the nursery, over the class they would otherwise derive from.
+ * They hold no references to other values, so a minor collection copies them as raw bytes.
+ */
+template <class Base>
+class NurseryAllocated : public Base {
+public:
+    static void* operator new(size_t size) {
+        return Heap::allocateYoung(size);
+    }
+
+    static void* operator new(size_t size, Heap::Tenured) {
+        return Heap::allocateOld(size);
+    }
+
+    static void operator delete(void* value) {
+        if (!Heap::isYoung(value)) {
+            Heap::freeOld(value);
+        }
+    }
+
+    static void operator delete(void* value, Heap::Tenured) {
+        Heap::freeOld(value);
+    }
+};
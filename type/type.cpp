@@ -0,0 +1,440 @@
+#include "type.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include "conversion.hpp"
+
+String* Number::toString() {
+    char buffer[NumberConversion::MAX_NUMBER_LENGTH];
+    size_t length = NumberConversion::toString(value, buffer);
+    return new String(std::string(buffer, length));
+}
+
+ESValue* ESObject::get(ESValue* key_ref) {
+    String* key = key_ref->toString();
+    std::map<std::string, ESValue*>::iterator it = properties.find(key->getValue());
+    if (it != properties.end()) {
+        return properties[key->getValue()];
+    }
+    fprintf(stderr, "ya blew it!\n");
+    return new Undefined();
+}
+
+ESValue* ESObject::set(ESValue* key_ref, ESValue* value) {
+    String* key = key_ref->toString();
+    ESValue*& slot = properties[key->getValue()];
+    ESValue* previous = slot;
+    slot = value;
+    writeBarrier(&slot, previous);
+    return value;
+}
+
+void ESObject::visitReferences(Heap::ReferenceVisitor& visitor) {
+    if (prototype != NULL) {
+        visitor.visit((ESValue**)&prototype);
+    }
+    visitor.visitProperties(this);
+}
+
+bool ESObject::visitProperties(Heap::ReferenceVisitor& visitor, const std::string* after, size_t limit,
+                               std::string* last) {
+    std::map<std::string, ESValue*>::iterator it = after != NULL ? properties.upper_bound(*after)
+                                                                 : properties.begin();
+    std::map<std::string, ESValue*>::iterator visitedLast = properties.end();
+    for (size_t visited = 0; it != properties.end() && visited < limit; ++it, visited++) {
+        visitor.visit(&it->second);
+        visitedLast = it;
+    }
+    if (last != NULL && visitedLast != properties.end()) {
+        *last = visitedLast->first;
+    }
+    return it != properties.end();
+}
+
+bool ESObject::hasOwnProperty(ESValue* key_ref) {
+    return properties.find(key_ref->toString()->getValue()) != properties.end();
+}
+
+ESValue* ESObject::findOwnProperty(const char* key) {
+    std::map<std::string, ESValue*>::iterator it = properties.find(key);
+    return it != properties.end() ? it->second : NULL;
+}
+
+bool ESArray::toIndex(ESValue* key_ref, size_t* index) {
+    if (key_ref->getType() == number) {
+        // compared as doubles first, converting one out of the range of size_t is undefined
+        double value = dynamic_cast<Number*>(key_ref)->getValue();
+        if (!(value >= 0 && value <= (double)MAX_INDEX) || value != std::floor(value)) {
+            return false;
+        }
+        *index = (size_t)value;
+        return true;
+    }
+    if (key_ref->getType() != string_) {
+        return false;
+    }
+    // the same keys as the numeric path: ToString of the index gives the key back
+    std::string key = dynamic_cast<String*>(key_ref)->getValue();
+    if (key.empty() || key.size() > 10 || (key[0] == '0' && key.size() > 1)) {
+        return false;
+    }
+    size_t value = 0;
+    for (size_t i = 0; i < key.size(); i++) {
+        if (key[i] < '0' || key[i] > '9') {
+            return false;
+        }
+        value = value * 10 + (key[i] - '0');
+    }
+    if (value > MAX_INDEX) {
+        return false;
+    }
+    *index = value;
+    return true;
+}
+
+void ESArray::transitionTo(ElementsKind target) {
+    if (target <= kind) {
+        return;
+    }
+    if (kind == packedInt32 && target == packedDouble) {
+        doubleElements.assign(int32Elements.begin(), int32Elements.end());
+    } else {
+        // generic from the first element boxed and remembered as a whole from then on, so that a minor collection
+        // while the rest are boxed updates the ones that are
+        bool int32 = kind == packedInt32;
+        size_t length = int32 ? int32Elements.size() : doubleElements.size();
+        kind = packedGeneric;
+        genericElements.reserve(length);
+        for (size_t i = 0; i < length; i++) {
+            genericElements.push_back(int32 ? new Number(int32Elements[i]) : new Number(doubleElements[i]));
+            if (i == 0) {
+                Heap::remember(this, 0, length);
+            }
+        }
+    }
+    std::vector<int>().swap(int32Elements);
+    if (target == packedGeneric) {
+        std::vector<double>().swap(doubleElements);
+    }
+    kind = target;
+}
+
+ESArray::ESArray(ESValue* const* elements, size_t length) {
+    kind = packedInt32;
+    sparseLength = 0;
+    for (size_t i = 0; i < length; i++) {
+        transitionTo(kindOf(elements[i]));
+    }
+    if (kind == packedGeneric) {
+        genericElements.assign(elements, elements + length);
+        elementsBarrier(0, length);
+    } else if (kind == packedDouble) {
+        doubleElements.reserve(length);
+        for (size_t i = 0; i < length; i++) {
+            doubleElements.push_back(dynamic_cast<Number*>(elements[i])->getValue());
+        }
+    } else {
+        int32Elements.reserve(length);
+        for (size_t i = 0; i < length; i++) {
+            int32Elements.push_back((int)dynamic_cast<Number*>(elements[i])->getValue());
+        }
+    }
+}
+
+ESValue* ESArray::getElement(size_t index) {
+    if (index >= getLength()) {
+        ESValue* element = index < sparseLength ? findOwnProperty(std::to_string(index).c_str()) : NULL;
+        return element != NULL ? element : new Undefined();
+    }
+    switch (kind) {
+        case packedInt32:
+            return new Number(int32Elements[index]);
+        case packedDouble:
+            return new Number(doubleElements[index]);
+        default:
+            return genericElements[index];
+    }
+}
+
+ESValue* ESArray::setElement(size_t index, ESValue* value) {
+    size_t length = getLength();
+    // once sparse the contiguous elements stop growing, so that none of them is a property as well
+    if (index >= length && (sparseLength > 0 || index - length > MAX_GAP)) {
+        sparseLength = std::max(sparseLength, index + 1);
+        return ESObject::set(new String(std::to_string(index)), value);
+    }
+    if (index > length) {
+        transitionTo(packedGeneric);
+        ESValue* hole = new Undefined();
+        genericElements.resize(index, hole);
+        elementsBarrier(length, index);
+        length = index;
+    }
+    transitionTo(kindOf(value));
+
+    switch (kind) {
+        case packedInt32: {
+            int element = (int)dynamic_cast<Number*>(value)->getValue();
+            if (index == length) {
+                int32Elements.push_back(element);
+            } else {
+                int32Elements[index] = element;
+            }
+            break;
+        }
+        case packedDouble: {
+            double element = dynamic_cast<Number*>(value)->getValue();
+            if (index == length) {
+                doubleElements.push_back(element);
+            } else {
+                doubleElements[index] = element;
+            }
+            break;
+        }
+        default: {
+            ESValue* previous = NULL;
+            if (index == length) {
+                genericElements.push_back(value);
+            } else {
+                previous = genericElements[index];
+                genericElements[index] = value;
+            }
+            // an element that held a young value is remembered already
+            if (!Heap::isYoung(value) || !Heap::isYoung(previous)) {
+                elementsBarrier(index, index + 1);
+            }
+        }
+    }
+    return value;
+}
+
+ESValue* ESArray::get(ESValue* key_ref) {
+    size_t index;
+    if (toIndex(key_ref, &index)) {
+        return getElement(index);
+    }
+    if (key_ref->getType() == string_ && dynamic_cast<String*>(key_ref)->getValue() == "length") {
+        return new Number(sparseLength > 0 ? sparseLength : getLength());
+    }
+    return ESObject::get(key_ref);
+}
+
+ESValue* ESArray::set(ESValue* key_ref, ESValue* value) {
+    size_t index;
+    if (toIndex(key_ref, &index)) {
+        return setElement(index, value);
+    }
+    return ESObject::set(key_ref, value);
+}
+
+void ESArray::visitReferences(Heap::ReferenceVisitor& visitor) {
+    ESObject::visitReferences(visitor);
+    visitor.visitElements(this);
+}
+
+String* ESArray::toString() {
+    // the longest String V8 makes, the join of a longer sparse array is a RangeError there
+    static const size_t MAX_STRING_LENGTH = (1u << 29) - 24;
+    std::string result;
+    size_t length = sparseLength > 0 ? sparseLength : getLength();
+    if (length > MAX_STRING_LENGTH) {
+        throw std::length_error("Invalid string length");
+    }
+    for (size_t i = 0; i < length; i++) {
+        if (i > 0) {
+            result += ",";
+        }
+        ESValue* element = getElement(i);
+        if (element->getType() != undefined && element->getType() != null) {
+            result += element->toString()->getValue();
+        }
+    }
+    return new String(result);
+}
+
+ArrayBuffer::ArrayBuffer(size_t byteLength) {
+    this->byteLength = byteLength;
+    size_t allocation = (byteLength + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    void* block = NULL;
+    if (posix_memalign(&block, ALIGNMENT, allocation > 0 ? allocation : ALIGNMENT) != 0) {
+        fprintf(stderr, "ArrayBuffer: failed to allocate %lu bytes\n", (unsigned long)byteLength);
+        abort();
+    }
+    memset(block, 0, allocation > 0 ? allocation : ALIGNMENT);
+    data = (unsigned char*)block;
+}
+
+ArrayBuffer::~ArrayBuffer() {
+    free(data);
+}
+
+ESValue* ArrayBuffer::get(ESValue* key_ref) {
+    if (key_ref->getType() == string_ && dynamic_cast<String*>(key_ref)->getValue() == "byteLength") {
+        return new Number(byteLength);
+    }
+    return ESObject::get(key_ref);
+}
+
+ESValue* TypedArray::get(ESValue* key_ref) {
+    if (key_ref->getType() == number) {
+        double index = dynamic_cast<Number*>(key_ref)->getValue();
+        if (index >= 0 && index < length && index == (double)(size_t)index) {
+            return new Number(getNumber((size_t)index));
+        }
+        return new Undefined();
+    }
+    if (key_ref->getType() == string_ && dynamic_cast<String*>(key_ref)->getValue() == "length") {
+        return new Number(length);
+    }
+    return ESObject::get(key_ref);
+}
+
+ESValue* TypedArray::set(ESValue* key_ref, ESValue* value) {
+    if (key_ref->getType() == number) {
+        double index = dynamic_cast<Number*>(key_ref)->getValue();
+        if (index >= 0 && index < length && index == (double)(size_t)index && value->getType() == number) {
+            setNumber((size_t)index, dynamic_cast<Number*>(value)->getValue());
+        }
+        return value;
+    }
+    return ESObject::set(key_ref, value);
+}
+
+void TypedArray::visitReferences(Heap::ReferenceVisitor& visitor) {
+    ESObject::visitReferences(visitor);
+    visitor.visit((ESValue**)&buffer);
+}
+
+String* TypedArray::toString() {
+    std::string result;
+    for (size_t i = 0; i < length; i++) {
+        if (i > 0) {
+            result += ",";
+        }
+        Number element(getNumber(i));
+        result += element.toString()->getValue();
+    }
+    return new String(result);
+}
+
+ESValue* TypeOps::toPrimitive(ESValue* input) {
+    if (input->isPrimitive()) {
+        Undefined* undefinedVal = dynamic_cast<Undefined*>(input);
+        if (undefinedVal != NULL) {
+            return undefinedVal;
+        }
+
+        Null* nullVal = dynamic_cast<Null*>(input);
+        if (nullVal != NULL) {
+            return nullVal;
+        }
+
+        String* stringVal = dynamic_cast<String*>(input);
+        if (stringVal != NULL) {
+            return stringVal;
+        }
+
+        Number* numberVal = dynamic_cast<Number*>(input);
+        if (numberVal != NULL) {
+            return numberVal;
+        }
+
+        Boolean* booleanVal = dynamic_cast<Boolean*>(input);
+        if (booleanVal != NULL) {
+            return booleanVal;
+        }
+    } else if (input->getType() == object) {
+        //TODO: implement this correctly
+        return new String("object[Object]");
+    }
+    return new Undefined();
+}
+
+Boolean TypeOps::toBoolean(ESValue* argument) {
+    switch (argument->getType()) {
+        case undefined:
+            return false;
+        case null:
+            return false;
+        case boolean:
+            return static_cast<Boolean*>(argument)->getValue();
+        case number: {
+            // false for +0, -0 and NaN, which is the only value not equal to itself
+            double value = static_cast<Number*>(argument)->getValue();
+            return value != 0 && value == value;
+        }
+        case string_:
+            return !static_cast<String*>(argument)->getValueReference().empty();
+        case symbol:
+            return true;
+        case object:
+            return true;
+        case reference:
+            return false;
+    }
+    return false;
+}
+
+Number* TypeOps::toNumber(ESValue* argument) {
+    switch (argument->getType()) {
+        case undefined:
+            return new NaN();
+        case null:
+            return new Number(0);
+        case boolean:
+            if (dynamic_cast<Boolean*>(argument)->getValue()) {
+                return new Number(1);
+            }
+            return new Number(0);
+        case number:
+            return dynamic_cast<Number*>(argument);
+        case string_: {
+            // 7.1.3.1 ToNumber Applied to the String Type
+            double value = NumberConversion::stringToNumber(dynamic_cast<String*>(argument)->getValue());
+            if (value != value) {
+                return new NaN();
+            }
+            return new Number(value);
+        }
+        case symbol:
+            // TODO: Throw a TypeError exception.
+            return new NaN();
+        case object:
+            return toNumber(toPrimitive(argument));
+        case reference:
+            return NULL;
+    }
+    return NULL;
+}
+
+String* TypeOps::toString(ESValue* argument) {
+    switch (argument->getType()) {
+        case undefined:
+            return new String("undefined");
+        case null:
+            return new String("null");
+        case boolean:
+            if (dynamic_cast<Boolean*>(argument)->getValue()) {
+                return new String("true");
+            }
+            return new String("false");
+
+        case string_:
+            return dynamic_cast<String*>(argument);
+        case symbol:
+            // TODO: Throw a TypeError exception.
+            return new String("Undefined");
+        case object:
+            return toString(toPrimitive(argument));
+        case reference:
+            return NULL;
+        case number:
+            // 7.1.12.1 ToString Applied to the Number Type
+            return dynamic_cast<Number*>(argument)->toString();
+    }
+    return NULL;
+}
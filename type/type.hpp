@@ -1,10 +1,15 @@
 #pragma once
 #include <map>
-#include <sstream>
+#include <vector>
+#include <string>
+#include <utility>
+#include <limits>
+#include <cmath>
 
 #include <stdio.h>
 #include <stdlib.h>
-#include <cstdio>
+
+#include "heap.hpp"
 
 
 /**
@@ -30,8 +35,22 @@ enum NumberType {
 
 class String;
 
+/**
+ * Values are allocated in the old generation of the heap unless their class says otherwise, and are freed by its
+ * collections, which run their destructors
+ */
 class ESValue {
 public:
+    static void* operator new(size_t size) {
+        return Heap::allocateOld(size);
+    }
+
+    static void operator delete(void* value) {
+        Heap::freeOld(value);
+    }
+
+    virtual ~ESValue() {}
+
     virtual Type getType() = 0;
     virtual bool isPrimitive() = 0;
     /**
@@ -39,6 +58,11 @@ public:
      * The abstract operation ToString converts argument to a value of type String
      */
     virtual String* toString() = 0;
+
+    /**
+     * Visits every slot that holds another value, which the collections trace and update through
+     */
+    virtual void visitReferences(Heap::ReferenceVisitor& visitor) {}
 };
 
 template <class T>
@@ -56,9 +80,7 @@ class String : public Primitive<std::string> {
 private:
     std::string value;
 public:
-    String(std::string value) {
-        this->value = value;
-    }
+    String(std::string value) : value(std::move(value)) {}
 
     String() {
         this->value = std::string();
@@ -72,6 +94,13 @@ public:
         return value;
     }
 
+    /**
+     * The characters themselves, for readers that do not need a copy
+     */
+    const std::string& getValueReference() {
+        return value;
+    }
+
     void setValue(std::string value) {
         this->value = value;
     }
@@ -89,7 +118,7 @@ public:
 /**
  * For now Undefined just has a value of 0
  */
-class Undefined : public Primitive<Type > {
+class Undefined : public NurseryAllocated<Primitive<Type> > {
 public:
     Undefined() {}
 
@@ -113,7 +142,7 @@ public:
 /**
  * For now, Null also has a value of 0
  */
-class Null : public Primitive<Type> {
+class Null : public NurseryAllocated<Primitive<Type> > {
 public:
     Null() {}
 
@@ -134,7 +163,7 @@ public:
     }
 };
 
-class Boolean : public Primitive<bool> {
+class Boolean : public NurseryAllocated<Primitive<bool> > {
 private:
     bool value;
 public:
@@ -155,7 +184,7 @@ public:
     }
 
     String* toString() {
-        return new String("null");
+        return new String(value ? "true" : "false");
     }
 
 };
@@ -176,6 +205,13 @@ public:
         return value;
     }
 
+    /**
+     * The characters themselves, for readers that do not need a copy
+     */
+    const std::string& getValueReference() {
+        return value;
+    }
+
     void setValue(std::string value) {
         this->value = value;
     }
@@ -189,7 +225,7 @@ public:
  * http://www.ecma-international.org/ecma-262/6.0/#sec-properties-of-the-number-constructor
  * TODO: implement the methods
  */
-class Number : public Primitive<double> {
+class Number : public NurseryAllocated<Primitive<double> > {
 private:
     double value;
 public:
@@ -213,29 +249,29 @@ public:
         this->value = value;
     }
 
-    String* toString() {
-        std::ostringstream strs;
-        strs << value;
-        return new String(strs.str());
-    }
+    String* toString();
 
-    Boolean* isNan() {
-        return new Boolean(false);
+    virtual Boolean* isNan() {
+        return new Boolean(value != value);
     }
 
-    Boolean* isFinite() {
-        return new Boolean(true);
+    virtual Boolean* isFinite() {
+        return new Boolean(std::isfinite(value));
     }
 
     // isInfinity is a non-standard method, but I want it
     // in the ops for the runtime - harry
-    Boolean* isInfinity() {
-        return new Boolean(false);
+    virtual Boolean* isInfinity() {
+        return new Boolean(std::isinf(value));
     }
 
 };
 
 class NaN : public Number {
+public:
+    NaN() : Number(std::numeric_limits<double>::quiet_NaN()) {}
+
+private:
     Boolean* isNan() {
         return new Boolean(true);
     }
@@ -250,8 +286,12 @@ class NaN : public Number {
 };
 
 class PosInfinity : public Number {
+public:
+    PosInfinity() : Number(std::numeric_limits<double>::infinity()) {}
+
+private:
     Boolean* isNan() {
-        return new Boolean(true);
+        return new Boolean(false);
     }
 
     Boolean* isFinite() {
@@ -263,8 +303,12 @@ class PosInfinity : public Number {
     }
 };
 class NegInfinity : public Number {
+public:
+    NegInfinity() : Number(-std::numeric_limits<double>::infinity()) {}
+
+private:
     Boolean* isNan() {
-        return new Boolean(true);
+        return new Boolean(false);
     }
 
     Boolean* isFinite() {
@@ -292,53 +336,500 @@ class ESObject : public Object {
 private:
     std::map<std::string, ESValue*> properties;
     ESObject* prototype;
+    // one past its position in the remembered set of the heap, which holds the objects that may refer to young
+    // values, or 0 when it is not in it, and whether all of its slots are in it
+    size_t rememberedAt;
+    bool rememberedWhole;
+    // not allocated in the heap, static or on the stack, and so a root of its collections
+    bool root;
+
+    friend class Heap;
+
+    void registerRoot() {
+        rememberedAt = 0;
+        rememberedWhole = false;
+        root = !Heap::isOld(this);
+        if (root) {
+            Heap::addRoot(this);
+        }
+    }
+
+protected:
+    /**
+     * Remembers this object the first time a young value is stored in it, so that the next minor collection
+     * updates all of its slots, and shades the value while a major collection is marking. Called after every store
+     * of a value into the object.
+     */
+    void writeBarrier(ESValue* value) {
+        if (Heap::isYoung(value)) {
+            if (!rememberedWhole) {
+                Heap::remember(this);
+            }
+        } else {
+            Heap::barrier(value);
+        }
+    }
+
+    /**
+     * The write barrier of a store into a slot that stays where it is, which remembers only the slot. A slot that
+     * held a young value before is remembered already.
+     */
+    void writeBarrier(ESValue** slot, ESValue* previous) {
+        if (Heap::isYoung(*slot)) {
+            if (!rememberedWhole && !Heap::isYoung(previous)) {
+                Heap::remember(this, slot);
+            }
+        } else {
+            Heap::barrier(*slot);
+        }
+    }
 
 public:
     ESObject() {
-        properties.clear();
+        prototype = NULL;
+        registerRoot();
     }
 
     ESObject(ESObject* prototype) {
         this->prototype = prototype;
+        Heap::barrier(prototype);
+        registerRoot();
     }
 
-    ESValue* get(ESValue* key_ref) {
-        String* key = key_ref->toString();
-        std::map<std::string, ESValue*>::iterator it = properties.find(key->getValue());
-        if (it != properties.end()) {
-            return properties[key->getValue()];
+    ESObject(const ESObject& other) : Object(other), properties(other.properties) {
+        prototype = other.prototype;
+        registerRoot();
+        for (std::map<std::string, ESValue*>::iterator it = properties.begin(); it != properties.end(); ++it) {
+            writeBarrier(it->second);
         }
-        fprintf(stderr, "ya blew it!\n");
-        return new Undefined();
     }
 
-    ESValue* set(ESValue* key_ref, ESValue* value) {
-        String* key = key_ref->toString();
-        properties[key->getValue()] = value;
-        return value;
+    ~ESObject() {
+        if (root) {
+            Heap::removeRoot(this);
+        }
+        if (rememberedAt != 0) {
+            Heap::forget(this);
+        }
+    }
+
+    ESObject* getPrototype() {
+        return prototype;
     }
 
+    virtual ESValue* get(ESValue* key_ref);
+
+    virtual ESValue* set(ESValue* key_ref, ESValue* value);
+
+    /**
+     * 7.3.11 HasOwnProperty (O, P)
+     * http://www.ecma-international.org/ecma-262/6.0/#sec-hasownproperty
+     */
+    bool hasOwnProperty(ESValue* key_ref);
+
+    /**
+     * The own property key of the property map, or NULL, without a String for the key
+     */
+    ESValue* findOwnProperty(const char* key);
+
+    /**
+     * Visits the prototype and the properties, through Heap::ReferenceVisitor::visitProperties. Subclasses that hold
+     * values elsewhere visit those too.
+     */
+    void visitReferences(Heap::ReferenceVisitor& visitor);
+
+    /**
+     * Visits the slots of at most limit properties in the order of their keys, from the first one or the one after
+     * the key *after. The key of the last one visited is stored in *last unless it is NULL. Returns whether any
+     * properties are left.
+     */
+    bool visitProperties(Heap::ReferenceVisitor& visitor, const std::string* after, size_t limit, std::string* last);
 
     String* toString() {
         return new String();
     }
 };
 
+/**
+ * Elements kinds of an ESArray, from most to least specialised. An array only ever moves down this list.
+ */
+enum ElementsKind {
+    packedInt32,
+    packedDouble,
+    packedGeneric
+};
+
+/**
+ * 9.4.2 Array Exotic Objects
+ * http://www.ecma-international.org/ecma-262/6.0/#sec-array-exotic-objects
+ * Elements live in one contiguous buffer instead of the property map. While every element is an int32 or a
+ * double they are stored unboxed; storing anything else transitions the array to generic ESValue* elements.
+ * An element stored more than MAX_GAP past the end makes the array sparse: it and every element stored past the
+ * contiguous ones from then on are properties keyed by their index, which only get, set and toString see, the
+ * bulk built-ins read the contiguous elements.
+ */
+class ESArray : public ESObject {
+private:
+    ElementsKind kind;
+    std::vector<int> int32Elements;
+    std::vector<double> doubleElements;
+    std::vector<ESValue*> genericElements;
+    // the length of a sparse array, 0 while all of its elements are contiguous
+    size_t sparseLength;
+
+    /**
+     * -0 is not one: the int32 elements would store it as +0
+     */
+    static bool isInt32(double value) {
+        return value >= -2147483648.0 && value <= 2147483647.0 && value == (double)(int)value
+            && !(value == 0 && std::signbit(value));
+    }
+
+    /**
+     * Returns the narrowest kind that can hold value without boxing it
+     */
+    static ElementsKind kindOf(ESValue* value) {
+        if (value->getType() != number) {
+            return packedGeneric;
+        }
+        return isInt32(dynamic_cast<Number*>(value)->getValue()) ? packedInt32 : packedDouble;
+    }
+
+    static const size_t MAX_INDEX = 4294967294u;
+
+    // the most holes a store past the end fills, beyond it the element is a property
+    static const size_t MAX_GAP = 1024;
+
+    /**
+     * 9.4.2 array index: canonical numeric String keys and integral Numbers from 0 to MAX_INDEX (2^32 - 2) address
+     * elements, everything else, larger integers included, is a property
+     */
+    static bool toIndex(ESValue* key_ref, size_t* index);
+
+    void transitionTo(ElementsKind target);
+
+public:
+    ESArray() {
+        kind = packedInt32;
+        sparseLength = 0;
+    }
+
+    /**
+     * Bulk initialisers used by array literals, the elements are copied in one go
+     */
+    ESArray(const int* elements, size_t length) : int32Elements(elements, elements + length) {
+        kind = packedInt32;
+        sparseLength = 0;
+    }
+
+    ESArray(const double* elements, size_t length) : doubleElements(elements, elements + length) {
+        kind = packedDouble;
+        sparseLength = 0;
+    }
+
+    ESArray(ESValue* const* elements, size_t length);
+
+    ElementsKind getElementsKind() {
+        return kind;
+    }
+
+    /**
+     * The number of contiguous elements, which is the length of the array unless it is sparse
+     */
+    size_t getLength() {
+        switch (kind) {
+            case packedInt32:
+                return int32Elements.size();
+            case packedDouble:
+                return doubleElements.size();
+            default:
+                return genericElements.size();
+        }
+    }
+
+    /**
+     * Raw element storage for the bulk built-ins, only the one matching getElementsKind() is populated
+     */
+    int* getInt32Elements() {
+        return int32Elements.data();
+    }
+
+    double* getDoubleElements() {
+        return doubleElements.data();
+    }
+
+    ESValue** getGenericElements() {
+        return genericElements.data();
+    }
+
+    /**
+     * The write barrier of a store into the generic elements from begin up to end, which remembers them as one range
+     * if any of them is young, by index since the elements move as the array grows
+     */
+    void elementsBarrier(size_t begin, size_t end) {
+        bool young = false;
+        for (size_t i = begin; i < end; i++) {
+            if (Heap::isYoung(genericElements[i])) {
+                young = true;
+            } else {
+                Heap::barrier(genericElements[i]);
+            }
+        }
+        if (young) {
+            Heap::remember(this, begin, end);
+        }
+    }
+
+    /**
+     * Unboxed elements are boxed on read, reads past the end are undefined
+     */
+    ESValue* getElement(size_t index);
+
+    /**
+     * Writing past the end fills the gap with undefined, which makes the elements generic, or makes the array sparse
+     * when the gap is longer than MAX_GAP
+     */
+    ESValue* setElement(size_t index, ESValue* value);
+
+    ESValue* get(ESValue* key_ref);
+
+    ESValue* set(ESValue* key_ref, ESValue* value);
+
+    void visitReferences(Heap::ReferenceVisitor& visitor);
+
+    /**
+     * 22.1.3.27 Array.prototype.toString ( ), which is join with ","
+     */
+    String* toString();
+};
+
+/**
+ * 24.1 ArrayBuffer Objects
+ * http://www.ecma-international.org/ecma-262/6.0/#sec-arraybuffer-objects
+ * The data block is zero filled raw memory, aligned to a cache line and padded to a multiple of it, so typed
+ * arrays over it can be loaded and stored natively.
+ */
+class ArrayBuffer : public ESObject {
+private:
+    unsigned char* data;
+    size_t byteLength;
+
+public:
+    static const size_t ALIGNMENT = 64;
+
+    ArrayBuffer(size_t byteLength);
+
+    ~ArrayBuffer();
+
+    unsigned char* getData() {
+        return data;
+    }
+
+    size_t getByteLength() {
+        return byteLength;
+    }
+
+    ESValue* get(ESValue* key_ref);
+};
+
+enum TypedArrayType {
+    uint8Array,
+    int32Array,
+    float64Array
+};
+
+/**
+ * 22.2 TypedArray Objects
+ * http://www.ecma-international.org/ecma-262/6.0/#sec-typedarray-objects
+ * A typed array is a view of length elements starting at byteOffset in an ArrayBuffer. Compiled element access
+ * switches on getTypedArrayType() and loads or stores the element natively (see Core::getElement), the virtual
+ * getNumber/setNumber are only for the generic paths.
+ */
+class TypedArray : public ESObject {
+protected:
+    ArrayBuffer* buffer;
+    size_t byteOffset;
+    size_t length;
+    TypedArrayType type;
+
+    TypedArray(TypedArrayType type, ArrayBuffer* buffer, size_t byteOffset, size_t length) {
+        this->type = type;
+        this->buffer = buffer;
+        this->byteOffset = byteOffset;
+        this->length = length;
+        Heap::barrier(buffer);
+    }
+
+public:
+    TypedArrayType getTypedArrayType() {
+        return type;
+    }
+
+    ArrayBuffer* getBuffer() {
+        return buffer;
+    }
+
+    size_t getByteOffset() {
+        return byteOffset;
+    }
+
+    size_t getLength() {
+        return length;
+    }
+
+    void* getData() {
+        return buffer->getData() + byteOffset;
+    }
+
+    virtual size_t getElementSize() = 0;
+    virtual double getNumber(size_t index) = 0;
+    virtual void setNumber(size_t index, double value) = 0;
+
+    /**
+     * 9.4.5.4 [[Get]], reads outside the view or at non integral indices are undefined
+     */
+    ESValue* get(ESValue* key_ref);
+
+    /**
+     * 9.4.5.5 [[Set]], writes outside the view are dropped
+     */
+    ESValue* set(ESValue* key_ref, ESValue* value);
+
+    void visitReferences(Heap::ReferenceVisitor& visitor);
+
+    String* toString();
+};
+
+template <class T, TypedArrayType TYPE>
+class TypedArrayOf : public TypedArray {
+public:
+    typedef T ElementType;
+
+    TypedArrayOf(size_t length) : TypedArray(TYPE, new ArrayBuffer(length * sizeof(T)), 0, length) {}
+
+    TypedArrayOf(ArrayBuffer* buffer, size_t byteOffset, size_t length) : TypedArray(TYPE, buffer, byteOffset, length) {}
+
+    /**
+     * 7.1.5 ToInt32 and 7.1.10 ToUint8 for the integer element types: NaN and infinities become 0,
+     * everything else is truncated and wrapped modulo 2^bits. Float64 elements are stored as is.
+     */
+    static T toElement(double value) {
+        if (!std::numeric_limits<T>::is_integer) {
+            return (T)value;
+        }
+        if (value != value || value == std::numeric_limits<double>::infinity()
+            || value == -std::numeric_limits<double>::infinity()) {
+            return 0;
+        }
+        double range = ldexp(1.0, sizeof(T) * 8);
+        double modulo = fmod(value < 0 ? ceil(value) : floor(value), range);
+        if (modulo < 0) {
+            modulo += range;
+        }
+        return (T)(unsigned long long)modulo;
+    }
+
+    T* getElements() {
+        return (T*)getData();
+    }
+
+    size_t getElementSize() {
+        return sizeof(T);
+    }
+
+    double getNumber(size_t index) {
+        return getElements()[index];
+    }
+
+    void setNumber(size_t index, double value) {
+        getElements()[index] = toElement(value);
+    }
+};
+
+class Uint8Array : public TypedArrayOf<unsigned char, uint8Array> {
+public:
+    Uint8Array(size_t length) : TypedArrayOf<unsigned char, uint8Array>(length) {}
+    Uint8Array(ArrayBuffer* buffer, size_t byteOffset, size_t length)
+        : TypedArrayOf<unsigned char, uint8Array>(buffer, byteOffset, length) {}
+};
+
+class Int32Array : public TypedArrayOf<int, int32Array> {
+public:
+    Int32Array(size_t length) : TypedArrayOf<int, int32Array>(length) {}
+    Int32Array(ArrayBuffer* buffer, size_t byteOffset, size_t length)
+        : TypedArrayOf<int, int32Array>(buffer, byteOffset, length) {}
+};
+
+class Float64Array : public TypedArrayOf<double, float64Array> {
+public:
+    Float64Array(size_t length) : TypedArrayOf<double, float64Array>(length) {}
+    Float64Array(ArrayBuffer* buffer, size_t byteOffset, size_t length)
+        : TypedArrayOf<double, float64Array>(buffer, byteOffset, length) {}
+};
+
 class StringObject : public Object {
 private:
     String* string;
 public:
     StringObject() {
         string = new String();
+        Heap::barrier(string);
     }
 
     StringObject(String* string) {
         this->string = string;
+        Heap::barrier(string);
+    }
+
+    void visitReferences(Heap::ReferenceVisitor& visitor) {
+        visitor.visit((ESValue**)&string);
     }
 };
 
+/**
+ * 9.2 ECMAScript Function Objects
+ * http://www.ecma-international.org/ecma-262/6.0/#sec-ecmascript-function-objects
+ * A function declared by a script is compiled to a C++ function taking its arguments as an array, the object holds
+ * it with the name and number of parameters. The built-in constructors are functions without code, they are
+ * resolved by name in Core::construct. Built-in functions that hold values of their own, such as the resolving
+ * functions of a Promise, override call.
+ */
 class Function : public ESObject {
+public:
+    typedef ESValue* (*Code)(ESValue** arguments, int argumentCount);
+
+private:
+    Code code;
+    const char* name;
+    int length;
 
+public:
+    Function() : code(NULL), name(""), length(0) {}
+
+    Function(Code code, const char* name, int length) : code(code), name(name), length(length) {}
+
+    Code getCode() {
+        return code;
+    }
+
+    const char* getName() {
+        return name;
+    }
+
+    int getLength() {
+        return length;
+    }
+
+    virtual bool isCallable() {
+        return code != NULL;
+    }
+
+    /**
+     * 9.2.1 [[Call]] ( thisArgument, argumentsList ), with the arguments already evaluated
+     */
+    virtual ESValue* call(ESValue** arguments, int argumentCount) {
+        return code(arguments, argumentCount);
+    }
 };
 
 /**
@@ -359,38 +850,7 @@ public:
      * converting to more than one primitive type, it may use the optional hint PreferredType to favour that type.
      * TODO: add the optional preferred type hint overload
      */
-    static ESValue* toPrimitive(ESValue* input) {
-        if (input->isPrimitive()) {
-            Undefined* undefinedVal = dynamic_cast<Undefined*>(input);
-            if (undefinedVal != NULL) {
-                return undefinedVal;
-            }
-
-            Null* nullVal = dynamic_cast<Null*>(input);
-            if (nullVal != NULL) {
-                return nullVal;
-            }
-
-            String* stringVal = dynamic_cast<String*>(input);
-            if (stringVal != NULL) {
-                return stringVal;
-            }
-
-            Number* numberVal = dynamic_cast<Number*>(input);
-            if (numberVal != NULL) {
-                return numberVal;
-            }
-
-            Boolean* booleanVal = dynamic_cast<Boolean*>(input);
-            if (booleanVal != NULL) {
-                return booleanVal;
-            }
-        } else if (input->getType() == object) {
-            //TODO: implement this correctly
-            return new String("object[Object]");
-        }
-        return new Undefined();
-    }
+    static ESValue* toPrimitive(ESValue* input);
 
 
     /**
@@ -398,59 +858,14 @@ public:
      * http://www.ecma-international.org/ecma-262/6.0/#sec-toboolean
      * The abstract operation ToBoolean converts argument to a value of type Boolean.
      */
-    static Boolean toBoolean(ESValue* argument) {
-        switch (argument->getType()) {
-            case undefined:
-                return false;
-            case null:
-                return false;
-            case boolean:
-                return argument;
-            case number:
-                // TODO: Return false if argument is +0, −0, or NaN; otherwise return true.
-                return true;
-            case string_:
-                // TODO: Return false if argument is the empty String (its length is zero); otherwise return true.
-                return true;
-            case symbol:
-                return true;
-            case object:
-                return true;
-            case reference:
-                return false;
-        }
-    }
+    static Boolean toBoolean(ESValue* argument);
 
     /**
      * 7.1.3 ToNumber ( argument )
      * http://www.ecma-international.org/ecma-262/6.0/#sec-tonumber
      * The abstract operation ToNumber converts argument to a value of type Number
      */
-    static Number* toNumber(ESValue* argument) {
-        switch (argument->getType()) {
-            case undefined:
-                return new NaN();
-            case null:
-                return new Number(0);
-            case boolean:
-                if (dynamic_cast<Boolean*>(argument)->getValue()) {
-                    return new Number(1);
-                }
-                return new Number(0);
-            case number:
-                return dynamic_cast<Number*>(argument);
-            case string_:
-                // TODO: 7.1.3.1 ToNumber Applied to the String Type
-                return new NaN();
-            case symbol:
-                // TODO: Throw a TypeError exception.
-                return new NaN();
-            case object:
-                return toNumber(toPrimitive(argument));
-            case reference:
-                return NULL;
-        }
-    }
+    static Number* toNumber(ESValue* argument);
 
     
     /**
@@ -458,43 +873,7 @@ public:
      * http://www.ecma-international.org/ecma-262/6.0/#sec-tostring
      * The abstract operation ToNumber converts argument to a value of type Number
      */
-    static String* toString(ESValue* argument) {
-        switch (argument->getType()) {
-            case undefined:
-                return new String("Undefined");
-            case null:
-                return new String("null");
-            case boolean:
-                if (dynamic_cast<Boolean*>(argument)->getValue()) {
-                    return new String("true");
-                }
-                return new String("false");
-
-            case string_:
-                return toString(toPrimitive(argument));
-            case symbol:
-                // TODO: Throw a TypeError exception.
-                return new String("Undefined");
-            case object:
-                return toString(toPrimitive(argument));
-            case reference:
-                return NULL;
-            case number:
-                /*
-                 * 7.1.12.1 ToString Applied to the Number Type
-                 * TODO: implement this properly.
-                 */ 
-                Number *num = dynamic_cast<Number*>(argument);
-                if(num->isInfinity()) {
-                    return new String("Infinity");
-                }
-                if(num->isNan()) {
-                    return new String("NaN");
-                } else {
-                    return num->toString();
-                }
-        }
-    }
+    static String* toString(ESValue* argument);
 
     
 };
\ No newline at end of file
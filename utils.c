@@ -8,17 +8,169 @@
 #include <stdlib.h>
 
 
+int parseErrors = 0;
+
 void yyerror(const char *s) {
+    parseErrors++;
     fprintf(stderr, "Parse Error:\n%s\n", s);
 }
 
-char* dynamic_strcat(char* str, char* s2) {
-    int len;
-    char *s;
-    if (str != NULL)
-        len = strlen(str);
-    len += strlen(s2) + 1 * sizeof(*s2);
-    s = (char*) realloc(str, len);
-    strcat(s, s2);
-    return s;
+static void token_buffer_reserve(struct TokenBuffer* buffer, size_t extra) {
+    if (buffer->length + extra + 1 <= buffer->capacity) {
+        return;
+    }
+    size_t capacity = buffer->capacity > 0 ? buffer->capacity : 256;
+    while (capacity < buffer->length + extra + 1) {
+        capacity *= 2;
+    }
+    buffer->data = (char*) realloc(buffer->data, capacity);
+    buffer->capacity = capacity;
+}
+
+void token_buffer_start(struct TokenBuffer* buffer) {
+    token_buffer_reserve(buffer, 1);
+    buffer->length = 0;
+    buffer->leadSurrogate = 0;
+    buffer->data[buffer->length++] = '"';
+}
+
+/* A character of the string value, written the way a C string literal spells it */
+static void token_buffer_put(struct TokenBuffer* buffer, unsigned char c) {
+    char* out = buffer->data + buffer->length;
+    switch (c) {
+        case '"': out[0] = '\\'; out[1] = '"'; buffer->length += 2; return;
+        case '\\': out[0] = '\\'; out[1] = '\\'; buffer->length += 2; return;
+        case '\n': out[0] = '\\'; out[1] = 'n'; buffer->length += 2; return;
+        case '\t': out[0] = '\\'; out[1] = 't'; buffer->length += 2; return;
+        case '\r': out[0] = '\\'; out[1] = 'r'; buffer->length += 2; return;
+    }
+    if (c < 0x20 || c == 0x7f) {
+        // always three octal digits, so a following digit cannot extend the escape
+        out[0] = '\\';
+        out[1] = '0' + (c >> 6);
+        out[2] = '0' + ((c >> 3) & 7);
+        out[3] = '0' + (c & 7);
+        buffer->length += 4;
+        return;
+    }
+    out[0] = c;
+    buffer->length++;
+}
+
+static unsigned long hex_value(const char* text, size_t length) {
+    unsigned long value = 0;
+    for (size_t i = 0; i < length; i++) {
+        char c = text[i];
+        value = value * 16 + (c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10);
+    }
+    return value;
+}
+
+/* UTF-8 of a code point, lone surrogates included as three bytes like any other */
+static void token_buffer_put_code_point(struct TokenBuffer* buffer, unsigned long codePoint) {
+    token_buffer_reserve(buffer, 16);
+    if (codePoint < 0x80) {
+        token_buffer_put(buffer, (unsigned char) codePoint);
+    } else if (codePoint < 0x800) {
+        token_buffer_put(buffer, 0xc0 | (codePoint >> 6));
+        token_buffer_put(buffer, 0x80 | (codePoint & 0x3f));
+    } else if (codePoint < 0x10000) {
+        token_buffer_put(buffer, 0xe0 | (codePoint >> 12));
+        token_buffer_put(buffer, 0x80 | ((codePoint >> 6) & 0x3f));
+        token_buffer_put(buffer, 0x80 | (codePoint & 0x3f));
+    } else {
+        token_buffer_put(buffer, 0xf0 | (codePoint >> 18));
+        token_buffer_put(buffer, 0x80 | ((codePoint >> 12) & 0x3f));
+        token_buffer_put(buffer, 0x80 | ((codePoint >> 6) & 0x3f));
+        token_buffer_put(buffer, 0x80 | (codePoint & 0x3f));
+    }
+}
+
+/* Writes a lead surrogate that no trail surrogate followed, as a lone surrogate */
+static void token_buffer_end_surrogate(struct TokenBuffer* buffer) {
+    if (buffer->leadSurrogate != 0) {
+        token_buffer_put_code_point(buffer, buffer->leadSurrogate);
+        buffer->leadSurrogate = 0;
+    }
+}
+
+/* The code point of an escape. The string value is UTF-16, so a lead surrogate followed by a trail surrogate is one
+ * supplementary code point, 10.1.2 UTF16Decode, and takes four bytes of UTF-8 */
+static void token_buffer_put_escaped(struct TokenBuffer* buffer, unsigned long codePoint) {
+    if (buffer->leadSurrogate != 0 && codePoint >= 0xdc00 && codePoint <= 0xdfff) {
+        codePoint = 0x10000 + ((buffer->leadSurrogate - 0xd800) << 10) + (codePoint - 0xdc00);
+        buffer->leadSurrogate = 0;
+    } else {
+        token_buffer_end_surrogate(buffer);
+        if (codePoint >= 0xd800 && codePoint <= 0xdbff) {
+            buffer->leadSurrogate = codePoint;
+            return;
+        }
+    }
+    token_buffer_put_code_point(buffer, codePoint);
+}
+
+void token_buffer_append(struct TokenBuffer* buffer, const char* text, size_t length) {
+    token_buffer_end_surrogate(buffer);
+    // a character takes at most four bytes escaped
+    token_buffer_reserve(buffer, length * 4);
+    for (size_t i = 0; i < length; i++) {
+        token_buffer_put(buffer, (unsigned char) text[i]);
+    }
+}
+
+/*
+ * 11.8.6.1 Static Semantics: TV and TRV, the value of an escape sequence starting with a backslash: \xHH, \uHHHH,
+ * \u{H...}, a line continuation, which is nothing, or a single character escape. A \x or \u without its digits, a
+ * code point past 10FFFF and a digit other than a lone \0 are not escape sequences, 11.8.6 Template Literal Lexical
+ * Components.
+ */
+int token_buffer_append_escape(struct TokenBuffer* buffer, const char* escape, size_t length) {
+    char c = escape[1];
+    if (c == 'x' || c == 'u') {
+        if (c == 'x' && length == 4) {
+            token_buffer_put_escaped(buffer, hex_value(escape + 2, 2));
+        } else if (c == 'u' && length == 6 && escape[2] != '{') {
+            token_buffer_put_escaped(buffer, hex_value(escape + 2, 4));
+        } else if (c == 'u' && length > 4 && escape[2] == '{') {
+            // leading zeros do not count towards the six digits
+            size_t start = 3;
+            while (start < length - 2 && escape[start] == '0') {
+                start++;
+            }
+            if (length - 1 - start > 6 || hex_value(escape + start, length - 1 - start) > 0x10ffff) {
+                return 0;
+            }
+            token_buffer_put_escaped(buffer, hex_value(escape + start, length - 1 - start));
+        } else {
+            return 0;
+        }
+        return 1;
+    }
+    if ((c >= '1' && c <= '9') || (c == '0' && length > 2)) {
+        return 0;
+    }
+    if (c == '\n' || c == '\r') {
+        return 1;
+    }
+    token_buffer_end_surrogate(buffer);
+    token_buffer_reserve(buffer, 4);
+    switch (c) {
+        case 'n': token_buffer_put(buffer, '\n'); break;
+        case 't': token_buffer_put(buffer, '\t'); break;
+        case 'r': token_buffer_put(buffer, '\r'); break;
+        case 'b': token_buffer_put(buffer, '\b'); break;
+        case 'f': token_buffer_put(buffer, '\f'); break;
+        case 'v': token_buffer_put(buffer, '\v'); break;
+        case '0': token_buffer_put(buffer, '\0'); break;
+        default: token_buffer_put(buffer, (unsigned char) c); break;
+    }
+    return 1;
+}
+
+char* token_buffer_finish(struct TokenBuffer* buffer) {
+    token_buffer_end_surrogate(buffer);
+    token_buffer_reserve(buffer, 1);
+    buffer->data[buffer->length++] = '"';
+    return strndup(buffer->data, buffer->length);
 }
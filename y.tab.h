@@ -6,4 +6,30 @@ int yyparse (void);
 
 void yyerror(const char *s);
 
-char* dynamic_strcat(char* str, char* s2);
+/* How many errors yyerror has reported, the scanner reports some and goes on */
+extern int parseErrors;
+
+#include <stddef.h>
+
+/* A token scanned piece by piece, template literals, kept as the C string literal of its value. The capacity
+ * doubles when it runs out, so scanning a token is linear in its length. */
+struct TokenBuffer {
+    char* data;
+    size_t length;
+    size_t capacity;
+    /* a lead surrogate escape waiting for a trail surrogate escape, or 0 */
+    unsigned long leadSurrogate;
+};
+
+/* Empties the buffer and opens the literal */
+void token_buffer_start(struct TokenBuffer* buffer);
+
+/* Appends characters of the value */
+void token_buffer_append(struct TokenBuffer* buffer, const char* text, size_t length);
+
+/* Appends the value of an escape sequence, backslash included, and returns 0 without appending anything when it
+ * is malformed */
+int token_buffer_append_escape(struct TokenBuffer* buffer, const char* escape, size_t length);
+
+/* Closes the literal and returns a copy of it */
+char* token_buffer_finish(struct TokenBuffer* buffer);